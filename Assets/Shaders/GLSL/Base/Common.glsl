@@ -191,13 +191,9 @@ vec3 F_SchlickR(PBRFactors pbrFactor)
     return pbrFactor.reflectance0 + (max(vec3(1.0 - pbrFactor.alphaRoughness), pbrFactor.reflectance0) - pbrFactor.reflectance0) * pow(1.0 - pbrFactor.VoH, 5.0);
 }
 
-vec3 CalculateNormal(vec3 tangentNormal, vec3 inWorldPos, vec3 inNormal, vec2 inUV)
+// 屏幕空间导数由调用者给出，Visibility Buffer解析时导数来自重心坐标而不是dFdx/dFdy
+vec3 CalculateNormalGrad(vec3 tangentNormal, vec3 inNormal, vec3 q1, vec3 q2, vec2 st1, vec2 st2)
 {
-    vec3 q1 = dFdx(inWorldPos);
-    vec3 q2 = dFdy(inWorldPos);
-    vec2 st1 = dFdx(inUV);
-    vec2 st2 = dFdy(inUV);
-
     vec3 N = normalize(inNormal);
     vec3 T = normalize(q1 * st2.t - q2 * st1.t);
     // vec3 T = normalize(inTangent.xyz);
@@ -207,6 +203,36 @@ vec3 CalculateNormal(vec3 tangentNormal, vec3 inWorldPos, vec3 inNormal, vec2 in
     return normalize(TBN * tangentNormal);
 }
 
+vec3 CalculateNormal(vec3 tangentNormal, vec3 inWorldPos, vec3 inNormal, vec2 inUV)
+{
+    return CalculateNormalGrad(tangentNormal, inNormal, dFdx(inWorldPos), dFdy(inWorldPos), dFdx(inUV), dFdy(inUV));
+}
+
+// 只用XY重建Z，兼容BC5这类只存储两个通道的法线贴图
+vec3 UnpackNormalMap(vec4 texel)
+{
+    vec2 xy = texel.xy * 2.0 - vec2(1.0);
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+
+// 使用顶点切线构建TBN，与glTF约定一致B = cross(N, T) * w，不依赖屏幕空间导数
+vec3 CalculateNormalTangent(vec3 tangentNormal, vec3 inNormal, vec4 inTangent)
+{
+    vec3 N = normalize(inNormal);
+    vec3 T = inTangent.xyz - N * dot(N, inTangent.xyz);
+    // 没有UV或切线时切线为0，normalize会得到NaN，改用由法线构建的任意正交基
+    if (dot(T, T) < 1e-8)
+    {
+        vec3 helper = abs(N.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+        T = cross(helper, N);
+    }
+    T = normalize(T);
+    vec3 B = cross(N, T) * (inTangent.w < 0.0 ? -1.0 : 1.0);
+    mat3 TBN = mat3(T, B, N);
+
+    return normalize(TBN * tangentNormal);
+}
+
 vec3 GetDirectionLight(vec3 lightColor, float lightIntensity, MaterialFactor matFactor, PBRFactors pbrFactor)
 {
     vec3 radiance = lightColor * lightIntensity;
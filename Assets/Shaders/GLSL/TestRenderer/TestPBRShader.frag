@@ -48,7 +48,7 @@ void main()
 {
     ShaderMaterial material = materials[pushConstants.materialIndex];
 
-    vec3 N = (material.normalTextureSet > -1) ? CalculateNormal(texture(samplerNormalMap, inUV0).xyz * 2.0 - vec3(1.0), inWorldPos, inNormal, inUV0) : normalize(inNormal);
+    vec3 N = (material.normalTextureSet > -1) ? CalculateNormal(UnpackNormalMap(texture(samplerNormalMap, inUV0)), inWorldPos, inNormal, inUV0) : normalize(inNormal);
     vec3 V = normalize(inWorldPos - uboScene.camPos);
     vec3 L = normalize(uboParams.lightPos.xyz);
     vec3 H = normalize(L + V);
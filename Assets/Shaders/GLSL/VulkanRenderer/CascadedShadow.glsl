@@ -0,0 +1,50 @@
+// 平行光的级联阴影，与VulkanRenderer.hpp中的UBOShadow一致
+// 定义SHADOW_CASTER时只包含UBO声明，供ShadowMap.vert使用
+
+#define SHADOW_CASCADE_COUNT 4
+
+layout (set = 0, binding = 9) uniform UBOShadow
+{
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+    vec4 splitDepths;
+    vec4 params;    // 是否开启、纹素大小、深度偏移
+} uboShadow;
+
+#ifndef SHADOW_CASTER
+
+layout (set = 0, binding = 8) uniform sampler2DArrayShadow samplerShadowMap;
+
+uint GetCascadeIndex(float viewDepth)
+{
+    uint cascade = 0u;
+    for (uint i = 0u; i < SHADOW_CASCADE_COUNT - 1; i++)
+    {
+        if (viewDepth > uboShadow.splitDepths[i]) cascade = i + 1u;
+    }
+    return cascade;
+}
+
+float GetCascadedShadow(vec3 worldPos, float viewDepth, float NoL)
+{
+    if (uboShadow.params.x == 0.0) return 1.0;
+
+    uint cascade = GetCascadeIndex(viewDepth);
+    vec4 shadowCoord = uboShadow.cascadeViewProj[cascade] * vec4(worldPos, 1.0);
+    shadowCoord.xyz /= shadowCoord.w;
+    vec2 uv = shadowCoord.xy * 0.5 + 0.5;
+    if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))) || shadowCoord.z > 1.0) return 1.0;
+
+    // 掠射角时加大偏移，3x3 PCF
+    float depthRef = shadowCoord.z - uboShadow.params.z * (2.0 - NoL);
+    float shadow = 0.0;
+    for (int x = -1; x <= 1; x++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            shadow += texture(samplerShadowMap, vec4(uv + vec2(x, y) * uboShadow.params.y, float(cascade), depthRef));
+        }
+    }
+    return shadow / 9.0;
+}
+
+#endif
@@ -0,0 +1,124 @@
+// 分簇光照，与VulkanRenderer.hpp中的ShaderLight、UBOCluster一致
+// 定义CLUSTER_CULLING时只包含数据声明，供LightCulling.comp使用
+
+#define MAX_LIGHTS_PER_CLUSTER 128u
+#define CLUSTER_STRIDE (MAX_LIGHTS_PER_CLUSTER + 1u)
+
+#define LIGHT_DIRECTIONAL 0u
+#define LIGHT_POINT 1u
+#define LIGHT_SPOT 2u
+
+struct ShaderLight
+{
+    vec4 posRange;
+    vec4 colorIntensity;
+    vec4 dirType;
+    vec4 spotParams;
+};
+
+// 平行光排在最前面
+layout (std430, set = 0, binding = 5) readonly buffer LightBuffer
+{
+    ShaderLight lights[];
+};
+
+// 每个分簇：光源数量，之后是MAX_LIGHTS_PER_CLUSTER个光源下标
+layout (std430, set = 0, binding = 6) buffer ClusterBuffer
+{
+    uint clusterData[];
+};
+
+layout (set = 0, binding = 7) uniform UBOCluster
+{
+    mat4 invProj;
+    mat4 view;
+    vec4 screenSize;
+    vec4 depthParams;
+    uvec4 gridSize;
+    uvec4 lightCounts;
+} uboCluster;
+
+// 深度按指数划分切片，近处的切片更薄
+uint GetClusterIndex(vec2 fragCoord, float viewDepth)
+{
+    uvec3 grid = uboCluster.gridSize.xyz;
+    uvec2 tile = uvec2(clamp(fragCoord * uboCluster.screenSize.zw, vec2(0.0), vec2(0.99999)) * vec2(grid.xy));
+    int slice = int(floor(log(max(viewDepth, uboCluster.depthParams.x)) * uboCluster.depthParams.z + uboCluster.depthParams.w));
+    uint z = uint(clamp(slice, 0, int(grid.z) - 1));
+    return tile.x + grid.x * (tile.y + grid.y * z);
+}
+
+#ifndef CLUSTER_CULLING
+
+vec3 GetLightRadiance(ShaderLight light, vec3 worldPos, out vec3 L)
+{
+    uint type = uint(light.dirType.w);
+    vec3 radiance = light.colorIntensity.rgb * light.colorIntensity.a;
+    if (type == LIGHT_DIRECTIONAL)
+    {
+        L = -light.dirType.xyz;
+        return radiance;
+    }
+
+    vec3 toLight = light.posRange.xyz - worldPos;
+    float dist2 = max(dot(toLight, toLight), 1e-8);
+    L = toLight * inversesqrt(dist2);
+
+    // KHR_lights_punctual推荐的平滑截断
+    float rangeRatio = dist2 / (light.posRange.w * light.posRange.w);
+    float attenuation = clamp(1.0 - rangeRatio * rangeRatio, 0.0, 1.0) / dist2;
+    if (type == LIGHT_SPOT)
+    {
+        float spot = clamp(dot(light.dirType.xyz, -L) * light.spotParams.x + light.spotParams.y, 0.0, 1.0);
+        attenuation *= spot * spot;
+    }
+    return radiance * attenuation;
+}
+
+// 只重新计算与L相关的项，其余PBR因子与主光源共用
+vec3 ShadeLight(ShaderLight light, vec3 worldPos, vec3 N, vec3 V, MaterialFactor matFactor, PBRFactors pbrFactor)
+{
+    vec3 L;
+    vec3 radiance = GetLightRadiance(light, worldPos, L);
+    float NoL = dot(N, L);
+    if (NoL <= 0.0 || max(radiance.r, max(radiance.g, radiance.b)) <= 0.0) return vec3(0.0);
+
+    vec3 H = normalize(L + V);
+    pbrFactor.NoL = clamp(NoL, 0.001, 1.0);
+    pbrFactor.NoH = clamp(dot(N, H), 0.0, 1.0);
+    pbrFactor.LoH = clamp(dot(L, H), 0.0, 1.0);
+    pbrFactor.VoH = clamp(dot(V, H), 0.0, 1.0);
+    return GetDirectionLight(radiance, 1.0, matFactor, pbrFactor);
+}
+
+vec3 GetPunctualLighting(vec3 worldPos, vec2 fragCoord, vec3 N, vec3 V, MaterialFactor matFactor, PBRFactors pbrFactor)
+{
+    vec3 color = vec3(0.0);
+    uint lightCount = uboCluster.lightCounts.x;
+    uint directionalCount = uboCluster.lightCounts.y;
+    for (uint i = 0u; i < directionalCount; i++)
+    {
+        color += ShadeLight(lights[i], worldPos, N, V, matFactor, pbrFactor);
+    }
+
+    // 关闭分簇时遍历所有光源，用于对比
+    if (uboCluster.lightCounts.z == 0u)
+    {
+        for (uint i = directionalCount; i < lightCount; i++)
+        {
+            color += ShadeLight(lights[i], worldPos, N, V, matFactor, pbrFactor);
+        }
+        return color;
+    }
+
+    float viewDepth = -(uboCluster.view * vec4(worldPos, 1.0)).z;
+    uint offset = GetClusterIndex(fragCoord, viewDepth) * CLUSTER_STRIDE;
+    uint clusterLightCount = min(clusterData[offset], MAX_LIGHTS_PER_CLUSTER);
+    for (uint i = 0u; i < clusterLightCount; i++)
+    {
+        color += ShadeLight(lights[clusterData[offset + 1u + i]], worldPos, N, V, matFactor, pbrFactor);
+    }
+    return color;
+}
+
+#endif
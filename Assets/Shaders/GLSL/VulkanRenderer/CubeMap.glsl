@@ -0,0 +1,20 @@
+// 按Vulkan立方体贴图的面朝向还原采样方向，uv范围是[-1, 1]，结果未归一化
+vec3 GetCubeFaceVector(vec2 uv, uint face)
+{
+    switch (face)
+    {
+        case 0u: return vec3(1.0, -uv.y, -uv.x);
+        case 1u: return vec3(-1.0, -uv.y, uv.x);
+        case 2u: return vec3(uv.x, 1.0, uv.y);
+        case 3u: return vec3(uv.x, -1.0, -uv.y);
+        case 4u: return vec3(uv.x, -uv.y, 1.0);
+        default: return vec3(-uv.x, -uv.y, -1.0);
+    }
+}
+
+// 面上texel中心的采样方向
+vec3 GetCubeDirection(uvec2 texel, uint size, uint face)
+{
+    vec2 uv = (vec2(texel) + 0.5) / float(size) * 2.0 - 1.0;
+    return normalize(GetCubeFaceVector(uv, face));
+}
@@ -0,0 +1,48 @@
+#version 450
+
+layout (location = 0) in vec3 inPos;
+layout (location = 5) in vec4 inJoint;
+layout (location = 6) in vec4 inWeight;
+
+#define MAX_NUM_JOINTS 128
+
+layout (set = 0, binding = 0) uniform UBOScene
+{
+    mat4 projection;
+    mat4 model;
+    mat4 view;
+    vec3 camPos;
+} uboScene;
+
+layout (set = 2, binding = 0) uniform UBONode
+{
+    mat4 matrix;
+    mat4 jointMatrix[MAX_NUM_JOINTS];
+    float jointCount;
+} node;
+
+// 与PBRShader.vert的计算保持完全一致，主Pass才能使用EQUAL深度测试
+invariant gl_Position;
+
+void main()
+{
+    vec4 locPos;
+    if (node.jointCount > 0.0)
+    {
+        mat4 skinMat = 
+            inWeight.x * node.jointMatrix[int(inJoint.x)] +
+            inWeight.y * node.jointMatrix[int(inJoint.y)] +
+            inWeight.z * node.jointMatrix[int(inJoint.z)] +
+            inWeight.w * node.jointMatrix[int(inJoint.w)];
+
+        locPos = uboScene.model * node.matrix * skinMat * vec4(inPos, 1.0);
+    } 
+    else 
+    {
+        locPos = uboScene.model * node.matrix * vec4(inPos, 1.0);
+    }
+
+    locPos.y = -locPos.y;
+    vec3 worldPos = locPos.xyz / locPos.w;
+    gl_Position =  uboScene.projection * uboScene.view * vec4(worldPos, 1.0);
+}
@@ -0,0 +1,38 @@
+// 一次Dispatch生成立方体贴图的所有面和Mip：X方向按Mip依次排列8x8的Tile，Z方向是立方体的面
+#define IBL_GROUP_SIZE 8u
+#define MAX_IBL_MIPS 10
+
+#include "CubeMap.glsl"
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+layout (set = 0, binding = 0) uniform samplerCube samplerEnv;
+// 每个Mip一个视图，工作组内的Mip相同，下标是动态一致的
+layout (set = 0, binding = 1, rgba16f) uniform writeonly image2DArray outputMips[MAX_IBL_MIPS];
+
+struct CubeTexel
+{
+    uint mip;
+    uint size;
+    uvec2 texel;
+    bool valid;
+};
+
+CubeTexel GetCubeTexel(uint baseSize, uint mipCount)
+{
+    CubeTexel result;
+    uint tile = gl_WorkGroupID.x;
+    result.mip = 0u;
+    result.size = baseSize;
+    uint tilesX = (result.size + IBL_GROUP_SIZE - 1u) / IBL_GROUP_SIZE;
+    while (tile >= tilesX * tilesX && result.mip + 1u < mipCount)
+    {
+        tile -= tilesX * tilesX;
+        result.mip++;
+        result.size = max(result.size >> 1u, 1u);
+        tilesX = (result.size + IBL_GROUP_SIZE - 1u) / IBL_GROUP_SIZE;
+    }
+    result.texel = uvec2(tile % tilesX, tile / tilesX) * IBL_GROUP_SIZE + gl_LocalInvocationID.xy;
+    result.valid = all(lessThan(result.texel, uvec2(result.size)));
+    return result;
+}
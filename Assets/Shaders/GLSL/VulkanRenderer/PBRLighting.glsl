@@ -0,0 +1,133 @@
+// 前向PBRShader.frag和VisibilityResolve.frag共用的材质与光照计算
+// 纹理采样方式不同（普通采样和textureGrad），由调用者采样后传入
+
+#include "ClusteredLighting.glsl"
+#include "CascadedShadow.glsl"
+#include "SphericalHarmonics.glsl"
+
+layout (set = 0, binding = 0) uniform UBOScene
+{
+    mat4 projection;
+    mat4 model;
+    mat4 view;
+    vec3 camPos;
+} uboScene;
+
+layout (set = 0, binding = 1) uniform UBOParam
+{
+    vec4 lightPos;
+    float exposure;
+    float gamma;
+    float prefilteredCubeMipLevels;
+    float scaleIBLAmbient;
+    vec3 lightColor;
+    float lightIntensity;
+    vec4 shIrradiance[9];
+    float useSHIrradiance;
+} uboParams;
+
+layout (set = 0, binding = 2) uniform sampler2D samplerBRDFLUT;
+layout (set = 0, binding = 3) uniform samplerCube samplerIrradiance;
+layout (set = 0, binding = 4) uniform samplerCube samplerPrefilterMap;
+
+vec3 GetIBLContribution(PBRFactors pbrFactors, vec3 n, vec3 reflection)
+{
+    float lod = (pbrFactors.perceptualRoughness * uboParams.prefilteredCubeMipLevels);
+    vec3 brdf = (texture(samplerBRDFLUT, vec2(pbrFactors.NoV, 1.0 - pbrFactors.perceptualRoughness))).rgb;
+
+    vec3 diffuseLight = uboParams.useSHIrradiance > 0.0 ? EvaluateSHIrradiance(uboParams.shIrradiance, n) : texture(samplerIrradiance, n).rgb;
+    vec3 specularLight = textureLod(samplerPrefilterMap, reflection, lod).rgb;
+
+    vec3 diffuse = diffuseLight * pbrFactors.diffuseColor;
+    vec3 specular = specularLight * (pbrFactors.specularColor * brdf.x + brdf.y);
+
+    return (diffuse + specular) * uboParams.scaleIBLAmbient;
+}
+
+// baseColor为线性空间的采样结果，没有贴图时传入vec4(1.0)
+MaterialFactor GetMetallicRoughnessFactor(ShaderMaterial material, vec4 baseColor, vec4 mrSample, bool hasPhysicalDescMap)
+{
+    MaterialFactor matFactor;
+    matFactor.roughness = material.roughnessFactor;
+    matFactor.metalic = material.metallicFactor;
+    if (hasPhysicalDescMap)
+    {
+        // Roughness is stored in the 'g' channel, metallic is stored in the 'b' channel.
+        // This layout intentionally reserves the 'r' channel for (optional) occlusion map data
+        matFactor.roughness *= mrSample.g;
+        matFactor.metalic *= mrSample.b;
+    }
+    else
+    {
+        matFactor.roughness = clamp(matFactor.roughness, c_MinRoughness, 1.0);
+        matFactor.metalic = clamp(matFactor.metalic, 0.0, 1.0);
+    }
+    matFactor.albedo = baseColor * material.baseColorFactor;
+    return matFactor;
+}
+
+// diffuse和specular为线性空间的采样结果，没有光泽度贴图时glossiness传入1.0
+MaterialFactor GetSpecularGlossinessFactor(ShaderMaterial material, vec4 diffuse, vec3 specular, float glossiness)
+{
+    // Values from specular glossiness workflow are converted to metallic roughness
+    MaterialFactor matFactor;
+    matFactor.roughness = 1.0 - glossiness;
+
+    const float epsilon = 1e-6;
+    float maxSpecular = max(max(specular.r, specular.g), specular.b);
+
+    // Convert metallic value from specular glossiness inputs
+    matFactor.metalic = ConvertMetallic(diffuse.rgb, specular, maxSpecular);
+
+    vec3 baseColorDiffusePart = diffuse.rgb * ((1.0 - maxSpecular) / (1 - c_MinRoughness) / max(1 - matFactor.metalic, epsilon)) * material.diffuseFactor.rgb;
+    vec3 baseColorSpecularPart = specular - (vec3(c_MinRoughness) * (1 - matFactor.metalic) * (1 / max(matFactor.metalic, epsilon))) * material.specularFactor.rgb;
+    matFactor.albedo = vec4(mix(baseColorDiffusePart, baseColorSpecularPart, matFactor.metalic * matFactor.metalic), diffuse.a);
+    return matFactor;
+}
+
+PBRFactors GetPBRFactors(MaterialFactor matFactor, vec3 N, vec3 V, vec3 L)
+{
+    vec3 H = normalize(L + V);
+    vec3 F0 = vec3(0.04);
+
+    PBRFactors pbrFactor;
+    pbrFactor.NoL = clamp(dot(N, L), 0.001, 1.0);
+    pbrFactor.NoV = clamp(abs(dot(N, V)), 0.001, 1.0);
+    pbrFactor.NoH = clamp(dot(N, H), 0.0, 1.0);
+    pbrFactor.LoH = clamp(dot(L, H), 0.0, 1.0);
+    pbrFactor.VoH = clamp(dot(V, H), 0.0, 1.0);
+
+    pbrFactor.diffuseColor = matFactor.albedo.rgb * (vec3(1.0) - F0);
+    pbrFactor.diffuseColor *= 1.0 - matFactor.metalic;
+    pbrFactor.specularColor = mix(F0, matFactor.albedo.rgb, matFactor.metalic);
+
+    pbrFactor.alphaRoughness = matFactor.roughness * matFactor.roughness;
+
+    float reflectance = max(max(pbrFactor.specularColor.r, pbrFactor.specularColor.g), pbrFactor.specularColor.b);
+    pbrFactor.reflectance0 = pbrFactor.specularColor.rgb;
+    pbrFactor.reflectance90 = vec3(clamp(reflectance * 25.0, 0.0, 1.0));
+    return pbrFactor;
+}
+
+// 平行光阴影、分簇光源、AO、自发光和IBL，返回线性HDR颜色
+// ao没有贴图时传入1.0，emissive已经乘上自发光系数
+vec3 GetSurfaceLighting(vec3 worldPos, vec2 fragCoord, vec3 N, MaterialFactor matFactor, float ao, vec3 emissive)
+{
+    vec3 V = normalize(worldPos - uboScene.camPos);
+    vec3 L = normalize(uboParams.lightPos.xyz);
+    vec3 R = -normalize(reflect(V, N));
+    R.y *= -1.0f;
+
+    PBRFactors pbrFactor = GetPBRFactors(matFactor, N, V, L);
+
+    float shadow = GetCascadedShadow(worldPos, -(uboScene.view * vec4(worldPos, 1.0)).z, pbrFactor.NoL);
+    vec3 color = GetDirectionLight(uboParams.lightColor, uboParams.lightIntensity, matFactor, pbrFactor) * shadow;
+    color += GetPunctualLighting(worldPos, fragCoord, N, V, matFactor, pbrFactor);
+
+    const float u_OcclusionStrength = 1.0f;
+    color = mix(color, color * ao, u_OcclusionStrength);
+
+    color += emissive;
+    color += GetIBLContribution(pbrFactor, N, R);
+    return color;
+}
@@ -3,6 +3,7 @@
 #extension GL_GOOGLE_include_directive : require
 
 #include "../Base/Common.glsl"
+#include "PBRLighting.glsl"
 
 layout (location = 0) in vec3 inWorldPos;
 layout (location = 1) in vec3 inNormal;
@@ -11,29 +12,6 @@ layout (location = 3) in vec2 inUV1;
 layout (location = 4) in vec4 inTangent;
 layout (location = 5) in vec4 inColor;
 
-layout (set = 0, binding = 0) uniform UBOScene
-{
-    mat4 projection;
-    mat4 model;
-    mat4 view;
-    vec3 camPos;
-} uboScene;
-
-layout (set = 0, binding = 1) uniform UBOParam
-{
-    vec4 lightPos;
-    float exposure;
-    float gamma;
-    float prefilteredCubeMipLevels;
-    float scaleIBLAmbient;
-    vec3 lightColor;
-    float lightIntensity;
-} uboParams;
-
-layout (set = 0, binding = 2) uniform sampler2D samplerBRDFLUT;
-layout (set = 0, binding = 3) uniform samplerCube samplerIrradiance;
-layout (set = 0, binding = 4) uniform samplerCube samplerPrefilterMap;
-
 layout (set = 1, binding = 0) uniform sampler2D samplerColorMap;
 layout (set = 1, binding = 1) uniform sampler2D samplerMetalicRoughnessMap;
 layout (set = 1, binding = 2) uniform sampler2D samplerNormalMap;
@@ -52,148 +30,69 @@ layout (push_constant) uniform PushConstants
 	int materialIndex;
 } pushConstants;
 
+// 材质特性位，与LeoVK::MaterialFeatureBits一致
+// 没有设置FEATURE_PERMUTATION时退回到按材质参数的运行时分支
+layout (constant_id = 0) const uint MATERIAL_FEATURES = 0u;
 
-vec3 GetIBLContribution(PBRFactors pbrFactors, vec3 n, vec3 reflection)
-{
-    float lod = (pbrFactors.perceptualRoughness * uboParams.prefilteredCubeMipLevels);
-    vec3 brdf = (texture(samplerBRDFLUT, vec2(pbrFactors.NoV, 1.0 - pbrFactors.perceptualRoughness))).rgb;
-    
-    vec3 diffuseLight = SRGBtoLINEAR(Tonemap(texture(samplerIrradiance, n), uboParams.exposure, uboParams.gamma)).rgb;
-    vec3 specularLight = SRGBtoLINEAR(Tonemap(textureLod(samplerPrefilterMap, reflection, lod), uboParams.exposure, uboParams.gamma)).rgb;
+const uint FEATURE_BASE_COLOR_MAP       = 0x00000001u;
+const uint FEATURE_PHYSICAL_DESC_MAP    = 0x00000002u;
+const uint FEATURE_NORMAL_MAP           = 0x00000004u;
+const uint FEATURE_OCCLUSION_MAP        = 0x00000008u;
+const uint FEATURE_EMISSIVE_MAP         = 0x00000010u;
+const uint FEATURE_ALPHA_MASK           = 0x00000020u;
+const uint FEATURE_SPECULAR_GLOSSINESS  = 0x00000040u;
+const uint FEATURE_PERMUTATION          = 0x80000000u;
 
-    vec3 diffuse = diffuseLight * pbrFactors.diffuseColor;
-    vec3 specular = specularLight * (pbrFactors.specularColor * brdf.x + brdf.y);
+const bool USE_PERMUTATION = (MATERIAL_FEATURES & FEATURE_PERMUTATION) != 0u;
 
-    return (diffuse + specular) * uboParams.scaleIBLAmbient;
+bool HasFeature(uint feature, bool runtimeValue)
+{
+    return USE_PERMUTATION ? ((MATERIAL_FEATURES & feature) != 0u) : runtimeValue;
 }
 
 void main()
 {
     ShaderMaterial material = materials[pushConstants.materialIndex];
 
-    vec3 N = (material.normalTextureSet > -1) ? CalculateNormal(texture(samplerNormalMap, inUV0).xyz * 2.0 - vec3(1.0), inWorldPos, inNormal, inUV0) : normalize(inNormal);
-    vec3 V = normalize(inWorldPos - uboScene.camPos);
-    vec3 L = normalize(uboParams.lightPos.xyz);
-    vec3 H = normalize(L + V);
-    vec3 R = -normalize(reflect(V, N));
-    R.y *= -1.0f;
+    bool hasBaseColorMap = HasFeature(FEATURE_BASE_COLOR_MAP, material.baseColorTextureSet > -1);
+    bool hasPhysicalDescMap = HasFeature(FEATURE_PHYSICAL_DESC_MAP, material.physicalDescriptorTextureSet > -1);
+    bool hasNormalMap = HasFeature(FEATURE_NORMAL_MAP, material.normalTextureSet > -1);
+    bool hasOcclusionMap = HasFeature(FEATURE_OCCLUSION_MAP, material.occlusionTextureSet > -1);
+    bool hasEmissiveMap = HasFeature(FEATURE_EMISSIVE_MAP, material.emissiveTextureSet > -1);
+    bool alphaMask = HasFeature(FEATURE_ALPHA_MASK, material.alphaMask == 1.0f);
+    bool specularGlossiness = HasFeature(FEATURE_SPECULAR_GLOSSINESS, material.workflow == PBR_WORKFLOW_SPECULAR_GLOSINESS);
 
-    MaterialFactor matFactor;
+    vec3 N = hasNormalMap ? CalculateNormalTangent(UnpackNormalMap(texture(samplerNormalMap, inUV0)), inNormal, inTangent) : normalize(inNormal);
+
+    vec4 baseColor = hasBaseColorMap ? SRGBtoLINEAR(texture(samplerColorMap, material.baseColorTextureSet == 0 ? inUV0 : inUV1)) : vec4(1.0);
+    if (alphaMask && (baseColor * material.baseColorFactor).a < material.alphaMaskCutoff)
     {
-        if (material.alphaMask == 1.0f) 
-        {
-            if (material.baseColorTextureSet > -1) 
-            {
-                matFactor.albedo = SRGBtoLINEAR(texture(samplerColorMap, material.baseColorTextureSet == 0 ? inUV0 : inUV1)) * material.baseColorFactor;
-            } 
-            else 
-            {
-                matFactor.albedo = material.baseColorFactor;
-            }
-            
-            if (matFactor.albedo.a < material.alphaMaskCutoff) 
-            {
-                discard;
-            }
-        }
-        
-        if (material.workflow == PBR_WORKFLOW_METALLIC_ROUGHNESS)
-        {
-            matFactor.roughness = material.roughnessFactor;
-            matFactor.metalic = material.metallicFactor;
-            if (material.physicalDescriptorTextureSet > -1) 
-            {
-                // Roughness is stored in the 'g' channel, metallic is stored in the 'b' channel.
-                // This layout intentionally reserves the 'r' channel for (optional) occlusion map data
-                vec4 mrSample = texture(samplerMetalicRoughnessMap, material.physicalDescriptorTextureSet == 0 ? inUV0 : inUV1);
-                matFactor.roughness *= mrSample.g;
-                matFactor.metalic *= mrSample.b;
-            } 
-            else 
-            {
-                matFactor.roughness = clamp(matFactor.roughness, c_MinRoughness, 1.0);
-                matFactor.metalic = clamp(matFactor.metalic, 0.0, 1.0);
-            }
-            // Roughness is authored as perceptual roughness; as is convention,
-            // convert to material roughness by squaring the perceptual roughness [2].
-            // The albedo may be defined from a base texture or a flat color
-            if (material.baseColorTextureSet > -1) 
-            {
-                matFactor.albedo = SRGBtoLINEAR(texture(samplerColorMap, material.baseColorTextureSet == 0 ? inUV0 : inUV1)) * material.baseColorFactor;
-            } 
-            else 
-            {
-                matFactor.albedo = material.baseColorFactor;
-            }
-        }
-
-        if (material.workflow == PBR_WORKFLOW_SPECULAR_GLOSINESS) 
-        {
-            // Values from specular glossiness workflow are converted to metallic roughness
-            if (material.physicalDescriptorTextureSet > -1) 
-            {
-                matFactor.roughness = 1.0 - texture(samplerMetalicRoughnessMap, material.physicalDescriptorTextureSet == 0 ? inUV0 : inUV1).a;
-            } 
-            else 
-            {
-            	matFactor.roughness = 0.0;
-            }
-        
-            const float epsilon = 1e-6;
-        
-            vec4 diffuse = SRGBtoLINEAR(texture(samplerColorMap, inUV0));
-            vec3 specular = SRGBtoLINEAR(texture(samplerMetalicRoughnessMap, inUV0)).rgb;
-        
-            float maxSpecular = max(max(specular.r, specular.g), specular.b);
-        
-            // Convert metallic value from specular glossiness inputs
-            matFactor.metalic = ConvertMetallic(diffuse.rgb, specular, maxSpecular);
-        
-            vec3 baseColorDiffusePart = diffuse.rgb * ((1.0 - maxSpecular) / (1 - c_MinRoughness) / max(1 - matFactor.metalic, epsilon)) * material.diffuseFactor.rgb;
-            vec3 baseColorSpecularPart = specular - (vec3(c_MinRoughness) * (1 - matFactor.metalic) * (1 / max(matFactor.metalic, epsilon))) * material.specularFactor.rgb;
-            matFactor.albedo = vec4(mix(baseColorDiffusePart, baseColorSpecularPart, matFactor.metalic * matFactor.metalic), diffuse.a);
-        }
+        discard;
     }
-    
-    PBRFactors pbrFactor;
+
+    MaterialFactor matFactor;
+    if (specularGlossiness)
     {
-        vec3 F0 = vec3(0.04);
-        pbrFactor.NoL = clamp(dot(N, L), 0.001, 1.0);
-        pbrFactor.NoV = clamp(abs(dot(N, V)), 0.001, 1.0);
-        pbrFactor.NoH = clamp(dot(N, H), 0.0, 1.0);
-        pbrFactor.LoH = clamp(dot(L, H), 0.0, 1.0);
-        pbrFactor.VoH = clamp(dot(V, H), 0.0, 1.0);
-
-        pbrFactor.diffuseColor = matFactor.albedo.rgb * (vec3(1.0) - F0);
-        pbrFactor.diffuseColor *= 1.0 - matFactor.metalic;
-        pbrFactor.specularColor = mix(F0, matFactor.albedo.rgb, matFactor.metalic);
-        
-        pbrFactor.alphaRoughness = matFactor.roughness * matFactor.roughness;
-
-        float reflectance = max(max(pbrFactor.specularColor.r, pbrFactor.specularColor.g), pbrFactor.specularColor.b);
-        pbrFactor.reflectance0 = pbrFactor.specularColor.rgb;
-        pbrFactor.reflectance90 = vec3(clamp(reflectance * 25.0, 0.0, 1.0));
+        float glossiness = hasPhysicalDescMap ? texture(samplerMetalicRoughnessMap, material.physicalDescriptorTextureSet == 0 ? inUV0 : inUV1).a : 1.0;
+        vec4 diffuse = SRGBtoLINEAR(texture(samplerColorMap, inUV0));
+        vec3 specular = SRGBtoLINEAR(texture(samplerMetalicRoughnessMap, inUV0)).rgb;
+        matFactor = GetSpecularGlossinessFactor(material, diffuse, specular, glossiness);
     }
-
-    vec3 color = GetDirectionLight(uboParams.lightColor, uboParams.lightIntensity, matFactor, pbrFactor);
-
-    const float u_OcclusionStrength = 1.0f;
-    if (material.occlusionTextureSet > -1) 
+    else
     {
-        float ao = texture(samplerAOMap, (material.occlusionTextureSet == 0 ? inUV0 : inUV1)).r;
-        color = mix(color, color * ao, u_OcclusionStrength);
+        vec4 mrSample = hasPhysicalDescMap ? texture(samplerMetalicRoughnessMap, material.physicalDescriptorTextureSet == 0 ? inUV0 : inUV1) : vec4(1.0);
+        matFactor = GetMetallicRoughnessFactor(material, baseColor, mrSample, hasPhysicalDescMap);
     }
 
+    float ao = hasOcclusionMap ? texture(samplerAOMap, (material.occlusionTextureSet == 0 ? inUV0 : inUV1)).r : 1.0;
     vec3 emissive = vec3(0.0f);
-    if (material.emissiveTextureSet > -1) 
+    if (hasEmissiveMap)
     {
         emissive = material.emissiveFactor.rgb * material.emissiveStrength;
         emissive *= SRGBtoLINEAR(texture(samplerEmissiveMap, material.emissiveTextureSet == 0 ? inUV0 : inUV1)).rgb * 10.0f;
-    };
-    color += emissive;
-    color += GetIBLContribution(pbrFactor, N, R);
+    }
+    vec3 color = GetSurfaceLighting(inWorldPos, gl_FragCoord.xy, N, matFactor, ao, emissive);
 
-    color = pow(vec3(color), vec3(0.4545));
-    color = AMDTonemapper(color.rgb);
+    // 输出线性HDR颜色，色调映射和Gamma在后处理中完成
     outColor = vec4(color.rgb, matFactor.albedo.a);
-}
\ No newline at end of file
+}
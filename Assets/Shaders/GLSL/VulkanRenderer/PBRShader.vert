@@ -33,6 +33,9 @@ layout (location = 3) out vec2 outUV1;
 layout (location = 4) out vec4 outTangent;
 layout (location = 5) out vec4 outColor;
 
+// 深度预渲染使用DepthPrepass.vert，两者的gl_Position必须逐位一致
+invariant gl_Position;
+
 void main()
 {
     vec4 locPos;
@@ -47,16 +50,15 @@ void main()
 
         locPos = uboScene.model * node.matrix * skinMat * vec4(inPos, 1.0);
         outNormal = normalize(transpose(inverse(mat3(uboScene.model * node.matrix * skinMat))) * inNormal);
+        outTangent = vec4(mat3(uboScene.model * node.matrix * skinMat) * inTangent.xyz, inTangent.w);
     } 
     else 
     {
         locPos = uboScene.model * node.matrix * vec4(inPos, 1.0);
         outNormal = normalize(transpose(inverse(mat3(uboScene.model * node.matrix))) * inNormal);
+        outTangent = vec4(mat3(uboScene.model * node.matrix) * inTangent.xyz, inTangent.w);
     }
 
-    outTangent = inTangent;
-    // outTangent = normalize(outTangent - dot(outTangent, outNormal) * outNormal);
-
     locPos.y = -locPos.y;
     vec3 positionWS = vec3(uboScene.model * vec4(inPos, 1.0));
     outWorldPos = locPos.xyz / locPos.w;
@@ -0,0 +1,56 @@
+// 阴影投射只读取位置，定义SKINNED时额外读取蒙皮属性
+
+layout (location = 0) in vec3 inPos;
+#ifdef SKINNED
+layout (location = 5) in vec4 inJoint;
+layout (location = 6) in vec4 inWeight;
+#endif
+
+#define MAX_NUM_JOINTS 128
+
+layout (set = 0, binding = 0) uniform UBOScene
+{
+    mat4 projection;
+    mat4 model;
+    mat4 view;
+    vec3 camPos;
+} uboScene;
+
+#define SHADOW_CASTER
+#include "CascadedShadow.glsl"
+
+layout (set = 2, binding = 0) uniform UBONode
+{
+    mat4 matrix;
+    mat4 jointMatrix[MAX_NUM_JOINTS];
+    float jointCount;
+} node;
+
+layout (push_constant) uniform PushConstants
+{
+    uint cascadeIndex;
+} pushConstants;
+
+void main()
+{
+    vec4 locPos;
+#ifdef SKINNED
+    if (node.jointCount > 0.0)
+    {
+        mat4 skinMat = 
+            inWeight.x * node.jointMatrix[int(inJoint.x)] +
+            inWeight.y * node.jointMatrix[int(inJoint.y)] +
+            inWeight.z * node.jointMatrix[int(inJoint.z)] +
+            inWeight.w * node.jointMatrix[int(inJoint.w)];
+
+        locPos = uboScene.model * node.matrix * skinMat * vec4(inPos, 1.0);
+    }
+    else
+#endif
+    {
+        locPos = uboScene.model * node.matrix * vec4(inPos, 1.0);
+    }
+
+    locPos.y = -locPos.y;
+    gl_Position = uboShadow.cascadeViewProj[pushConstants.cascadeIndex] * vec4(locPos.xyz / locPos.w, 1.0);
+}
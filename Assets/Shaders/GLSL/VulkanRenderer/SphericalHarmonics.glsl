@@ -0,0 +1,26 @@
+// L2球谐的9个实数基函数
+void GetSHBasis(vec3 n, out float basis[9])
+{
+    basis[0] = 0.282095;
+    basis[1] = 0.488603 * n.y;
+    basis[2] = 0.488603 * n.z;
+    basis[3] = 0.488603 * n.x;
+    basis[4] = 1.092548 * n.x * n.y;
+    basis[5] = 1.092548 * n.y * n.z;
+    basis[6] = 0.315392 * (3.0 * n.z * n.z - 1.0);
+    basis[7] = 1.092548 * n.x * n.z;
+    basis[8] = 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
+// 系数在CPU上已经乘过余弦卷积，结果与辐照度立方体贴图的值一致
+vec3 EvaluateSHIrradiance(vec4 coeffs[9], vec3 n)
+{
+    float basis[9];
+    GetSHBasis(n, basis);
+    vec3 result = vec3(0.0);
+    for (int i = 0; i < 9; i++)
+    {
+        result += coeffs[i].rgb * basis[i];
+    }
+    return max(result, vec3(0.0));
+}
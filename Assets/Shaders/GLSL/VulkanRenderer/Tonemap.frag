@@ -0,0 +1,27 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+
+#include "../Base/Common.glsl"
+
+layout (location = 0) in vec2 inUV;
+
+layout (set = 0, binding = 0) uniform sampler2D samplerScene;
+
+// 渲染区域占整个目标的比例，限制在区域内的最大UV，以及色调映射参数
+layout (push_constant) uniform PushConsts
+{
+    vec2 uvScale;
+    vec2 maxUV;
+    float exposure;
+    float gamma;
+} pushConsts;
+
+layout (location = 0) out vec4 outColor;
+
+void main()
+{
+    vec2 uv = min(inUV * pushConsts.uvScale, pushConsts.maxUV);
+    vec3 color = texture(samplerScene, uv).rgb;
+    outColor = vec4(Tonemap(vec4(color, 1.0), pushConsts.exposure, pushConsts.gamma).rgb, 1.0);
+}
@@ -0,0 +1,44 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+
+#include "../Base/Common.glsl"
+
+layout (location = 0) in vec2 inUV0;
+layout (location = 1) in vec2 inUV1;
+
+layout (set = 1, binding = 0) uniform sampler2D samplerColorMap;
+
+layout (std430, set = 3, binding = 0) buffer SSBO
+{
+    ShaderMaterial materials[];
+};
+
+layout (push_constant) uniform PushConstants 
+{
+    uint drawIndex;
+    uint materialIndex;
+} pushConstants;
+
+// 只有Alpha Mask材质的Pipeline需要读取纹理，其余Pipeline保留Early-Z
+layout (constant_id = 0) const bool ALPHA_MASK = false;
+
+layout (location = 0) out uvec2 outVisibility;
+
+void main()
+{
+    if (ALPHA_MASK)
+    {
+        ShaderMaterial material = materials[pushConstants.materialIndex];
+        float alpha = material.baseColorFactor.a;
+        if (material.baseColorTextureSet > -1)
+        {
+            alpha *= texture(samplerColorMap, material.baseColorTextureSet == 0 ? inUV0 : inUV1).a;
+        }
+        if (alpha < material.alphaMaskCutoff)
+        {
+            discard;
+        }
+    }
+    outVisibility = uvec2(pushConstants.drawIndex, uint(gl_PrimitiveID));
+}
@@ -0,0 +1,25 @@
+// Visibility Buffer几何Pass与解析Pass共用的定义，修改时需要同步VulkanRenderer.hpp中的VisibilityDraw
+
+// 与MAX_VISIBILITY_TEXTURES一致
+#define MAX_VISIBILITY_TEXTURES 256
+// 没有几何体覆盖的像素
+#define INVALID_VISIBILITY_ID 0xFFFFFFFFu
+
+struct VisibilityDraw
+{
+    mat4 model;
+    mat4 normal;
+    uint firstIndex;
+    uint materialIndex;
+    uint hasIndices;
+    uint padding;
+    // 场景纹理数组中的索引：BaseColor, PhysicalDesc, Normal, Occlusion
+    ivec4 textures;
+    // x: Emissive
+    ivec4 texturesExt;
+};
+
+layout (std430, set = 2, binding = 0) readonly buffer DrawBuffer
+{
+    VisibilityDraw draws[];
+};
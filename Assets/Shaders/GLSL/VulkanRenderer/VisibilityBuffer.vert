@@ -0,0 +1,37 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+
+#include "VisibilityBuffer.glsl"
+
+layout (location = 0) in vec3 inPos;
+layout (location = 2) in vec2 inUV0;
+layout (location = 3) in vec2 inUV1;
+
+layout (set = 0, binding = 0) uniform UBOScene
+{
+    mat4 projection;
+    mat4 model;
+    mat4 view;
+    vec3 camPos;
+} uboScene;
+
+layout (push_constant) uniform PushConstants 
+{
+    uint drawIndex;
+    uint materialIndex;
+} pushConstants;
+
+layout (location = 0) out vec2 outUV0;
+layout (location = 1) out vec2 outUV1;
+
+void main()
+{
+    // 变换与VisibilityResolve.frag中重建顶点时完全一致，重心坐标才能对上光栅化结果
+    vec4 locPos = draws[pushConstants.drawIndex].model * vec4(inPos, 1.0);
+    locPos.y = -locPos.y;
+    vec3 worldPos = locPos.xyz / locPos.w;
+    outUV0 = inUV0;
+    outUV1 = inUV1;
+    gl_Position = uboScene.projection * uboScene.view * vec4(worldPos, 1.0);
+}
@@ -0,0 +1,206 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+#include "../Base/Common.glsl"
+#include "PBRLighting.glsl"
+#include "VisibilityBuffer.glsl"
+
+layout (location = 0) in vec2 inUV;
+
+layout (set = 1, binding = 0) uniform usampler2D samplerVisibility;
+layout (set = 1, binding = 1) uniform sampler2D samplerVisibilityDepth;
+layout (std430, set = 1, binding = 2) readonly buffer VertexBuffer
+{
+    float vertices[];
+};
+layout (std430, set = 1, binding = 3) readonly buffer IndexBuffer
+{
+    uint indices[];
+};
+layout (set = 1, binding = 4) uniform sampler2D sceneTextures[MAX_VISIBILITY_TEXTURES];
+
+layout (std430, set = 3, binding = 0) buffer SSBO
+{
+    ShaderMaterial materials[];
+};
+
+layout (location = 0) out vec4 outColor;
+
+// LeoVK::Vertex的布局，单位为float，由CreateVisibilityResolvePipeline按sizeof和offsetof填入
+layout (constant_id = 0) const uint VERTEX_STRIDE = 0u;
+layout (constant_id = 1) const uint VERTEX_POS = 0u;
+layout (constant_id = 2) const uint VERTEX_NORMAL = 0u;
+layout (constant_id = 3) const uint VERTEX_UV0 = 0u;
+layout (constant_id = 4) const uint VERTEX_UV1 = 0u;
+layout (constant_id = 5) const uint VERTEX_TANGENT = 0u;
+
+struct BarycentricDeriv
+{
+    vec3 lambda;
+    vec3 ddx;
+    vec3 ddy;
+};
+
+// 透视校正的重心坐标及其屏幕空间导数，用于插值顶点属性和选择纹理Mip
+BarycentricDeriv CalcFullBary(vec4 pt0, vec4 pt1, vec4 pt2, vec2 pixelNdc, vec2 winSize)
+{
+    BarycentricDeriv ret;
+
+    vec3 invW = 1.0 / vec3(pt0.w, pt1.w, pt2.w);
+
+    vec2 ndc0 = pt0.xy * invW.x;
+    vec2 ndc1 = pt1.xy * invW.y;
+    vec2 ndc2 = pt2.xy * invW.z;
+
+    float invDet = 1.0 / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+    ret.ddx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+    ret.ddy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+    float ddxSum = dot(ret.ddx, vec3(1.0));
+    float ddySum = dot(ret.ddy, vec3(1.0));
+
+    vec2 deltaVec = pixelNdc - ndc0;
+    float interpInvW = invW.x + deltaVec.x * ddxSum + deltaVec.y * ddySum;
+    float interpW = 1.0 / interpInvW;
+
+    ret.lambda.x = interpW * (invW.x + deltaVec.x * ret.ddx.x + deltaVec.y * ret.ddy.x);
+    ret.lambda.y = interpW * (deltaVec.x * ret.ddx.y + deltaVec.y * ret.ddy.y);
+    ret.lambda.z = interpW * (deltaVec.x * ret.ddx.z + deltaVec.y * ret.ddy.z);
+
+    // NDC到像素的缩放，Vulkan中NDC的y轴与像素y轴同向
+    ret.ddx *= 2.0 / winSize.x;
+    ret.ddy *= 2.0 / winSize.y;
+    ddxSum *= 2.0 / winSize.x;
+    ddySum *= 2.0 / winSize.y;
+
+    float interpW_ddx = 1.0 / (interpInvW + ddxSum);
+    float interpW_ddy = 1.0 / (interpInvW + ddySum);
+
+    ret.ddx = interpW_ddx * (ret.lambda * interpInvW + ret.ddx) - ret.lambda;
+    ret.ddy = interpW_ddy * (ret.lambda * interpInvW + ret.ddy) - ret.lambda;
+
+    return ret;
+}
+
+vec3 LoadVec3(uint vertexIndex, uint offset)
+{
+    uint base = vertexIndex * VERTEX_STRIDE + offset;
+    return vec3(vertices[base], vertices[base + 1u], vertices[base + 2u]);
+}
+
+vec4 LoadVec4(uint vertexIndex, uint offset)
+{
+    uint base = vertexIndex * VERTEX_STRIDE + offset;
+    return vec4(vertices[base], vertices[base + 1u], vertices[base + 2u], vertices[base + 3u]);
+}
+
+vec2 LoadVec2(uint vertexIndex, uint offset)
+{
+    uint base = vertexIndex * VERTEX_STRIDE + offset;
+    return vec2(vertices[base], vertices[base + 1u]);
+}
+
+vec4 SampleTexture(int textureIndex, vec2 uv, vec2 uvDdx, vec2 uvDdy)
+{
+    return textureGrad(sceneTextures[nonuniformEXT(textureIndex)], uv, uvDdx, uvDdy);
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    uvec2 visibility = texelFetch(samplerVisibility, pixel, 0).xy;
+    if (visibility.x == INVALID_VISIBILITY_ID)
+    {
+        discard;
+    }
+    // 后续的前向绘制（半透明、蒙皮等）需要和解析出的深度做测试
+    gl_FragDepth = texelFetch(samplerVisibilityDepth, pixel, 0).r;
+
+    VisibilityDraw draw = draws[visibility.x];
+    ShaderMaterial material = materials[draw.materialIndex];
+
+    // 按需读取三角形的三个顶点，变换与VisibilityBuffer.vert一致
+    uint vertexIndex[3];
+    vec3 worldPos[3];
+    vec4 clipPos[3];
+    for (uint i = 0u; i < 3u; i++)
+    {
+        uint index = visibility.y * 3u + i;
+        vertexIndex[i] = draw.hasIndices != 0u ? indices[draw.firstIndex + index] : index;
+
+        vec4 locPos = draw.model * vec4(LoadVec3(vertexIndex[i], VERTEX_POS), 1.0);
+        locPos.y = -locPos.y;
+        worldPos[i] = locPos.xyz / locPos.w;
+        clipPos[i] = uboScene.projection * uboScene.view * vec4(worldPos[i], 1.0);
+    }
+
+    // 动态分辨率时只渲染目标的左上角，使用实际的渲染大小
+    vec2 winSize = uboCluster.screenSize.xy;
+    vec2 pixelNdc = (gl_FragCoord.xy / winSize) * 2.0 - 1.0;
+    BarycentricDeriv bary = CalcFullBary(clipPos[0], clipPos[1], clipPos[2], pixelNdc, winSize);
+
+    mat3 positions = mat3(worldPos[0], worldPos[1], worldPos[2]);
+    vec3 inWorldPos = positions * bary.lambda;
+
+    mat3 normals = mat3(LoadVec3(vertexIndex[0], VERTEX_NORMAL), LoadVec3(vertexIndex[1], VERTEX_NORMAL), LoadVec3(vertexIndex[2], VERTEX_NORMAL));
+    vec3 inNormal = normalize(mat3(draw.normal) * (normals * bary.lambda));
+
+    mat3x4 tangents = mat3x4(LoadVec4(vertexIndex[0], VERTEX_TANGENT), LoadVec4(vertexIndex[1], VERTEX_TANGENT), LoadVec4(vertexIndex[2], VERTEX_TANGENT));
+    vec4 tangent = tangents * bary.lambda;
+    vec4 inTangent = vec4(mat3(draw.model) * tangent.xyz, tangent.w);
+
+    mat3x2 uvs0 = mat3x2(LoadVec2(vertexIndex[0], VERTEX_UV0), LoadVec2(vertexIndex[1], VERTEX_UV0), LoadVec2(vertexIndex[2], VERTEX_UV0));
+    mat3x2 uvs1 = mat3x2(LoadVec2(vertexIndex[0], VERTEX_UV1), LoadVec2(vertexIndex[1], VERTEX_UV1), LoadVec2(vertexIndex[2], VERTEX_UV1));
+    vec2 inUV0 = uvs0 * bary.lambda;
+    vec2 inUV1 = uvs1 * bary.lambda;
+    vec2 uv0Ddx = uvs0 * bary.ddx;
+    vec2 uv0Ddy = uvs0 * bary.ddy;
+    vec2 uv1Ddx = uvs1 * bary.ddx;
+    vec2 uv1Ddy = uvs1 * bary.ddy;
+
+    int colorTex = draw.textures.x;
+    int physicalDescTex = draw.textures.y;
+    int normalTex = draw.textures.z;
+    int occlusionTex = draw.textures.w;
+    int emissiveTex = draw.texturesExt.x;
+
+    vec3 N = material.normalTextureSet > -1 ? CalculateNormalTangent(UnpackNormalMap(SampleTexture(normalTex, inUV0, uv0Ddx, uv0Ddy)), inNormal, inTangent) : inNormal;
+
+    // 与PBRShader.frag的运行时分支一致，Alpha Mask已经在几何Pass中处理
+    MaterialFactor matFactor;
+    bool colorUV0 = material.baseColorTextureSet == 0;
+    bool physicalDescUV0 = material.physicalDescriptorTextureSet == 0;
+    if (material.workflow == PBR_WORKFLOW_SPECULAR_GLOSINESS)
+    {
+        float glossiness = material.physicalDescriptorTextureSet > -1 ? SampleTexture(physicalDescTex, physicalDescUV0 ? inUV0 : inUV1, physicalDescUV0 ? uv0Ddx : uv1Ddx, physicalDescUV0 ? uv0Ddy : uv1Ddy).a : 1.0;
+        vec4 diffuse = SRGBtoLINEAR(SampleTexture(colorTex, inUV0, uv0Ddx, uv0Ddy));
+        vec3 specular = SRGBtoLINEAR(SampleTexture(physicalDescTex, inUV0, uv0Ddx, uv0Ddy)).rgb;
+        matFactor = GetSpecularGlossinessFactor(material, diffuse, specular, glossiness);
+    }
+    else
+    {
+        vec4 baseColor = material.baseColorTextureSet > -1 ? SRGBtoLINEAR(SampleTexture(colorTex, colorUV0 ? inUV0 : inUV1, colorUV0 ? uv0Ddx : uv1Ddx, colorUV0 ? uv0Ddy : uv1Ddy)) : vec4(1.0);
+        vec4 mrSample = material.physicalDescriptorTextureSet > -1 ? SampleTexture(physicalDescTex, physicalDescUV0 ? inUV0 : inUV1, physicalDescUV0 ? uv0Ddx : uv1Ddx, physicalDescUV0 ? uv0Ddy : uv1Ddy) : vec4(1.0);
+        matFactor = GetMetallicRoughnessFactor(material, baseColor, mrSample, material.physicalDescriptorTextureSet > -1);
+    }
+
+    float ao = 1.0;
+    if (material.occlusionTextureSet > -1)
+    {
+        bool occlusionUV0 = material.occlusionTextureSet == 0;
+        ao = SampleTexture(occlusionTex, occlusionUV0 ? inUV0 : inUV1, occlusionUV0 ? uv0Ddx : uv1Ddx, occlusionUV0 ? uv0Ddy : uv1Ddy).r;
+    }
+
+    vec3 emissive = vec3(0.0f);
+    if (material.emissiveTextureSet > -1)
+    {
+        bool emissiveUV0 = material.emissiveTextureSet == 0;
+        emissive = material.emissiveFactor.rgb * material.emissiveStrength;
+        emissive *= SRGBtoLINEAR(SampleTexture(emissiveTex, emissiveUV0 ? inUV0 : inUV1, emissiveUV0 ? uv0Ddx : uv1Ddx, emissiveUV0 ? uv0Ddy : uv1Ddy)).rgb * 10.0f;
+    }
+    vec3 color = GetSurfaceLighting(inWorldPos, gl_FragCoord.xy, N, matFactor, ao, emissive);
+
+    // 输出线性HDR颜色，色调映射和Gamma在后处理中完成
+    outColor = vec4(color.rgb, matFactor.albedo.a);
+}
@@ -0,0 +1,192 @@
+#include "AssetPackage.hpp"
+
+#include <filesystem>
+
+// 各段按16字节对齐，映射后的指针可以直接使用
+#define ASSET_PACKAGE_ALIGNMENT 16ull
+
+namespace LeoVK
+{
+    static uint64_t AlignOffset(uint64_t offset)
+    {
+        return (offset + ASSET_PACKAGE_ALIGNMENT - 1) & ~(ASSET_PACKAGE_ALIGNMENT - 1);
+    }
+
+    bool AssetPackage::Open(const std::string &filename, std::string* error)
+    {
+        Close();
+        if (!mFile.Open(filename, error)) return false;
+
+        auto fail = [&](const std::string& message)
+        {
+            if (error) *error = message + " : " + filename;
+            Close();
+            return false;
+        };
+        const uint64_t fileSize = mFile.Size();
+        // 检查[offset, offset + count * elementSize)是否在文件内，避免乘法溢出
+        auto inRange = [fileSize](uint64_t offset, uint64_t count, uint64_t elementSize)
+        {
+            return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+        };
+
+        if (fileSize < sizeof(PackageHeader)) return fail("Invalid asset package");
+        memcpy(&mHeader, mFile.Data(), sizeof(PackageHeader));
+        if (mHeader.mMagic != ASSET_PACKAGE_MAGIC) return fail("Invalid asset package");
+        if (mHeader.mVersion != ASSET_PACKAGE_VERSION) return fail("Asset package version " + std::to_string(mHeader.mVersion) + " is not supported, rebake it");
+        if (!inRange(sizeof(PackageHeader), mHeader.mSourcePathSize, 1) ||
+            !inRange(mHeader.mPrimitivesOffset, mHeader.mPrimitiveCount, sizeof(PackagePrimitive)) ||
+            !inRange(mHeader.mTexturesOffset, mHeader.mTextureCount, sizeof(PackageTexture)) ||
+            !inRange(mHeader.mVerticesOffset, mHeader.mVertexCount, sizeof(Vertex)) ||
+            !inRange(mHeader.mIndicesOffset, mHeader.mIndexCount, sizeof(uint32_t)))
+        {
+            return fail("Truncated asset package");
+        }
+
+        const uint8_t* data = mFile.Data();
+        mpPrimitives = reinterpret_cast<const PackagePrimitive*>(data + mHeader.mPrimitivesOffset);
+        mpTextures = reinterpret_cast<const PackageTexture*>(data + mHeader.mTexturesOffset);
+        mpVertices = reinterpret_cast<const Vertex*>(data + mHeader.mVerticesOffset);
+        mpIndices = reinterpret_cast<const uint32_t*>(data + mHeader.mIndicesOffset);
+        for (uint32_t i = 0; i < mHeader.mTextureCount; i++)
+        {
+            const PackageTexture& texture = mpTextures[i];
+            if (texture.mFormat == VK_FORMAT_UNDEFINED) continue;
+            bool bValid = texture.mMipLevels > 0 && texture.mMipLevels <= ASSET_PACKAGE_MAX_MIP_LEVELS && inRange(texture.mDataOffset, texture.mDataSize, 1);
+            for (uint32_t level = 0; bValid && level < texture.mMipLevels; level++) bValid = texture.mMipOffsets[level] < texture.mDataSize;
+            if (!bValid) return fail("Truncated asset package");
+        }
+
+        // 源路径相对包所在的目录保存，包和源文件可以一起移动
+        std::filesystem::path sourcePath(std::string(reinterpret_cast<const char*>(data + sizeof(PackageHeader)), mHeader.mSourcePathSize));
+        if (sourcePath.is_relative()) sourcePath = std::filesystem::path(filename).parent_path() / sourcePath;
+        mSourcePath = sourcePath.lexically_normal().string();
+        return true;
+    }
+
+    void AssetPackage::Close()
+    {
+        mFile.Close();
+        mHeader = {};
+        mSourcePath.clear();
+        mpPrimitives = nullptr;
+        mpTextures = nullptr;
+        mpVertices = nullptr;
+        mpIndices = nullptr;
+    }
+
+    uint64_t GetSourceStamp(const std::string& sourceFile, const tinygltf::Model& model)
+    {
+        // FNV-1a，找不到的文件记为大小和时间都是0
+        uint64_t hash = 14695981039346656037ull;
+        auto hashFile = [&hash](const std::filesystem::path& path)
+        {
+            std::error_code ec;
+            uint64_t values[2] = {};
+            values[0] = std::filesystem::file_size(path, ec);
+            if (ec) values[0] = 0;
+            const auto writeTime = std::filesystem::last_write_time(path, ec);
+            values[1] = ec ? 0 : static_cast<uint64_t>(writeTime.time_since_epoch().count());
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(values);
+            for (size_t i = 0; i < sizeof(values); i++)
+            {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        };
+
+        const std::filesystem::path sourcePath(sourceFile);
+        hashFile(sourcePath);
+        auto hashUri = [&](const std::string& uri)
+        {
+            // 与tinygltf一致，外部文件相对源文件所在的目录
+            if (uri.empty() || uri.compare(0, 5, "data:") == 0) return;
+            hashFile(sourcePath.parent_path() / uri);
+        };
+        for (const auto& buffer : model.buffers) hashUri(buffer.uri);
+        for (const auto& image : model.images) hashUri(image.uri);
+        return hash;
+    }
+
+    bool WriteAssetPackage(const std::string &filename, const PackageContents &contents, std::string* error)
+    {
+        PackageHeader header{};
+        header.mMagic = ASSET_PACKAGE_MAGIC;
+        header.mVersion = ASSET_PACKAGE_VERSION;
+        header.mSourceHash = contents.mSourceHash;
+        header.mSourceStamp = contents.mSourceStamp;
+        header.mLoadingFlags = contents.mLoadingFlags;
+        header.mPrimitiveCount = static_cast<uint32_t>(contents.mPrimitives.size());
+        header.mTextureCount = static_cast<uint32_t>(contents.mTextures.size());
+        header.mSourcePathSize = static_cast<uint32_t>(contents.mSourcePath.size());
+        header.mVertexCount = contents.mVertices.size();
+        header.mIndexCount = contents.mIndices.size();
+        header.mPrimitivesOffset = AlignOffset(sizeof(PackageHeader) + contents.mSourcePath.size());
+        header.mTexturesOffset = AlignOffset(header.mPrimitivesOffset + contents.mPrimitives.size() * sizeof(PackagePrimitive));
+        header.mVerticesOffset = AlignOffset(header.mTexturesOffset + contents.mTextures.size() * sizeof(PackageTexture));
+        header.mIndicesOffset = AlignOffset(header.mVerticesOffset + contents.mVertices.size() * sizeof(Vertex));
+
+        uint64_t dataOffset = header.mIndicesOffset + contents.mIndices.size() * sizeof(uint32_t);
+        std::vector<PackageTexture> textures(contents.mTextures.size());
+        for (size_t i = 0; i < contents.mTextures.size(); i++)
+        {
+            const CompressedImage& image = contents.mTextures[i];
+            PackageTexture& texture = textures[i];
+            texture = {};
+            if (image.mData.empty()) continue;
+            if (image.mMipLevels > ASSET_PACKAGE_MAX_MIP_LEVELS)
+            {
+                if (error) *error = "Texture " + std::to_string(i) + " has too many mip levels";
+                return false;
+            }
+            dataOffset = AlignOffset(dataOffset);
+            texture.mFormat = image.mFormat;
+            texture.mWidth = image.mWidth;
+            texture.mHeight = image.mHeight;
+            texture.mMipLevels = image.mMipLevels;
+            texture.mDataOffset = dataOffset;
+            texture.mDataSize = image.mData.size();
+            for (uint32_t level = 0; level < image.mMipLevels; level++) texture.mMipOffsets[level] = image.mMipOffsets[level];
+            dataOffset += image.mData.size();
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), ec);
+        std::string tmpPath = filename + ".tmp";
+        std::ofstream os(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!os.is_open())
+        {
+            if (error) *error = "Could not write asset package : " + filename;
+            return false;
+        }
+
+        auto writeAt = [&os](uint64_t offset, const void* data, size_t size)
+        {
+            // 对齐产生的空隙补0
+            static const char zeros[ASSET_PACKAGE_ALIGNMENT] = {};
+            while ((uint64_t)os.tellp() < offset) os.write(zeros, (std::streamsize)std::min<uint64_t>(ASSET_PACKAGE_ALIGNMENT, offset - (uint64_t)os.tellp()));
+            if (size > 0) os.write(static_cast<const char*>(data), (std::streamsize)size);
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(sizeof(header), contents.mSourcePath.data(), contents.mSourcePath.size());
+        writeAt(header.mPrimitivesOffset, contents.mPrimitives.data(), contents.mPrimitives.size() * sizeof(PackagePrimitive));
+        writeAt(header.mTexturesOffset, textures.data(), textures.size() * sizeof(PackageTexture));
+        writeAt(header.mVerticesOffset, contents.mVertices.data(), contents.mVertices.size() * sizeof(Vertex));
+        writeAt(header.mIndicesOffset, contents.mIndices.data(), contents.mIndices.size() * sizeof(uint32_t));
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            if (textures[i].mFormat != VK_FORMAT_UNDEFINED) writeAt(textures[i].mDataOffset, contents.mTextures[i].mData.data(), contents.mTextures[i].mData.size());
+        }
+        const bool bWritten = os.good();
+        os.close();
+
+        if (bWritten) std::filesystem::rename(tmpPath, filename, ec);
+        if (!bWritten || ec)
+        {
+            std::filesystem::remove(tmpPath, ec);
+            if (error) *error = "Could not write asset package : " + filename;
+            return false;
+        }
+        return true;
+    }
+}
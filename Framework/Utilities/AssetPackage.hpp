@@ -0,0 +1,104 @@
+#pragma once
+
+#include "ProjectPCH.hpp"
+
+#include "AssetsLoader.hpp"
+#include "TextureCompressor.hpp"
+#include "MappedFile.hpp"
+
+// 包的格式变化时增加，旧的包需要重新烘焙
+#define ASSET_PACKAGE_VERSION 2
+#define ASSET_PACKAGE_MAGIC 0x474B504Cu     // "LPKG"
+#define ASSET_PACKAGE_MAX_MIP_LEVELS 16
+
+namespace LeoVK
+{
+    // 影响顶点和索引内容的加载标志，烘焙和加载时必须一致
+    const uint32_t PACKAGE_GEOMETRY_FLAGS =
+        FileLoadingFlags::PreTransformVertices | FileLoadingFlags::PreMultiplyVertexColors |
+        FileLoadingFlags::FlipY | FileLoadingFlags::SmoothNormals;
+
+    struct PackageHeader
+    {
+        uint32_t mMagic;
+        uint32_t mVersion;
+        uint64_t mSourceHash;           // 源glTF、Buffer、图像和烘焙参数的哈希，只用于增量烘焙
+        uint64_t mSourceStamp;          // GetSourceStamp的结果，加载时比较，不读取文件内容就能发现源文件被修改
+        uint32_t mLoadingFlags;         // 烘焙时使用的PACKAGE_GEOMETRY_FLAGS
+        uint32_t mPrimitiveCount;
+        uint32_t mTextureCount;
+        uint32_t mSourcePathSize;       // 源glTF相对包所在目录的路径，紧跟在头之后
+        uint64_t mVertexCount;
+        uint64_t mIndexCount;
+        uint64_t mPrimitivesOffset;
+        uint64_t mTexturesOffset;
+        uint64_t mVerticesOffset;
+        uint64_t mIndicesOffset;
+    };
+
+    // 顺序与LoadNode遍历节点的顺序一致，索引是整个场景顶点Buffer中的绝对位置
+    struct PackagePrimitive
+    {
+        uint32_t    mFirstIndex;
+        uint32_t    mIndexCount;
+        uint32_t    mFirstVertex;
+        uint32_t    mVertexCount;
+        glm::vec3   mMin;
+        glm::vec3   mMax;
+    };
+
+    // 与glTF的textures一一对应，带完整Mip链的块压缩数据
+    struct PackageTexture
+    {
+        uint32_t mFormat;               // VkFormat，VK_FORMAT_UNDEFINED表示源图像无法解码，加载时使用占位纹理
+        uint32_t mWidth;
+        uint32_t mHeight;
+        uint32_t mMipLevels;
+        uint64_t mDataOffset;           // 相对文件开头
+        uint64_t mDataSize;
+        uint64_t mMipOffsets[ASSET_PACKAGE_MAX_MIP_LEVELS];    // 相对mDataOffset
+    };
+
+    /**
+     * @brief 离线烘焙的场景包，顶点、索引和纹理都是GPU直接使用的格式
+     * @note 读取时映射整个文件，各段指针直接指向映射的内存，在Close或者析构前有效
+     */
+    class AssetPackage
+    {
+    public:
+        bool Open(const std::string& filename, std::string* error = nullptr);
+        void Close();
+
+        const uint8_t* GetTextureData(const PackageTexture& texture) const { return mFile.Data() + texture.mDataOffset; }
+
+    public:
+        PackageHeader               mHeader{};
+        std::string                 mSourcePath;    // 已经解析为可以直接打开的路径
+        const PackagePrimitive*     mpPrimitives = nullptr;
+        const PackageTexture*       mpTextures = nullptr;
+        const Vertex*               mpVertices = nullptr;
+        const uint32_t*             mpIndices = nullptr;
+
+    private:
+        LeoVK::MappedFile mFile;
+    };
+
+    // 烘焙工具写入的内容，mTextures为空数据的项写为VK_FORMAT_UNDEFINED
+    struct PackageContents
+    {
+        uint64_t                        mSourceHash = 0;
+        uint64_t                        mSourceStamp = 0;
+        uint32_t                        mLoadingFlags = 0;
+        std::string                     mSourcePath;
+        std::vector<PackagePrimitive>   mPrimitives;
+        std::vector<Vertex>             mVertices;
+        std::vector<uint32_t>           mIndices;
+        std::vector<CompressedImage>    mTextures;
+    };
+
+    // 源glTF和它引用的外部Buffer、图像文件的大小和修改时间的哈希，嵌入的数据已经包含在源文件中
+    uint64_t GetSourceStamp(const std::string& sourceFile, const tinygltf::Model& model);
+
+    // 先写临时文件再替换，避免中途退出留下损坏的包
+    bool WriteAssetPackage(const std::string& filename, const PackageContents& contents, std::string* error = nullptr);
+}
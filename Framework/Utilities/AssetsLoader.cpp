@@ -3,15 +3,63 @@
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 
 #include "AssetsLoader.hpp"
+#include "VKMipGenerator.hpp"
+#include "TextureCompressor.hpp"
+#include "ThreadPool.hpp"
+#include "MappedFile.hpp"
+#include "TangentGenerator.hpp"
+#include "AssetPackage.hpp"
+#include "KTX2Reader.hpp"
+
+#include <psapi.h>
+#include <climits>
+
+// 流式加载时顶点和索引Staging Buffer各自的大小
+#define STREAM_STAGING_SIZE (32ull * 1024 * 1024)
 
 namespace LeoVK
 {
+    static void CreateSamplerAndView(LeoVK::Texture* texture, VkFormat format, TextureSampler textureSampler)
+    {
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = textureSampler.mMagFilter;
+        samplerInfo.minFilter = textureSampler.mMinFilter;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = textureSampler.mAddressModeU;
+        samplerInfo.addressModeV = textureSampler.mAddressModeV;
+        samplerInfo.addressModeW = textureSampler.mAddressModeW;
+        samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+        samplerInfo.maxAnisotropy = 1.0;
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxLod = (float)texture->mMipLevels;
+        samplerInfo.maxAnisotropy = 8.0f;
+        samplerInfo.anisotropyEnable = VK_TRUE;
+        texture->mSampler = texture->mpDevice->AcquireSampler(samplerInfo);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = texture->mImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.layerCount = 1;
+        viewInfo.subresourceRange.levelCount = texture->mMipLevels;
+        VK_CHECK(vkCreateImageView(texture->mpDevice->mLogicalDevice, &viewInfo, nullptr, &texture->mView));
+
+        texture->UpdateDescriptor();
+    }
+
     void LoadFromImage(
         LeoVK::Texture* texture,
         tinygltf::Image& gltfImage,
         TextureSampler textureSampler,
         LeoVK::VulkanDevice *device,
-        VkQueue copyQueue)
+        VkQueue copyQueue,
+        LeoVK::MipGenerator* mipGenerator = nullptr,
+        bool bSRGB = false)
     {
         texture->mpDevice = device;
         
@@ -49,28 +97,8 @@ namespace LeoVK
         assert(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_2_BLIT_SRC_BIT);
         assert(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_2_BLIT_DST_BIT);
 
-        VkMemoryAllocateInfo memAI = LeoVK::Init::MemoryAllocateInfo();
-        VkMemoryRequirements memReqs;
-
-        VkBuffer stageBuffer;
-        VkDeviceMemory stageMem;
-
-        VkBufferCreateInfo bufferCI = LeoVK::Init::BufferCreateInfo();
-        bufferCI.size = bufferSize;
-        bufferCI.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        VK_CHECK(vkCreateBuffer(texture->mpDevice->mLogicalDevice, &bufferCI, nullptr, &stageBuffer))
-        vkGetBufferMemoryRequirements(texture->mpDevice->mLogicalDevice, stageBuffer, &memReqs);
-        memAI.allocationSize = memReqs.size;
-        memAI.memoryTypeIndex = texture->mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        VK_CHECK(vkAllocateMemory(texture->mpDevice->mLogicalDevice, &memAI, nullptr, &stageMem))
-        VK_CHECK(vkBindBufferMemory(texture->mpDevice->mLogicalDevice, stageBuffer, stageMem, 0))
-
-        uint8_t* data;
-        VK_CHECK(vkMapMemory(texture->mpDevice->mLogicalDevice, stageMem, 0, memReqs.size, 0, (void**)&data))
-        memcpy(data, buffer, bufferSize);
-        vkUnmapMemory(texture->mpDevice->mLogicalDevice, stageMem);
+        // 尺寸在Compute生成的范围内时，上传和Mip生成都录制到MipGenerator的批次中
+        const bool bComputeMips = mipGenerator != nullptr && mipGenerator->IsSupported(texture->mWidth, texture->mHeight);
 
         VkImageCreateInfo imageCI = LeoVK::Init::ImageCreateInfo();
         imageCI.imageType = VK_IMAGE_TYPE_2D;
@@ -84,79 +112,30 @@ namespace LeoVK
         imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         imageCI.extent = { texture->mWidth, texture->mHeight, 1 };
         imageCI.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        if (bComputeMips) imageCI.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
         VK_CHECK(vkCreateImage(texture->mpDevice->mLogicalDevice, &imageCI, nullptr, &texture->mImage))
-        vkGetImageMemoryRequirements(texture->mpDevice->mLogicalDevice, texture->mImage, &memReqs);
-        memAI.allocationSize = memReqs.size;
-        memAI.memoryTypeIndex = texture->mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        VK_CHECK(vkAllocateMemory(texture->mpDevice->mLogicalDevice, &memAI, nullptr, &texture->mDeviceMemory))
-        VK_CHECK(vkBindImageMemory(texture->mpDevice->mLogicalDevice, texture->mImage, texture->mDeviceMemory, 0))
-
-        VkCommandBuffer copyCmd = texture->mpDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-        VkImageSubresourceRange subresourceRange = {};
-        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        subresourceRange.levelCount = 1;
-        subresourceRange.layerCount = 1;
-        {
-            VkImageMemoryBarrier imageMemoryBarrier{};
-            imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-            imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            imageMemoryBarrier.srcAccessMask = 0;
-            imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            imageMemoryBarrier.image = texture->mImage;
-            imageMemoryBarrier.subresourceRange = subresourceRange;
-            vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-        }
-        VkBufferImageCopy bufferCopyRegion = {};
-        bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        bufferCopyRegion.imageSubresource.mipLevel = 0;
-        bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-        bufferCopyRegion.imageSubresource.layerCount = 1;
-        bufferCopyRegion.imageExtent.width = texture->mWidth;
-        bufferCopyRegion.imageExtent.height = texture->mHeight;
-        bufferCopyRegion.imageExtent.depth = 1;
-        vkCmdCopyBufferToImage(copyCmd, stageBuffer, texture->mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-        {
-            VkImageMemoryBarrier imageMemoryBarrier{};
-            imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-            imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            imageMemoryBarrier.image = texture->mImage;
-            imageMemoryBarrier.subresourceRange = subresourceRange;
-            vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-        }
-        texture->mpDevice->FlushCommandBuffer(copyCmd, copyQueue, true);
-        vkFreeMemory(texture->mpDevice->mLogicalDevice, stageMem, nullptr);
-        vkDestroyBuffer(texture->mpDevice->mLogicalDevice, stageBuffer, nullptr);
-
-        // Generate the mip chain (glTF uses jpg and png, so we need to create this manually)
-        VkCommandBuffer blitCmd = texture->mpDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-        for (uint32_t i = 1; i < texture->mMipLevels; i++)
-        {
-            VkImageBlit imageBlit{};
-
-            imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            imageBlit.srcSubresource.layerCount = 1;
-            imageBlit.srcSubresource.mipLevel = i - 1;
-            imageBlit.srcOffsets[1].x = int32_t(texture->mWidth >> (i - 1));
-            imageBlit.srcOffsets[1].y = int32_t(texture->mHeight >> (i - 1));
-            imageBlit.srcOffsets[1].z = 1;
-
-            imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            imageBlit.dstSubresource.layerCount = 1;
-            imageBlit.dstSubresource.mipLevel = i;
-            imageBlit.dstOffsets[1].x = int32_t(texture->mWidth >> i);
-            imageBlit.dstOffsets[1].y = int32_t(texture->mHeight >> i);
-            imageBlit.dstOffsets[1].z = 1;
-
-            VkImageSubresourceRange mipSubRange = {};
-            mipSubRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            mipSubRange.baseMipLevel = i;
-            mipSubRange.levelCount = 1;
-            mipSubRange.layerCount = 1;
+        VK_CHECK(texture->mpDevice->AllocateImageMemory(texture->mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Texture, LeoVK::MemoryCategory::Texture, &texture->mDeviceMemory))
+
+        if (bComputeMips)
+        {
+            mipGenerator->Add(texture, buffer, bufferSize, bSRGB);
+        }
+        else
+        {
+            LeoVK::Buffer stageBuffer;
+            VK_CHECK(texture->mpDevice->CreateBuffer(
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                &stageBuffer,
+                bufferSize,
+                buffer))
+
+            VkCommandBuffer copyCmd = texture->mpDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+
+            VkImageSubresourceRange subresourceRange = {};
+            subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            subresourceRange.levelCount = 1;
+            subresourceRange.layerCount = 1;
             {
                 VkImageMemoryBarrier imageMemoryBarrier{};
                 imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -165,10 +144,18 @@ namespace LeoVK
                 imageMemoryBarrier.srcAccessMask = 0;
                 imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
                 imageMemoryBarrier.image = texture->mImage;
-                imageMemoryBarrier.subresourceRange = mipSubRange;
-                vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+                imageMemoryBarrier.subresourceRange = subresourceRange;
+                vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
             }
-            vkCmdBlitImage(blitCmd, texture->mImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture->mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
+            VkBufferImageCopy bufferCopyRegion = {};
+            bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            bufferCopyRegion.imageSubresource.mipLevel = 0;
+            bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+            bufferCopyRegion.imageSubresource.layerCount = 1;
+            bufferCopyRegion.imageExtent.width = texture->mWidth;
+            bufferCopyRegion.imageExtent.height = texture->mHeight;
+            bufferCopyRegion.imageExtent.depth = 1;
+            vkCmdCopyBufferToImage(copyCmd, stageBuffer.mBuffer, texture->mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
             {
                 VkImageMemoryBarrier imageMemoryBarrier{};
                 imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -177,57 +164,131 @@ namespace LeoVK
                 imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
                 imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
                 imageMemoryBarrier.image = texture->mImage;
-                imageMemoryBarrier.subresourceRange = mipSubRange;
-                vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+                imageMemoryBarrier.subresourceRange = subresourceRange;
+                vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
             }
-        }
+            texture->mpDevice->FlushCommandBuffer(copyCmd, copyQueue, true);
+            stageBuffer.Destroy();
 
-        subresourceRange.levelCount = texture->mMipLevels;
-        texture->mImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        {
-            VkImageMemoryBarrier imageMemoryBarrier{};
-            imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-            imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            imageMemoryBarrier.image = texture->mImage;
-            imageMemoryBarrier.subresourceRange = subresourceRange;
-            vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+            // Generate the mip chain (glTF uses jpg and png, so we need to create this manually)
+            VkCommandBuffer blitCmd = texture->mpDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+            for (uint32_t i = 1; i < texture->mMipLevels; i++)
+            {
+                VkImageBlit imageBlit{};
+
+                imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                imageBlit.srcSubresource.layerCount = 1;
+                imageBlit.srcSubresource.mipLevel = i - 1;
+                imageBlit.srcOffsets[1].x = int32_t(texture->mWidth >> (i - 1));
+                imageBlit.srcOffsets[1].y = int32_t(texture->mHeight >> (i - 1));
+                imageBlit.srcOffsets[1].z = 1;
+
+                imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                imageBlit.dstSubresource.layerCount = 1;
+                imageBlit.dstSubresource.mipLevel = i;
+                imageBlit.dstOffsets[1].x = int32_t(texture->mWidth >> i);
+                imageBlit.dstOffsets[1].y = int32_t(texture->mHeight >> i);
+                imageBlit.dstOffsets[1].z = 1;
+
+                VkImageSubresourceRange mipSubRange = {};
+                mipSubRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                mipSubRange.baseMipLevel = i;
+                mipSubRange.levelCount = 1;
+                mipSubRange.layerCount = 1;
+                {
+                    VkImageMemoryBarrier imageMemoryBarrier{};
+                    imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                    imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                    imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                    imageMemoryBarrier.srcAccessMask = 0;
+                    imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                    imageMemoryBarrier.image = texture->mImage;
+                    imageMemoryBarrier.subresourceRange = mipSubRange;
+                    vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+                }
+                vkCmdBlitImage(blitCmd, texture->mImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture->mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
+                {
+                    VkImageMemoryBarrier imageMemoryBarrier{};
+                    imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                    imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                    imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                    imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                    imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                    imageMemoryBarrier.image = texture->mImage;
+                    imageMemoryBarrier.subresourceRange = mipSubRange;
+                    vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+                }
+            }
+
+            subresourceRange.levelCount = texture->mMipLevels;
+            texture->mImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            {
+                VkImageMemoryBarrier imageMemoryBarrier{};
+                imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                imageMemoryBarrier.image = texture->mImage;
+                imageMemoryBarrier.subresourceRange = subresourceRange;
+                vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+            }
+            texture->mpDevice->FlushCommandBuffer(blitCmd, copyQueue, true);
         }
-        texture->mpDevice->FlushCommandBuffer(blitCmd, copyQueue, true);
 
-        VkSamplerCreateInfo samplerInfo{};
-        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-        samplerInfo.magFilter = textureSampler.mMagFilter;
-        samplerInfo.minFilter = textureSampler.mMinFilter;
-        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-        samplerInfo.addressModeU = textureSampler.mAddressModeU;
-        samplerInfo.addressModeV = textureSampler.mAddressModeV;
-        samplerInfo.addressModeW = textureSampler.mAddressModeW;
-        samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
-        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-        samplerInfo.maxAnisotropy = 1.0;
-        samplerInfo.anisotropyEnable = VK_FALSE;
-        samplerInfo.maxLod = (float)texture->mMipLevels;
-        samplerInfo.maxAnisotropy = 8.0f;
-        samplerInfo.anisotropyEnable = VK_TRUE;
-        VK_CHECK(vkCreateSampler(texture->mpDevice->mLogicalDevice, &samplerInfo, nullptr, &texture->mSampler));
+        CreateSamplerAndView(texture, format, textureSampler);
 
-        VkImageViewCreateInfo viewInfo{};
-        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        viewInfo.image = texture->mImage;
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        viewInfo.format = format;
-        viewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
-        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        viewInfo.subresourceRange.layerCount = 1;
-        viewInfo.subresourceRange.levelCount = texture->mMipLevels;
-        VK_CHECK(vkCreateImageView(texture->mpDevice->mLogicalDevice, &viewInfo, nullptr, &texture->mView));
+        if (deleteBuffer) delete[] buffer;
+    }
 
-        texture->UpdateDescriptor();
+    // 运行时压缩和烘焙包中的纹理都是带完整Mip链的块压缩数据，各级数据在data中的偏移由mipOffsets给出
+    void LoadFromCompressedImage(
+        LeoVK::Texture* texture,
+        VkFormat format,
+        uint32_t width,
+        uint32_t height,
+        uint32_t mipLevels,
+        const void* data,
+        VkDeviceSize dataSize,
+        const VkDeviceSize* mipOffsets,
+        TextureSampler textureSampler,
+        LeoVK::VulkanDevice *device,
+        LeoVK::MipGenerator* uploader)
+    {
+        texture->mpDevice = device;
+        texture->mWidth = width;
+        texture->mHeight = height;
+        texture->mMipLevels = mipLevels;
 
-        if (deleteBuffer) delete[] buffer;
+        VkImageCreateInfo imageCI = LeoVK::Init::ImageCreateInfo();
+        imageCI.imageType = VK_IMAGE_TYPE_2D;
+        imageCI.format = format;
+        imageCI.mipLevels = texture->mMipLevels;
+        imageCI.arrayLayers = 1;
+        imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageCI.extent = { texture->mWidth, texture->mHeight, 1 };
+        imageCI.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        VK_CHECK(vkCreateImage(device->mLogicalDevice, &imageCI, nullptr, &texture->mImage))
+        VK_CHECK(device->AllocateImageMemory(texture->mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Texture, LeoVK::MemoryCategory::Texture, &texture->mDeviceMemory))
+
+        // 所有Mip已经在CPU上压缩好，一个Region对应一级
+        std::vector<VkBufferImageCopy> regions(texture->mMipLevels);
+        for (uint32_t level = 0; level < texture->mMipLevels; level++)
+        {
+            VkBufferImageCopy& region = regions[level];
+            region = {};
+            region.bufferOffset = mipOffsets[level];
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = level;
+            region.imageSubresource.layerCount = 1;
+            region.imageExtent = { std::max(1u, texture->mWidth >> level), std::max(1u, texture->mHeight >> level), 1 };
+        }
+        uploader->AddUpload(texture, data, dataSize, regions);
+
+        CreateSamplerAndView(texture, format, textureSampler);
     }
 
     BoundingBox::BoundingBox() {}
@@ -272,6 +333,8 @@ namespace LeoVK
     {
         this->mpDevice = device;
         this->mUniformBlock.mMatrix = matrix;
+        // 离线烘焙时没有设备，只需要Primitive
+        if (device == nullptr) return;
         VK_CHECK(device->CreateBuffer(
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
@@ -279,18 +342,13 @@ namespace LeoVK
             &mUniformBuffer.mBuffer,
             &mUniformBuffer.mMemory,
             &mUniformBlock));
-        VK_CHECK(vkMapMemory(
-            mpDevice->mLogicalDevice,
-            mUniformBuffer.mMemory, 0,
-            sizeof(mUniformBlock), 0,
-            &mUniformBuffer.mpMapped));
+        mUniformBuffer.mpMapped = mpDevice->GetMappedData(mUniformBuffer.mBuffer);
         mUniformBuffer.mDescriptor = {mUniformBuffer.mBuffer, 0, sizeof(mUniformBlock)};
     }
 
     Mesh::~Mesh()
     {
-        vkDestroyBuffer(mpDevice->mLogicalDevice, mUniformBuffer.mBuffer, nullptr);
-        vkFreeMemory(mpDevice->mLogicalDevice, mUniformBuffer.mMemory, nullptr);
+        if (mpDevice) mpDevice->DeferDestroyBuffer(mUniformBuffer.mBuffer);
         for (auto primitive : mPrimitives) delete primitive;
     }
 
@@ -361,20 +419,22 @@ namespace LeoVK
 
     void GLTFScene::Destroy(VkDevice device)
     {
+        // 切换场景时旧场景可能还被正在执行的帧引用，GPU资源都在帧结束后销毁
         if (mVertices.mBuffer != VK_NULL_HANDLE)
         {
-            vkDestroyBuffer(device, mVertices.mBuffer, nullptr);
-            vkFreeMemory(device, mVertices.mMemory, nullptr);
+            mpDevice->DeferDestroyBuffer(mVertices.mBuffer);
             mVertices.mBuffer = VK_NULL_HANDLE;
         }
         if (mIndices.mBuffer != VK_NULL_HANDLE)
         {
-            vkDestroyBuffer(device, mIndices.mBuffer, nullptr);
-            vkFreeMemory(device, mIndices.mMemory, nullptr);
+            mpDevice->DeferDestroyBuffer(mIndices.mBuffer);
             mIndices.mBuffer = VK_NULL_HANDLE;
         }
 
-        for (auto texture : mTextures) texture.Destroy();
+        for (auto texture : mTextures)
+        {
+            if (texture.mImage != VK_NULL_HANDLE) texture.DeferDestroy();
+        }
 
         mTextures.resize(0);
         mTexSamplers.resize(0);
@@ -383,6 +443,7 @@ namespace LeoVK
 
         mMaterials.resize(0);
         mAnimations.resize(0);
+        mLights.resize(0);
         mNodes.resize(0);
         mLinearNodes.resize(0);
         mExtensions.resize(0);
@@ -392,6 +453,252 @@ namespace LeoVK
         mSkins.resize(0);
     }
 
+    static void FinalizeVertex(Vertex& vert, uint32_t fileLoadingFlags, const glm::mat4& matrix, const glm::vec4& baseColorFactor)
+    {
+        if (fileLoadingFlags & FileLoadingFlags::PreTransformVertices)
+        {
+            vert.mPos = glm::vec3(matrix * glm::vec4(vert.mPos, 1.0f));
+            vert.mNormal = glm::normalize(glm::mat3(matrix) * vert.mNormal);
+            vert.mTangent = glm::vec4(glm::normalize(glm::mat3(matrix) * glm::vec3(vert.mTangent)), vert.mTangent.w);
+        }
+        if (fileLoadingFlags & FileLoadingFlags::FlipY)
+        {
+            vert.mPos.y *= -1.0f;
+            vert.mNormal.y *= -1.0f;
+            vert.mTangent.y *= -1.0f;
+        }
+        if (fileLoadingFlags & FileLoadingFlags::PreMultiplyVertexColors)
+        {
+            vert.mColor = baseColorFactor * vert.mColor;
+        }
+    }
+
+    /**
+     * 按顺序读取Primitive的每个顶点，转换为Vertex后交给emit
+     */
+    template <typename EmitVertex>
+    static void ReadPrimitiveVertices(const tinygltf::Model& model, const tinygltf::Primitive& primitive, EmitVertex&& emit)
+    {
+        const float* bufferPos = nullptr;
+        const float* bufferNormals = nullptr;
+        const float* bufferTexCoordSet0 = nullptr;
+        const float* bufferTexCoordSet1 = nullptr;
+        const float* bufferColorSet0 = nullptr;
+        const float* bufferTangents = nullptr;
+        const void * bufferJoints = nullptr;
+        const float* bufferWeights = nullptr;
+
+        uint32_t posByteStride;
+        uint32_t normByteStride;
+        uint32_t uv0ByteStride;
+        uint32_t uv1ByteStride;
+        uint32_t color0ByteStride;
+        uint32_t jointByteStride;
+        uint32_t weightByteStride;
+
+        int jointComponentType;
+
+        // Position attribute is required
+        assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
+
+        const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
+        const tinygltf::BufferView &posView = model.bufferViews[posAccessor.bufferView];
+
+        bufferPos = reinterpret_cast<const float *>(&(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
+        posByteStride = posAccessor.ByteStride(posView) ? (posAccessor.ByteStride(posView) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC3);
+
+        if (primitive.attributes.find("NORMAL") != primitive.attributes.end())
+        {
+            const tinygltf::Accessor &normAccessor = model.accessors[primitive.attributes.find("NORMAL")->second];
+            const tinygltf::BufferView &normView = model.bufferViews[normAccessor.bufferView];
+            bufferNormals = reinterpret_cast<const float *>(&(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
+            normByteStride = normAccessor.ByteStride(normView) ? (normAccessor.ByteStride(normView) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC3);
+        }
+
+        // UVs
+        if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end())
+        {
+            const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
+            const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
+            bufferTexCoordSet0 = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+            uv0ByteStride = uvAccessor.ByteStride(uvView) ? (uvAccessor.ByteStride(uvView) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC2);
+        }
+        if (primitive.attributes.find("TEXCOORD_1") != primitive.attributes.end())
+        {
+            const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_1")->second];
+            const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
+            bufferTexCoordSet1 = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+            uv1ByteStride = uvAccessor.ByteStride(uvView) ? (uvAccessor.ByteStride(uvView) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC2);
+        }
+
+        // Vertex colors
+        if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
+        {
+            const tinygltf::Accessor& accessor = model.accessors[primitive.attributes.find("COLOR_0")->second];
+            const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+            bufferColorSet0 = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
+            color0ByteStride = accessor.ByteStride(view) ? (accessor.ByteStride(view) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC3);
+        }
+        
+        if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
+        {
+            const tinygltf::Accessor &tangentAccessor = model.accessors[primitive.attributes.find("TANGENT")->second];
+            const tinygltf::BufferView &tangentView = model.bufferViews[tangentAccessor.bufferView];
+            bufferTangents = reinterpret_cast<const float *>(&(model.buffers[tangentView.buffer].data[tangentAccessor.byteOffset + tangentView.byteOffset]));
+        }
+
+        // Skinning
+        // Joints
+        if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end())
+        {
+            const tinygltf::Accessor &jointAccessor = model.accessors[primitive.attributes.find("JOINTS_0")->second];
+            const tinygltf::BufferView &jointView = model.bufferViews[jointAccessor.bufferView];
+            bufferJoints = &(model.buffers[jointView.buffer].data[jointAccessor.byteOffset + jointView.byteOffset]);
+            jointComponentType = jointAccessor.componentType;
+            jointByteStride = jointAccessor.ByteStride(jointView) ? (jointAccessor.ByteStride(jointView) / tinygltf::GetComponentSizeInBytes(jointComponentType)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC4);
+        }
+
+        if (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end())
+        {
+            const tinygltf::Accessor &weightAccessor = model.accessors[primitive.attributes.find("WEIGHTS_0")->second];
+            const tinygltf::BufferView &weightView = model.bufferViews[weightAccessor.bufferView];
+            bufferWeights = reinterpret_cast<const float *>(&(model.buffers[weightView.buffer].data[weightAccessor.byteOffset + weightView.byteOffset]));
+            weightByteStride = weightAccessor.ByteStride(weightView) ? (weightAccessor.ByteStride(weightView) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC4);
+        }
+
+        const bool hasSkin = (bufferJoints && bufferWeights);
+
+        for (size_t v = 0; v < posAccessor.count; v++)
+        {
+            Vertex vert{};
+            vert.mPos = glm::vec4(glm::make_vec3(&bufferPos[v * posByteStride]), 1.0f);
+            vert.mNormal = glm::normalize(glm::vec3(bufferNormals ? glm::make_vec3(&bufferNormals[v * normByteStride]) : glm::vec3(0.0f)));
+            vert.mUV0 = bufferTexCoordSet0 ? glm::make_vec2(&bufferTexCoordSet0[v * uv0ByteStride]) : glm::vec3(0.0f);
+            vert.mUV1 = bufferTexCoordSet1 ? glm::make_vec2(&bufferTexCoordSet1[v * uv1ByteStride]) : glm::vec3(0.0f);
+            vert.mColor = bufferColorSet0 ? glm::make_vec4(&bufferColorSet0[v * color0ByteStride]) : glm::vec4(1.0f);
+            vert.mTangent = bufferTangents ? glm::vec4(glm::make_vec4(&bufferTangents[v * 4])) : glm::vec4(0.0f);
+            
+            if (hasSkin)
+            {
+                switch (jointComponentType)
+                {
+                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+                    {
+                        auto buf = static_cast<const uint16_t*>(bufferJoints);
+                        vert.mJoint0 = glm::vec4(glm::make_vec4(&buf[v * jointByteStride]));
+                        break;
+                    }
+                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                    {
+                        auto buf = static_cast<const uint8_t*>(bufferJoints);
+                        vert.mJoint0 = glm::vec4(glm::make_vec4(&buf[v * jointByteStride]));
+                        break;
+                    }
+                    default:
+                        // Not supported by spec
+                        std::cerr << "Joint component type " << jointComponentType << " not supported!" << std::endl;
+                        break;
+                }
+            }
+            else
+            {
+                vert.mJoint0 = glm::vec4(0.0f);
+            }
+            vert.mWeight0 = hasSkin ? glm::make_vec4(&bufferWeights[v * weightByteStride]) : glm::vec4(0.0f);
+            // Fix for all zero weights
+            if (glm::length(vert.mWeight0) == 0.0f)
+            {
+                vert.mWeight0 = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+            }
+            emit(vert);
+        }
+    }
+
+    /**
+     * 读取Primitive的索引交给emit，不支持的索引类型返回false
+     */
+    template <typename EmitIndex>
+    static bool ReadPrimitiveIndices(const tinygltf::Model& model, const tinygltf::Primitive& primitive, EmitIndex&& emit)
+    {
+        const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
+        const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+        const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+        const void *dataPtr = &(buffer.data[accessor.byteOffset + bufferView.byteOffset]);
+
+        switch (accessor.componentType)
+        {
+            case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+            {
+                auto buf = static_cast<const uint32_t*>(dataPtr);
+                for (size_t index = 0; index < accessor.count; index++) emit(buf[index]);
+                return true;
+            }
+            case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+            {
+                auto buf = static_cast<const uint16_t*>(dataPtr);
+                for (size_t index = 0; index < accessor.count; index++) emit(buf[index]);
+                return true;
+            }
+            case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+            {
+                auto buf = static_cast<const uint8_t*>(dataPtr);
+                for (size_t index = 0; index < accessor.count; index++) emit(buf[index]);
+                return true;
+            }
+            default:
+                std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
+                return false;
+        }
+    }
+
+    /**
+     * 统计场景中每个节点的Primitive对各个Buffer的引用，蒙皮和动画引用的Buffer额外加1，保留到它们读取之后
+     */
+    static void CountBufferUses(const tinygltf::Model& model, const tinygltf::Scene& scene, LoaderInfo& loaderInfo)
+    {
+        loaderInfo.mBufferUses.assign(model.buffers.size(), 0);
+        auto addUse = [&](int accessorIndex)
+        {
+            if (accessorIndex < 0 || model.accessors[accessorIndex].bufferView < 0) return;
+            loaderInfo.mBufferUses[model.bufferViews[model.accessors[accessorIndex].bufferView].buffer]++;
+        };
+        std::function<void(int)> countNode = [&](int nodeIndex)
+        {
+            const tinygltf::Node& node = model.nodes[nodeIndex];
+            for (int child : node.children) countNode(child);
+            if (node.mesh < 0) return;
+            for (const auto& primitive : model.meshes[node.mesh].primitives)
+            {
+                for (const auto& attribute : primitive.attributes) addUse(attribute.second);
+                addUse(primitive.indices);
+            }
+        };
+        for (int node : scene.nodes) countNode(node);
+        for (const auto& skin : model.skins) addUse(skin.inverseBindMatrices);
+        for (const auto& animation : model.animations)
+        {
+            for (const auto& sampler : animation.samplers)
+            {
+                addUse(sampler.input);
+                addUse(sampler.output);
+            }
+        }
+    }
+
+    // Primitive已经写入Staging，释放不再被引用的Buffer
+    static void ReleasePrimitiveBuffers(const tinygltf::Model& model, const tinygltf::Primitive& primitive, LoaderInfo& loaderInfo)
+    {
+        if (!loaderInfo.mReleaseBuffer) return;
+        auto release = [&](int accessorIndex)
+        {
+            if (accessorIndex < 0 || model.accessors[accessorIndex].bufferView < 0) return;
+            const int buffer = model.bufferViews[model.accessors[accessorIndex].bufferView].buffer;
+            if (--loaderInfo.mBufferUses[buffer] == 0) loaderInfo.mReleaseBuffer(buffer);
+        };
+        for (const auto& attribute : primitive.attributes) release(attribute.second);
+        release(primitive.indices);
+    }
+
     void GLTFScene::LoadNode(
         LeoVK::Node *parent,
         const tinygltf::Node &node,
@@ -406,6 +713,11 @@ namespace LeoVK
         newNode->mName = node.name;
         newNode->mSkinIndex = node.skin;
         newNode->mMatrix = glm::mat4(1.0f);
+        if (node.extensions.find("KHR_lights_punctual") != node.extensions.end())
+        {
+            const auto& lightExt = node.extensions.at("KHR_lights_punctual");
+            if (lightExt.Has("light")) newNode->mLightIndex = static_cast<int32_t>(lightExt.Get("light").GetNumberAsInt());
+        }
 
         // Generate local node matrix
         auto translation = glm::vec3(0.0f);
@@ -443,207 +755,79 @@ namespace LeoVK
         // Node contains mesh data
         if (node.mesh > -1)
         {
-            const tinygltf::Mesh mesh = model.meshes[node.mesh];
+            const tinygltf::Mesh& mesh = model.meshes[node.mesh];
             Mesh *newMesh = new Mesh(mpDevice, newNode->mMatrix);
             newMesh->mName = mesh.name;
-            for (const auto & primitive : mesh.primitives)
+
+            // 预变换在写入Staging Buffer之前完成，避免回读映射的内存
+            const glm::mat4 localMatrix = (loaderInfo.mFileLoadingFlags & FileLoadingFlags::PreTransformVertices) ? newNode->GetMatrix() : glm::mat4(1.0f);
+
+            for (size_t primitiveIndex = 0; primitiveIndex < mesh.primitives.size(); primitiveIndex++)
             {
+                const tinygltf::Primitive& primitive = mesh.primitives[primitiveIndex];
                 auto vertexStart = static_cast<uint32_t>(loaderInfo.mVertexPos);
                 auto indexStart = static_cast<uint32_t>(loaderInfo.mIndexPos);
                 uint32_t indexCount = 0;
                 uint32_t vertexCount = 0;
-                glm::vec3 posMin{};
-                glm::vec3 posMax{};
-                bool hasSkin = false;
                 bool hasIndices = primitive.indices > -1;
+                Material& material = primitive.material > -1 ? mMaterials[primitive.material] : mMaterials.back();
 
-                // Vertices
+                if (loaderInfo.mpPackagePrimitives)
                 {
-                    const float* bufferPos = nullptr;
-                    const float* bufferNormals = nullptr;
-                    const float* bufferTexCoordSet0 = nullptr;
-                    const float* bufferTexCoordSet1 = nullptr;
-                    const float* bufferColorSet0 = nullptr;
-                    const float* bufferTangents = nullptr;
-                    const void * bufferJoints = nullptr;
-                    const float* bufferWeights = nullptr;
-
-                    uint32_t posByteStride;
-                    uint32_t normByteStride;
-                    uint32_t uv0ByteStride;
-                    uint32_t uv1ByteStride;
-                    uint32_t color0ByteStride;
-                    uint32_t jointByteStride;
-                    uint32_t weightByteStride;
-
-                    int jointComponentType;
-
-                    // Position attribute is required
-                    assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
-
-                    const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
-                    const tinygltf::BufferView &posView = model.bufferViews[posAccessor.bufferView];
-
-                    bufferPos = reinterpret_cast<const float *>(&(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
-                    posMin = glm::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
-                    posMax = glm::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
-                    vertexCount = static_cast<uint32_t>(posAccessor.count);
-                    posByteStride = posAccessor.ByteStride(posView) ? (posAccessor.ByteStride(posView) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC3);
-
-                    if (primitive.attributes.find("NORMAL") != primitive.attributes.end())
-                    {
-                        const tinygltf::Accessor &normAccessor = model.accessors[primitive.attributes.find("NORMAL")->second];
-                        const tinygltf::BufferView &normView = model.bufferViews[normAccessor.bufferView];
-                        bufferNormals = reinterpret_cast<const float *>(&(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
-                        normByteStride = normAccessor.ByteStride(normView) ? (normAccessor.ByteStride(normView) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC3);
-                    }
-
-                    // UVs
-                    if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end())
-                    {
-                        const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
-                        const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-                        bufferTexCoordSet0 = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
-                        uv0ByteStride = uvAccessor.ByteStride(uvView) ? (uvAccessor.ByteStride(uvView) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC2);
-                    }
-                    if (primitive.attributes.find("TEXCOORD_1") != primitive.attributes.end())
-                    {
-                        const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_1")->second];
-                        const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-                        bufferTexCoordSet1 = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
-                        uv1ByteStride = uvAccessor.ByteStride(uvView) ? (uvAccessor.ByteStride(uvView) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC2);
-                    }
-
-                    // Vertex colors
-                    if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
-                    {
-                        const tinygltf::Accessor& accessor = model.accessors[primitive.attributes.find("COLOR_0")->second];
-                        const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
-                        bufferColorSet0 = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-                        color0ByteStride = accessor.ByteStride(view) ? (accessor.ByteStride(view) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC3);
-                    }
-                    
-                    if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
+                    // 烘焙包中的数据已经按同样的顺序整体拷贝，这里只建立Primitive
+                    if (loaderInfo.mPackagePrimitivePos < loaderInfo.mPackagePrimitiveCount)
                     {
-                        const tinygltf::Accessor &tangentAccessor = model.accessors[primitive.attributes.find("TANGENT")->second];
-					    const tinygltf::BufferView &tangentView = model.bufferViews[tangentAccessor.bufferView];
-					    bufferTangents = reinterpret_cast<const float *>(&(model.buffers[tangentView.buffer].data[tangentAccessor.byteOffset + tangentView.byteOffset]));
-                    }
-
-                    // Skinning
-                    // Joints
-                    if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end())
-                    {
-                        const tinygltf::Accessor &jointAccessor = model.accessors[primitive.attributes.find("JOINTS_0")->second];
-                        const tinygltf::BufferView &jointView = model.bufferViews[jointAccessor.bufferView];
-                        bufferJoints = &(model.buffers[jointView.buffer].data[jointAccessor.byteOffset + jointView.byteOffset]);
-                        jointComponentType = jointAccessor.componentType;
-                        jointByteStride = jointAccessor.ByteStride(jointView) ? (jointAccessor.ByteStride(jointView) / tinygltf::GetComponentSizeInBytes(jointComponentType)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC4);
+                        const PackagePrimitive& packed = loaderInfo.mpPackagePrimitives[loaderInfo.mPackagePrimitivePos];
+                        auto* newPrimitive = new Primitive(packed.mFirstIndex, packed.mIndexCount, packed.mVertexCount, material);
+                        newPrimitive->mFirstVertex = packed.mFirstVertex;
+                        newPrimitive->SetBoundingBox(packed.mMin, packed.mMax);
+                        newMesh->mPrimitives.push_back(newPrimitive);
                     }
+                    loaderInfo.mPackagePrimitivePos++;
+                    continue;
+                }
 
-                    if (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end())
-                    {
-                        const tinygltf::Accessor &weightAccessor = model.accessors[primitive.attributes.find("WEIGHTS_0")->second];
-                        const tinygltf::BufferView &weightView = model.bufferViews[weightAccessor.bufferView];
-                        bufferWeights = reinterpret_cast<const float *>(&(model.buffers[weightView.buffer].data[weightAccessor.byteOffset + weightView.byteOffset]));
-                        weightByteStride = weightAccessor.ByteStride(weightView) ? (weightAccessor.ByteStride(weightView) / sizeof(float)) : tinygltf::GetNumComponentsInType(TINYGLTF_TYPE_VEC4);
-                    }
+                // Position attribute is required
+                assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
+                const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
+                const glm::vec3 posMin = glm::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
+                const glm::vec3 posMax = glm::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
 
-                    hasSkin = (bufferJoints && bufferWeights);
+                auto storeVertex = [&](Vertex& vert)
+                {
+                    FinalizeVertex(vert, loaderInfo.mFileLoadingFlags, localMatrix, material.mBaseColorFactor);
+                    loaderInfo.mpVertexBuffer[loaderInfo.mVertexPos - loaderInfo.mVertexBase] = vert;
+                    loaderInfo.mVertexPos++;
+                };
+                auto storeIndex = [&](uint32_t index)
+                {
+                    loaderInfo.mpIndexBuffer[loaderInfo.mIndexPos - loaderInfo.mIndexBase] = index + vertexStart;
+                    loaderInfo.mIndexPos++;
+                };
 
-                    for (size_t v = 0; v < posAccessor.count; v++)
-                    {
-                        Vertex& vert = loaderInfo.mpVertexBuffer[loaderInfo.mVertexPos];
-                        vert.mPos = glm::vec4(glm::make_vec3(&bufferPos[v * posByteStride]), 1.0f);
-                        vert.mNormal = glm::normalize(glm::vec3(bufferNormals ? glm::make_vec3(&bufferNormals[v * normByteStride]) : glm::vec3(0.0f)));
-                        vert.mUV0 = bufferTexCoordSet0 ? glm::make_vec2(&bufferTexCoordSet0[v * uv0ByteStride]) : glm::vec3(0.0f);
-                        vert.mUV1 = bufferTexCoordSet1 ? glm::make_vec2(&bufferTexCoordSet1[v * uv1ByteStride]) : glm::vec3(0.0f);
-                        vert.mColor = bufferColorSet0 ? glm::make_vec4(&bufferColorSet0[v * color0ByteStride]) : glm::vec4(1.0f);
-                        vert.mTangent = bufferTangents ? glm::vec4(glm::make_vec4(&bufferTangents[v * 4])) : glm::vec4(0.0f);
-                        
-                        if (hasSkin)
-                        {
-                            switch (jointComponentType)
-                            {
-                                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                                {
-                                    auto buf = static_cast<const uint16_t*>(bufferJoints);
-                                    vert.mJoint0 = glm::vec4(glm::make_vec4(&buf[v * jointByteStride]));
-                                    break;
-                                }
-                                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                                {
-                                    auto buf = static_cast<const uint8_t*>(bufferJoints);
-                                    vert.mJoint0 = glm::vec4(glm::make_vec4(&buf[v * jointByteStride]));
-                                    break;
-                                }
-                                default:
-                                    // Not supported by spec
-                                    std::cerr << "Joint component type " << jointComponentType << " not supported!" << std::endl;
-                                    break;
-                            }
-                        }
-                        else
-                        {
-                            vert.mJoint0 = glm::vec4(0.0f);
-                        }
-                        vert.mWeight0 = hasSkin ? glm::make_vec4(&bufferWeights[v * weightByteStride]) : glm::vec4(0.0f);
-                        // Fix for all zero weights
-                        if (glm::length(vert.mWeight0) == 0.0f)
-                        {
-                            vert.mWeight0 = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
-                        }
-                        loaderInfo.mVertexPos++;
-                    }
+                // 缺少法线或切线的Primitive已经在GenerateMissingAttributes中生成，大小以生成后的为准
+                auto generated = loaderInfo.mGeneratedPrimitives.find({ node.mesh, primitiveIndex });
+                if (generated != loaderInfo.mGeneratedPrimitives.end())
+                {
+                    LoaderInfo::GeneratedPrimitive& generatedPrimitive = generated->second;
+                    vertexCount = static_cast<uint32_t>(generatedPrimitive.mVertices.size());
+                    indexCount = static_cast<uint32_t>(generatedPrimitive.mIndices.size());
+                    // 保证Staging Buffer能放下整个Primitive
+                    if (loaderInfo.mReserve) loaderInfo.mReserve(vertexCount, indexCount);
+                    for (Vertex vert : generatedPrimitive.mVertices) storeVertex(vert);
+                    for (uint32_t index : generatedPrimitive.mIndices) storeIndex(index);
+                    if (--generatedPrimitive.mUseCount == 0) loaderInfo.mGeneratedPrimitives.erase(generated);
                 }
-                // Indices
-                if (hasIndices)
+                else
                 {
-                    const tinygltf::Accessor &accessor = model.accessors[primitive.indices > -1 ? primitive.indices : 0];
-                    const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-                    const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-
-                    indexCount = static_cast<uint32_t>(accessor.count);
-                    const void *dataPtr = &(buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-
-                    switch (accessor.componentType)
-                    {
-                        case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
-                        {
-                            auto buf = static_cast<const uint32_t*>(dataPtr);
-                            for (size_t index = 0; index < accessor.count; index++)
-                            {
-                                loaderInfo.mpIndexBuffer[loaderInfo.mIndexPos] = buf[index] + vertexStart;
-                                loaderInfo.mIndexPos++;
-                            }
-                            break;
-                        }
-                        case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
-                        {
-                            auto buf = static_cast<const uint16_t*>(dataPtr);
-                            for (size_t index = 0; index < accessor.count; index++)
-                            {
-                                loaderInfo.mpIndexBuffer[loaderInfo.mIndexPos] = buf[index] + vertexStart;
-                                loaderInfo.mIndexPos++;
-                            }
-                            break;
-                        }
-                        case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
-                        {
-                            auto buf = static_cast<const uint8_t*>(dataPtr);
-                            for (size_t index = 0; index < accessor.count; index++)
-                            {
-                                loaderInfo.mpIndexBuffer[loaderInfo.mIndexPos] = buf[index] + vertexStart;
-                                loaderInfo.mIndexPos++;
-                            }
-                            break;
-                        }
-                        default:
-                            std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
-                            return;
-                    }
+                    vertexCount = static_cast<uint32_t>(posAccessor.count);
+                    indexCount = hasIndices ? static_cast<uint32_t>(model.accessors[primitive.indices].count) : 0;
+                    if (loaderInfo.mReserve) loaderInfo.mReserve(vertexCount, indexCount);
+                    ReadPrimitiveVertices(model, primitive, storeVertex);
+                    if (hasIndices && !ReadPrimitiveIndices(model, primitive, storeIndex)) return;
                 }
-                auto * newPrimitive = new Primitive(indexStart, indexCount, vertexCount, primitive.material > -1 ? mMaterials[primitive.material] : mMaterials.back());
+                ReleasePrimitiveBuffers(model, primitive, loaderInfo);
+                auto * newPrimitive = new Primitive(indexStart, indexCount, vertexCount, material);
                 newPrimitive->mFirstVertex = vertexStart;
                 newPrimitive->SetBoundingBox(posMin, posMax);
                 newMesh->mPrimitives.push_back(newPrimitive);
@@ -676,27 +860,104 @@ namespace LeoVK
         const tinygltf::Node& node,
         const tinygltf::Model& model,
         size_t& vertexCount,
-        size_t& indexCount)
+        size_t& indexCount,
+        const LoaderInfo& loaderInfo)
     {
         if (!node.children.empty())
         {
             for (int i : node.children)
             {
-                GetNodeProperty(model.nodes[i], model, vertexCount, indexCount);
+                GetNodeProperty(model.nodes[i], model, vertexCount, indexCount, loaderInfo);
             }
         }
         if (node.mesh > -1)
         {
-            const tinygltf::Mesh mesh = model.meshes[node.mesh];
+            const tinygltf::Mesh& mesh = model.meshes[node.mesh];
 
-            for (auto primitive : mesh.primitives)
+            for (size_t primitiveIndex = 0; primitiveIndex < mesh.primitives.size(); primitiveIndex++)
             {
+                const tinygltf::Primitive& primitive = mesh.primitives[primitiveIndex];
+                // 与LoadNode一致，生成过法线或切线的Primitive按生成后的大小统计
+                auto generated = loaderInfo.mGeneratedPrimitives.find({ node.mesh, primitiveIndex });
+                if (generated != loaderInfo.mGeneratedPrimitives.end())
+                {
+                    vertexCount += generated->second.mVertices.size();
+                    indexCount += generated->second.mIndices.size();
+                    continue;
+                }
                 vertexCount += model.accessors[primitive.attributes.find("POSITION")->second].count;
-                if (primitive.indices > -1) indexCount += model.accessors[primitive.indices].count;
+                indexCount += primitive.indices > -1 ? model.accessors[primitive.indices].count : 0;
             }
         }
     }
 
+    void GLTFScene::GenerateMissingAttributes(const tinygltf::Model& model, const tinygltf::Scene& scene, LoaderInfo& loaderInfo)
+    {
+        // 统计场景中引用每个Mesh的节点数，实例化的Mesh只生成一次
+        std::vector<uint32_t> meshUseCounts(model.meshes.size(), 0);
+        std::function<void(int)> countMeshes = [&](int nodeIndex)
+        {
+            const tinygltf::Node& node = model.nodes[nodeIndex];
+            for (int child : node.children) countMeshes(child);
+            if (node.mesh > -1) meshUseCounts[node.mesh]++;
+        };
+        for (int node : scene.nodes) countMeshes(node);
+
+        struct GenerateJob
+        {
+            LoaderInfo::GeneratedPrimitive* mpPrimitive;
+            bool mbGenerateNormals;
+            bool mbFlatNormals;
+            bool mbGenerateTangents;
+        };
+        std::vector<GenerateJob> jobs;
+        for (size_t meshIndex = 0; meshIndex < model.meshes.size(); meshIndex++)
+        {
+            if (meshUseCounts[meshIndex] == 0) continue;
+            const tinygltf::Mesh& mesh = model.meshes[meshIndex];
+            for (size_t primitiveIndex = 0; primitiveIndex < mesh.primitives.size(); primitiveIndex++)
+            {
+                const tinygltf::Primitive& primitive = mesh.primitives[primitiveIndex];
+                if (primitive.attributes.find("POSITION") == primitive.attributes.end()) continue;
+                const Material& material = primitive.material > -1 ? mMaterials[primitive.material] : mMaterials.back();
+
+                // 缺少法线时生成，默认按glTF规范展开为面法线；有法线贴图但缺少切线时生成切线
+                const bool hasNormals = primitive.attributes.find("NORMAL") != primitive.attributes.end();
+                const bool generateTangents = primitive.attributes.find("TANGENT") == primitive.attributes.end() &&
+                    primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end() && material.mpNormalTexture != nullptr;
+                if (hasNormals && !generateTangents) continue;
+
+                const std::pair<int, size_t> key{ static_cast<int>(meshIndex), primitiveIndex };
+                LoaderInfo::GeneratedPrimitive& generated = loaderInfo.mGeneratedPrimitives[key];
+                generated.mUseCount = meshUseCounts[meshIndex];
+                ReadPrimitiveVertices(model, primitive, [&](Vertex& vert) { generated.mVertices.push_back(vert); });
+                if (primitive.indices > -1 && !ReadPrimitiveIndices(model, primitive, [&](uint32_t index) { generated.mIndices.push_back(index); }))
+                {
+                    // 不支持的索引类型留给LoadNode按原来的路径报错
+                    loaderInfo.mGeneratedPrimitives.erase(key);
+                    continue;
+                }
+                const bool flatNormals = !hasNormals && primitive.indices > -1 && !(loaderInfo.mFileLoadingFlags & FileLoadingFlags::SmoothNormals);
+                jobs.push_back({ &generated, !hasNormals, flatNormals, generateTangents });
+            }
+        }
+        if (jobs.empty()) return;
+
+        // 整个加载只创建这一个线程池，每个Primitive在一个工作线程上生成
+        LeoVK::ThreadPool threadPool;
+        threadPool.SetThreadCount(std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<uint32_t>(jobs.size()))));
+        uint32_t nextThread = 0;
+        for (const GenerateJob& job : jobs)
+        {
+            threadPool.mThreads[nextThread++ % threadPool.mThreads.size()]->AddJob([job]() {
+                if (job.mbFlatNormals) LeoVK::TangentGenerator::Unweld(job.mpPrimitive->mVertices, job.mpPrimitive->mIndices);
+                if (job.mbGenerateNormals) LeoVK::TangentGenerator::GenerateNormals(job.mpPrimitive->mVertices, job.mpPrimitive->mIndices);
+                if (job.mbGenerateTangents) LeoVK::TangentGenerator::GenerateTangents(job.mpPrimitive->mVertices, job.mpPrimitive->mIndices);
+            });
+        }
+        threadPool.Wait();
+    }
+
     void GLTFScene::LoadSkins(tinygltf::Model &gltfModel)
     {
         for (tinygltf::Skin &source : gltfModel.skins)
@@ -733,32 +994,257 @@ namespace LeoVK
         }
     }
 
+    // 流式加载时图像的编码数据，可能在image中，也可能直接指向Buffer
+    static bool GetEncodedImage(const tinygltf::Model& model, const tinygltf::Image& image, const unsigned char*& data, size_t& size)
+    {
+        if (image.as_is && image.image.empty() && image.bufferView >= 0)
+        {
+            const tinygltf::BufferView& view = model.bufferViews[image.bufferView];
+            const tinygltf::Buffer& buffer = model.buffers[view.buffer];
+            if (view.byteOffset + view.byteLength > buffer.data.size()) return false;
+            data = buffer.data.data() + view.byteOffset;
+            size = view.byteLength;
+            return true;
+        }
+        data = image.image.data();
+        size = image.image.size();
+        return !image.image.empty();
+    }
+
+    // KTX2中的格式需要设备可以采样，BC格式还需要启用textureCompressionBC
+    static bool IsFormatSampleable(LeoVK::VulkanDevice* device, VkFormat format)
+    {
+        if (format == VK_FORMAT_UNDEFINED) return false;
+        if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && !device->mEnabledFeatures.textureCompressionBC) return false;
+        VkFormatProperties formatProps;
+        vkGetPhysicalDeviceFormatProperties(device->mPhysicalDevice, format, &formatProps);
+        return (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+    }
+
     void GLTFScene::LoadTextures(
         tinygltf::Model &gltfModel,
         LeoVK::VulkanDevice *device,
-        VkQueue transferQueue)
+        VkQueue transferQueue,
+        uint32_t fileLoadingFlags,
+        LoadingProgress* progress,
+        const AssetPackage* package)
     {
-        for (tinygltf::Texture &tex : gltfModel.textures)
+        auto tStart = std::chrono::high_resolution_clock::now();
+        const size_t textureCount = gltfModel.textures.size();
+        auto isCancelled = [progress]() { return progress && progress->mbCancel; };
+
+        // 颜色贴图按sRGB编码存储，生成Mip时需要在线性空间中平均
+        std::vector<bool> srgbTextures(textureCount, false);
+        std::vector<bool> normalTextures(textureCount, false);
+        auto markTexture = [textureCount](std::vector<bool>& textures, int index) {
+            if (index >= 0 && index < (int)textureCount) textures[index] = true;
+        };
+        for (tinygltf::Material &mat : gltfModel.materials)
         {
-            tinygltf::Image image = gltfModel.images[tex.source];
-            LeoVK::TextureSampler texSampler{};
-            if (tex.sampler == -1)
+            if (mat.values.find("baseColorTexture") != mat.values.end()) markTexture(srgbTextures, mat.values["baseColorTexture"].TextureIndex());
+            if (mat.additionalValues.find("emissiveTexture") != mat.additionalValues.end()) markTexture(srgbTextures, mat.additionalValues["emissiveTexture"].TextureIndex());
+            if (mat.additionalValues.find("normalTexture") != mat.additionalValues.end()) markTexture(normalTextures, mat.additionalValues["normalTexture"].TextureIndex());
+            auto ext = mat.extensions.find("KHR_materials_pbrSpecularGlossiness");
+            if (ext != mat.extensions.end())
             {
-                // No sampler specified, use a default one
-                texSampler.mMagFilter = VK_FILTER_LINEAR;
-                texSampler.mMinFilter = VK_FILTER_LINEAR;
-                texSampler.mAddressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-                texSampler.mAddressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-                texSampler.mAddressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+                if (ext->second.Has("diffuseTexture")) markTexture(srgbTextures, ext->second.Get("diffuseTexture").Get("index").Get<int>());
+                if (ext->second.Has("specularGlossinessTexture")) markTexture(srgbTextures, ext->second.Get("specularGlossinessTexture").Get("index").Get<int>());
             }
-            else
+        }
+
+        // KTX2中设备可以采样的BC/RGBA8数据（无超压缩或Zstd）在工作线程上直接读取，KHR_texture_basisu的source优先。
+        // Basis Universal（ETC1S/UASTC）没有转码器，只能使用source中可选的PNG/JPG回退，
+        // 没有回退的纹理使用白色占位，数量记录到统计中并显示在界面上
+        auto isLoadable = [&](int imageIndex, bool& bKTX2)
+        {
+            const unsigned char* encodedData = nullptr;
+            size_t encodedSize = 0;
+            bKTX2 = false;
+            if (imageIndex < 0 || imageIndex >= (int)gltfModel.images.size()) return false;
+            const tinygltf::Image& image = gltfModel.images[imageIndex];
+            if (!GetEncodedImage(gltfModel, image, encodedData, encodedSize)) return false;
+            bKTX2 = image.as_is && LeoVK::KTX2Reader::IsKTX2(encodedData, encodedSize);
+            return !bKTX2 || IsFormatSampleable(device, LeoVK::KTX2Reader::GetFormat(encodedData, encodedSize));
+        };
+        std::vector<int> sources(textureCount, -1);
+        uint32_t placeholderCount = 0;
+        bool bHasKTX2 = false;
+        for (size_t texIndex = 0; texIndex < textureCount; texIndex++)
+        {
+            const tinygltf::Texture &tex = gltfModel.textures[texIndex];
+            const auto basisu = tex.extensions.find("KHR_texture_basisu");
+            const int basisSource = basisu != tex.extensions.end() && basisu->second.Has("source") ? basisu->second.Get("source").GetNumberAsInt() : -1;
+            bool bKTX2 = false;
+            const int source = isLoadable(basisSource, bKTX2) ? basisSource : isLoadable(tex.source, bKTX2) ? tex.source : -1;
+            if (source >= 0)
+            {
+                sources[texIndex] = source;
+                bHasKTX2 |= bKTX2;
+            }
+            else if (!package)
             {
-                texSampler = mTexSamplers[tex.sampler];
+                std::cout << "Warning: texture " << texIndex << (basisSource >= 0 ? " only has a Basis Universal image, which cannot be transcoded" : " has no loadable image")
+                    << ", using a white placeholder" << std::endl;
+                placeholderCount++;
             }
+        }
 
-            LeoVK::Texture2D texture;
-            LoadFromImage(&texture, image, texSampler, device, transferQueue);
-            mTextures.push_back(texture);
+        // 流式加载时图像在解析阶段只保存编码后的数据，按批解码、上传后立即释放
+        const bool bStream = fileLoadingFlags & FileLoadingFlags::StreamAssets;
+        std::vector<int> lastUses(gltfModel.images.size(), -1);
+        for (size_t texIndex = 0; texIndex < textureCount; texIndex++)
+        {
+            if (sources[texIndex] >= 0) lastUses[sources[texIndex]] = static_cast<int>(texIndex);
+        }
+
+        // 在工作线程上解码，生成Mip并压缩为BC1/BC3，法线贴图保留RGBA8避免BC1的精度损失
+        std::vector<LeoVK::CompressedImage> compressedImages(textureCount);
+        const bool bCompress = (fileLoadingFlags & FileLoadingFlags::CompressTextures) && LeoVK::TextureCompressor::IsSupported(device);
+        LeoVK::ThreadPool workerThreadPool;
+        if (bCompress || bStream || bHasKTX2) workerThreadPool.SetThreadCount(std::max(1u, std::thread::hardware_concurrency()));
+        // 不流式加载时所有纹理作为一批处理
+        const size_t batchSize = bStream ? std::max<size_t>(1, workerThreadPool.mThreads.size()) : std::max<size_t>(1, textureCount);
+
+        mTextureStats = {};
+        mTextureStats.mPlaceholderCount = placeholderCount;
+        LeoVK::MipGenerator mipGenerator(device, transferQueue);
+        for (size_t batchStart = 0; batchStart < textureCount && !isCancelled(); batchStart += batchSize)
+        {
+            const size_t batchEnd = std::min(batchStart + batchSize, textureCount);
+            std::vector<tinygltf::Image> decodedImages(batchEnd - batchStart);
+            auto getImage = [&](size_t texIndex) -> tinygltf::Image* {
+                if (sources[texIndex] < 0) return nullptr;
+                tinygltf::Image* image = &gltfModel.images[sources[texIndex]];
+                return image->as_is ? &decodedImages[texIndex - batchStart] : image;
+            };
+
+            auto tCompressStart = std::chrono::high_resolution_clock::now();
+            uint32_t nextThread = 0;
+            for (size_t texIndex = batchStart; texIndex < batchEnd; texIndex++)
+            {
+                if (sources[texIndex] < 0) continue;
+                const tinygltf::Image* encoded = &gltfModel.images[sources[texIndex]];
+                tinygltf::Image* image = getImage(texIndex);
+                const bool bSRGB = srgbTextures[texIndex];
+                const bool bTryCompress = bCompress && !normalTextures[texIndex];
+                if (!encoded->as_is && (!bTryCompress || image->bits != 8 || (image->component != 3 && image->component != 4))) continue;
+
+                LeoVK::CompressedImage* compressedImage = &compressedImages[texIndex];
+                const int imageIndex = sources[texIndex];
+                const unsigned char* encodedData = nullptr;
+                size_t encodedSize = 0;
+                if (encoded->as_is) GetEncodedImage(gltfModel, *encoded, encodedData, encodedSize);
+                workerThreadPool.mThreads[nextThread++ % workerThreadPool.mThreads.size()]->AddJob([encoded, image, imageIndex, bSRGB, bTryCompress, compressedImage, encodedData, encodedSize, isCancelled]() {
+                    if (isCancelled()) return;
+                    if (encoded->as_is && LeoVK::KTX2Reader::IsKTX2(encodedData, encodedSize))
+                    {
+                        // 已经是GPU格式，只解压Zstd，不再生成Mip或压缩
+                        std::string err;
+                        if (!LeoVK::KTX2Reader::Read(encodedData, encodedSize, *compressedImage, &err))
+                        {
+                            std::cout << "Failed to read KTX2 image " << imageIndex << ": " << err << std::endl;
+                        }
+                        return;
+                    }
+                    if (encoded->as_is)
+                    {
+                        std::string err, warn;
+                        if (!tinygltf::LoadImageData(image, imageIndex, &err, &warn, 0, 0, encodedData, static_cast<int>(encodedSize), nullptr))
+                        {
+                            std::cout << "Failed to decode image " << imageIndex << ": " << err << std::endl;
+                            image->image.clear();
+                            return;
+                        }
+                    }
+                    if (!bTryCompress || image->bits != 8 || (image->component != 3 && image->component != 4)) return;
+                    LeoVK::TextureCompressor::Compress(image->image.data(), image->component, image->width, image->height, bSRGB, *compressedImage);
+                    // 压缩后只上传块压缩数据，解码的像素可以提前释放
+                    if (encoded->as_is) std::vector<unsigned char>().swap(image->image);
+                });
+            }
+            workerThreadPool.Wait();
+            mTextureStats.mCompressTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tCompressStart).count();
+            SampleLoadMemory();
+
+            for (size_t texIndex = batchStart; texIndex < batchEnd; texIndex++)
+            {
+                // 取消后不再上传剩余的纹理，已经创建的由调用者销毁
+                if (isCancelled()) break;
+                // 纹理上传占整个加载进度的20%到80%
+                if (progress) progress->mProgress = 0.2f + 0.6f * (float)texIndex / (float)textureCount;
+                tinygltf::Texture &tex = gltfModel.textures[texIndex];
+                LeoVK::TextureSampler texSampler{};
+                if (tex.sampler == -1)
+                {
+                    // No sampler specified, use a default one
+                    texSampler.mMagFilter = VK_FILTER_LINEAR;
+                    texSampler.mMinFilter = VK_FILTER_LINEAR;
+                    texSampler.mAddressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+                    texSampler.mAddressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+                    texSampler.mAddressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+                }
+                else
+                {
+                    texSampler = mTexSamplers[tex.sampler];
+                }
+
+                tinygltf::Image* image = getImage(texIndex);
+                const PackageTexture* packed = package ? &package->mpTextures[texIndex] : nullptr;
+                LeoVK::Texture2D texture;
+                if (packed && packed->mFormat != VK_FORMAT_UNDEFINED)
+                {
+                    // 烘焙包中的数据从映射的文件直接拷贝到Staging
+                    LoadFromCompressedImage(&texture, static_cast<VkFormat>(packed->mFormat), packed->mWidth, packed->mHeight, packed->mMipLevels,
+                        package->GetTextureData(*packed), packed->mDataSize, packed->mMipOffsets, texSampler, device, &mipGenerator);
+                    mTextureStats.mCompressedCount++;
+                }
+                else if (!compressedImages[texIndex].mData.empty())
+                {
+                    const LeoVK::CompressedImage& compressed = compressedImages[texIndex];
+                    LoadFromCompressedImage(&texture, compressed.mFormat, compressed.mWidth, compressed.mHeight, compressed.mMipLevels,
+                        compressed.mData.data(), compressed.mData.size(), compressed.mMipOffsets.data(), texSampler, device, &mipGenerator);
+                    mTextureStats.mCompressedCount++;
+                }
+                else if (image == nullptr || image->image.empty())
+                {
+                    std::vector<uint8_t> whiteVal = { 255, 255, 255, 255 };
+                    texture.LoadFromBuffer(whiteVal.data(), whiteVal.size(), VK_FORMAT_R8G8B8A8_UNORM, 1, 1, device, transferQueue);
+                }
+                else
+                {
+                    LoadFromImage(&texture, *image, texSampler, device, transferQueue, &mipGenerator, srgbTextures[texIndex]);
+                }
+                mTextures.push_back(texture);
+
+                // 数据已经拷贝到Staging中，CPU上的副本不再需要
+                std::vector<uint8_t>().swap(compressedImages[texIndex].mData);
+                if (bStream && image != nullptr)
+                {
+                    std::vector<unsigned char>().swap(image->image);
+                    if (lastUses[sources[texIndex]] == static_cast<int>(texIndex)) std::vector<unsigned char>().swap(gltfModel.images[sources[texIndex]].image);
+                }
+            }
+        }
+        mipGenerator.Flush();
+
+        for (auto& texture : mTextures)
+        {
+            VkMemoryRequirements memReqs;
+            vkGetImageMemoryRequirements(device->mLogicalDevice, texture.mImage, &memReqs);
+            mTextureStats.mMemory += memReqs.size;
+        }
+        mTextureStats.mCount = static_cast<uint32_t>(mTextures.size());
+        mTextureStats.mLoadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+        if (textureCount > 0)
+        {
+            std::cout << "Loading " << textureCount << " textures took " << mTextureStats.mLoadTime << " ms ("
+                << mTextureStats.mCompressedCount << " BC compressed in " << mTextureStats.mCompressTime << " ms, "
+                << mipGenerator.mTextureCount << " compute mips in " << mipGenerator.mSubmitCount << " submits), "
+                << (float)mTextureStats.mMemory / (1024.0f * 1024.0f) << " MB" << std::endl;
+        }
+        if (placeholderCount > 0)
+        {
+            std::cout << "Warning: " << placeholderCount << " textures use a placeholder, Basis Universal transcoding is not implemented" << std::endl;
         }
         LeoVK::Texture2D emptyTex;
         std::vector<char> emptyVal = {0, 0, 0, 0};
@@ -804,34 +1290,28 @@ namespace LeoVK
             materialParams.push_back(matShaderParam);
         }
 
-        if (matParamsBuffer.mBuffer != VK_NULL_HANDLE) matParamsBuffer.Destroy();
+        if (matParamsBuffer.mBuffer != VK_NULL_HANDLE) matParamsBuffer.DeferDestroy();
 
         VkDeviceSize bufferSize = materialParams.size() * sizeof(MaterialShaderParams);
         LeoVK::Buffer stagingBuffer;
         VK_CHECK(mpDevice->CreateBuffer(
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
+            &stagingBuffer,
             bufferSize, 
-            &stagingBuffer.mBuffer, &stagingBuffer.mMemory, 
             materialParams.data()))
         VK_CHECK(mpDevice->CreateBuffer(
             VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
-            bufferSize, 
-            &matParamsBuffer.mBuffer, &matParamsBuffer.mMemory))
+            &matParamsBuffer,
+            bufferSize))
 
         VkCommandBuffer copyCmd = mpDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
         VkBufferCopy copyRegion{};
         copyRegion.size = bufferSize;
         vkCmdCopyBuffer(copyCmd, stagingBuffer.mBuffer, matParamsBuffer.mBuffer, 1, &copyRegion);
         mpDevice->FlushCommandBuffer(copyCmd, queue, true);
-        stagingBuffer.mDevice = mpDevice->mLogicalDevice;
         stagingBuffer.Destroy();
-
-        matParamsBuffer.mDescriptor.buffer = matParamsBuffer.mBuffer;
-        matParamsBuffer.mDescriptor.offset = 0;
-        matParamsBuffer.mDescriptor.range = bufferSize;
-        matParamsBuffer.mDevice = mpDevice->mLogicalDevice;
     }
 
     VkSamplerAddressMode GLTFScene::GetVkWrapMode(int32_t wrapMode)
@@ -1015,12 +1495,57 @@ namespace LeoVK
                 }
             }
             material.mIndex = static_cast<uint32_t>(mMaterials.size());
+            material.mFeatureBits = GetMaterialFeatureBits(material);
             mMaterials.push_back(material);
         }
         // Push a default material at the end of the list for meshes with no material assigned
         mMaterials.push_back(Material());
     }
 
+    /**
+    * 根据材质用到的贴图和工作流计算特性位，用于选择Shader排列
+    */
+    uint32_t GetMaterialFeatureBits(const Material& material)
+    {
+        const bool specularGlossiness = material.mPBRWorkFlows.mbSpecularGlossiness;
+        uint32_t features = 0;
+        if (specularGlossiness ? material.mExtension.mpDiffuseTexture != nullptr : material.mpBaseColorTexture != nullptr)
+        {
+            features |= MATERIAL_FEATURE_BASE_COLOR_MAP;
+        }
+        if (specularGlossiness ? material.mExtension.mpSpecularGlossinessTexture != nullptr : material.mpMetallicRoughnessTexture != nullptr)
+        {
+            features |= MATERIAL_FEATURE_PHYSICAL_DESC_MAP;
+        }
+        if (material.mpNormalTexture) features |= MATERIAL_FEATURE_NORMAL_MAP;
+        if (material.mpOcclusionTexture) features |= MATERIAL_FEATURE_OCCLUSION_MAP;
+        if (material.mpEmissiveTexture) features |= MATERIAL_FEATURE_EMISSIVE_MAP;
+        if (material.mAlphaMode == Material::ALPHA_MODE_MASK) features |= MATERIAL_FEATURE_ALPHA_MASK;
+        if (specularGlossiness) features |= MATERIAL_FEATURE_SPECULAR_GLOSSINESS;
+        return features;
+    }
+
+    void GLTFScene::LoadLights(tinygltf::Model &gltfModel)
+    {
+        for (auto& light : gltfModel.lights)
+        {
+            LeoVK::Light newLight{};
+            newLight.mName = light.name;
+            if (light.color.size() == 3) newLight.mColor = glm::make_vec3(light.color.data());
+            newLight.mIntensity = static_cast<float>(light.intensity);
+            newLight.mRange = static_cast<float>(light.range);
+            if (light.type == "directional") newLight.mType = Light::DIRECTIONAL;
+            else if (light.type == "spot")
+            {
+                newLight.mType = Light::SPOT;
+                newLight.mInnerConeAngle = static_cast<float>(light.spot.innerConeAngle);
+                newLight.mOuterConeAngle = static_cast<float>(light.spot.outerConeAngle);
+            }
+            else newLight.mType = Light::POINT;
+            mLights.push_back(newLight);
+        }
+    }
+
     void GLTFScene::LoadAnimations(tinygltf::Model &gltfModel)
     {
         for (tinygltf::Animation &anim : gltfModel.animations)
@@ -1150,198 +1675,379 @@ namespace LeoVK
         }
     }
 
-    void GLTFScene::LoadFromFile(
+    // KTX2图像只保存编码后的数据，由LoadTextures在工作线程上读取；其他格式直接解码
+    static bool LoadImageDataDeferKTX2(
+        tinygltf::Image* image, const int imageIndex, std::string* err, std::string* warn,
+        int reqWidth, int reqHeight, const unsigned char* bytes, int size, void* userData)
+    {
+        if (LeoVK::KTX2Reader::IsKTX2(bytes, static_cast<size_t>(size)))
+        {
+            if (image->bufferView < 0) image->image.assign(bytes, bytes + size);
+            image->as_is = true;
+            return true;
+        }
+        return tinygltf::LoadImageData(image, imageIndex, err, warn, reqWidth, reqHeight, bytes, size, userData);
+    }
+
+    // 流式加载时只保存编码后的数据，LoadTextures中按批解码
+    static bool LoadImageDataDeferred(
+        tinygltf::Image* image, const int imageIndex, std::string* err, std::string* warn,
+        int reqWidth, int reqHeight, const unsigned char* bytes, int size, void* userData)
+    {
+        // 引用BufferView的图像（GLB内嵌）不拷贝，解码时直接从Buffer中读取
+        if (image->bufferView < 0) image->image.assign(bytes, bytes + size);
+        image->as_is = true;
+        return true;
+    }
+
+    // 烘焙包中已经有压缩好的纹理，源图像不需要解码
+    static bool LoadImageDataNone(
+        tinygltf::Image* image, const int imageIndex, std::string* err, std::string* warn,
+        int reqWidth, int reqHeight, const unsigned char* bytes, int size, void* userData)
+    {
+        return true;
+    }
+
+    static size_t GetProcessMemoryUsage()
+    {
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+        return counters.WorkingSetSize;
+    }
+
+    void GLTFScene::SampleLoadMemory()
+    {
+        mPeakLoadMemory = std::max(mPeakLoadMemory, GetProcessMemoryUsage());
+    }
+
+    bool GLTFScene::LoadFromFile(
         const std::string& filename,
         LeoVK::VulkanDevice *device,
         VkQueue transferQueue,
         uint32_t fileLoadingFlags,
-        float scale)
+        float scale,
+        LoadingProgress* progress)
     {
+        auto isCancelled = [progress]() { return progress && progress->mbCancel; };
+        auto getExtension = [](const std::string& path) {
+            const size_t extpos = path.rfind('.', path.length());
+            return extpos != std::string::npos ? path.substr(extpos + 1, path.length() - extpos) : std::string();
+        };
         tinygltf::Model gltfModel;
         tinygltf::TinyGLTF gltfContext;
+        mPeakLoadMemory = GetProcessMemoryUsage();
 
         std::string error;
         std::string warning;
 
         this->mpDevice = device;
 
-        bool binary = false;
-        size_t extpos = filename.rfind('.', filename.length());
-        if (extpos != std::string::npos)
+        // 烘焙包只包含几何和纹理数据，节点、材质和动画仍然从源glTF读取，
+        // 蒙皮和动画需要Buffer，所以源glTF的Buffer仍会被完整读入
+        std::string sourceFile = filename;
+        LeoVK::AssetPackage package;
+        const bool bPackage = getExtension(filename) == "leopkg";
+        bool fileLoaded = true;
+        if (bPackage)
         {
-            binary = (filename.substr(extpos + 1, filename.length() - extpos) == "glb");
+            fileLoaded = package.Open(filename, &error);
+            if (fileLoaded && package.mHeader.mLoadingFlags != (fileLoadingFlags & PACKAGE_GEOMETRY_FLAGS))
+            {
+                error = "the package was baked with different vertex loading flags, rebake it";
+                fileLoaded = false;
+            }
+            if (fileLoaded && package.mHeader.mTextureCount > 0 && !LeoVK::TextureCompressor::IsSupported(device))
+            {
+                error = "the device does not support BC compressed textures";
+                fileLoaded = false;
+            }
+            sourceFile = package.mSourcePath;
         }
-
-        bool fileLoaded = binary ? gltfContext.LoadBinaryFromFile(&gltfModel, &error, &warning, filename) : gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
+        gltfContext.SetImageLoader(bPackage ? LoadImageDataNone : (fileLoadingFlags & FileLoadingFlags::StreamAssets) ? LoadImageDataDeferred : LoadImageDataDeferKTX2, nullptr);
+        const bool binary = getExtension(sourceFile) == "glb";
+
+        // 直接从文件映射中解析，GLB不再先整个读入内存再拷贝出二进制块。
+        // tinygltf总是把Buffer拷贝到自己的data中，外部的.bin仍然用它默认的文件读取
+        LeoVK::MappedFile mappedFile;
+        if (fileLoaded) fileLoaded = mappedFile.Open(sourceFile, &error);
+        // tinygltf的接口只接受32位的大小
+        if (fileLoaded && mappedFile.Size() > UINT_MAX)
+        {
+            error = sourceFile + " is larger than 4 GB, which tinygltf cannot parse";
+            fileLoaded = false;
+        }
+        if (fileLoaded)
+        {
+            const size_t sepPos = sourceFile.find_last_of("/\\");
+            const std::string baseDir = sepPos != std::string::npos ? sourceFile.substr(0, sepPos) : "";
+            fileLoaded = binary ?
+                gltfContext.LoadBinaryFromMemory(&gltfModel, &error, &warning, mappedFile.Data(), static_cast<unsigned int>(mappedFile.Size()), baseDir) :
+                gltfContext.LoadASCIIFromString(&gltfModel, &error, &warning, reinterpret_cast<const char*>(mappedFile.Data()), static_cast<unsigned int>(mappedFile.Size()), baseDir);
+        }
+        // Buffer和图片数据解析时已经拷贝到Model中
+        mappedFile.Close();
+        if (isCancelled()) return false;
+        // 源文件在烘焙之后被修改过时，按遍历顺序对应的Primitive和纹理会错位
+        if (fileLoaded && bPackage && (package.mHeader.mTextureCount != gltfModel.textures.size() ||
+            package.mHeader.mSourceStamp != GetSourceStamp(sourceFile, gltfModel)))
+        {
+            error = "the package is out of date with " + sourceFile + ", rebake it";
+            fileLoaded = false;
+        }
+        if (progress) progress->mProgress = 0.2f;
 
         LoaderInfo loaderInfo{};
+        loaderInfo.mFileLoadingFlags = fileLoadingFlags;
         size_t vertexCount = 0;
         size_t indexCount = 0;
+        LeoVK::Buffer vertexStaging, indexStaging;
+        size_t vertexCapacity = 0;
+        size_t indexCapacity = 0;
+        uint32_t stagingFlushCount = 0;
+
+        // 把Staging中[Base, Pos)范围内的数据拷贝到设备Buffer的对应位置
+        auto flushStaging = [&]()
+        {
+            const size_t stagedVertices = loaderInfo.mVertexPos - loaderInfo.mVertexBase;
+            const size_t stagedIndices = loaderInfo.mIndexPos - loaderInfo.mIndexBase;
+            if (stagedVertices == 0 && stagedIndices == 0) return;
+
+            VkCommandBuffer copyCmd = device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+            VkBufferCopy copyRegion = {};
+            if (stagedVertices > 0)
+            {
+                copyRegion.dstOffset = loaderInfo.mVertexBase * sizeof(Vertex);
+                copyRegion.size = stagedVertices * sizeof(Vertex);
+                vkCmdCopyBuffer(copyCmd, vertexStaging.mBuffer, mVertices.mBuffer, 1, &copyRegion);
+            }
+            if (stagedIndices > 0)
+            {
+                copyRegion.dstOffset = loaderInfo.mIndexBase * sizeof(uint32_t);
+                copyRegion.size = stagedIndices * sizeof(uint32_t);
+                vkCmdCopyBuffer(copyCmd, indexStaging.mBuffer, mIndices.mBuffer, 1, &copyRegion);
+            }
+            device->FlushCommandBuffer(copyCmd, transferQueue, true);
+            loaderInfo.mVertexBase = loaderInfo.mVertexPos;
+            loaderInfo.mIndexBase = loaderInfo.mIndexPos;
+            stagingFlushCount++;
+        };
+        auto createStaging = [&](size_t vertexStagingCount, size_t indexStagingCount)
+        {
+            vertexStaging.Destroy();
+            indexStaging.Destroy();
+            VK_CHECK(device->CreateBuffer(
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                &vertexStaging,
+                vertexStagingCount * sizeof(Vertex)))
+            VK_CHECK(vertexStaging.Map())
+            loaderInfo.mpVertexBuffer = static_cast<Vertex*>(vertexStaging.mpMapped);
+            if (indexStagingCount > 0)
+            {
+                VK_CHECK(device->CreateBuffer(
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    &indexStaging,
+                    indexStagingCount * sizeof(uint32_t)))
+                VK_CHECK(indexStaging.Map())
+                loaderInfo.mpIndexBuffer = static_cast<uint32_t*>(indexStaging.mpMapped);
+            }
+            vertexCapacity = vertexStagingCount;
+            indexCapacity = indexStagingCount;
+        };
+        loaderInfo.mReserve = [&](size_t primVertexCount, size_t primIndexCount)
+        {
+            if (loaderInfo.mVertexPos - loaderInfo.mVertexBase + primVertexCount <= vertexCapacity &&
+                loaderInfo.mIndexPos - loaderInfo.mIndexBase + primIndexCount <= indexCapacity) return;
+            flushStaging();
+            // 单个Primitive超过Staging大小时按它的大小重新创建
+            if (primVertexCount > vertexCapacity || primIndexCount > indexCapacity)
+            {
+                createStaging(std::max(vertexCapacity, primVertexCount), std::max(indexCapacity, primIndexCount));
+            }
+        };
 
         if (fileLoaded)
         {
+            SampleLoadMemory();
             LoadTextureSamplers(gltfModel);
-            LoadTextures(gltfModel, device, transferQueue);
+            LoadTextures(gltfModel, device, transferQueue, fileLoadingFlags, progress, bPackage ? &package : nullptr);
+            if (isCancelled()) return false;
             LoadMaterials(gltfModel);
 
             const tinygltf::Scene& scene = gltfModel.scenes[gltfModel.defaultScene > -1 ? gltfModel.defaultScene : 0];
 
             // Get vertex and index buffer sizes up-front
-            for (int node : scene.nodes)
+            if (bPackage)
             {
-                GetNodeProperty(gltfModel.nodes[node], gltfModel, vertexCount, indexCount);
+                vertexCount = package.mHeader.mVertexCount;
+                indexCount = package.mHeader.mIndexCount;
+                loaderInfo.mpPackagePrimitives = package.mpPrimitives;
+                loaderInfo.mPackagePrimitiveCount = package.mHeader.mPrimitiveCount;
+            }
+            else
+            {
+                GenerateMissingAttributes(gltfModel, scene, loaderInfo);
+                for (int node : scene.nodes)
+                {
+                    GetNodeProperty(gltfModel.nodes[node], gltfModel, vertexCount, indexCount, loaderInfo);
+                }
+            }
+            assert(vertexCount > 0);
+
+            // Create device local buffers
+            // 顶点和索引Buffer同时作为Storage Buffer，Visibility Buffer解析时按需读取
+            // Vertex buffer
+            VK_CHECK(device->CreateBuffer(
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                vertexCount * sizeof(Vertex),
+                &mVertices.mBuffer,
+                &mVertices.mMemory));
+            // Index buffer
+            if (indexCount > 0)
+            {
+                VK_CHECK(device->CreateBuffer(
+                    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    indexCount * sizeof(uint32_t),
+                    &mIndices.mBuffer,
+                    &mIndices.mMemory));
+            }
+
+            // LoadNode直接把转换后的顶点和索引写入持久映射的Staging Buffer，流式加载时Staging大小固定，写满后先提交
+            if (fileLoadingFlags & FileLoadingFlags::StreamAssets)
+            {
+                createStaging(std::min<size_t>(vertexCount, STREAM_STAGING_SIZE / sizeof(Vertex)), std::min<size_t>(indexCount, STREAM_STAGING_SIZE / sizeof(uint32_t)));
+                // 每个Buffer在最后一个引用它的Primitive写入后释放，多个.bin的场景不必等到整个场景写完
+                if (!bPackage)
+                {
+                    CountBufferUses(gltfModel, scene, loaderInfo);
+                    loaderInfo.mReleaseBuffer = [&gltfModel](int buffer) { std::vector<unsigned char>().swap(gltfModel.buffers[buffer].data); };
+                }
+            }
+            else
+            {
+                createStaging(vertexCount, indexCount);
             }
-            loaderInfo.mpVertexBuffer = new Vertex[vertexCount];
-            loaderInfo.mpIndexBuffer = new uint32_t[indexCount];
 
             // TODO: scene handling with no default scene
             for (int i : scene.nodes)
             {
-                const tinygltf::Node node = gltfModel.nodes[i];
+                const tinygltf::Node& node = gltfModel.nodes[i];
                 LoadNode(nullptr, node, i, gltfModel, loaderInfo, scale);
             }
+            if (bPackage)
+            {
+                if (loaderInfo.mPackagePrimitivePos != loaderInfo.mPackagePrimitiveCount)
+                {
+                    vertexStaging.Destroy();
+                    indexStaging.Destroy();
+                    const std::string message = "Could not load asset package \"" + filename + "\": the package is out of date with " + sourceFile + ", rebake it";
+                    if (!progress) LeoVK::VKTools::ExitFatal(message, -1);
+                    progress->mError = message;
+                    return false;
+                }
+                // 顶点和索引已经是最终的格式，按Staging的大小分段拷贝
+                while (!isCancelled() && (loaderInfo.mVertexPos < vertexCount || loaderInfo.mIndexPos < indexCount))
+                {
+                    const size_t vertexChunk = std::min(vertexCount - loaderInfo.mVertexPos, vertexCapacity);
+                    const size_t indexChunk = std::min(indexCount - loaderInfo.mIndexPos, indexCapacity);
+                    if (vertexChunk > 0) memcpy(loaderInfo.mpVertexBuffer, package.mpVertices + loaderInfo.mVertexPos, vertexChunk * sizeof(Vertex));
+                    if (indexChunk > 0) memcpy(loaderInfo.mpIndexBuffer, package.mpIndices + loaderInfo.mIndexPos, indexChunk * sizeof(uint32_t));
+                    loaderInfo.mVertexPos += vertexChunk;
+                    loaderInfo.mIndexPos += indexChunk;
+                    flushStaging();
+                }
+            }
+            if (!isCancelled()) flushStaging();
+            vertexStaging.Destroy();
+            indexStaging.Destroy();
+            SampleLoadMemory();
+
             if (!gltfModel.animations.empty())
             {
                 LoadAnimations(gltfModel);
             }
             LoadSkins(gltfModel);
+            LoadLights(gltfModel);
+            // 网格、动画和蒙皮都已经读取，剩下的Buffer不再需要
+            if (fileLoadingFlags & FileLoadingFlags::StreamAssets) std::vector<tinygltf::Buffer>().swap(gltfModel.buffers);
 
             for (auto node : mLinearNodes)
             {
                 // Assign skins
                 if (node->mSkinIndex > -1) node->mpSkin = mSkins[node->mSkinIndex];
+                // Assign lights
+                if (node->mLightIndex > -1 && node->mLightIndex < static_cast<int32_t>(mLights.size()))
+                {
+                    mLights[node->mLightIndex].mpNode = node;
+                }
 
                 // Initial pose
                 if (node->mpMesh) node->Update();
             }
         }
+        else if (progress)
+        {
+            // 后台加载失败时保留当前场景，由调用者报告错误
+            progress->mError = "Could not load glTF file \"" + filename + "\": " + error;
+            return false;
+        }
         else
         {
             // TODO: throw
             LeoVK::VKTools::ExitFatal("Could not load glTF file \"" + filename + "\": " + error, -1);
-            return;
-        }
-
-        if ((fileLoadingFlags & FileLoadingFlags::PreTransformVertices) ||
-            (fileLoadingFlags & FileLoadingFlags::PreMultiplyVertexColors) ||
-            (fileLoadingFlags & FileLoadingFlags::FlipY))
-        {
-            const bool preTransform = fileLoadingFlags & FileLoadingFlags::PreTransformVertices;
-            const bool preMultiplyColor = fileLoadingFlags & FileLoadingFlags::PreMultiplyVertexColors;
-            const bool flipY = fileLoadingFlags & FileLoadingFlags::FlipY;
-            for (Node* node : mLinearNodes)
-            {
-                if (node->mpMesh)
-                {
-                    const glm::mat4 localMatrix = node->GetMatrix();
-                    for (Primitive* primitive : node->mpMesh->mPrimitives)
-                    {
-                        for (uint32_t i = 0; i < primitive->mVertexCount; i++)
-                        {
-                            Vertex& vertex = loaderInfo.mpVertexBuffer[primitive->mFirstVertex + i];
-                            if (preTransform)
-                            {
-                                vertex.mPos = glm::vec3(localMatrix * glm::vec4(vertex.mPos, 1.0f));
-                                vertex.mNormal = glm::normalize(glm::mat3(localMatrix) * vertex.mNormal);
-                                vertex.mTangent = glm::normalize(localMatrix * vertex.mTangent);
-                            }
-                            if (flipY)
-                            {
-                                vertex.mPos.y *= -1.0f;
-                                vertex.mNormal.y *= -1.0f;
-                                vertex.mTangent.y *= -1.0f;
-                            }
-                            if (preMultiplyColor)
-                            {
-                                vertex.mColor = primitive->mMaterial.mBaseColorFactor * vertex.mColor;
-                            }
-                        }
-                    }
-                }
-            }
+            return false;
         }
+        // 已经创建的设备Buffer由调用者随场景一起销毁
+        if (isCancelled()) return false;
+        if (progress) progress->mProgress = 0.9f;
 
         mExtensions = gltfModel.extensionsUsed;
 
-        size_t vertexBufferSize = vertexCount * sizeof(Vertex);
-        size_t indexBufferSize = indexCount * sizeof(uint32_t);
-
-        assert((vertexBufferSize > 0) && (indexBufferSize > 0));
+        SampleLoadMemory();
+        std::cout << "Peak process memory during load: " << (float)mPeakLoadMemory / (1024.0f * 1024.0f) << " MB ("
+            << stagingFlushCount << " geometry uploads)" << std::endl;
 
-        struct StagingBuffer
-        {
-            VkBuffer buffer;
-            VkDeviceMemory memory;
-        } vertexStaging{}, indexStaging{};
-
-        // Create staging buffers
-        // Vertex data
-        VK_CHECK(device->CreateBuffer(
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            vertexBufferSize,
-            &vertexStaging.buffer,
-            &vertexStaging.memory,
-            loaderInfo.mpVertexBuffer));
-        // Index data
-        if (indexBufferSize > 0)
-        {
-            VK_CHECK(device->CreateBuffer(
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                indexBufferSize,
-                &indexStaging.buffer,
-                &indexStaging.memory,
-                loaderInfo.mpIndexBuffer));
-        }
-
-        // Create device local buffers
-        // Vertex buffer
-        VK_CHECK(device->CreateBuffer(
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            vertexBufferSize,
-            &mVertices.mBuffer,
-            &mVertices.mMemory));
-        // Index buffer
-        if (indexBufferSize > 0)
-        {
-            VK_CHECK(device->CreateBuffer(
-                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                indexBufferSize,
-                &mIndices.mBuffer,
-                &mIndices.mMemory));
-        }
-
-        // Copy from staging buffers
-        VkCommandBuffer copyCmd = device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-        VkBufferCopy copyRegion = {};
+        GetSceneDimensions();
+        return true;
+    }
 
-        copyRegion.size = vertexBufferSize;
-        vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, mVertices.mBuffer, 1, &copyRegion);
+    void GLTFScene::LoadGeometry(
+        tinygltf::Model &gltfModel,
+        uint32_t fileLoadingFlags,
+        float scale,
+        std::vector<Vertex> &vertices,
+        std::vector<uint32_t> &indices)
+    {
+        mpDevice = nullptr;
+        // 材质只需要知道有没有法线贴图，纹理保持为空
+        mTextures.resize(gltfModel.textures.size() + 1);
+        LoadMaterials(gltfModel);
 
-        if (indexBufferSize > 0)
+        const tinygltf::Scene& scene = gltfModel.scenes[gltfModel.defaultScene > -1 ? gltfModel.defaultScene : 0];
+        LoaderInfo loaderInfo{};
+        loaderInfo.mFileLoadingFlags = fileLoadingFlags;
+        GenerateMissingAttributes(gltfModel, scene, loaderInfo);
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        for (int node : scene.nodes)
         {
-            copyRegion.size = indexBufferSize;
-            vkCmdCopyBuffer(copyCmd, indexStaging.buffer, mIndices.mBuffer, 1, &copyRegion);
+            GetNodeProperty(gltfModel.nodes[node], gltfModel, vertexCount, indexCount, loaderInfo);
         }
+        vertices.resize(vertexCount);
+        indices.resize(indexCount);
 
-        device->FlushCommandBuffer(copyCmd, transferQueue, true);
-
-        vkDestroyBuffer(mpDevice->mLogicalDevice, vertexStaging.buffer, nullptr);
-        vkFreeMemory(mpDevice->mLogicalDevice, vertexStaging.memory, nullptr);
-        if (indexBufferSize > 0)
+        // 与LoadFromFile相同的写入路径，只是目标换成CPU上的数组
+        loaderInfo.mpVertexBuffer = vertices.data();
+        loaderInfo.mpIndexBuffer = indices.data();
+        for (int i : scene.nodes)
         {
-            vkDestroyBuffer(mpDevice->mLogicalDevice, indexStaging.buffer, nullptr);
-            vkFreeMemory(mpDevice->mLogicalDevice, indexStaging.memory, nullptr);
+            LoadNode(nullptr, gltfModel.nodes[i], i, gltfModel, loaderInfo, scale);
         }
-
-        delete[] loaderInfo.mpVertexBuffer;
-        delete[] loaderInfo.mpIndexBuffer;
-
-        GetSceneDimensions();
+        vertices.resize(loaderInfo.mVertexPos);
+        indices.resize(loaderInfo.mIndexPos);
     }
 
     void GLTFScene::DrawNode(Node *node, VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t bindImageSet, Material::AlphaMode renderFlag)
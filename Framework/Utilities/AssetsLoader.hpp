@@ -24,7 +24,10 @@ namespace LeoVK
 		PreTransformVertices = 0x00000001,
 		PreMultiplyVertexColors = 0x00000002,
 		FlipY = 0x00000004,
-		DontLoadImages = 0x00000008
+		DontLoadImages = 0x00000008,
+		CompressTextures = 0x00000010,
+		StreamAssets = 0x00000020,
+		SmoothNormals = 0x00000040
 	};
 
     struct BoundingBox
@@ -39,6 +42,19 @@ namespace LeoVK
     
     enum PBRWorkflows{ PBR_WORKFLOW_METALLIC_ROUGHNESS = 0, PBR_WORKFLOW_SPECULAR_GLOSINESS = 1 };
 
+    // 材质特性位，作为Specialization Constant传入PBRShader.frag，修改时需要同步Shader中的定义
+    enum MaterialFeatureBits
+    {
+        MATERIAL_FEATURE_BASE_COLOR_MAP         = 0x00000001,
+        MATERIAL_FEATURE_PHYSICAL_DESC_MAP      = 0x00000002,
+        MATERIAL_FEATURE_NORMAL_MAP             = 0x00000004,
+        MATERIAL_FEATURE_OCCLUSION_MAP          = 0x00000008,
+        MATERIAL_FEATURE_EMISSIVE_MAP           = 0x00000010,
+        MATERIAL_FEATURE_ALPHA_MASK             = 0x00000020,
+        MATERIAL_FEATURE_SPECULAR_GLOSSINESS    = 0x00000040,
+        MATERIAL_FEATURE_PERMUTATION            = 0x80000000   // 未设置时Shader使用运行时分支
+    };
+
     struct Material
     {
         enum AlphaMode
@@ -64,6 +80,7 @@ namespace LeoVK
         int mIndex = 0;
         bool mbUnlit = false;
         float mEmissiveStrength = 1.0f;
+        uint32_t mFeatureBits = 0;
 
         struct TexCoordSets
         {
@@ -191,6 +208,7 @@ namespace LeoVK
         Mesh*               mpMesh;
         Skin*               mpSkin;
         int32_t             mSkinIndex = -1;
+        int32_t             mLightIndex = -1;   // KHR_lights_punctual
         glm::vec3           mTranslation{};
         glm::vec3           mScale{ 1.0f };
         glm::quat           mRotation{};
@@ -198,6 +216,23 @@ namespace LeoVK
         BoundingBox         mAABB;
     };
 
+    // KHR_lights_punctual 光源，位置和方向来自挂载的节点
+    struct Light
+    {
+        enum LightType
+        {
+            DIRECTIONAL, POINT, SPOT
+        };
+        std::string mName;
+        LightType   mType = POINT;
+        glm::vec3   mColor{ 1.0f };
+        float       mIntensity = 1.0f;
+        float       mRange = 0.0f;                  // 0 表示无限远
+        float       mInnerConeAngle = 0.0f;
+        float       mOuterConeAngle = glm::quarter_pi<float>();
+        Node*       mpNode = nullptr;
+    };
+
     struct AnimationChannel
     {
         enum PathType
@@ -252,12 +287,62 @@ namespace LeoVK
         VkDeviceMemory  mMemory;
     };
 
+    struct PackagePrimitive;
+    class AssetPackage;
+
+    // 顶点和索引指向持久映射的Staging Buffer，只能顺序写入，不要回读
     struct LoaderInfo
     {
         uint32_t*   mpIndexBuffer{};
         Vertex*     mpVertexBuffer{};
         size_t      mIndexPos = 0;
         size_t      mVertexPos = 0;
+        // Staging Buffer开头对应的全局位置，写入前通过mReserve保证放得下
+        size_t      mIndexBase = 0;
+        size_t      mVertexBase = 0;
+        uint32_t    mFileLoadingFlags = 0;
+        std::function<void(size_t vertexCount, size_t indexCount)> mReserve;
+
+        // 缺少法线或切线的Primitive在统计大小之前并行生成，切线接缝处会增加顶点，按(Mesh, Primitive)缓存到LoadNode写入
+        struct GeneratedPrimitive
+        {
+            std::vector<Vertex>     mVertices;      // 局部空间，写入时再变换
+            std::vector<uint32_t>   mIndices;       // 相对于Primitive的第一个顶点
+            uint32_t                mUseCount = 0;  // 引用这个Mesh的节点数，最后一个写入后释放
+        };
+        std::map<std::pair<int, size_t>, GeneratedPrimitive> mGeneratedPrimitives;
+
+        // 流式加载时每个Buffer剩余的Accessor引用数，Primitive写入后递减，减到0时通过mReleaseBuffer释放
+        std::vector<uint32_t>               mBufferUses;
+        std::function<void(int buffer)>     mReleaseBuffer;
+
+        // 从烘焙包加载时按遍历顺序取Primitive的范围和包围盒，不读取Accessor
+        const PackagePrimitive* mpPackagePrimitives = nullptr;
+        size_t                  mPackagePrimitiveCount = 0;
+        size_t                  mPackagePrimitivePos = 0;
+    };
+
+    uint32_t GetMaterialFeatureBits(const Material& material);
+
+    struct TextureStats
+    {
+        uint32_t        mCount = 0;
+        uint32_t        mCompressedCount = 0;
+        uint32_t        mPlaceholderCount = 0;  // 没有可加载图像（例如只有Basis Universal）而使用占位纹理的数量
+        VkDeviceSize    mMemory = 0;
+        double          mCompressTime = 0.0;
+        double          mLoadTime = 0.0;
+    };
+
+    /**
+     * @brief 后台加载时的进度和取消请求
+     * @note 加载线程写入mProgress并轮询mbCancel；mError在加载函数返回后才能读取
+     */
+    struct LoadingProgress
+    {
+        std::atomic<float>  mProgress{ 0.0f };
+        std::atomic<bool>   mbCancel{ false };
+        std::string         mError;
     };
 
     class GLTFScene
@@ -265,9 +350,11 @@ namespace LeoVK
     public:
         void Destroy(VkDevice device);
         void LoadNode(LeoVK::Node* parent, const tinygltf::Node& node, uint32_t nodeIndex, const tinygltf::Model& model, LoaderInfo& loaderInfo, float globalScale);
-        void GetNodeProperty(const tinygltf::Node& node, const tinygltf::Model& model, size_t& vertexCount, size_t& indexCount);
+        void GetNodeProperty(const tinygltf::Node& node, const tinygltf::Model& model, size_t& vertexCount, size_t& indexCount, const LoaderInfo& loaderInfo);
+        // 在GetNodeProperty之前调用，需要材质已经加载
+        void GenerateMissingAttributes(const tinygltf::Model& model, const tinygltf::Scene& scene, LoaderInfo& loaderInfo);
         void LoadSkins(tinygltf::Model& gltfModel);
-        void LoadTextures(tinygltf::Model& gltfModel, LeoVK::VulkanDevice* device, VkQueue transferQueue);
+        void LoadTextures(tinygltf::Model& gltfModel, LeoVK::VulkanDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags = FileLoadingFlags::None, LoadingProgress* progress = nullptr, const AssetPackage* package = nullptr);
         void LoadMaterialBuffer(LeoVK::Buffer& matParamsBuffer, VkQueue queue);
         VkSamplerAddressMode GetVkWrapMode(int32_t wrapMode);
         VkFilter GetVkFilterMode(int32_t filterMode);
@@ -275,7 +362,10 @@ namespace LeoVK
         void LoadTextureSamplers(tinygltf::Model& gltfModel);
         void LoadMaterials(tinygltf::Model& gltfModel);
         void LoadAnimations(tinygltf::Model& gltfModel);
-        void LoadFromFile(const std::string& filename, LeoVK::VulkanDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags = FileLoadingFlags::None, float scale = 1.0f);
+        void LoadLights(tinygltf::Model& gltfModel);
+        // 传入progress时加载失败不会退出程序，取消或失败返回false，已经创建的资源需要调用Destroy释放
+        // 也可以传入烘焙的.leopkg，结构从包中记录的源glTF读取，几何和纹理直接拷贝
+        bool LoadFromFile(const std::string& filename, LeoVK::VulkanDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags = FileLoadingFlags::None, float scale = 1.0f, LoadingProgress* progress = nullptr);
         void DrawNode(Node* node, VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1, Material::AlphaMode renderFlag = Material::ALPHA_MODE_OPAQUE);
         void Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1, Material::AlphaMode renderFlag = Material::ALPHA_MODE_OPAQUE);
         void CalculateBoundingBox(Node* node, Node* parent);
@@ -283,6 +373,10 @@ namespace LeoVK
         void UpdateAnimation(uint32_t index, float time);
         Node* FindNode(Node* parent, uint32_t index);
         Node* NodeFromIndex(uint32_t index);
+        // 记录加载过程中采样到的进程内存峰值
+        void SampleLoadMemory();
+        // 离线烘焙使用，只在CPU上生成节点、Primitive和最终的顶点索引，不创建GPU资源；结束后调用Destroy释放节点
+        void LoadGeometry(tinygltf::Model& gltfModel, uint32_t fileLoadingFlags, float scale, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
 
     public:
         LeoVK::VulkanDevice* mpDevice{};
@@ -298,7 +392,10 @@ namespace LeoVK
         std::vector<TextureSampler> mTexSamplers;
         std::vector<Material>       mMaterials;
         std::vector<Animation>      mAnimations;
+        std::vector<Light>          mLights;
         std::vector<std::string>    mExtensions;
+        TextureStats                mTextureStats;
+        size_t                      mPeakLoadMemory = 0;
 
         Dimensions mDimensions;
     };
@@ -43,6 +43,12 @@ void Benchmark::Run(std::function<void()> renderFunc, VkPhysicalDeviceProperties
     }
 }
 
+void Benchmark::AddEvent(const std::string& event)
+{
+    mEvents.emplace_back(mFrameCount, event);
+    std::cout << "Frame " << mFrameCount << ": " << event << "\n";
+}
+
 void Benchmark::SaveResults() {
 
     std::ofstream result(mFilename, std::ios::out);
@@ -53,6 +59,37 @@ void Benchmark::SaveResults() {
         result << "Device, DriverVersion, Duration (ms), Frames, FPS" << "\n";
         result << mDeviceProps.deviceName << "," << mDeviceProps.driverVersion << "," << mRuntime << "," << mFrameCount << "," << mFrameCount / (mRuntime / 1000.0) << "\n";
 
+        const double toMB = 1.0 / (1024.0 * 1024.0);
+        result << "\n" << "Memory Category, Allocations, MB" << "\n";
+        for (uint32_t i = 0; i < (uint32_t)MemoryCategory::Count; i++)
+        {
+            result << VulkanDevice::GetMemoryCategoryName((MemoryCategory)i) << "," << mMemoryReport.mCategoryCounts[i] << "," << mMemoryReport.mCategoryBytes[i] * toMB << "\n";
+        }
+        result << "Total,," << mMemoryReport.mTotalBytes * toMB << "\n";
+
+        result << "\n" << "Memory Heap, Device Local, Allocated (MB), Usage (MB), Budget (MB)" << "\n";
+        for (size_t i = 0; i < mMemoryReport.mHeaps.size(); i++)
+        {
+            const MemoryHeapBudget& heap = mMemoryReport.mHeaps[i];
+            result << i << "," << (heap.mbDeviceLocal ? 1 : 0) << "," << heap.mBlockBytes * toMB << "," << heap.mUsage * toMB << "," << heap.mBudget * toMB << "\n";
+        }
+
+        result << "\n" << "Largest Allocation, Category, Pool, MB" << "\n";
+        for (size_t i = 0; i < mMemoryReport.mTopAllocations.size(); i++)
+        {
+            const MemoryAllocationRecord& record = mMemoryReport.mTopAllocations[i];
+            result << i << "," << VulkanDevice::GetMemoryCategoryName(record.mCategory) << "," << VulkanDevice::GetMemoryPoolName(record.mPool) << "," << record.mSize * toMB << "\n";
+        }
+
+        if (!mEvents.empty())
+        {
+            result << "\n" << "Frame, Event" << "\n";
+            for (auto& event : mEvents)
+            {
+                result << event.first << "," << event.second << "\n";
+            }
+        }
+
         if (mbOutputFrameTime)
         {
             result << "\n" << "Frame, ms" << "\n";
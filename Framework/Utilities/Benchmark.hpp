@@ -3,6 +3,8 @@
 
 #include "ProjectPCH.hpp"
 
+#include "VKDevice.hpp"
+
 namespace LeoVK
 {
     class Benchmark
@@ -10,6 +12,7 @@ namespace LeoVK
     public:
         void Run(std::function<void()> renderFunc, VkPhysicalDeviceProperties deviceProp);
         void SaveResults();
+        void AddEvent(const std::string& event);
 
     public:
         bool mbActive = false;
@@ -18,6 +21,10 @@ namespace LeoVK
         uint32_t mWarmup = 1;
         uint32_t mDuration = 10;
         std::vector<double> mFrameTimes;
+        // 运行过程中的事件（如动态分辨率的调整），按帧记录
+        std::vector<std::pair<uint32_t, std::string>> mEvents;
+        // 结束时的显存用量，随结果一起保存
+        MemoryReport mMemoryReport;
         std::string mFilename;
         double mRuntime = 0.0;
         uint32_t mFrameCount = 0;
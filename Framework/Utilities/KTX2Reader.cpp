@@ -0,0 +1,158 @@
+#include "KTX2Reader.hpp"
+
+#include <zstd.h>
+
+// KTX 2.0规范中的超压缩方案
+#define KTX2_SUPERCOMPRESSION_NONE 0u
+#define KTX2_SUPERCOMPRESSION_ZSTD 2u
+#define KTX2_MAX_MIP_LEVELS 16u
+
+namespace LeoVK
+{
+    namespace KTX2Reader
+    {
+        static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+        // 文件开头的布局，之后紧跟mLevelCount个LevelIndex
+        struct Header
+        {
+            uint8_t  mIdentifier[12];
+            uint32_t mVkFormat;
+            uint32_t mTypeSize;
+            uint32_t mPixelWidth;
+            uint32_t mPixelHeight;
+            uint32_t mPixelDepth;
+            uint32_t mLayerCount;
+            uint32_t mFaceCount;
+            uint32_t mLevelCount;
+            uint32_t mSupercompressionScheme;
+            uint32_t mDfdByteOffset;
+            uint32_t mDfdByteLength;
+            uint32_t mKvdByteOffset;
+            uint32_t mKvdByteLength;
+            uint64_t mSgdByteOffset;
+            uint64_t mSgdByteLength;
+        };
+        static_assert(sizeof(Header) == 80, "KTX2 header layout");
+
+        struct LevelIndex
+        {
+            uint64_t mByteOffset;
+            uint64_t mByteLength;
+            uint64_t mUncompressedByteLength;
+        };
+
+        // 每个4x4块或者每个像素的字节数，不支持的格式返回0
+        static uint32_t GetBlockSize(VkFormat format, bool& bBlockCompressed)
+        {
+            bBlockCompressed = true;
+            switch (format)
+            {
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+                case VK_FORMAT_BC4_UNORM_BLOCK:
+                    return 8;
+                case VK_FORMAT_BC3_UNORM_BLOCK:
+                case VK_FORMAT_BC3_SRGB_BLOCK:
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                case VK_FORMAT_BC7_UNORM_BLOCK:
+                case VK_FORMAT_BC7_SRGB_BLOCK:
+                    return 16;
+                case VK_FORMAT_R8G8B8A8_UNORM:
+                case VK_FORMAT_R8G8B8A8_SRGB:
+                    bBlockCompressed = false;
+                    return 4;
+                default:
+                    return 0;
+            }
+        }
+
+        static uint64_t GetLevelSize(VkFormat format, uint32_t width, uint32_t height)
+        {
+            bool bBlockCompressed;
+            const uint64_t blockSize = GetBlockSize(format, bBlockCompressed);
+            if (!bBlockCompressed) return blockSize * width * height;
+            return blockSize * ((width + 3) / 4) * ((height + 3) / 4);
+        }
+
+        bool IsKTX2(const uint8_t* data, size_t size)
+        {
+            return data && size >= sizeof(KTX2_IDENTIFIER) && memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+        }
+
+        VkFormat GetFormat(const uint8_t* data, size_t size)
+        {
+            if (!IsKTX2(data, size) || size < sizeof(Header)) return VK_FORMAT_UNDEFINED;
+            Header header;
+            memcpy(&header, data, sizeof(Header));
+
+            // 只支持单层、单面的2D纹理；Basis数据的vkFormat是VK_FORMAT_UNDEFINED
+            const bool bKnownScheme = header.mSupercompressionScheme == KTX2_SUPERCOMPRESSION_NONE || header.mSupercompressionScheme == KTX2_SUPERCOMPRESSION_ZSTD;
+            if (!bKnownScheme || header.mPixelWidth == 0 || header.mPixelHeight == 0 || header.mPixelDepth > 1 ||
+                header.mLayerCount > 1 || header.mFaceCount != 1 || header.mLevelCount > KTX2_MAX_MIP_LEVELS)
+            {
+                return VK_FORMAT_UNDEFINED;
+            }
+            bool bBlockCompressed;
+            const auto format = static_cast<VkFormat>(header.mVkFormat);
+            return GetBlockSize(format, bBlockCompressed) > 0 ? format : VK_FORMAT_UNDEFINED;
+        }
+
+        bool Read(const uint8_t* data, size_t size, CompressedImage& image, std::string* error)
+        {
+            auto fail = [&](const std::string& message)
+            {
+                if (error) *error = message;
+                image = {};
+                return false;
+            };
+
+            const VkFormat format = GetFormat(data, size);
+            if (format == VK_FORMAT_UNDEFINED) return fail("unsupported KTX2 format or Basis Universal data");
+            Header header;
+            memcpy(&header, data, sizeof(Header));
+
+            // mLevelCount为0表示由加载者生成Mip，这里只上传第0级
+            const uint32_t levelCount = std::max(1u, header.mLevelCount);
+            if ((size - sizeof(Header)) / sizeof(LevelIndex) < levelCount) return fail("truncated KTX2 level index");
+            std::vector<LevelIndex> levels(levelCount);
+            memcpy(levels.data(), data + sizeof(Header), levelCount * sizeof(LevelIndex));
+
+            image.mFormat = format;
+            image.mWidth = header.mPixelWidth;
+            image.mHeight = header.mPixelHeight;
+            image.mMipLevels = levelCount;
+            image.mMipOffsets.resize(levelCount);
+            uint64_t totalSize = 0;
+            for (uint32_t level = 0; level < levelCount; level++)
+            {
+                image.mMipOffsets[level] = totalSize;
+                totalSize += GetLevelSize(format, std::max(1u, header.mPixelWidth >> level), std::max(1u, header.mPixelHeight >> level));
+            }
+            image.mData.resize(static_cast<size_t>(totalSize));
+
+            // 文件中的级别从小到大存放，Level Index按从大到小的顺序给出位置
+            for (uint32_t level = 0; level < levelCount; level++)
+            {
+                const LevelIndex& index = levels[level];
+                const uint64_t levelSize = (level + 1 < levelCount ? image.mMipOffsets[level + 1] : totalSize) - image.mMipOffsets[level];
+                if (index.mByteOffset > size || index.mByteLength > size - index.mByteOffset) return fail("truncated KTX2 level data");
+                uint8_t* dst = image.mData.data() + image.mMipOffsets[level];
+                if (header.mSupercompressionScheme == KTX2_SUPERCOMPRESSION_ZSTD)
+                {
+                    const size_t result = ZSTD_decompress(dst, static_cast<size_t>(levelSize), data + index.mByteOffset, static_cast<size_t>(index.mByteLength));
+                    if (ZSTD_isError(result)) return fail(std::string("Zstd: ") + ZSTD_getErrorName(result));
+                    if (result != levelSize) return fail("unexpected KTX2 level size");
+                }
+                else
+                {
+                    if (index.mByteLength != levelSize) return fail("unexpected KTX2 level size");
+                    memcpy(dst, data + index.mByteOffset, static_cast<size_t>(levelSize));
+                }
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "ProjectPCH.hpp"
+
+#include "TextureCompressor.hpp"
+
+namespace LeoVK
+{
+    /**
+     * @brief 读取KTX2容器中可以直接上传的2D纹理，支持无超压缩和Zstd超压缩
+     * @note Basis Universal（BasisLZ/ETC1S和UASTC）的数据需要转码器，这里不支持
+     */
+    namespace KTX2Reader
+    {
+        bool IsKTX2(const uint8_t* data, size_t size);
+        // 只检查头，返回数据的格式；不支持的容器、格式或者Basis数据返回VK_FORMAT_UNDEFINED
+        VkFormat GetFormat(const uint8_t* data, size_t size);
+        // 解压所有Mip级别，按从大到小的顺序连续存放到image中
+        bool Read(const uint8_t* data, size_t size, CompressedImage& image, std::string* error = nullptr);
+    }
+}
@@ -0,0 +1,50 @@
+#include "MappedFile.hpp"
+
+namespace LeoVK
+{
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    bool MappedFile::Open(const std::string &filename, std::string* error)
+    {
+        Close();
+        mFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (mFile == INVALID_HANDLE_VALUE)
+        {
+            if (error) *error = "File open error : " + filename;
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart <= 0)
+        {
+            if (error) *error = "Invalid file size : " + filename;
+            Close();
+            return false;
+        }
+        mSize = static_cast<size_t>(fileSize.QuadPart);
+
+        mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mMapping != nullptr) mpData = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+        if (mpData == nullptr)
+        {
+            if (error) *error = "File mapping error : " + filename;
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (mpData) UnmapViewOfFile(mpData);
+        if (mMapping) CloseHandle(mMapping);
+        if (mFile != INVALID_HANDLE_VALUE) CloseHandle(mFile);
+        mFile = INVALID_HANDLE_VALUE;
+        mMapping = nullptr;
+        mpData = nullptr;
+        mSize = 0;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ProjectPCH.hpp"
+
+namespace LeoVK
+{
+    /**
+     * @brief 只读映射整个文件，数据直接由系统页缓存提供，不额外拷贝到堆上
+     * @note 映射的地址在Close或者析构前一直有效
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool Open(const std::string& filename, std::string* error = nullptr);
+        void Close();
+
+        const uint8_t* Data() const { return mpData; }
+        size_t Size() const { return mSize; }
+
+    private:
+        HANDLE          mFile = INVALID_HANDLE_VALUE;
+        HANDLE          mMapping = nullptr;
+        const uint8_t*  mpData = nullptr;
+        size_t          mSize = 0;
+    };
+}
@@ -0,0 +1,151 @@
+#include "TangentGenerator.hpp"
+
+namespace LeoVK
+{
+    namespace TangentGenerator
+    {
+        static size_t TriangleCount(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+        {
+            return (indices.empty() ? vertices.size() : indices.size()) / 3;
+        }
+
+        // 索引越界的三角形直接跳过
+        static bool GetTriangle(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t triangle, uint32_t corners[3])
+        {
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                corners[i] = indices.empty() ? static_cast<uint32_t>(triangle * 3 + i) : indices[triangle * 3 + i];
+                if (corners[i] >= vertices.size()) return false;
+            }
+            return true;
+        }
+
+        // 投影到法线的切平面上并归一化，退化时返回零向量
+        static glm::vec3 ProjectToPlane(const glm::vec3& v, const glm::vec3& n)
+        {
+            glm::vec3 projected = v - n * glm::dot(n, v);
+            float length = glm::length(projected);
+            return length > 1e-8f ? projected / length : glm::vec3(0.0f);
+        }
+
+        static float CornerAngle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b)
+        {
+            glm::vec3 e1 = a - p;
+            glm::vec3 e2 = b - p;
+            float lengths = glm::length(e1) * glm::length(e2);
+            if (lengths <= 0.0f) return 0.0f;
+            return std::acos(std::clamp(glm::dot(e1, e2) / lengths, -1.0f, 1.0f));
+        }
+
+        void Unweld(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+        {
+            if (indices.empty()) return;
+            std::vector<Vertex> unwelded;
+            unwelded.reserve(indices.size());
+            for (uint32_t& index : indices)
+            {
+                unwelded.push_back(index < vertices.size() ? vertices[index] : Vertex{});
+                index = static_cast<uint32_t>(unwelded.size() - 1);
+            }
+            vertices.swap(unwelded);
+        }
+
+        void GenerateNormals(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+        {
+            std::vector<glm::vec3> normals(vertices.size(), glm::vec3(0.0f));
+            const size_t triangleCount = TriangleCount(vertices, indices);
+            for (size_t triangle = 0; triangle < triangleCount; triangle++)
+            {
+                uint32_t c[3];
+                if (!GetTriangle(vertices, indices, triangle, c)) continue;
+                // 叉积的长度是面积的两倍，直接累加就是按面积加权
+                glm::vec3 faceNormal = glm::cross(vertices[c[1]].mPos - vertices[c[0]].mPos, vertices[c[2]].mPos - vertices[c[0]].mPos);
+                for (uint32_t i = 0; i < 3; i++) normals[c[i]] += faceNormal;
+            }
+            for (size_t v = 0; v < vertices.size(); v++)
+            {
+                float length = glm::length(normals[v]);
+                vertices[v].mNormal = length > 0.0f ? normals[v] / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            }
+        }
+
+        // 累加的切线退化时任取一个与法线垂直的方向，保证TBN可以正交化
+        static glm::vec4 FinalizeTangent(const glm::vec3& n, const glm::vec3& tangentSum, float w)
+        {
+            glm::vec3 t = ProjectToPlane(tangentSum, n);
+            if (t == glm::vec3(0.0f))
+            {
+                t = ProjectToPlane(std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f), n);
+                if (t == glm::vec3(0.0f)) t = glm::vec3(1.0f, 0.0f, 0.0f);
+            }
+            return glm::vec4(t, w);
+        }
+
+        void GenerateTangents(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+        {
+            // 每个顶点按角的手性分两组累加，0为右手（w = 1），1为左手（w = -1），两侧的切线不会互相抵消
+            const size_t originalCount = vertices.size();
+            std::vector<glm::vec3> tangents[2] = {
+                std::vector<glm::vec3>(originalCount, glm::vec3(0.0f)),
+                std::vector<glm::vec3>(originalCount, glm::vec3(0.0f)) };
+            std::vector<uint8_t> usedGroups(originalCount, 0);
+            std::vector<uint8_t> cornerGroups(indices.size(), 0);
+            const size_t triangleCount = TriangleCount(vertices, indices);
+            for (size_t triangle = 0; triangle < triangleCount; triangle++)
+            {
+                uint32_t c[3];
+                if (!GetTriangle(vertices, indices, triangle, c)) continue;
+                const glm::vec3 e1 = vertices[c[1]].mPos - vertices[c[0]].mPos;
+                const glm::vec3 e2 = vertices[c[2]].mPos - vertices[c[0]].mPos;
+                const glm::vec2 d1 = vertices[c[1]].mUV0 - vertices[c[0]].mUV0;
+                const glm::vec2 d2 = vertices[c[2]].mUV0 - vertices[c[0]].mUV0;
+                const float det = d1.x * d2.y - d2.x * d1.y;
+                if (std::abs(det) < 1e-12f) continue;
+
+                // 切线沿u增大的方向；glTF的UV原点在左上角，法线贴图的+Y对应v减小的方向
+                const glm::vec3 sdir = (e1 * d2.y - e2 * d1.y) / det;
+                const glm::vec3 tdir = (e1 * d2.x - e2 * d1.x) / det;
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    const glm::vec3& n = vertices[c[i]].mNormal;
+                    const float angle = CornerAngle(vertices[c[i]].mPos, vertices[c[(i + 1) % 3]].mPos, vertices[c[(i + 2) % 3]].mPos);
+                    const glm::vec3 t = ProjectToPlane(sdir, n);
+                    const uint8_t group = glm::dot(glm::cross(n, t), ProjectToPlane(tdir, n)) < 0.0f ? 1 : 0;
+                    tangents[group][c[i]] += t * angle;
+                    usedGroups[c[i]] |= 1 << group;
+                    if (!indices.empty()) cornerGroups[triangle * 3 + i] = group;
+                }
+            }
+
+            // 两种手性都用到的顶点复制一份给左手的三角形，UV退化的三角形留在原来的顶点上
+            std::vector<uint32_t> splitVertices(originalCount, UINT32_MAX);
+            size_t splitCount = 0;
+            for (size_t v = 0; v < originalCount; v++) splitCount += usedGroups[v] == 3 ? 1 : 0;
+            vertices.reserve(originalCount + splitCount);
+            for (size_t v = 0; v < originalCount; v++)
+            {
+                if (usedGroups[v] != 3) continue;
+                splitVertices[v] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(vertices[v]);
+            }
+            for (size_t corner = 0; corner < indices.size(); corner++)
+            {
+                if (cornerGroups[corner] == 1 && indices[corner] < originalCount && splitVertices[indices[corner]] != UINT32_MAX)
+                {
+                    indices[corner] = splitVertices[indices[corner]];
+                }
+            }
+
+            for (size_t v = 0; v < originalCount; v++)
+            {
+                const glm::vec3& n = vertices[v].mNormal;
+                const uint8_t group = usedGroups[v] == 2 ? 1 : 0;
+                vertices[v].mTangent = FinalizeTangent(n, tangents[group][v], group ? -1.0f : 1.0f);
+                if (splitVertices[v] != UINT32_MAX)
+                {
+                    vertices[splitVertices[v]].mTangent = FinalizeTangent(n, tangents[1][v], -1.0f);
+                }
+            }
+        }
+    }
+}
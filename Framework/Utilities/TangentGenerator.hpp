@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ProjectPCH.hpp"
+
+#include "AssetsLoader.hpp"
+
+namespace LeoVK
+{
+    /**
+     * @brief 加载时为缺少属性的Primitive生成法线和切线
+     * @note indices相对于vertices的第一个顶点，为空时按顺序每三个顶点组成一个三角形
+     */
+    namespace TangentGenerator
+    {
+        // 每个索引展开为独立的顶点，索引变为顺序排列，之后生成的法线就是面法线
+        void Unweld(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+        // 按面积加权平均共享顶点的三角形面法线
+        void GenerateNormals(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+        // 与MikkTSpace相同的约定：按角度加权累加投影到法线平面的切线，w为副切线方向，B = cross(N, T) * w
+        // 同一个顶点被两种手性的三角形共享时（镜像UV的接缝）复制一份顶点，并改写左手三角形的索引
+        void GenerateTangents(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+    }
+}
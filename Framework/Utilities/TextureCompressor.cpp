@@ -0,0 +1,418 @@
+#include "TextureCompressor.hpp"
+
+#include <climits>
+#include <xmmintrin.h>
+
+namespace LeoVK
+{
+    namespace TextureCompressor
+    {
+        using BlockEncoder = void(*)(const uint8_t block[16][4], uint8_t* out);
+
+        static float SRGBToLinear(float c)
+        {
+            return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        static float LinearToSRGB(float c)
+        {
+            return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        }
+
+        static uint16_t PackRGB565(const uint8_t* c)
+        {
+            return static_cast<uint16_t>(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+        }
+
+        static void UnpackRGB565(uint16_t v, int* c)
+        {
+            const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+            c[0] = (r << 3) | (r >> 2);
+            c[1] = (g << 2) | (g >> 4);
+            c[2] = (b << 3) | (b >> 2);
+        }
+
+        // 包围盒端点向内收缩1/16，再把每个像素映射到最近的调色板颜色
+        static void EncodeColorBlock(const uint8_t block[16][4], uint8_t* out)
+        {
+            uint8_t minC[3] = { 255, 255, 255 }, maxC[3] = { 0, 0, 0 };
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                for (uint32_t ch = 0; ch < 3; ch++)
+                {
+                    minC[ch] = std::min(minC[ch], block[i][ch]);
+                    maxC[ch] = std::max(maxC[ch], block[i][ch]);
+                }
+            }
+            for (uint32_t ch = 0; ch < 3; ch++)
+            {
+                const uint8_t inset = static_cast<uint8_t>((maxC[ch] - minC[ch]) >> 4);
+                minC[ch] += inset;
+                maxC[ch] -= inset;
+            }
+
+            // 565的每个分量单调，c0 >= c1，相等时只能使用端点0
+            const uint16_t c0 = PackRGB565(maxC), c1 = PackRGB565(minC);
+            uint32_t indices = 0;
+            if (c0 != c1)
+            {
+                int palette[4][3];
+                UnpackRGB565(c0, palette[0]);
+                UnpackRGB565(c1, palette[1]);
+                for (uint32_t ch = 0; ch < 3; ch++)
+                {
+                    palette[2][ch] = (2 * palette[0][ch] + palette[1][ch]) / 3;
+                    palette[3][ch] = (palette[0][ch] + 2 * palette[1][ch]) / 3;
+                }
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    uint32_t best = 0;
+                    int bestDist = INT_MAX;
+                    for (uint32_t p = 0; p < 4; p++)
+                    {
+                        const int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+                        const int dist = dr * dr + dg * dg + db * db;
+                        if (dist < bestDist)
+                        {
+                            bestDist = dist;
+                            best = p;
+                        }
+                    }
+                    indices |= best << (2 * i);
+                }
+            }
+            out[0] = static_cast<uint8_t>(c0 & 0xFF);
+            out[1] = static_cast<uint8_t>(c0 >> 8);
+            out[2] = static_cast<uint8_t>(c1 & 0xFF);
+            out[3] = static_cast<uint8_t>(c1 >> 8);
+            for (uint32_t i = 0; i < 4; i++) out[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+        }
+
+        // BC3的Alpha块和BC4/BC5的通道块格式相同，使用8个插值的模式，端点取块内的最大最小值
+        static void EncodeSingleChannelBlock(const uint8_t block[16][4], uint32_t channel, uint8_t* out)
+        {
+            uint8_t a0 = 0, a1 = 255;
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                a0 = std::max(a0, block[i][channel]);
+                a1 = std::min(a1, block[i][channel]);
+            }
+
+            uint64_t indices = 0;
+            if (a0 != a1)
+            {
+                int palette[8] = { a0, a1 };
+                for (int i = 1; i <= 6; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    uint64_t best = 0;
+                    int bestDist = INT_MAX;
+                    for (uint32_t p = 0; p < 8; p++)
+                    {
+                        const int dist = std::abs(block[i][channel] - palette[p]);
+                        if (dist < bestDist)
+                        {
+                            bestDist = dist;
+                            best = p;
+                        }
+                    }
+                    indices |= best << (3 * i);
+                }
+            }
+            out[0] = a0;
+            out[1] = a1;
+            for (uint32_t i = 0; i < 6; i++) out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+        }
+
+        static void EncodeBC3Block(const uint8_t block[16][4], uint8_t* out)
+        {
+            EncodeSingleChannelBlock(block, 3, out);
+            EncodeColorBlock(block, out + 8);
+        }
+
+        static void EncodeBC4Block(const uint8_t block[16][4], uint8_t* out)
+        {
+            EncodeSingleChannelBlock(block, 0, out);
+        }
+
+        static void EncodeBC5Block(const uint8_t block[16][4], uint8_t* out)
+        {
+            EncodeSingleChannelBlock(block, 0, out);
+            EncodeSingleChannelBlock(block, 1, out + 8);
+        }
+
+        // BC7模式6的插值权重，对称排列，交换端点时索引取反即可
+        static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        static void WriteBits(uint64_t bits[2], uint32_t& pos, uint32_t value, uint32_t count)
+        {
+            for (uint32_t i = 0; i < count; i++, pos++)
+            {
+                if ((value >> i) & 1) bits[pos / 64] |= 1ull << (pos % 64);
+            }
+        }
+
+        // BC7模式6：单个子集，RGBA端点各7位加每个端点一个P位，4位索引
+        // 端点取像素在主轴上投影的两端，主轴由协方差矩阵幂迭代得到
+        static void EncodeBC7Block(const uint8_t block[16][4], uint8_t* out)
+        {
+            glm::vec4 pixels[16];
+            glm::vec4 mean(0.0f);
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                pixels[i] = glm::vec4(block[i][0], block[i][1], block[i][2], block[i][3]);
+                mean += pixels[i];
+            }
+            mean /= 16.0f;
+
+            glm::mat4 covariance(0.0f);
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                const glm::vec4 d = pixels[i] - mean;
+                covariance += glm::outerProduct(d, d);
+            }
+            glm::vec4 axis(1.0f);
+            for (uint32_t iter = 0; iter < 8; iter++)
+            {
+                const glm::vec4 next = covariance * axis;
+                const float length = glm::length(next);
+                if (length < 1e-6f) break;
+                axis = next / length;
+            }
+
+            float tMin = FLT_MAX, tMax = -FLT_MAX;
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                const float t = glm::dot(pixels[i] - mean, axis);
+                tMin = std::min(tMin, t);
+                tMax = std::max(tMax, t);
+            }
+            const glm::vec4 endpoints[2] = {
+                glm::clamp(mean + axis * tMin, glm::vec4(0.0f), glm::vec4(255.0f)),
+                glm::clamp(mean + axis * tMax, glm::vec4(0.0f), glm::vec4(255.0f)) };
+
+            // 每个端点选择量化误差较小的P位
+            uint32_t quantized[2][4], pBits[2];
+            int colors[2][4];
+            for (uint32_t e = 0; e < 2; e++)
+            {
+                float bestError = FLT_MAX;
+                for (uint32_t p = 0; p < 2; p++)
+                {
+                    uint32_t q[4];
+                    float error = 0.0f;
+                    for (uint32_t ch = 0; ch < 4; ch++)
+                    {
+                        q[ch] = static_cast<uint32_t>(glm::clamp((int)std::lround((endpoints[e][ch] - (float)p) * 0.5f), 0, 127));
+                        const float d = (float)((q[ch] << 1) | p) - endpoints[e][ch];
+                        error += d * d;
+                    }
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        memcpy(quantized[e], q, sizeof(q));
+                        pBits[e] = p;
+                    }
+                }
+                for (uint32_t ch = 0; ch < 4; ch++) colors[e][ch] = static_cast<int>((quantized[e][ch] << 1) | pBits[e]);
+            }
+
+            uint32_t indices[16];
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                int bestDist = INT_MAX;
+                for (uint32_t w = 0; w < 16; w++)
+                {
+                    int dist = 0;
+                    for (uint32_t ch = 0; ch < 4; ch++)
+                    {
+                        const int value = ((64 - BC7_WEIGHTS[w]) * colors[0][ch] + BC7_WEIGHTS[w] * colors[1][ch] + 32) >> 6;
+                        dist += (block[i][ch] - value) * (block[i][ch] - value);
+                    }
+                    if (dist < bestDist)
+                    {
+                        bestDist = dist;
+                        indices[i] = w;
+                    }
+                }
+            }
+
+            // 第一个索引的最高位不存储，必须为0
+            if (indices[0] & 8)
+            {
+                std::swap(quantized[0], quantized[1]);
+                std::swap(pBits[0], pBits[1]);
+                for (uint32_t i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+            }
+
+            uint64_t bits[2] = { 0, 0 };
+            uint32_t pos = 0;
+            WriteBits(bits, pos, 1u << 6, 7);
+            for (uint32_t ch = 0; ch < 4; ch++)
+            {
+                WriteBits(bits, pos, quantized[0][ch], 7);
+                WriteBits(bits, pos, quantized[1][ch], 7);
+            }
+            WriteBits(bits, pos, pBits[0], 1);
+            WriteBits(bits, pos, pBits[1], 1);
+            WriteBits(bits, pos, indices[0], 3);
+            for (uint32_t i = 1; i < 16; i++) WriteBits(bits, pos, indices[i], 4);
+            for (uint32_t i = 0; i < 16; i++) out[i] = static_cast<uint8_t>(bits[i / 8] >> (8 * (i % 8)));
+        }
+
+        // sRGB编码的贴图在线性空间中生成Mip，写入压缩块前再编码回sRGB
+        static std::vector<glm::vec4> DecodeTexels(const uint8_t* pixels, uint32_t components, size_t count, bool bSRGB, bool& bAlpha)
+        {
+            std::array<float, 256> decode{};
+            for (uint32_t i = 0; i < 256; i++) decode[i] = bSRGB ? SRGBToLinear((float)i / 255.0f) : (float)i / 255.0f;
+
+            bAlpha = false;
+            std::vector<glm::vec4> texels(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                const uint8_t* p = pixels + i * components;
+                const uint8_t g = components >= 3 ? p[1] : p[0], b = components >= 3 ? p[2] : p[0];
+                const uint8_t alpha = components == 4 ? p[3] : (components == 2 ? p[1] : 255);
+                bAlpha |= alpha != 255;
+                texels[i] = glm::vec4(decode[p[0]], decode[g], decode[b], (float)alpha / 255.0f);
+            }
+            return texels;
+        }
+
+        // 2x2盒式滤波，每个纹素的四个通道一起用SSE计算
+        static void Downsample(const std::vector<glm::vec4>& src, uint32_t width, uint32_t height, std::vector<glm::vec4>& dst, uint32_t dstWidth, uint32_t dstHeight)
+        {
+            const __m128 quarter = _mm_set1_ps(0.25f);
+            dst.resize(static_cast<size_t>(dstWidth) * dstHeight);
+            for (uint32_t y = 0; y < dstHeight; y++)
+            {
+                const uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+                const glm::vec4* row0 = &src[static_cast<size_t>(y0) * width];
+                const glm::vec4* row1 = &src[static_cast<size_t>(y1) * width];
+                for (uint32_t x = 0; x < dstWidth; x++)
+                {
+                    const uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                    const __m128 top = _mm_add_ps(_mm_loadu_ps(&row0[x0].x), _mm_loadu_ps(&row0[x1].x));
+                    const __m128 bottom = _mm_add_ps(_mm_loadu_ps(&row1[x0].x), _mm_loadu_ps(&row1[x1].x));
+                    _mm_storeu_ps(&dst[static_cast<size_t>(y) * dstWidth + x].x, _mm_mul_ps(_mm_add_ps(top, bottom), quarter));
+                }
+            }
+        }
+
+        // 对每一级转换回8位、按4x4块编码，再向下一级滤波
+        static void EncodeMipChain(std::vector<glm::vec4>& texels, uint32_t width, uint32_t height, bool bSRGB, bool bNormalMap,
+            VkFormat format, uint32_t blockSize, BlockEncoder encoder, CompressedImage& image)
+        {
+            image.mFormat = format;
+            image.mWidth = width;
+            image.mHeight = height;
+            image.mMipLevels = static_cast<uint32_t>(floor(log2(std::max(width, height))) + 1.0);
+            image.mData.clear();
+            image.mMipOffsets.clear();
+
+            uint32_t levelWidth = width, levelHeight = height;
+            std::vector<uint8_t> rgba;
+            std::vector<glm::vec4> next;
+            for (uint32_t level = 0; level < image.mMipLevels; level++)
+            {
+                rgba.resize(static_cast<size_t>(levelWidth) * levelHeight * 4);
+                for (size_t i = 0; i < static_cast<size_t>(levelWidth) * levelHeight; i++)
+                {
+                    for (uint32_t ch = 0; ch < 4; ch++)
+                    {
+                        float c = glm::clamp(texels[i][ch], 0.0f, 1.0f);
+                        if (bSRGB && ch < 3) c = LinearToSRGB(c);
+                        rgba[i * 4 + ch] = static_cast<uint8_t>(c * 255.0f + 0.5f);
+                    }
+                }
+
+                // 不足4x4的边缘块重复最后一行和最后一列
+                const uint32_t blocksX = (levelWidth + 3) / 4, blocksY = (levelHeight + 3) / 4;
+                image.mMipOffsets.push_back(image.mData.size());
+                image.mData.resize(image.mData.size() + static_cast<size_t>(blocksX) * blocksY * blockSize);
+                uint8_t* out = image.mData.data() + image.mMipOffsets.back();
+                for (uint32_t by = 0; by < blocksY; by++)
+                {
+                    for (uint32_t bx = 0; bx < blocksX; bx++)
+                    {
+                        uint8_t block[16][4];
+                        for (uint32_t y = 0; y < 4; y++)
+                        {
+                            for (uint32_t x = 0; x < 4; x++)
+                            {
+                                const uint32_t sx = std::min(bx * 4 + x, levelWidth - 1), sy = std::min(by * 4 + y, levelHeight - 1);
+                                memcpy(block[y * 4 + x], &rgba[(static_cast<size_t>(sy) * levelWidth + sx) * 4], 4);
+                            }
+                        }
+                        encoder(block, out);
+                        out += blockSize;
+                    }
+                }
+
+                if (level + 1 == image.mMipLevels) break;
+                const uint32_t nextWidth = std::max(1u, levelWidth / 2), nextHeight = std::max(1u, levelHeight / 2);
+                Downsample(texels, levelWidth, levelHeight, next, nextWidth, nextHeight);
+                // 法线平均之后长度变短，重新归一化
+                if (bNormalMap)
+                {
+                    for (glm::vec4& texel : next)
+                    {
+                        const glm::vec3 n = glm::vec3(texel) * 2.0f - glm::vec3(1.0f);
+                        const float length = glm::length(n);
+                        if (length > 1e-6f) texel = glm::vec4(n / length * 0.5f + glm::vec3(0.5f), texel.w);
+                    }
+                }
+                texels.swap(next);
+                levelWidth = nextWidth;
+                levelHeight = nextHeight;
+            }
+        }
+
+        bool IsSupported(LeoVK::VulkanDevice *device)
+        {
+            if (!device->mEnabledFeatures.textureCompressionBC) return false;
+            for (VkFormat format : { VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC3_UNORM_BLOCK })
+            {
+                VkFormatProperties formatProps;
+                vkGetPhysicalDeviceFormatProperties(device->mPhysicalDevice, format, &formatProps);
+                if (!(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) return false;
+            }
+            return true;
+        }
+
+        void Compress(const uint8_t *pixels, uint32_t components, uint32_t width, uint32_t height, bool bSRGB, CompressedImage &image)
+        {
+            bool bAlpha = false;
+            std::vector<glm::vec4> texels = DecodeTexels(pixels, components, static_cast<size_t>(width) * height, bSRGB, bAlpha);
+            if (bAlpha)
+            {
+                EncodeMipChain(texels, width, height, bSRGB, false, VK_FORMAT_BC3_UNORM_BLOCK, 16, EncodeBC3Block, image);
+            }
+            else
+            {
+                EncodeMipChain(texels, width, height, bSRGB, false, VK_FORMAT_BC1_RGB_UNORM_BLOCK, 8, EncodeColorBlock, image);
+            }
+        }
+
+        bool CompressToFormat(const uint8_t *pixels, uint32_t components, uint32_t width, uint32_t height, bool bSRGB, VkFormat format, CompressedImage &image)
+        {
+            BlockEncoder encoder = nullptr;
+            uint32_t blockSize = 16;
+            switch (format)
+            {
+            case VK_FORMAT_BC7_UNORM_BLOCK: encoder = EncodeBC7Block; break;
+            case VK_FORMAT_BC5_UNORM_BLOCK: encoder = EncodeBC5Block; break;
+            case VK_FORMAT_BC4_UNORM_BLOCK: encoder = EncodeBC4Block; blockSize = 8; break;
+            case VK_FORMAT_BC3_UNORM_BLOCK: encoder = EncodeBC3Block; break;
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK: encoder = EncodeColorBlock; blockSize = 8; break;
+            default: return false;
+            }
+
+            bool bAlpha = false;
+            const bool bNormalMap = format == VK_FORMAT_BC5_UNORM_BLOCK;
+            std::vector<glm::vec4> texels = DecodeTexels(pixels, components, static_cast<size_t>(width) * height, bSRGB && !bNormalMap, bAlpha);
+            EncodeMipChain(texels, width, height, bSRGB && !bNormalMap, bNormalMap, format, blockSize, encoder, image);
+            return true;
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 #include <thread>
 #include <queue>
 #include <mutex>
@@ -39,49 +40,49 @@ namespace LeoVK
         std::vector<std::unique_ptr<Thread>> mThreads;
     };
 
-    Thread::Thread()
+    inline Thread::Thread()
     {
         mWorker = std::thread(&Thread::queueLoop, this);
     }
 
-    Thread::~Thread()
+    inline Thread::~Thread()
     {
         if (mWorker.joinable())
         {
             Wait();
             mQueueMutex.lock();
             mbDestroying = true;
-            mCondition.notify_one();
+            mCondition.notify_all();
             mQueueMutex.unlock();
             mWorker.join();
         }
     }
 
-    void Thread::AddJob(std::function<void()> function)
+    inline void Thread::AddJob(std::function<void()> function)
     {
         std::lock_guard<std::mutex> lock(mQueueMutex);
         mJobQueue.push(std::move(function));
-        mCondition.notify_one();
+        mCondition.notify_all();
     }
 
-    void Thread::Wait()
+    inline void Thread::Wait()
     {
         std::unique_lock<std::mutex> lock(mQueueMutex);
         mCondition.wait(lock, [this]() { return mJobQueue.empty(); });
     }
 
-    void ThreadPool::SetThreadCount(uint32_t count)
+    inline void ThreadPool::SetThreadCount(uint32_t count)
     {
         mThreads.clear();
         for (auto i = 0; i < count; i++) mThreads.push_back(std::make_unique<Thread>());
     }
 
-    void ThreadPool::Wait()
+    inline void ThreadPool::Wait()
     {
         for (auto & t : mThreads) t->Wait();
     }
 
-    void Thread::queueLoop()
+    inline void Thread::queueLoop()
     {
         while (true)
         {
@@ -96,7 +97,7 @@ namespace LeoVK
             {
                 std::lock_guard<std::mutex> lock(mQueueMutex);
                 mJobQueue.pop();
-                mCondition.notify_one();
+                mCondition.notify_all();
             }
         }
     }
@@ -1,9 +1,11 @@
 ﻿#include "VKBuffer.hpp"
+#include "VKDevice.hpp"
 
 namespace LeoVK
 {
     /**
 	* 映射内存到这个Buffer，如果成功，mpMapped会指向这段buffer
+	* 主机可见的内存由VMA持久映射，这里只取出对应的地址
 	*
 	* @param size (Optional) 映射的内存大小，VK_WHOLE_SIZE会映射整个buffer的范围
 	* @param offset (Optional) 起始位置偏移
@@ -12,33 +14,33 @@ namespace LeoVK
 	*/
     VkResult Buffer::Map(VkDeviceSize size, VkDeviceSize offset)
     {
-        return vkMapMemory(mDevice, mMemory, offset, size, 0, &mpMapped);
+        VmaAllocationInfo allocInfo;
+        vmaGetAllocationInfo(mpVulkanDevice->mAllocator, mAllocation, &allocInfo);
+        if (allocInfo.pMappedData == nullptr) return VK_ERROR_MEMORY_MAP_FAILED;
+        mpMapped = static_cast<uint8_t*>(allocInfo.pMappedData) + offset;
+        return VK_SUCCESS;
     }
 
     /**
 	* Unmap a mapped memory range
 	*
-	* @note Does not return a result as vkUnmapMemory can't fail
+	* @note 内存块的映射由VMA管理，释放分配时才会真正Unmap
 	*/
     void Buffer::UnMap()
     {
-        if (mpMapped)
-        {
-            vkUnmapMemory(mDevice, mMemory);
-            mpMapped = nullptr;
-        }
+        mpMapped = nullptr;
     }
 
     /**
 	* 把内存绑定到Buffer上
 	*
-	* @param offset (Optional) 要绑定内存的起始位置偏移
+	* @param offset (Optional) 相对于分配起始位置的偏移
 	*
 	* @return VkResult of the bindBufferMemory call
 	*/
     VkResult Buffer::Bind(VkDeviceSize offset)
     {
-        return vkBindBufferMemory(mDevice, mBuffer, mMemory, offset);
+        return vmaBindBufferMemory2(mpVulkanDevice->mAllocator, mAllocation, offset, mBuffer, nullptr);
     }
 
     /**
@@ -80,12 +82,7 @@ namespace LeoVK
 	*/
     VkResult Buffer::Flush(VkDeviceSize size, VkDeviceSize offset)
     {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = mMemory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkFlushMappedMemoryRanges(mDevice, 1, &mappedRange);
+        return vmaFlushAllocation(mpVulkanDevice->mAllocator, mAllocation, offset, size);
     }
 
     /**
@@ -100,12 +97,7 @@ namespace LeoVK
 	*/
     VkResult Buffer::Invalidate(VkDeviceSize size, VkDeviceSize offset)
     {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = mMemory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(mDevice, 1, &mappedRange);
+        return vmaInvalidateAllocation(mpVulkanDevice->mAllocator, mAllocation, offset, size);
     }
 
     /**
@@ -116,10 +108,37 @@ namespace LeoVK
         if (mBuffer)
         {
             vkDestroyBuffer(mDevice, mBuffer, nullptr);
+            mBuffer = VK_NULL_HANDLE;
         }
-        if (mMemory)
+        if (mAllocation)
+        {
+            mpVulkanDevice->FreeMemory(mAllocation);
+            mAllocation = VK_NULL_HANDLE;
+        }
+        mpMapped = nullptr;
+    }
+
+    /**
+	* 交给设备在当前帧完成后销毁，调用后这个对象可以立即重新创建
+	*/
+    void Buffer::DeferDestroy()
+    {
+        if (mpVulkanDevice == nullptr)
         {
-            vkFreeMemory(mDevice, mMemory, nullptr);
+            Destroy();
+            return;
         }
+        VkDevice device = mDevice;
+        VkBuffer buffer = mBuffer;
+        VmaAllocation allocation = mAllocation;
+        LeoVK::VulkanDevice* vulkanDevice = mpVulkanDevice;
+        mpVulkanDevice->DeferDestroy([device, buffer, allocation, vulkanDevice]()
+        {
+            if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(device, buffer, nullptr);
+            vulkanDevice->FreeMemory(allocation);
+        });
+        mBuffer = VK_NULL_HANDLE;
+        mAllocation = VK_NULL_HANDLE;
+        mpMapped = nullptr;
     }
 }
\ No newline at end of file
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <Vulkan/vulkan.h>
+#include "vk_mem_alloc.h"
 #include "VKTools.hpp"
 
 namespace LeoVK
 {
+    class VulkanDevice;
+
     /**
 	* @brief Encapsulates access to a Vulkan buffer backed up by device memory
 	* @note To be filled by an external source like the VulkanDevice
@@ -22,11 +25,13 @@ namespace LeoVK
         VkResult Flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
         VkResult Invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
         void Destroy();
+        void DeferDestroy();
 
     public:
         VkDevice                mDevice;
+        VulkanDevice*           mpVulkanDevice = nullptr;
         VkBuffer                mBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory          mMemory = VK_NULL_HANDLE;
+        VmaAllocation           mAllocation = VK_NULL_HANDLE;
         VkDescriptorBufferInfo  mDescriptor;
         VkDeviceSize            mSize = 0;
         VkDeviceSize            mAlignment = 0;
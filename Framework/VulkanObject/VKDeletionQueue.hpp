@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <functional>
+
+namespace LeoVK
+{
+    /**
+     * @brief 按帧编号延迟执行的销毁操作
+     * @note 入队之后资源不能再被新提交的命令引用，入队时所在帧的GPU工作完成后才真正销毁
+     */
+    class DeletionQueue
+    {
+    public:
+        void Push(uint64_t frameIndex, std::function<void()> deleter);
+        // 执行所有不晚于completedFrame入队的销毁，返回执行的数量
+        uint32_t Collect(uint64_t completedFrame);
+        // 设备空闲时执行全部销毁
+        uint32_t Flush();
+        size_t Size();
+
+    private:
+        struct Entry
+        {
+            uint64_t                mFrameIndex;
+            std::function<void()>   mDeleter;
+        };
+        std::deque<Entry>   mEntries;
+        std::mutex          mMutex;
+    };
+
+    inline void DeletionQueue::Push(uint64_t frameIndex, std::function<void()> deleter)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries.push_back({ frameIndex, std::move(deleter) });
+    }
+
+    inline uint32_t DeletionQueue::Collect(uint64_t completedFrame)
+    {
+        // 先取出再执行，销毁过程中可以继续入队
+        std::vector<std::function<void()>> deleters;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            while (!mEntries.empty() && mEntries.front().mFrameIndex <= completedFrame)
+            {
+                deleters.push_back(std::move(mEntries.front().mDeleter));
+                mEntries.pop_front();
+            }
+        }
+        for (auto& deleter : deleters) deleter();
+        return static_cast<uint32_t>(deleters.size());
+    }
+
+    inline uint32_t DeletionQueue::Flush()
+    {
+        return Collect(UINT64_MAX);
+    }
+
+    inline size_t DeletionQueue::Size()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEntries.size();
+    }
+}
@@ -0,0 +1,161 @@
+#include "VKDescriptorAllocator.hpp"
+
+// 每个分组第一个Pool能分配的Set数量，之后每次扩容翻倍
+#define DESCRIPTOR_POOL_MIN_SETS 32u
+#define DESCRIPTOR_POOL_MAX_SETS 1024u
+
+namespace LeoVK
+{
+    // 新Pool中每个Set平均预留的Descriptor数量
+    static const std::array<std::pair<VkDescriptorType, float>, 4> PoolRatios = {{
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.5f },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f },
+    }};
+
+    static bool PoolFits(const std::vector<VkDescriptorPoolSize>& poolSizes, const std::vector<VkDescriptorPoolSize>& required)
+    {
+        for (auto& req : required)
+        {
+            auto it = std::find_if(poolSizes.begin(), poolSizes.end(), [&](const VkDescriptorPoolSize& size) { return size.type == req.type; });
+            if (it == poolSizes.end() || it->descriptorCount < req.descriptorCount) return false;
+        }
+        return true;
+    }
+
+    void DescriptorAllocator::Init(LeoVK::VulkanDevice *device)
+    {
+        mpDevice = device;
+    }
+
+    void DescriptorAllocator::Destroy()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mpDevice == nullptr) return;
+        VkDevice logicalDevice = mpDevice->mLogicalDevice;
+        for (auto& group : mGroups)
+        {
+            for (auto& pool : group.second.mPools) vkDestroyDescriptorPool(logicalDevice, pool.mPool, nullptr);
+        }
+        for (auto& pool : mRetiredPools) vkDestroyDescriptorPool(logicalDevice, pool.mPool, nullptr);
+        for (auto& layout : mLayouts) vkDestroyDescriptorSetLayout(logicalDevice, layout.second, nullptr);
+        mGroups.clear();
+        mRetiredPools.clear();
+        mLayouts.clear();
+        mLayoutSizes.clear();
+        mPoolCount = 0;
+        mSetCount = 0;
+    }
+
+    /**
+    * 签名由每个Binding的编号、类型、数量和Shader阶段组成，不支持Immutable Sampler
+    */
+    VkDescriptorSetLayout DescriptorAllocator::GetLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::vector<VkDescriptorSetLayoutBinding> sorted = bindings;
+        std::sort(sorted.begin(), sorted.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+        std::vector<uint32_t> key;
+        key.reserve(sorted.size() * 4);
+        for (auto& binding : sorted)
+        {
+            assert(binding.pImmutableSamplers == nullptr);
+            key.insert(key.end(), { binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags });
+        }
+
+        auto it = mLayouts.find(key);
+        if (it != mLayouts.end()) return it->second;
+
+        VkDescriptorSetLayout layout;
+        VkDescriptorSetLayoutCreateInfo descSetLayoutCI = LeoVK::Init::DescSetLayoutCreateInfo(bindings);
+        VK_CHECK(vkCreateDescriptorSetLayout(mpDevice->mLogicalDevice, &descSetLayoutCI, nullptr, &layout))
+        mLayouts[key] = layout;
+
+        // 记录一个Set需要的Descriptor数量，创建Pool时保证至少能放下一个
+        std::vector<VkDescriptorPoolSize>& sizes = mLayoutSizes[layout];
+        for (auto& binding : sorted)
+        {
+            auto sizeIt = std::find_if(sizes.begin(), sizes.end(), [&](const VkDescriptorPoolSize& size) { return size.type == binding.descriptorType; });
+            if (sizeIt == sizes.end()) sizes.push_back(LeoVK::Init::DescPoolSize(binding.descriptorType, binding.descriptorCount));
+            else sizeIt->descriptorCount += binding.descriptorCount;
+        }
+        return layout;
+    }
+
+    VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, uint32_t group)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Group& setGroup = mGroups[group];
+        VkDescriptorSet descSet = VK_NULL_HANDLE;
+        if (!setGroup.mPools.empty())
+        {
+            VkDescriptorSetAllocateInfo descSetAI = LeoVK::Init::DescSetAllocateInfo(setGroup.mPools.back().mPool, &layout, 1);
+            VkResult result = vkAllocateDescriptorSets(mpDevice->mLogicalDevice, &descSetAI, &descSet);
+            if (result == VK_SUCCESS)
+            {
+                setGroup.mSetCount++;
+                mSetCount++;
+                return descSet;
+            }
+            // 当前Pool用完或者碎片化时换一个新的Pool，其它错误照常报告
+            if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) VK_CHECK(result)
+        }
+
+        setGroup.mPools.push_back(AcquirePool(mLayoutSizes[layout], setGroup));
+        VkDescriptorSetAllocateInfo descSetAI = LeoVK::Init::DescSetAllocateInfo(setGroup.mPools.back().mPool, &layout, 1);
+        VK_CHECK(vkAllocateDescriptorSets(mpDevice->mLogicalDevice, &descSetAI, &descSet))
+        setGroup.mSetCount++;
+        mSetCount++;
+        return descSet;
+    }
+
+    void DescriptorAllocator::FreeGroup(uint32_t group)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mGroups.find(group);
+        if (it == mGroups.end()) return;
+        for (auto& pool : it->second.mPools)
+        {
+            pool.mRetiredFrame = mpDevice->mFrameIndex;
+            mRetiredPools.push_back(pool);
+        }
+        mSetCount -= it->second.mSetCount;
+        mGroups.erase(it);
+    }
+
+    /**
+    * 优先复用已经不被GPU引用、容量足够的Pool，没有时按分组的增长规模创建
+    */
+    DescriptorAllocator::Pool DescriptorAllocator::AcquirePool(const std::vector<VkDescriptorPoolSize> &required, Group &group)
+    {
+        group.mNextMaxSets = group.mNextMaxSets == 0 ? DESCRIPTOR_POOL_MIN_SETS : std::min(group.mNextMaxSets * 2, DESCRIPTOR_POOL_MAX_SETS);
+
+        for (auto it = mRetiredPools.begin(); it != mRetiredPools.end(); ++it)
+        {
+            // 释放时所在的帧可能还有命令在录制，要等下一帧完成
+            if (it->mRetiredFrame >= mpDevice->mCompletedFrameIndex || !PoolFits(it->mSizes, required)) continue;
+            Pool pool = *it;
+            mRetiredPools.erase(it);
+            VK_CHECK(vkResetDescriptorPool(mpDevice->mLogicalDevice, pool.mPool, 0))
+            return pool;
+        }
+
+        Pool pool;
+        pool.mMaxSets = group.mNextMaxSets;
+        for (auto& ratio : PoolRatios)
+        {
+            pool.mSizes.push_back(LeoVK::Init::DescPoolSize(ratio.first, static_cast<uint32_t>(ratio.second * (float)pool.mMaxSets)));
+        }
+        for (auto& req : required)
+        {
+            auto it = std::find_if(pool.mSizes.begin(), pool.mSizes.end(), [&](const VkDescriptorPoolSize& size) { return size.type == req.type; });
+            if (it == pool.mSizes.end()) pool.mSizes.push_back(req);
+            else it->descriptorCount = std::max(it->descriptorCount, req.descriptorCount);
+        }
+        VkDescriptorPoolCreateInfo descPoolCI = LeoVK::Init::DescPoolCreateInfo(pool.mSizes, pool.mMaxSets);
+        VK_CHECK(vkCreateDescriptorPool(mpDevice->mLogicalDevice, &descPoolCI, nullptr, &pool.mPool))
+        mPoolCount++;
+        return pool;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ProjectPCH.hpp"
+
+#include <mutex>
+
+#include "VKDevice.hpp"
+
+namespace LeoVK
+{
+    /**
+     * @brief 按需增长的Descriptor Pool列表，Set Layout按Binding签名缓存
+     * @note Set按分组分配，一个分组的Set只能整体释放；释放后的Pool等所在帧完成后重置复用。
+     *       可以在后台线程中向其它分组分配，同一个Set的写入仍由调用者保证不冲突
+     */
+    class DescriptorAllocator
+    {
+    public:
+        void Init(LeoVK::VulkanDevice* device);
+        void Destroy();
+
+        // 相同Binding的Layout只创建一次，由分配器统一销毁
+        VkDescriptorSetLayout GetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+        VkDescriptorSet Allocate(VkDescriptorSetLayout layout, uint32_t group = 0);
+        // 释放分组中的全部Set，调用后这些Set不能再被新录制的命令引用
+        void FreeGroup(uint32_t group);
+
+    public:
+        uint32_t mPoolCount = 0;    // 已创建的Pool，包括等待复用的
+        uint32_t mSetCount = 0;     // 当前存活的Set
+
+    private:
+        struct Pool
+        {
+            VkDescriptorPool                    mPool = VK_NULL_HANDLE;
+            std::vector<VkDescriptorPoolSize>   mSizes;
+            uint32_t                            mMaxSets = 0;
+            uint64_t                            mRetiredFrame = 0;
+        };
+        struct Group
+        {
+            std::vector<Pool>   mPools;     // 最后一个是当前分配使用的Pool
+            uint32_t            mSetCount = 0;
+            uint32_t            mNextMaxSets = 0;
+        };
+
+        Pool AcquirePool(const std::vector<VkDescriptorPoolSize>& required, Group& group);
+
+    private:
+        LeoVK::VulkanDevice*    mpDevice = nullptr;
+        std::map<std::vector<uint32_t>, VkDescriptorSetLayout>                          mLayouts;
+        std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorPoolSize>>    mLayoutSizes;
+        std::unordered_map<uint32_t, Group>     mGroups;
+        std::vector<Pool>                       mRetiredPools;
+        std::mutex                              mMutex;
+    };
+}
@@ -1,4 +1,6 @@
-﻿#include "VKDevice.hpp"
+﻿#define VMA_IMPLEMENTATION
+
+#include "VKDevice.hpp"
 
 namespace LeoVK
 {
@@ -35,10 +37,61 @@ namespace LeoVK
 
     VulkanDevice::~VulkanDevice()
     {
+        // 延迟销毁的资源可能引用共享的Sampler和内存池，最先释放
+        mDeletionQueue.Flush();
+        if (!mSamplerCache.empty())
+        {
+            std::cerr << mSamplerCache.size() << " cached samplers were not released" << std::endl;
+            for (auto& entry : mSamplerCache) vkDestroySampler(mLogicalDevice, entry.second.mSampler, nullptr);
+        }
+        if (mAllocator)
+        {
+            if (!mImageAllocations.empty() || !mBufferAllocations.empty())
+            {
+                std::cerr << mImageAllocations.size() << " images and " << mBufferAllocations.size() << " buffers were not freed" << std::endl;
+            }
+            for (auto& entry : mMemoryPools) vmaDestroyPool(mAllocator, entry.second);
+            vmaDestroyAllocator(mAllocator);
+        }
         if (mCommandPool) vkDestroyCommandPool(mLogicalDevice, mCommandPool, nullptr);
+        for (auto& entry : mThreadCommandPools) vkDestroyCommandPool(mLogicalDevice, entry.second, nullptr);
         if (mLogicalDevice) vkDestroyDevice(mLogicalDevice, nullptr);
     }
 
+    // 每个池单块的大小，不超过所在堆的1/8
+    static VkDeviceSize GetMemoryPoolBlockSize(MemoryPool pool)
+    {
+        switch (pool)
+        {
+            case MemoryPool::Geometry:  return 64ull * 1024 * 1024;
+            case MemoryPool::Texture:   return 128ull * 1024 * 1024;
+            case MemoryPool::Transient: return 64ull * 1024 * 1024;
+            default:                    return 32ull * 1024 * 1024;
+        }
+    }
+
+    // 设备本地的顶点和索引数据属于场景几何，只作为拷贝源的主机可见Buffer是Staging
+    static MemoryPool GetBufferMemoryPool(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags)
+    {
+        if ((memoryPropertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) &&
+            (usageFlags & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)))
+        {
+            return MemoryPool::Geometry;
+        }
+        if (usageFlags == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) return MemoryPool::Transient;
+        return MemoryPool::Default;
+    }
+
+    // Buffer的统计类别由用途决定
+    static MemoryCategory GetBufferMemoryCategory(VkBufferUsageFlags usageFlags)
+    {
+        if (usageFlags & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) return MemoryCategory::Vertex;
+        if (usageFlags & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) return MemoryCategory::Index;
+        if (usageFlags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) return MemoryCategory::Uniform;
+        if (usageFlags == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) return MemoryCategory::Staging;
+        return MemoryCategory::Other;
+    }
+
     /**
 	* Get the index of a memory type that has all the requested property bits set
 	*
@@ -235,6 +288,13 @@ namespace LeoVK
             mbEnableDebugMarkers = true;
         }
 
+        // 显存预算扩展依赖的GetPhysicalDeviceProperties2在Vulkan 1.1中已经是核心功能
+        if (ExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+        {
+            deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            mbMemoryBudget = true;
+        }
+
         if (!deviceExtensions.empty())
         {
             for (const char* enabledExtension : deviceExtensions)
@@ -255,10 +315,392 @@ namespace LeoVK
         if (res != VK_SUCCESS) return res;
 
         mCommandPool = CreateCommandPool(mQueueFamilyIndices.graphics);
+        mOwnerThread = std::this_thread::get_id();
 
         return res;
     }
 
+    /**
+    * 创建VMA分配器，需要在逻辑设备创建之后调用
+    */
+    VkResult VulkanDevice::CreateAllocator(VkInstance instance, uint32_t apiVersion)
+    {
+        VmaAllocatorCreateInfo allocatorCI{};
+        allocatorCI.physicalDevice = mPhysicalDevice;
+        allocatorCI.device = mLogicalDevice;
+        allocatorCI.instance = instance;
+        // 内置的VMA版本最高识别到Vulkan 1.2
+        allocatorCI.vulkanApiVersion = std::min(apiVersion, (uint32_t)VK_API_VERSION_1_2);
+        if (mbMemoryBudget) allocatorCI.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        return vmaCreateAllocator(&allocatorCI, &mAllocator);
+    }
+
+    /**
+    * 从指定的池中分配内存，主机可见的内存会被持久映射
+    *
+    * @param memReqs 资源的内存需求
+    * @param memoryPropertyFlags 需要的内存属性
+    * @param pool 资源所属的池，决定和哪些资源共享内存块
+    * @param category 资源的类别，只用于统计
+    * @param allocation 返回的分配，使用FreeMemory释放
+    */
+    VkResult VulkanDevice::AllocateMemory(const VkMemoryRequirements& memReqs, VkMemoryPropertyFlags memoryPropertyFlags, MemoryPool pool, MemoryCategory category, VmaAllocation* allocation)
+    {
+        const uint32_t memoryTypeIndex = GetMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
+        const uint32_t heapIndex = mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+        const VkDeviceSize blockSize = std::min(GetMemoryPoolBlockSize(pool), mMemoryProperties.memoryHeaps[heapIndex].size / 8);
+
+        VmaAllocationCreateInfo allocCI{};
+        allocCI.requiredFlags = memoryPropertyFlags;
+        allocCI.memoryTypeBits = 1u << memoryTypeIndex;
+        if (mMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            allocCI.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        }
+
+        std::lock_guard<std::mutex> lock(mMemoryMutex);
+        // 大资源单独分配，避免占满一整块后剩下的空间无法利用
+        if (memReqs.size > blockSize / 2)
+        {
+            allocCI.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+            VkResult result = vmaAllocateMemory(mAllocator, &memReqs, &allocCI, allocation, nullptr);
+            if (result == VK_SUCCESS) mAllocations[*allocation] = { pool, category, memReqs.size, true };
+            return result;
+        }
+
+        VmaPool& vmaPool = mMemoryPools[{ pool, memoryTypeIndex }];
+        if (vmaPool == VK_NULL_HANDLE)
+        {
+            VmaPoolCreateInfo poolCI{};
+            poolCI.memoryTypeIndex = memoryTypeIndex;
+            poolCI.blockSize = blockSize;
+            VkResult result = vmaCreatePool(mAllocator, &poolCI, &vmaPool);
+            if (result != VK_SUCCESS)
+            {
+                mMemoryPools.erase({ pool, memoryTypeIndex });
+                return result;
+            }
+        }
+        allocCI.pool = vmaPool;
+        VkResult result = vmaAllocateMemory(mAllocator, &memReqs, &allocCI, allocation, nullptr);
+        if (result == VK_SUCCESS) mAllocations[*allocation] = { pool, category, memReqs.size, false };
+        return result;
+    }
+
+    void VulkanDevice::FreeMemory(VmaAllocation allocation)
+    {
+        if (allocation == VK_NULL_HANDLE) return;
+
+        std::lock_guard<std::mutex> lock(mMemoryMutex);
+        mAllocations.erase(allocation);
+        vmaFreeMemory(mAllocator, allocation);
+    }
+
+    /**
+    * 为Image分配并绑定内存
+    *
+    * @param memory (Optional) 返回Image所在的内存块，它可能被其他资源共享，不能直接释放
+    */
+    VkResult VulkanDevice::AllocateImageMemory(VkImage image, VkMemoryPropertyFlags memoryPropertyFlags, MemoryPool pool, MemoryCategory category, VkDeviceMemory* memory)
+    {
+        VkMemoryRequirements memReqs;
+        vkGetImageMemoryRequirements(mLogicalDevice, image, &memReqs);
+        VmaAllocation allocation;
+        VkResult result = AllocateMemory(memReqs, memoryPropertyFlags, pool, category, &allocation);
+        if (result != VK_SUCCESS) return result;
+        result = vmaBindImageMemory(mAllocator, allocation, image);
+        if (result != VK_SUCCESS)
+        {
+            FreeMemory(allocation);
+            return result;
+        }
+        if (memory != nullptr)
+        {
+            VmaAllocationInfo allocInfo;
+            vmaGetAllocationInfo(mAllocator, allocation, &allocInfo);
+            *memory = allocInfo.deviceMemory;
+        }
+
+        std::lock_guard<std::mutex> lock(mMemoryMutex);
+        mImageAllocations[image] = allocation;
+        return VK_SUCCESS;
+    }
+
+    /**
+    * 把Image绑定到另一个Image已有的内存上，两者的内容不能同时有效
+    *
+    * @note 只用于每次使用前都会清除的附件，使用它们的Pass之间需要有覆盖附件写入的依赖
+    *
+    * @return 内存类型不兼容或者空间不够时返回VK_ERROR_FEATURE_NOT_PRESENT，调用者需要自己分配
+    */
+    VkResult VulkanDevice::AliasImageMemory(VkImage image, VkImage source, VkDeviceMemory* memory)
+    {
+        VkMemoryRequirements memReqs;
+        vkGetImageMemoryRequirements(mLogicalDevice, image, &memReqs);
+
+        std::lock_guard<std::mutex> lock(mMemoryMutex);
+        auto it = mImageAllocations.find(source);
+        if (it == mImageAllocations.end()) return VK_ERROR_FEATURE_NOT_PRESENT;
+        const VmaAllocation allocation = it->second;
+        VmaAllocationInfo allocInfo;
+        vmaGetAllocationInfo(mAllocator, allocation, &allocInfo);
+        if (!(memReqs.memoryTypeBits & (1u << allocInfo.memoryType)) || memReqs.size > allocInfo.size || allocInfo.offset % memReqs.alignment != 0)
+        {
+            return VK_ERROR_FEATURE_NOT_PRESENT;
+        }
+
+        VkResult result = vmaBindImageMemory(mAllocator, allocation, image);
+        if (result != VK_SUCCESS) return result;
+        if (memory != nullptr) *memory = allocInfo.deviceMemory;
+        mImageAllocations[image] = allocation;
+        mAliasCounts[allocation]++;
+        return VK_SUCCESS;
+    }
+
+    /**
+    * 只在Render Pass内部使用的附件优先放在Lazy内存上，Tile-based GPU上它们可能完全不占用显存
+    */
+    VkMemoryPropertyFlags VulkanDevice::GetTransientAttachmentMemoryFlags(VkImage image) const
+    {
+        VkMemoryRequirements memReqs;
+        vkGetImageMemoryRequirements(mLogicalDevice, image, &memReqs);
+        VkBool32 lazyMemTypePresent = VK_FALSE;
+        GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &lazyMemTypePresent);
+        return lazyMemTypePresent ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    }
+
+    void VulkanDevice::FreeImageMemory(VkImage image)
+    {
+        VmaAllocation allocation;
+        {
+            std::lock_guard<std::mutex> lock(mMemoryMutex);
+            auto it = mImageAllocations.find(image);
+            if (it == mImageAllocations.end()) return;
+            allocation = it->second;
+            mImageAllocations.erase(it);
+
+            // 还有其他Image共用这个分配
+            auto aliasIt = mAliasCounts.find(allocation);
+            if (aliasIt != mAliasCounts.end())
+            {
+                if (--aliasIt->second == 0) mAliasCounts.erase(aliasIt);
+                return;
+            }
+        }
+        FreeMemory(allocation);
+    }
+
+    void VulkanDevice::FreeBufferMemory(VkBuffer buffer)
+    {
+        VmaAllocation allocation;
+        {
+            std::lock_guard<std::mutex> lock(mMemoryMutex);
+            auto it = mBufferAllocations.find(buffer);
+            if (it == mBufferAllocations.end()) return;
+            allocation = it->second;
+            mBufferAllocations.erase(it);
+        }
+        FreeMemory(allocation);
+    }
+
+    /**
+    * 返回主机可见Buffer持久映射的地址，设备本地的Buffer返回nullptr
+    */
+    void* VulkanDevice::GetMappedData(VkBuffer buffer)
+    {
+        std::lock_guard<std::mutex> lock(mMemoryMutex);
+        auto it = mBufferAllocations.find(buffer);
+        if (it == mBufferAllocations.end()) return nullptr;
+        VmaAllocationInfo allocInfo;
+        vmaGetAllocationInfo(mAllocator, it->second, &allocInfo);
+        return allocInfo.pMappedData;
+    }
+
+    /**
+    * 切换场景后调用，销毁已经没有资源的池，把它们的内存块整体还给驱动
+    *
+    * @note 仍在使用的资源被描述符和命令引用，移动它们需要重建所有绑定，这里不做搬移
+    *
+    * @return 释放的内存大小
+    */
+    VkDeviceSize VulkanDevice::DefragmentMemoryPools()
+    {
+        std::lock_guard<std::mutex> lock(mMemoryMutex);
+        VkDeviceSize releasedBytes = 0;
+        for (auto it = mMemoryPools.begin(); it != mMemoryPools.end();)
+        {
+            VmaPoolStats poolStats;
+            vmaGetPoolStats(mAllocator, it->second, &poolStats);
+            if (poolStats.allocationCount == 0)
+            {
+                releasedBytes += poolStats.size;
+                vmaDestroyPool(mAllocator, it->second);
+                it = mMemoryPools.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        return releasedBytes;
+    }
+
+    MemoryPoolStats VulkanDevice::GetMemoryPoolStats(MemoryPool pool)
+    {
+        MemoryPoolStats stats{};
+        std::lock_guard<std::mutex> lock(mMemoryMutex);
+        for (auto& entry : mMemoryPools)
+        {
+            if (entry.first.first != pool) continue;
+            VmaPoolStats poolStats;
+            vmaGetPoolStats(mAllocator, entry.second, &poolStats);
+            stats.mBlockBytes += poolStats.size;
+            stats.mUsedBytes += poolStats.size - poolStats.unusedSize;
+            stats.mBlockCount += static_cast<uint32_t>(poolStats.blockCount);
+            stats.mAllocationCount += static_cast<uint32_t>(poolStats.allocationCount);
+        }
+        for (auto& entry : mAllocations)
+        {
+            if (!entry.second.mbDedicated || entry.second.mPool != pool) continue;
+            stats.mBlockBytes += entry.second.mSize;
+            stats.mUsedBytes += entry.second.mSize;
+            stats.mBlockCount++;
+            stats.mAllocationCount++;
+        }
+        return stats;
+    }
+
+    const char* VulkanDevice::GetMemoryPoolName(MemoryPool pool)
+    {
+        switch (pool)
+        {
+            case MemoryPool::Default:   return "Default";
+            case MemoryPool::Geometry:  return "Geometry";
+            case MemoryPool::Texture:   return "Texture";
+            case MemoryPool::Transient: return "Transient";
+            default:                    return "Unknown";
+        }
+    }
+
+    /**
+    * 每帧开始时调用，启用了VK_EXT_memory_budget时VMA在这里重新查询各个堆的预算
+    */
+    void VulkanDevice::BeginFrame()
+    {
+        mFrameIndex++;
+        if (mAllocator != VK_NULL_HANDLE) vmaSetCurrentFrameIndex(mAllocator, static_cast<uint32_t>(mFrameIndex));
+    }
+
+    /**
+    * 当前帧的GPU工作全部完成后调用，销毁在这一帧及之前延迟的资源
+    */
+    void VulkanDevice::EndFrame()
+    {
+        const uint64_t completedFrame = mFrameIndex;
+        mCompletedFrameIndex = completedFrame;
+        if (mDeletionQueue.Collect(completedFrame) == 0) return;
+        // 场景和环境切换时的旧资源销毁后，空出来的池整块还给驱动
+        VkDeviceSize releasedBytes = DefragmentMemoryPools();
+        if (releasedBytes > 0) std::cout << "Released " << releasedBytes / (1024 * 1024) << " MB of pooled memory" << std::endl;
+    }
+
+    /**
+    * 资源可能还被已经提交的命令引用，等当前帧完成后再销毁
+    */
+    void VulkanDevice::DeferDestroy(std::function<void()> deleter)
+    {
+        mDeletionQueue.Push(mFrameIndex, std::move(deleter));
+    }
+
+    void VulkanDevice::DeferDestroyBuffer(VkBuffer buffer)
+    {
+        if (buffer == VK_NULL_HANDLE) return;
+        DeferDestroy([this, buffer]()
+        {
+            vkDestroyBuffer(mLogicalDevice, buffer, nullptr);
+            FreeBufferMemory(buffer);
+        });
+    }
+
+    void VulkanDevice::DeferDestroyImage(VkImage image, VkImageView view)
+    {
+        if (image == VK_NULL_HANDLE) return;
+        DeferDestroy([this, image, view]()
+        {
+            if (view != VK_NULL_HANDLE) vkDestroyImageView(mLogicalDevice, view, nullptr);
+            vkDestroyImage(mLogicalDevice, image, nullptr);
+            FreeImageMemory(image);
+        });
+    }
+
+    void VulkanDevice::DeferDestroyDescriptorPool(VkDescriptorPool descPool)
+    {
+        if (descPool == VK_NULL_HANDLE) return;
+        DeferDestroy([this, descPool]() { vkDestroyDescriptorPool(mLogicalDevice, descPool, nullptr); });
+    }
+
+    void VulkanDevice::DeferDestroyPipeline(VkPipeline pipeline)
+    {
+        if (pipeline == VK_NULL_HANDLE) return;
+        DeferDestroy([this, pipeline]() { vkDestroyPipeline(mLogicalDevice, pipeline, nullptr); });
+    }
+
+    /**
+    * 汇总当前存活的分配
+    *
+    * @param topCount 返回的最大分配的数量
+    */
+    MemoryReport VulkanDevice::GetMemoryReport(uint32_t topCount)
+    {
+        MemoryReport report{};
+        report.mbBudgetExtension = mbMemoryBudget;
+        if (mAllocator == VK_NULL_HANDLE) return report;
+
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetBudget(mAllocator, budgets);
+        for (uint32_t i = 0; i < mMemoryProperties.memoryHeapCount; i++)
+        {
+            MemoryHeapBudget heap{};
+            heap.mUsage = budgets[i].usage;
+            heap.mBudget = budgets[i].budget;
+            heap.mBlockBytes = budgets[i].blockBytes;
+            heap.mbDeviceLocal = (mMemoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+            report.mHeaps.push_back(heap);
+        }
+
+        std::lock_guard<std::mutex> lock(mMemoryMutex);
+        report.mTopAllocations.reserve(mAllocations.size());
+        for (auto& entry : mAllocations)
+        {
+            const MemoryAllocationRecord& record = entry.second;
+            report.mCategoryBytes[(size_t)record.mCategory] += record.mSize;
+            report.mCategoryCounts[(size_t)record.mCategory]++;
+            report.mTotalBytes += record.mSize;
+            report.mTopAllocations.push_back(record);
+        }
+        const size_t count = std::min((size_t)topCount, report.mTopAllocations.size());
+        std::partial_sort(report.mTopAllocations.begin(), report.mTopAllocations.begin() + count, report.mTopAllocations.end(),
+            [](const MemoryAllocationRecord& a, const MemoryAllocationRecord& b) { return a.mSize > b.mSize; });
+        report.mTopAllocations.resize(count);
+        return report;
+    }
+
+    const char* VulkanDevice::GetMemoryCategoryName(MemoryCategory category)
+    {
+        switch (category)
+        {
+            case MemoryCategory::Vertex:        return "Vertex";
+            case MemoryCategory::Index:         return "Index";
+            case MemoryCategory::Texture:       return "Texture";
+            case MemoryCategory::IBL:           return "IBL";
+            case MemoryCategory::Uniform:       return "Uniform";
+            case MemoryCategory::Staging:       return "Staging";
+            case MemoryCategory::RenderTarget:  return "Render target";
+            case MemoryCategory::Other:         return "Other";
+            default:                            return "Unknown";
+        }
+    }
+
     /**
     * Create a buffer on the device
     *
@@ -284,37 +726,31 @@ namespace LeoVK
         VK_CHECK(vkCreateBuffer(mLogicalDevice, &bufferCI, nullptr, buffer))
 
         VkMemoryRequirements memReqs;
-        VkMemoryAllocateInfo memAI = LeoVK::Init::MemoryAllocateInfo();
         vkGetBufferMemoryRequirements(mLogicalDevice, *buffer, &memReqs);
-        memAI.allocationSize = memReqs.size;
-        memAI.memoryTypeIndex = GetMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
-        VkMemoryAllocateFlagsInfoKHR allocFlagsInfo{};
-        if (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+        VmaAllocation allocation;
+        VK_CHECK(AllocateMemory(memReqs, memoryPropertyFlags, GetBufferMemoryPool(usageFlags, memoryPropertyFlags), GetBufferMemoryCategory(usageFlags), &allocation))
         {
-            allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR;
-            allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
-            memAI.pNext = &allocFlagsInfo;
+            std::lock_guard<std::mutex> lock(mMemoryMutex);
+            mBufferAllocations[*buffer] = allocation;
         }
-        VK_CHECK(vkAllocateMemory(mLogicalDevice, &memAI, nullptr, memory))
 
-        // 如果传入了Buffer的指针，那么就映射Buffer并拷贝数据
+        VmaAllocationInfo allocInfo;
+        vmaGetAllocationInfo(mAllocator, allocation, &allocInfo);
+        // 返回的是共享的内存块，只能用来查看，释放需要调用FreeBufferMemory
+        if (memory != nullptr) *memory = allocInfo.deviceMemory;
+
+        // 如果传入了数据，就拷贝到持久映射的地址
         if (data != nullptr)
         {
-            void *mapped;
-            VK_CHECK(vkMapMemory(mLogicalDevice, *memory, 0, size, 0, &mapped))
-            memcpy(mapped, data, size);
+            assert(allocInfo.pMappedData);
+            memcpy(allocInfo.pMappedData, data, size);
             // If host coherency hasn't been requested, do a manual flush to make writes visible
             if ((memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
             {
-                VkMappedMemoryRange mappedRange = LeoVK::Init::MappedMemoryRange();
-                mappedRange.memory = *memory;
-                mappedRange.offset = 0;
-                mappedRange.size = size;
-                vkFlushMappedMemoryRanges(mLogicalDevice, 1, &mappedRange);
+                vmaFlushAllocation(mAllocator, allocation, 0, size);
             }
-            vkUnmapMemory(mLogicalDevice, *memory);
         }
-        VK_CHECK(vkBindBufferMemory(mLogicalDevice, *buffer, *memory, 0))
+        VK_CHECK(vmaBindBufferMemory(mAllocator, allocation, *buffer))
         return VK_SUCCESS;
     }
 
@@ -337,24 +773,15 @@ namespace LeoVK
         void *data)
     {
         buffer->mDevice = mLogicalDevice;
+        buffer->mpVulkanDevice = this;
 
         VkBufferCreateInfo bufferCreateInfo = LeoVK::Init::BufferCreateInfo(usageFlags, size);
         VK_CHECK(vkCreateBuffer(mLogicalDevice, &bufferCreateInfo, nullptr, &buffer->mBuffer));
 
         // Create the memory backing up the buffer handle
         VkMemoryRequirements memReqs;
-        VkMemoryAllocateInfo memAlloc = LeoVK::Init::MemoryAllocateInfo();
         vkGetBufferMemoryRequirements(mLogicalDevice, buffer->mBuffer, &memReqs);
-        memAlloc.allocationSize = memReqs.size;
-        memAlloc.memoryTypeIndex = GetMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
-        VkMemoryAllocateFlagsInfoKHR allocFlagsInfo{};
-        if (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
-        {
-            allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR;
-            allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
-            memAlloc.pNext = &allocFlagsInfo;
-        }
-        VK_CHECK(vkAllocateMemory(mLogicalDevice, &memAlloc, nullptr, &buffer->mMemory));
+        VK_CHECK(AllocateMemory(memReqs, memoryPropertyFlags, GetBufferMemoryPool(usageFlags, memoryPropertyFlags), GetBufferMemoryCategory(usageFlags), &buffer->mAllocation));
 
         buffer->mAlignment = memReqs.alignment;
         buffer->mSize = size;
@@ -462,7 +889,19 @@ namespace LeoVK
 
     VkCommandBuffer VulkanDevice::CreateCommandBuffer(VkCommandBufferLevel level, bool begin)
     {
-        return CreateCommandBuffer(level, mCommandPool, begin);
+        return CreateCommandBuffer(level, GetCommandPool(), begin);
+    }
+
+    /**
+    * Command Pool不能在多个线程中同时使用，后台线程第一次录制时创建自己的Pool
+    */
+    VkCommandPool VulkanDevice::GetCommandPool()
+    {
+        if (std::this_thread::get_id() == mOwnerThread) return mCommandPool;
+        std::lock_guard<std::mutex> lock(mCommandPoolMutex);
+        VkCommandPool& pool = mThreadCommandPools[std::this_thread::get_id()];
+        if (pool == VK_NULL_HANDLE) pool = CreateCommandPool(mQueueFamilyIndices.graphics);
+        return pool;
     }
 
     void VulkanDevice::BeginCommandBuffer(VkCommandBuffer commandBuffer)
@@ -501,7 +940,10 @@ namespace LeoVK
         VkFence fence;
         VK_CHECK(vkCreateFence(mLogicalDevice, &fenceInfo, nullptr, &fence));
         // Submit to the queue
-        VK_CHECK(vkQueueSubmit(queue, 1, &submitInfo, fence));
+        {
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            VK_CHECK(vkQueueSubmit(queue, 1, &submitInfo, fence));
+        }
         // Wait for the fence to signal that command buffer has finished executing
         VK_CHECK(vkWaitForFences(mLogicalDevice, 1, &fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
         vkDestroyFence(mLogicalDevice, fence, nullptr);
@@ -513,7 +955,16 @@ namespace LeoVK
 
     void VulkanDevice::FlushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free)
     {
-        return FlushCommandBuffer(commandBuffer, queue, mCommandPool, free);
+        return FlushCommandBuffer(commandBuffer, queue, GetCommandPool(), free);
+    }
+
+    /**
+    * vkDeviceWaitIdle要求所有Queue都被外部同步，等待期间后台线程不能提交
+    */
+    void VulkanDevice::WaitIdle()
+    {
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        vkDeviceWaitIdle(mLogicalDevice);
     }
 
     bool VulkanDevice::ExtensionSupported(std::string extension)
@@ -548,5 +999,87 @@ namespace LeoVK
         throw std::runtime_error("Could not find a matching depth format");
     }
 
+    size_t SamplerKeyHash::operator()(const SamplerKey& key) const
+    {
+        // FNV-1a
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&key);
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(SamplerKey); i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+
+    /**
+    * 返回与创建参数相同的共享Sampler，不存在时才创建，使用完后需要调用ReleaseSampler
+    */
+    VkSampler VulkanDevice::AcquireSampler(const VkSamplerCreateInfo& samplerCI)
+    {
+        // 带扩展结构体的Sampler不参与共享
+        if (samplerCI.pNext != nullptr)
+        {
+            VkSampler sampler;
+            VK_CHECK(vkCreateSampler(mLogicalDevice, &samplerCI, nullptr, &sampler))
+            return sampler;
+        }
+
+        SamplerKey key = {
+            samplerCI.flags, samplerCI.magFilter, samplerCI.minFilter, samplerCI.mipmapMode,
+            samplerCI.addressModeU, samplerCI.addressModeV, samplerCI.addressModeW, samplerCI.mipLodBias,
+            samplerCI.anisotropyEnable, samplerCI.anisotropyEnable ? samplerCI.maxAnisotropy : 1.0f,
+            samplerCI.compareEnable, samplerCI.compareEnable ? samplerCI.compareOp : VK_COMPARE_OP_NEVER,
+            samplerCI.minLod, samplerCI.maxLod, samplerCI.borderColor, samplerCI.unnormalizedCoordinates
+        };
+
+        std::lock_guard<std::mutex> lock(mSamplerMutex);
+        auto it = mSamplerCache.find(key);
+        if (it != mSamplerCache.end())
+        {
+            it->second.mRefCount++;
+            return it->second.mSampler;
+        }
+
+        VkSampler sampler;
+        VK_CHECK(vkCreateSampler(mLogicalDevice, &samplerCI, nullptr, &sampler))
+        mSamplerCache[key] = { sampler, 1 };
+        mSamplerKeys[sampler] = key;
+        return sampler;
+    }
 
+    void VulkanDevice::ReleaseSampler(VkSampler sampler)
+    {
+        if (sampler == VK_NULL_HANDLE) return;
+
+        std::lock_guard<std::mutex> lock(mSamplerMutex);
+        auto keyIt = mSamplerKeys.find(sampler);
+        if (keyIt == mSamplerKeys.end())
+        {
+            // 不经过缓存创建的Sampler直接销毁
+            vkDestroySampler(mLogicalDevice, sampler, nullptr);
+            return;
+        }
+        auto it = mSamplerCache.find(keyIt->second);
+        if (--it->second.mRefCount == 0)
+        {
+            vkDestroySampler(mLogicalDevice, sampler, nullptr);
+            mSamplerCache.erase(it);
+            mSamplerKeys.erase(keyIt);
+        }
+    }
+
+    uint32_t VulkanDevice::GetSamplerCount()
+    {
+        std::lock_guard<std::mutex> lock(mSamplerMutex);
+        return static_cast<uint32_t>(mSamplerCache.size());
+    }
+
+    uint32_t VulkanDevice::GetSamplerRefCount()
+    {
+        std::lock_guard<std::mutex> lock(mSamplerMutex);
+        uint32_t refCount = 0;
+        for (auto& entry : mSamplerCache) refCount += entry.second.mRefCount;
+        return refCount;
+    }
 }
\ No newline at end of file
@@ -1,11 +1,107 @@
 #pragma once
 
 #include "ProjectPCH.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+
+#include "vk_mem_alloc.h"
+
 #include "VKBuffer.hpp"
+#include "VKDeletionQueue.hpp"
 #include "VKTools.hpp"
 
 namespace LeoVK
 {
+    /** @brief 按生命周期划分的内存池，同一个池中的资源共享VkDeviceMemory块 */
+    enum class MemoryPool : uint32_t
+    {
+        Default = 0,    // UBO、IBL、字体等长期存在的资源
+        Geometry,       // 场景的顶点和索引Buffer
+        Texture,        // 场景纹理
+        Transient,      // 渲染目标和Staging Buffer
+        Count
+    };
+
+    /** @brief 内存统计使用的资源类别，和资源所在的池无关 */
+    enum class MemoryCategory : uint32_t
+    {
+        Vertex = 0,
+        Index,
+        Texture,
+        IBL,
+        Uniform,
+        Staging,
+        RenderTarget,
+        Other,          // Storage Buffer、回读Buffer等
+        Count
+    };
+
+    struct MemoryAllocationRecord
+    {
+        MemoryPool      mPool = MemoryPool::Default;
+        MemoryCategory  mCategory = MemoryCategory::Other;
+        VkDeviceSize    mSize = 0;
+        bool            mbDedicated = false;
+    };
+
+    struct MemoryHeapBudget
+    {
+        VkDeviceSize    mUsage = 0;             // 没有VK_EXT_memory_budget时只是VMA自己的估计
+        VkDeviceSize    mBudget = 0;
+        VkDeviceSize    mBlockBytes = 0;        // 本进程通过VMA申请的内存
+        bool            mbDeviceLocal = false;
+    };
+
+    /** @brief 某一时刻的显存用量：各类别的总量、各个堆的预算和最大的几个分配 */
+    struct MemoryReport
+    {
+        std::array<VkDeviceSize, (size_t)MemoryCategory::Count> mCategoryBytes{};
+        std::array<uint32_t, (size_t)MemoryCategory::Count>     mCategoryCounts{};
+        VkDeviceSize                        mTotalBytes = 0;
+        bool                                mbBudgetExtension = false;
+        std::vector<MemoryHeapBudget>       mHeaps;
+        std::vector<MemoryAllocationRecord> mTopAllocations;    // 按大小降序
+    };
+
+    struct MemoryPoolStats
+    {
+        VkDeviceSize    mBlockBytes = 0;        // 向驱动申请的内存
+        VkDeviceSize    mUsedBytes = 0;         // 实际分配给资源的内存
+        uint32_t        mBlockCount = 0;        // VkDeviceMemory的数量
+        uint32_t        mAllocationCount = 0;
+    };
+
+    /** @brief VkSamplerCreateInfo中参与比较的字段，全部是4字节，没有填充 */
+    struct SamplerKey
+    {
+        VkSamplerCreateFlags    mFlags;
+        VkFilter                mMagFilter;
+        VkFilter                mMinFilter;
+        VkSamplerMipmapMode     mMipmapMode;
+        VkSamplerAddressMode    mAddressModeU;
+        VkSamplerAddressMode    mAddressModeV;
+        VkSamplerAddressMode    mAddressModeW;
+        float                   mMipLodBias;
+        VkBool32                mAnisotropyEnable;
+        float                   mMaxAnisotropy;
+        VkBool32                mCompareEnable;
+        VkCompareOp             mCompareOp;
+        float                   mMinLod;
+        float                   mMaxLod;
+        VkBorderColor           mBorderColor;
+        VkBool32                mUnnormalizedCoordinates;
+
+        bool operator==(const SamplerKey& other) const { return memcmp(this, &other, sizeof(SamplerKey)) == 0; }
+    };
+
+    struct SamplerKeyHash
+    {
+        size_t operator()(const SamplerKey& key) const;
+    };
+
     class VulkanDevice
     {
     public:
@@ -15,17 +111,44 @@ namespace LeoVK
         uint32_t        GetMemoryType(uint32_t typeBits, VkMemoryPropertyFlags memProps, VkBool32 *memTypeFound = nullptr) const;
         uint32_t        GetQueueFamilyIndex(VkQueueFlags queueFlags) const;
         VkResult        CreateLogicalDevice(VkPhysicalDeviceFeatures enabledFeatures, std::vector<const char *> enabledExtensions, void *pNextChain, bool useSwapChain = true, VkQueueFlags requestedQueueTypes = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+        VkResult        CreateAllocator(VkInstance instance, uint32_t apiVersion);
+        VkResult        AllocateMemory(const VkMemoryRequirements& memReqs, VkMemoryPropertyFlags memoryPropertyFlags, MemoryPool pool, MemoryCategory category, VmaAllocation* allocation);
+        void            FreeMemory(VmaAllocation allocation);
+        VkResult        AllocateImageMemory(VkImage image, VkMemoryPropertyFlags memoryPropertyFlags, MemoryPool pool, MemoryCategory category, VkDeviceMemory* memory = nullptr);
+        VkResult        AliasImageMemory(VkImage image, VkImage source, VkDeviceMemory* memory = nullptr);
+        VkMemoryPropertyFlags GetTransientAttachmentMemoryFlags(VkImage image) const;
+        void            FreeImageMemory(VkImage image);
+        void            FreeBufferMemory(VkBuffer buffer);
+        void*           GetMappedData(VkBuffer buffer);
+        VkDeviceSize    DefragmentMemoryPools();
+        MemoryPoolStats GetMemoryPoolStats(MemoryPool pool);
+        static const char* GetMemoryPoolName(MemoryPool pool);
+        void            BeginFrame();
+        void            EndFrame();
+        void            DeferDestroy(std::function<void()> deleter);
+        void            DeferDestroyBuffer(VkBuffer buffer);
+        void            DeferDestroyImage(VkImage image, VkImageView view = VK_NULL_HANDLE);
+        void            DeferDestroyDescriptorPool(VkDescriptorPool descPool);
+        void            DeferDestroyPipeline(VkPipeline pipeline);
+        MemoryReport    GetMemoryReport(uint32_t topCount = 8);
+        static const char* GetMemoryCategoryName(MemoryCategory category);
         VkResult        CreateBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer *buffer, VkDeviceMemory *memory, void *data = nullptr);
         VkResult        CreateBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, LeoVK::Buffer *buffer, VkDeviceSize size, void *data = nullptr);
         void            CopyBuffer(LeoVK::Buffer *src, LeoVK::Buffer *dst, VkQueue queue, VkBufferCopy *copyRegion = nullptr);
         VkCommandPool   CreateCommandPool(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags createFlags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
         VkCommandBuffer CreateCommandBuffer(VkCommandBufferLevel level, VkCommandPool pool, bool begin = false);
         VkCommandBuffer CreateCommandBuffer(VkCommandBufferLevel level, bool begin = false);
+        VkCommandPool   GetCommandPool();
         void            BeginCommandBuffer(VkCommandBuffer commandBuffer);
         void            FlushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, VkCommandPool pool, bool free = true);
         void            FlushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free = true);
+        void            WaitIdle();
         bool            ExtensionSupported(std::string extension);
         VkFormat        GetSupportedDepthFormat(bool checkSamplingSupport);
+        VkSampler       AcquireSampler(const VkSamplerCreateInfo& samplerCI);
+        void            ReleaseSampler(VkSampler sampler);
+        uint32_t        GetSamplerCount();
+        uint32_t        GetSamplerRefCount();
 
     public:
         /** @brief Physical device representation */
@@ -46,8 +169,41 @@ namespace LeoVK
         std::vector<std::string> mSupportedExtensions;
         /** @brief Default command pool for the graphics queue family index */
         VkCommandPool mCommandPool = VK_NULL_HANDLE;
+        /** @brief 创建设备的线程使用mCommandPool，后台线程各自使用一个Command Pool */
+        std::thread::id mOwnerThread;
+        std::unordered_map<std::thread::id, VkCommandPool> mThreadCommandPools;
+        std::mutex mCommandPoolMutex;
+        /** @brief 渲染线程和后台加载线程共用同一个Queue，提交、呈现和等待空闲时都需要持有 */
+        std::mutex mQueueMutex;
         /** @brief Set to true when the debug marker extension is detected */
         bool mbEnableDebugMarkers = false;
+        /** @brief 设备支持VK_EXT_memory_budget时启用，VMA从驱动查询每个堆的实际用量和预算 */
+        bool mbMemoryBudget = false;
+        /** @brief 所有Buffer和Image的内存都从VMA分配，按MemoryPool和内存类型划分自定义池 */
+        VmaAllocator mAllocator = VK_NULL_HANDLE;
+        std::map<std::pair<MemoryPool, uint32_t>, VmaPool> mMemoryPools;
+        // 所有存活的分配，记录所属的池、类别和大小用于统计
+        std::unordered_map<VmaAllocation, MemoryAllocationRecord> mAllocations;
+        /** @brief 当前帧的编号，BeginFrame时递增 */
+        std::atomic<uint64_t> mFrameIndex{ 0 };
+        /** @brief 最近一次EndFrame时已经完成的帧编号 */
+        std::atomic<uint64_t> mCompletedFrameIndex{ 0 };
+        /** @brief 可能仍被GPU使用的资源，所在帧完成后在EndFrame中销毁 */
+        DeletionQueue mDeletionQueue;
+        std::unordered_map<VkImage, VmaAllocation> mImageAllocations;
+        // 通过AliasImageMemory额外绑定到同一个分配上的Image数量，归零后才真正释放
+        std::unordered_map<VmaAllocation, uint32_t> mAliasCounts;
+        std::unordered_map<VkBuffer, VmaAllocation> mBufferAllocations;
+        std::mutex mMemoryMutex;
+        /** @brief 按创建参数共享的Sampler及其引用计数 */
+        struct SamplerEntry
+        {
+            VkSampler mSampler;
+            uint32_t  mRefCount;
+        };
+        std::unordered_map<SamplerKey, SamplerEntry, SamplerKeyHash> mSamplerCache;
+        std::unordered_map<VkSampler, SamplerKey> mSamplerKeys;
+        std::mutex mSamplerMutex;
         /** @brief Contains queue family indices */
         struct
         {
@@ -44,9 +44,9 @@ namespace LeoVK
         {
             vkDestroyImage(mpVulkanDevice->mLogicalDevice, attachment.mImage, nullptr);
             vkDestroyImageView(mpVulkanDevice->mLogicalDevice, attachment.mView, nullptr);
-            vkFreeMemory(mpVulkanDevice->mLogicalDevice, attachment.mMemory, nullptr);
+            mpVulkanDevice->FreeImageMemory(attachment.mImage);
         }
-        vkDestroySampler(mpVulkanDevice->mLogicalDevice, mSampler, nullptr);
+        mpVulkanDevice->ReleaseSampler(mSampler);
         vkDestroyRenderPass(mpVulkanDevice->mLogicalDevice, mRenderPass, nullptr);
         vkDestroyFramebuffer(mpVulkanDevice->mLogicalDevice, mFrameBuffer, nullptr);
     }
@@ -85,16 +85,9 @@ namespace LeoVK
         imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageCI.usage = createInfo.usage;
 
-        VkMemoryAllocateInfo memAlloc = LeoVK::Init::MemoryAllocateInfo();
-        VkMemoryRequirements memReqs;
-
         // Create Image
         VK_CHECK(vkCreateImage(mpVulkanDevice->mLogicalDevice, &imageCI, nullptr, &attachment.mImage))
-        vkGetImageMemoryRequirements(mpVulkanDevice->mLogicalDevice, attachment.mImage, &memReqs);
-        memAlloc.allocationSize = memReqs.size;
-        memAlloc.memoryTypeIndex = mpVulkanDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        VK_CHECK(vkAllocateMemory(mpVulkanDevice->mLogicalDevice, &memAlloc, nullptr, &attachment.mMemory));
-        VK_CHECK(vkBindImageMemory(mpVulkanDevice->mLogicalDevice, attachment.mImage, attachment.mMemory, 0));
+        VK_CHECK(mpVulkanDevice->AllocateImageMemory(attachment.mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Transient, LeoVK::MemoryCategory::RenderTarget, &attachment.mMemory));
 
         attachment.mSubresourceRange = {};
         attachment.mSubresourceRange.aspectMask = aspectMask;
@@ -160,7 +153,8 @@ namespace LeoVK
         samplerInfo.maxLod = 1.0f;
         samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
 
-        return vkCreateSampler(mpVulkanDevice->mLogicalDevice, &samplerInfo, nullptr, &mSampler);
+        mSampler = mpVulkanDevice->AcquireSampler(samplerInfo);
+        return VK_SUCCESS;
     }
 
     /**
@@ -0,0 +1,221 @@
+#include "VKMipGenerator.hpp"
+
+// 每批最多录制的纹理数和暂存数据量，超过后自动提交，避免暂存内存无限增长
+#define MIP_BATCH_MAX_TEXTURES 64u
+#define MIP_BATCH_MAX_STAGING (256ull * 1024 * 1024)
+#define MIP_TILE_SIZE 64u
+
+namespace LeoVK
+{
+    MipGenerator::MipGenerator(LeoVK::VulkanDevice *device, VkQueue queue) : mpDevice(device), mQueue(queue)
+    {
+        VkDevice logicalDevice = mpDevice->mLogicalDevice;
+        mShaderModule = LeoVK::VKTools::LoadShader((GetAssetsPath() + "Shaders/GLSL/Base/GenerateMips.comp.spv").c_str(), logicalDevice);
+        // 没有编译好的Shader时所有纹理退回Blit
+        if (mShaderModule == VK_NULL_HANDLE) return;
+
+        std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 0, MIP_GENERATOR_MAX_MIPS),
+            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+        };
+        VkDescriptorSetLayoutCreateInfo descSetLayoutCI = LeoVK::Init::DescSetLayoutCreateInfo(setLayoutBindings);
+        VK_CHECK(vkCreateDescriptorSetLayout(logicalDevice, &descSetLayoutCI, nullptr, &mDescSetLayout))
+
+        std::vector<VkDescriptorPoolSize> poolSizes = {
+            LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MIP_BATCH_MAX_TEXTURES * MIP_GENERATOR_MAX_MIPS),
+            LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MIP_BATCH_MAX_TEXTURES),
+        };
+        VkDescriptorPoolCreateInfo descPoolCI = LeoVK::Init::DescPoolCreateInfo(poolSizes, MIP_BATCH_MAX_TEXTURES);
+        VK_CHECK(vkCreateDescriptorPool(logicalDevice, &descPoolCI, nullptr, &mDescPool))
+
+        VkPushConstantRange pushConstRange = LeoVK::Init::PushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(int32_t) * 2 + sizeof(uint32_t) * 4, 0);
+        VkPipelineLayoutCreateInfo pipelineLayoutCI = LeoVK::Init::PipelineLayoutCreateInfo(&mDescSetLayout, 1);
+        pipelineLayoutCI.pushConstantRangeCount = 1;
+        pipelineLayoutCI.pPushConstantRanges = &pushConstRange;
+        VK_CHECK(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCI, nullptr, &mPipelineLayout))
+
+        VkComputePipelineCreateInfo computePipelineCI = LeoVK::Init::ComputePipelineCreateInfo(mPipelineLayout);
+        computePipelineCI.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computePipelineCI.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        computePipelineCI.stage.module = mShaderModule;
+        computePipelineCI.stage.pName = "main";
+        VK_CHECK(vkCreateComputePipelines(logicalDevice, VK_NULL_HANDLE, 1, &computePipelineCI, nullptr, &mPipeline))
+
+        // 每个纹理一个计数器，用来找出最后完成的工作组
+        VK_CHECK(mpDevice->CreateBuffer(
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &mCounterBuffer, sizeof(uint32_t) * MIP_BATCH_MAX_TEXTURES))
+    }
+
+    MipGenerator::~MipGenerator()
+    {
+        Flush();
+        VkDevice logicalDevice = mpDevice->mLogicalDevice;
+        mCounterBuffer.Destroy();
+        if (mPipeline != VK_NULL_HANDLE) vkDestroyPipeline(logicalDevice, mPipeline, nullptr);
+        if (mPipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(logicalDevice, mPipelineLayout, nullptr);
+        if (mDescPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(logicalDevice, mDescPool, nullptr);
+        if (mDescSetLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(logicalDevice, mDescSetLayout, nullptr);
+        if (mShaderModule != VK_NULL_HANDLE) vkDestroyShaderModule(logicalDevice, mShaderModule, nullptr);
+    }
+
+    bool MipGenerator::IsSupported(uint32_t width, uint32_t height) const
+    {
+        return mPipeline != VK_NULL_HANDLE && std::max(width, height) <= (1u << (MIP_GENERATOR_MAX_MIPS - 1));
+    }
+
+    void MipGenerator::BeginBatch()
+    {
+        if (mCmdBuffer != VK_NULL_HANDLE) return;
+
+        mCmdBuffer = mpDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+        if (mCounterBuffer.mBuffer == VK_NULL_HANDLE) return;
+        vkCmdFillBuffer(mCmdBuffer, mCounterBuffer.mBuffer, 0, VK_WHOLE_SIZE, 0);
+        VkBufferMemoryBarrier bufferBarrier = LeoVK::Init::BufferMemoryBarrier();
+        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.buffer = mCounterBuffer.mBuffer;
+        bufferBarrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(mCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+    }
+
+    LeoVK::Buffer& MipGenerator::CreateStagingBuffer(const void *data, VkDeviceSize size)
+    {
+        BeginBatch();
+        LeoVK::Buffer stagingBuffer;
+        VK_CHECK(mpDevice->CreateBuffer(
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &stagingBuffer, size, const_cast<void*>(data)))
+        mStagingBuffers.push_back(stagingBuffer);
+        mStagingSize += size;
+        return mStagingBuffers.back();
+    }
+
+    void MipGenerator::Add(LeoVK::Texture *texture, const void *data, VkDeviceSize size, bool bSRGB)
+    {
+        assert(IsSupported(texture->mWidth, texture->mHeight));
+        VkDevice logicalDevice = mpDevice->mLogicalDevice;
+
+        LeoVK::Buffer& stagingBuffer = CreateStagingBuffer(data, size);
+
+        VkImageSubresourceRange subresourceRange = {};
+        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        subresourceRange.levelCount = texture->mMipLevels;
+        subresourceRange.layerCount = 1;
+        LeoVK::VKTools::SetImageLayout(mCmdBuffer, texture->mImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+
+        VkBufferImageCopy bufferCopyRegion = {};
+        bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        bufferCopyRegion.imageSubresource.layerCount = 1;
+        bufferCopyRegion.imageExtent = { texture->mWidth, texture->mHeight, 1 };
+        vkCmdCopyBufferToImage(mCmdBuffer, stagingBuffer.mBuffer, texture->mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
+
+        // 整条Mip链一次转换到GENERAL，Mip0作为输入，其余作为输出
+        VkImageMemoryBarrier imageBarrier = LeoVK::Init::ImageMemoryBarrier();
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        imageBarrier.image = texture->mImage;
+        imageBarrier.subresourceRange = subresourceRange;
+        vkCmdPipelineBarrier(mCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+        // 图像数组固定长度，不足的部分重复最后一级，Shader不会写入
+        std::array<VkDescriptorImageInfo, MIP_GENERATOR_MAX_MIPS> mipInfos{};
+        for (uint32_t mip = 0; mip < MIP_GENERATOR_MAX_MIPS; mip++)
+        {
+            if (mip < texture->mMipLevels)
+            {
+                VkImageViewCreateInfo viewCI = LeoVK::Init::ImageViewCreateInfo();
+                viewCI.image = texture->mImage;
+                viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                viewCI.format = VK_FORMAT_R8G8B8A8_UNORM;
+                viewCI.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1 };
+                VkImageView mipView;
+                VK_CHECK(vkCreateImageView(logicalDevice, &viewCI, nullptr, &mipView))
+                mMipViews.push_back(mipView);
+                mipInfos[mip] = { VK_NULL_HANDLE, mipView, VK_IMAGE_LAYOUT_GENERAL };
+            }
+            else
+            {
+                mipInfos[mip] = mipInfos[texture->mMipLevels - 1];
+            }
+        }
+
+        VkDescriptorSet descSet;
+        VkDescriptorSetAllocateInfo descSetAI = LeoVK::Init::DescSetAllocateInfo(mDescPool, &mDescSetLayout, 1);
+        VK_CHECK(vkAllocateDescriptorSets(logicalDevice, &descSetAI, &descSet))
+        std::array<VkWriteDescriptorSet, 2> writeDescSets = {
+            LeoVK::Init::WriteDescriptorSet(descSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, mipInfos.data(), MIP_GENERATOR_MAX_MIPS),
+            LeoVK::Init::WriteDescriptorSet(descSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &mCounterBuffer.mDescriptor),
+        };
+        vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writeDescSets.size()), writeDescSets.data(), 0, nullptr);
+
+        const uint32_t groupCountX = (texture->mWidth + MIP_TILE_SIZE - 1) / MIP_TILE_SIZE;
+        const uint32_t groupCountY = (texture->mHeight + MIP_TILE_SIZE - 1) / MIP_TILE_SIZE;
+        struct
+        {
+            int32_t width, height;
+            uint32_t mipCount;
+            uint32_t srgb;
+            uint32_t counterIndex;
+            uint32_t groupCount;
+        } pushConsts = {
+            (int32_t)texture->mWidth, (int32_t)texture->mHeight, texture->mMipLevels,
+            bSRGB ? 1u : 0u, mBatchCount, groupCountX * groupCountY
+        };
+        vkCmdBindPipeline(mCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+        vkCmdBindDescriptorSets(mCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &descSet, 0, nullptr);
+        vkCmdPushConstants(mCmdBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConsts), &pushConsts);
+        vkCmdDispatch(mCmdBuffer, groupCountX, groupCountY, 1);
+
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(mCmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+        texture->mImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        mTextureCount++;
+        mBatchCount++;
+        if (mBatchCount >= MIP_BATCH_MAX_TEXTURES || mStagingSize >= MIP_BATCH_MAX_STAGING) Flush();
+    }
+
+    void MipGenerator::AddUpload(LeoVK::Texture *texture, const void *data, VkDeviceSize size, const std::vector<VkBufferImageCopy> &regions)
+    {
+        LeoVK::Buffer& stagingBuffer = CreateStagingBuffer(data, size);
+
+        VkImageSubresourceRange subresourceRange = {};
+        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        subresourceRange.levelCount = texture->mMipLevels;
+        subresourceRange.layerCount = 1;
+        LeoVK::VKTools::SetImageLayout(mCmdBuffer, texture->mImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+        vkCmdCopyBufferToImage(mCmdBuffer, stagingBuffer.mBuffer, texture->mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+        LeoVK::VKTools::SetImageLayout(mCmdBuffer, texture->mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
+        texture->mImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        if (mStagingSize >= MIP_BATCH_MAX_STAGING) Flush();
+    }
+
+    void MipGenerator::Flush()
+    {
+        if (mCmdBuffer == VK_NULL_HANDLE) return;
+
+        mpDevice->FlushCommandBuffer(mCmdBuffer, mQueue, true);
+        mCmdBuffer = VK_NULL_HANDLE;
+        mSubmitCount++;
+
+        // FlushCommandBuffer等待Fence，此时可以安全释放本批次的资源
+        for (auto& stagingBuffer : mStagingBuffers) stagingBuffer.Destroy();
+        for (auto mipView : mMipViews) vkDestroyImageView(mpDevice->mLogicalDevice, mipView, nullptr);
+        mStagingBuffers.clear();
+        mMipViews.clear();
+        if (mDescPool != VK_NULL_HANDLE) VK_CHECK(vkResetDescriptorPool(mpDevice->mLogicalDevice, mDescPool, 0))
+        mStagingSize = 0;
+        mBatchCount = 0;
+    }
+}
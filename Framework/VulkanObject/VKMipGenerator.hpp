@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ProjectPCH.hpp"
+
+#include "VKBuffer.hpp"
+#include "VKDevice.hpp"
+#include "VKTexture.hpp"
+
+// 单Pass Compute生成Mip的上限，对应GenerateMips.comp中的MAX_MIPS
+#define MIP_GENERATOR_MAX_MIPS 13u
+
+namespace LeoVK
+{
+    /**
+     * @brief 用单个Compute Dispatch生成纹理的整条Mip链
+     * @note 多个纹理的上传和Dispatch录制在同一个Command Buffer中，Flush时一次提交
+     */
+    class MipGenerator
+    {
+    public:
+        MipGenerator(LeoVK::VulkanDevice* device, VkQueue queue);
+        ~MipGenerator();
+
+        bool IsSupported(uint32_t width, uint32_t height) const;
+        // 纹理的Image需要带有STORAGE和TRANSFER_DST用途，完成后处于SHADER_READ_ONLY_OPTIMAL
+        void Add(LeoVK::Texture* texture, const void* data, VkDeviceSize size, bool bSRGB);
+        // 已经带有完整Mip链的纹理（例如块压缩）只录制各级的拷贝
+        void AddUpload(LeoVK::Texture* texture, const void* data, VkDeviceSize size, const std::vector<VkBufferImageCopy>& regions);
+        void Flush();
+
+    public:
+        uint32_t mTextureCount = 0;
+        uint32_t mSubmitCount = 0;
+
+    private:
+        void BeginBatch();
+        LeoVK::Buffer& CreateStagingBuffer(const void* data, VkDeviceSize size);
+
+    private:
+        LeoVK::VulkanDevice*    mpDevice;
+        VkQueue                 mQueue;
+        VkShaderModule          mShaderModule = VK_NULL_HANDLE;
+        VkDescriptorSetLayout   mDescSetLayout = VK_NULL_HANDLE;
+        VkPipelineLayout        mPipelineLayout = VK_NULL_HANDLE;
+        VkPipeline              mPipeline = VK_NULL_HANDLE;
+
+        // 当前批次的资源，Flush后释放
+        VkCommandBuffer             mCmdBuffer = VK_NULL_HANDLE;
+        VkDescriptorPool            mDescPool = VK_NULL_HANDLE;
+        LeoVK::Buffer               mCounterBuffer;
+        std::vector<LeoVK::Buffer>  mStagingBuffers;
+        std::vector<VkImageView>    mMipViews;
+        VkDeviceSize                mStagingSize = 0;
+        uint32_t                    mBatchCount = 0;
+    };
+}
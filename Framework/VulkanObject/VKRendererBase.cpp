@@ -1,5 +1,8 @@
 #include "VKRendererBase.hpp"
 
+#include <filesystem>
+#include <sstream>
+
 std::vector<const char*> VKRendererBase::mArgs;
 
 // Public
@@ -35,6 +38,19 @@ VKRendererBase::VKRendererBase(bool msaa, bool enableValidation)
     mCmdLineParser.Add("benchmarkResultFile", { "-bf", "--benchFilename" }, 1, "Set file name for benchmark results");
     mCmdLineParser.Add("benchmarkResultFrames", { "-bt", "--benchFrameTimes" }, 0, "Save frame times to benchmark results file");
     mCmdLineParser.Add("benchmarkFrames", { "-bfs", "--benchmarkFrames" }, 1, "Only render the given number of frames");
+    mCmdLineParser.Add("depthPrepass", { "-dp", "--depthPrepass" }, 0, "Render a depth-only pre-pass before shading (if supported by the renderer)");
+    mCmdLineParser.Add("visibilityBuffer", { "-vb", "--visibilityBuffer" }, 0, "Shade opaque geometry from a visibility buffer instead of forward rendering (if supported by the renderer)");
+    mCmdLineParser.Add("manyLights", { "-ml", "--manyLights" }, 1, "Add the given number of synthetic point lights (if supported by the renderer)");
+    mCmdLineParser.Add("bruteForceLights", { "-bl", "--bruteForceLights" }, 0, "Loop over all lights per pixel instead of clustered light culling (if supported by the renderer)");
+    mCmdLineParser.Add("dynamicResolution", { "-dr", "--dynamicResolution" }, 1, "Scale render resolution and MSAA to meet the given GPU frame time in ms (if supported by the renderer)");
+    mCmdLineParser.Add("graphicsIBL", { "-gibl", "--graphicsIBL" }, 0, "Generate irradiance and prefiltered cube maps by rendering each face instead of with compute shaders (if supported by the renderer)");
+    mCmdLineParser.Add("noIBLCache", { "-nic", "--noIBLCache" }, 0, "Always regenerate the BRDF LUT and IBL cube maps instead of loading them from the on-disk cache (if supported by the renderer)");
+    mCmdLineParser.Add("noTextureCompression", { "-ntc", "--noTextureCompression" }, 0, "Upload scene textures as uncompressed RGBA8 instead of compressing them to BC1/BC3 at load time (if supported by the renderer)");
+    mCmdLineParser.Add("streamAssets", { "-sa", "--streamAssets" }, 0, "Load scenes in bounded batches, freeing CPU copies of images and geometry as soon as they are uploaded (if supported by the renderer). tinygltf still reads each buffer whole while parsing, so peak memory includes the largest .bin or GLB binary chunk");
+    mCmdLineParser.Add("smoothNormals", { "-sn", "--smoothNormals" }, 0, "Generate smooth instead of flat normals for primitives without NORMAL (if supported by the renderer)");
+    mCmdLineParser.Add("shIrradiance", { "-sh", "--shIrradiance" }, 0, "Evaluate diffuse IBL from spherical harmonics instead of the irradiance cube map (if supported by the renderer)");
+    mCmdLineParser.Add("noShadowCache", { "-nsc", "--noShadowCache" }, 0, "Re-render all shadow casters every frame instead of caching static cascades (if supported by the renderer)");
+    mCmdLineParser.Add("memoryReport", { "-mr", "--memoryReport" }, 0, "Print device memory usage by category, heap budgets and the largest allocations after loading and on exit");
 
     mCmdLineParser.Parse(mArgs);
     if (mCmdLineParser.IsSet("help")) 
@@ -55,6 +71,8 @@ VKRendererBase::VKRendererBase(bool msaa, bool enableValidation)
 
     if (mCmdLineParser.IsSet("fullscreen")) mSettings.fullscreen = true;
 
+    if (mCmdLineParser.IsSet("memoryReport")) mbMemoryReport = true;
+
     if (mCmdLineParser.IsSet("shaders"))
     {
         std::string value = mCmdLineParser.GetValueAsString("shaders", "glsl");
@@ -117,8 +135,9 @@ VKRendererBase::~VKRendererBase()
     }
     vkDestroyImageView(mDevice, mDepthStencil.imageView, nullptr);
     vkDestroyImage(mDevice, mDepthStencil.image, nullptr);
-    vkFreeMemory(mDevice, mDepthStencil.memory, nullptr);
+    mpVulkanDevice->FreeImageMemory(mDepthStencil.image);
 
+    savePipelineCache();
     vkDestroyPipelineCache(mDevice, mPipelineCache, nullptr);
     vkDestroyCommandPool(mDevice, mCmdPool, nullptr);
 
@@ -126,10 +145,10 @@ VKRendererBase::~VKRendererBase()
     {
         vkDestroyImage(mDevice, mMSTarget.color.image, nullptr);
         vkDestroyImageView(mDevice, mMSTarget.color.imageView, nullptr);
-        vkFreeMemory(mDevice, mMSTarget.color.memory, nullptr);
+        mpVulkanDevice->FreeImageMemory(mMSTarget.color.image);
         vkDestroyImage(mDevice, mMSTarget.depth.image, nullptr);
         vkDestroyImageView(mDevice, mMSTarget.depth.imageView, nullptr);
-        vkFreeMemory(mDevice, mMSTarget.depth.memory, nullptr);
+        mpVulkanDevice->FreeImageMemory(mMSTarget.depth.image);
     }
 
     vkDestroySemaphore(mDevice, mSemaphores.presentComplete, nullptr);
@@ -236,6 +255,13 @@ bool VKRendererBase::InitVulkan()
 
     mDevice = mpVulkanDevice->mLogicalDevice;
 
+    result = mpVulkanDevice->CreateAllocator(mInstance, mAPIVersion);
+    if (result != VK_SUCCESS)
+    {
+        LeoVK::VKTools::ExitFatal("Could not create memory allocator: \n" + LeoVK::VKTools::ErrorString(result), result);
+        return false;
+    }
+
     vkGetDeviceQueue(mDevice, mpVulkanDevice->mQueueFamilyIndices.graphics, 0, &mQueue);
 
     // Find a suitable Depth format
@@ -662,7 +688,7 @@ void VKRendererBase::MouseMoved(double x, double y, bool &handled)
 void VKRendererBase::WindowResized()
 {
     BuildCommandBuffers();
-    vkDeviceWaitIdle(mDevice);
+    mpVulkanDevice->WaitIdle();
     updateOverlay();
 }
 
@@ -684,14 +710,7 @@ void VKRendererBase::SetupDepthStencil()
     imageCI.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
     VK_CHECK(vkCreateImage(mDevice, &imageCI, nullptr, &mDepthStencil.image))
-    VkMemoryRequirements memReqs{};
-    vkGetImageMemoryRequirements(mDevice, mDepthStencil.image, &memReqs);
-
-    VkMemoryAllocateInfo memAI = LeoVK::Init::MemoryAllocateInfo();
-    memAI.allocationSize = memReqs.size;
-    memAI.memoryTypeIndex = mpVulkanDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    VK_CHECK(vkAllocateMemory(mDevice, &memAI, nullptr, &mDepthStencil.memory))
-    VK_CHECK(vkBindImageMemory(mDevice, mDepthStencil.image, mDepthStencil.memory, 0))
+    VK_CHECK(mpVulkanDevice->AllocateImageMemory(mDepthStencil.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Transient, LeoVK::MemoryCategory::RenderTarget, &mDepthStencil.memory))
 
     VkImageViewCreateInfo depthViewCI = LeoVK::Init::ImageViewCreateInfo();
     depthViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
@@ -760,11 +779,11 @@ void VKRendererBase::SetupRenderPass()
     {
         std::array<VkAttachmentDescription, 4> attachments{};
 
-        // MSAA Attachment render to
+        // MSAA Attachment render to，Resolve之后不再需要，不写回内存
         attachments[0].format = mSwapChain.mFormat;
         attachments[0].samples = mSettings.sampleCount;
         attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -917,6 +936,54 @@ void VKRendererBase::SetupRenderPass()
     }
 }
 
+void VKRendererBase::SetSampleCount(VkSampleCountFlagBits sampleCount)
+{
+    if (sampleCount == mSettings.sampleCount) return;
+
+    SampleCountChanging();
+    mpVulkanDevice->WaitIdle();
+    if (mSettings.multiSampling)
+    {
+        vkDestroyImageView(mDevice, mMSTarget.color.imageView, nullptr);
+        vkDestroyImage(mDevice, mMSTarget.color.image, nullptr);
+        mpVulkanDevice->FreeImageMemory(mMSTarget.color.image);
+        vkDestroyImageView(mDevice, mMSTarget.depth.imageView, nullptr);
+        vkDestroyImage(mDevice, mMSTarget.depth.image, nullptr);
+        mpVulkanDevice->FreeImageMemory(mMSTarget.depth.image);
+    }
+    for (auto & frameBuffer : mFrameBuffers)
+    {
+        vkDestroyFramebuffer(mDevice, frameBuffer, nullptr);
+    }
+    vkDestroyRenderPass(mDevice, mRenderPass, nullptr);
+
+    // 单采样时使用不带Resolve的Render Pass
+    mSettings.sampleCount = sampleCount;
+    mSettings.multiSampling = sampleCount != VK_SAMPLE_COUNT_1_BIT;
+    SetupRenderPass();
+    SetupFrameBuffer();
+
+    if (mSettings.overlay)
+    {
+        vkDestroyPipeline(mDevice, mUIOverlay.mPipeline, nullptr);
+        vkDestroyPipelineLayout(mDevice, mUIOverlay.mPipelineLayout, nullptr);
+        mUIOverlay.mMSAA = mSettings.sampleCount;
+        mUIOverlay.PreparePipeline(mPipelineCache, mRenderPass, mSwapChain.mFormat, mDepthFormat);
+    }
+
+    SampleCountChanged();
+}
+
+void VKRendererBase::SampleCountChanging()
+{
+
+}
+
+void VKRendererBase::SampleCountChanged()
+{
+
+}
+
 void VKRendererBase::GetEnabledFeatures()
 {
 
@@ -973,7 +1040,9 @@ void VKRendererBase::RenderLoop()
     if (mBenchmark.mbActive)
     {
         mBenchmark.Run([=] { Render(); }, mpVulkanDevice->mProperties);
-        vkDeviceWaitIdle(mDevice);
+        mpVulkanDevice->WaitIdle();
+        mBenchmark.mMemoryReport = mpVulkanDevice->GetMemoryReport();
+        if (mbMemoryReport) PrintMemoryReport();
         if (!mBenchmark.mFilename.empty()) mBenchmark.SaveResults();
         return;
     }
@@ -1005,7 +1074,8 @@ void VKRendererBase::RenderLoop()
     // Flush device to make sure all resources can be freed
     if (mDevice != VK_NULL_HANDLE)
     {
-        vkDeviceWaitIdle(mDevice);
+        mpVulkanDevice->WaitIdle();
+        if (mbMemoryReport) PrintMemoryReport();
     }
 }
 
@@ -1024,6 +1094,8 @@ void VKRendererBase::DrawUI(VkCommandBuffer commandBuffer)
 
 void VKRendererBase::PrepareFrame()
 {
+    mpVulkanDevice->BeginFrame();
+
     // Acquire the next image from the swap chain
     VkResult result = mSwapChain.AcquireNextImage(mSemaphores.presentComplete, &mCurrentBuffer);
 
@@ -1045,7 +1117,11 @@ void VKRendererBase::PrepareFrame()
 
 void VKRendererBase::SubmitFrame()
 {
-    VkResult result = mSwapChain.QueuePresent(mQueue, mCurrentBuffer, mSemaphores.renderComplete);
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> lock(mpVulkanDevice->mQueueMutex);
+        result = mSwapChain.QueuePresent(mQueue, mCurrentBuffer, mSemaphores.renderComplete);
+    }
     // Recreate the swapchain if it's no longer compatible with the surface (OUT_OF_DATE) or no longer optimal for presentation (SUBOPTIMAL)
 
     if ((result == VK_ERROR_OUT_OF_DATE_KHR) || (result == VK_SUBOPTIMAL_KHR))
@@ -1057,7 +1133,47 @@ void VKRendererBase::SubmitFrame()
     {
         VK_CHECK(result);
     }
-    VK_CHECK(vkQueueWaitIdle(mQueue));
+    {
+        // 后台加载线程提交的上传也一起等待
+        std::lock_guard<std::mutex> lock(mpVulkanDevice->mQueueMutex);
+        VK_CHECK(vkQueueWaitIdle(mQueue));
+    }
+    // 队列已经空闲，这一帧及之前延迟销毁的资源都不再被使用
+    mpVulkanDevice->EndFrame();
+}
+
+void VKRendererBase::PrintMemoryReport()
+{
+    const LeoVK::MemoryReport report = mpVulkanDevice->GetMemoryReport();
+    const double toMB = 1.0 / (1024.0 * 1024.0);
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Device memory: " << report.mTotalBytes * toMB << " MB in resources" << (report.mbBudgetExtension ? "" : " (budgets estimated, VK_EXT_memory_budget not available)") << "\n";
+    for (size_t i = 0; i < report.mHeaps.size(); i++)
+    {
+        const LeoVK::MemoryHeapBudget& heap = report.mHeaps[i];
+        std::cout << "  Heap " << i << (heap.mbDeviceLocal ? " (device local)" : "") << ": "
+            << heap.mBlockBytes * toMB << " MB allocated, " << heap.mUsage * toMB << " / " << heap.mBudget * toMB << " MB budget" << "\n";
+    }
+    for (uint32_t i = 0; i < (uint32_t)LeoVK::MemoryCategory::Count; i++)
+    {
+        if (report.mCategoryCounts[i] == 0) continue;
+        std::cout << "  " << LeoVK::VulkanDevice::GetMemoryCategoryName((LeoVK::MemoryCategory)i) << ": "
+            << report.mCategoryCounts[i] << " allocations, " << report.mCategoryBytes[i] * toMB << " MB" << "\n";
+    }
+    for (uint32_t i = 0; i < (uint32_t)LeoVK::MemoryPool::Count; i++)
+    {
+        const LeoVK::MemoryPoolStats poolStats = mpVulkanDevice->GetMemoryPoolStats((LeoVK::MemoryPool)i);
+        if (poolStats.mBlockCount == 0) continue;
+        std::cout << "  " << LeoVK::VulkanDevice::GetMemoryPoolName((LeoVK::MemoryPool)i) << " pool: "
+            << poolStats.mAllocationCount << " allocations in " << poolStats.mBlockCount << " blocks, "
+            << poolStats.mUsedBytes * toMB << " / " << poolStats.mBlockBytes * toMB << " MB" << "\n";
+    }
+    for (auto& record : report.mTopAllocations)
+    {
+        std::cout << "  Largest: " << LeoVK::VulkanDevice::GetMemoryCategoryName(record.mCategory) << " in "
+            << LeoVK::VulkanDevice::GetMemoryPoolName(record.mPool) << " pool" << (record.mbDedicated ? " (dedicated)" : "") << ", " << record.mSize * toMB << " MB" << "\n";
+    }
+    std::cout << std::defaultfloat << std::flush;
 }
 
 void VKRendererBase::RenderFrame()
@@ -1065,7 +1181,10 @@ void VKRendererBase::RenderFrame()
     VKRendererBase::PrepareFrame();
     mSubmitInfo.commandBufferCount = 1;
     mSubmitInfo.pCommandBuffers = &mDrawCmdBuffers[mCurrentBuffer];
-    VK_CHECK(vkQueueSubmit(mQueue, 1, &mSubmitInfo, VK_NULL_HANDLE));
+    {
+        std::lock_guard<std::mutex> lock(mpVulkanDevice->mQueueMutex);
+        VK_CHECK(vkQueueSubmit(mQueue, 1, &mSubmitInfo, VK_NULL_HANDLE));
+    }
     VKRendererBase::SubmitFrame();
 }
 
@@ -1108,7 +1227,7 @@ void VKRendererBase::windowResizing()
     if (!mbPrepared) return;
     mbPrepared = false;
 
-    vkDeviceWaitIdle(mDevice);
+    mpVulkanDevice->WaitIdle();
     mWidth = mDstWidth;
     mHeight = mDstHeight;
     setupSwapChain();
@@ -1117,14 +1236,14 @@ void VKRendererBase::windowResizing()
     {
         vkDestroyImageView(mDevice, mMSTarget.color.imageView, nullptr);
         vkDestroyImage(mDevice, mMSTarget.color.image, nullptr);
-        vkFreeMemory(mDevice, mMSTarget.color.memory, nullptr);
+        mpVulkanDevice->FreeImageMemory(mMSTarget.color.image);
         vkDestroyImageView(mDevice, mMSTarget.depth.imageView, nullptr);
         vkDestroyImage(mDevice, mMSTarget.depth.image, nullptr);
-        vkFreeMemory(mDevice, mMSTarget.depth.memory, nullptr);
+        mpVulkanDevice->FreeImageMemory(mMSTarget.depth.image);
     }
     vkDestroyImageView(mDevice, mDepthStencil.imageView, nullptr);
     vkDestroyImage(mDevice, mDepthStencil.image, nullptr);
-    vkFreeMemory(mDevice, mDepthStencil.memory, nullptr);
+    mpVulkanDevice->FreeImageMemory(mDepthStencil.image);
     SetupDepthStencil();
     for (auto & mFrameBuffer : mFrameBuffers)
     {
@@ -1142,7 +1261,7 @@ void VKRendererBase::windowResizing()
 
     createSynchronizationPrimitives();
 
-    vkDeviceWaitIdle(mDevice);
+    mpVulkanDevice->WaitIdle();
 
     mCamera.UpdateAspectRatio((float)mWidth / (float)mHeight);
     WindowResized();
@@ -1259,6 +1378,8 @@ void VKRendererBase::updateOverlay()
     ImGui::TextUnformatted(mTitle.c_str());
     ImGui::TextUnformatted(mDeviceProps.deviceName);
     ImGui::Text("%.2f ms/frame (%.1d fps)", (1000.0f / (float)mLastFPS), mLastFPS);
+    ImGui::Text("Pipeline cache: %s (%.1f KB)", mPipelineCacheStats.mbLoadedFromDisk ? "warm" : "cold", (float)mPipelineCacheStats.mLoadedSize / 1024.0f);
+    ImGui::Text("Samplers: %d shared by %d users", mpVulkanDevice->GetSamplerCount(), mpVulkanDevice->GetSamplerRefCount());
 
     ImGui::PushItemWidth(110.0f * mUIOverlay.mScale);
     OnUpdateUIOverlay(&mUIOverlay);
@@ -1275,11 +1396,114 @@ void VKRendererBase::updateOverlay()
     }
 }
 
+// 磁盘上的Pipeline Cache文件头，Vulkan自带的Header里没有驱动版本，所以额外记录一份
+struct PipelineCacheFileHeader
+{
+    uint32_t mMagic;
+    uint32_t mDriverVersion;
+    uint64_t mDataSize;
+};
+static constexpr uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x4C50434Bu;
+
+std::string VKRendererBase::getPipelineCachePath()
+{
+    // 每个设备单独一个缓存文件，放在可执行文件旁边，不依赖工作目录
+    std::stringstream ss;
+    ss << GetExecutablePath() << "PipelineCache/" << mName << "_" << std::hex << std::setw(4) << std::setfill('0') << mDeviceProps.vendorID
+       << "_" << std::setw(4) << mDeviceProps.deviceID << ".bin";
+    return ss.str();
+}
+
 void VKRendererBase::createPipelineCache()
 {
+    std::vector<char> cacheData;
+
+    std::ifstream is(getPipelineCachePath(), std::ios::binary | std::ios::ate);
+    if (is.is_open())
+    {
+        const uint64_t fileSize = (uint64_t)is.tellg();
+        is.seekg(0);
+        PipelineCacheFileHeader fileHeader{};
+        is.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
+        // 文件头记录的大小必须和实际文件一致，截断或损坏的文件直接丢弃
+        if (is && fileHeader.mMagic == PIPELINE_CACHE_FILE_MAGIC && fileHeader.mDriverVersion == mDeviceProps.driverVersion &&
+            fileHeader.mDataSize == fileSize - sizeof(fileHeader))
+        {
+            cacheData.resize(fileHeader.mDataSize);
+            is.read(cacheData.data(), (std::streamsize)cacheData.size());
+            if (!is) cacheData.clear();
+        }
+        is.close();
+    }
+
+    // 校验Vulkan的Cache Header，任何一项不匹配都丢弃旧数据
+    if (cacheData.size() >= sizeof(VkPipelineCacheHeaderVersionOne))
+    {
+        VkPipelineCacheHeaderVersionOne header{};
+        memcpy(&header, cacheData.data(), sizeof(header));
+        if (header.headerSize < sizeof(VkPipelineCacheHeaderVersionOne) ||
+            header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+            header.vendorID != mDeviceProps.vendorID ||
+            header.deviceID != mDeviceProps.deviceID ||
+            memcmp(header.pipelineCacheUUID, mDeviceProps.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+        {
+            std::cout << "Pipeline cache on disk does not match the current device, ignoring" << std::endl;
+            cacheData.clear();
+        }
+    }
+    else
+    {
+        cacheData.clear();
+    }
+
     VkPipelineCacheCreateInfo pipelineCacheCI {};
     pipelineCacheCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-    VK_CHECK(vkCreatePipelineCache(mDevice, &pipelineCacheCI, nullptr, &mPipelineCache));
+    pipelineCacheCI.initialDataSize = cacheData.size();
+    pipelineCacheCI.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+    VkResult result = vkCreatePipelineCache(mDevice, &pipelineCacheCI, nullptr, &mPipelineCache);
+    if (result != VK_SUCCESS && !cacheData.empty())
+    {
+        // 驱动拒绝了缓存数据，退回到空的Cache
+        cacheData.clear();
+        pipelineCacheCI.initialDataSize = 0;
+        pipelineCacheCI.pInitialData = nullptr;
+        result = vkCreatePipelineCache(mDevice, &pipelineCacheCI, nullptr, &mPipelineCache);
+    }
+    VK_CHECK(result);
+
+    mPipelineCacheStats.mbLoadedFromDisk = !cacheData.empty();
+    mPipelineCacheStats.mLoadedSize = cacheData.size();
+    std::cout << "Pipeline cache: " << (cacheData.empty() ? "cold start" : "loaded " + std::to_string(cacheData.size()) + " bytes") << std::endl;
+}
+
+void VKRendererBase::savePipelineCache()
+{
+    if (mPipelineCache == VK_NULL_HANDLE) return;
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(mDevice, mPipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) return;
+    std::vector<char> cacheData(dataSize);
+    if (vkGetPipelineCacheData(mDevice, mPipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS) return;
+
+    std::string path = getPipelineCachePath();
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    // 先写临时文件再替换，避免中途退出留下损坏的缓存
+    std::string tmpPath = path + ".tmp";
+    std::ofstream os(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!os.is_open())
+    {
+        std::cerr << "Could not write pipeline cache to " << path << std::endl;
+        return;
+    }
+    PipelineCacheFileHeader fileHeader{ PIPELINE_CACHE_FILE_MAGIC, mDeviceProps.driverVersion, dataSize };
+    os.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    os.write(cacheData.data(), (std::streamsize)dataSize);
+    os.close();
+
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) std::cerr << "Could not write pipeline cache to " << path << std::endl;
 }
 
 void VKRendererBase::createCommandPool()
@@ -1349,28 +1573,24 @@ void VKRendererBase::setupRenderTarget(VkImage *image, VkImageView *imageView, V
         mDevice, &imageCI, nullptr,
         isDepth ? &mMSTarget.depth.image : &mMSTarget.color.image))
 
-    VkMemoryRequirements memReqs{};
-    vkGetImageMemoryRequirements(mDevice, isDepth ? mMSTarget.depth.image : mMSTarget.color.image, &memReqs);
-
-    VkBool32 lazyMemTypePresent;
-    VkMemoryAllocateInfo memoryAI{};
-    memoryAI.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memoryAI.allocationSize = memReqs.size;
-    memoryAI.memoryTypeIndex = mpVulkanDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &lazyMemTypePresent);
-
-    if (!lazyMemTypePresent)
-    {
-        memoryAI.memoryTypeIndex = mpVulkanDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    }
+    // MSAA附件只在Pass内部使用，Resolve之后内容就被丢弃
+    VkMemoryPropertyFlags memProps = mpVulkanDevice->GetTransientAttachmentMemoryFlags(isDepth ? mMSTarget.depth.image : mMSTarget.color.image);
     if (isDepth)
     {
-        VK_CHECK(vkAllocateMemory(mDevice, &memoryAI, nullptr, &mMSTarget.depth.memory));
-        vkBindImageMemory(mDevice, mMSTarget.depth.image, mMSTarget.depth.memory, 0);
+        VK_CHECK(mpVulkanDevice->AllocateImageMemory(mMSTarget.depth.image, memProps, LeoVK::MemoryPool::Transient, LeoVK::MemoryCategory::RenderTarget, &mMSTarget.depth.memory));
     }
     else
     {
-        VK_CHECK(vkAllocateMemory(mDevice, &memoryAI, nullptr, &mMSTarget.color.memory));
-        vkBindImageMemory(mDevice, mMSTarget.color.image, mMSTarget.color.memory, 0);
+        // 没有Lazy内存时和其他Pass的MSAA颜色共用内存
+        VkResult result = VK_ERROR_FEATURE_NOT_PRESENT;
+        if (!(memProps & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) && mMSColorAlias != VK_NULL_HANDLE)
+        {
+            result = mpVulkanDevice->AliasImageMemory(mMSTarget.color.image, mMSColorAlias, &mMSTarget.color.memory);
+        }
+        if (result != VK_SUCCESS)
+        {
+            VK_CHECK(mpVulkanDevice->AllocateImageMemory(mMSTarget.color.image, memProps, LeoVK::MemoryPool::Transient, LeoVK::MemoryCategory::RenderTarget, &mMSTarget.color.memory));
+        }
     }
 
     // Create image view for the MSAA target
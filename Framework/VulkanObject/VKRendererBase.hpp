@@ -75,6 +75,15 @@ public:
     /** @brief (Virtual) Setup a default renderpass */
     virtual void SetupRenderPass();
 
+    /** @brief Recreates the render pass, multisample targets, frame buffers and UI overlay pipeline for a different MSAA sample count */
+    void SetSampleCount(VkSampleCountFlagBits sampleCount);
+
+    /** @brief (Virtual) Called before the MSAA sample count and render pass change, pending work that reads them has to finish here */
+    virtual void SampleCountChanging();
+
+    /** @brief (Virtual) Called after the MSAA sample count has changed, pipelines created against the render pass have to be recreated */
+    virtual void SampleCountChanged();
+
     /** @brief (Virtual) Called after the physical device features have been read, can be used to set features to enable on the device */
     virtual void GetEnabledFeatures();
 
@@ -99,6 +108,9 @@ public:
     /** @brief Presents the current image to the swap chain */
     void SubmitFrame();
 
+    /** @brief Prints device memory usage by category, heap budgets and the largest allocations */
+    void PrintMemoryReport();
+
     /** @brief (Virtual) Default image acquire + submission and command buffer submission function */
     virtual void RenderFrame();
 
@@ -112,6 +124,7 @@ public:
     bool mbPrepared = false;
     bool mbResized = false;
     bool mbViewUpdated = false;
+    bool mbMemoryReport = false;
     uint32_t mWidth = 1280;
     uint32_t mHeight = 720;
 
@@ -222,7 +235,13 @@ protected:
     // List of shader modules created (stored for cleanup)
     std::vector<VkShaderModule> mShaderModules;
     // Pipeline cache object
-    VkPipelineCache mPipelineCache;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+    // Pipeline cache persisted on disk, used to compare cold and warm startup
+    struct
+    {
+        bool        mbLoadedFromDisk = false;
+        size_t      mLoadedSize = 0;
+    } mPipelineCacheStats;
     // Wraps the swap chain to present images (framebuffers) to the windowing system
     VulkanSwapChain mSwapChain;
     // Synchronization semaphores
@@ -234,6 +253,10 @@ protected:
         VkSemaphore renderComplete;
     } mSemaphores;
     std::vector<VkFence> mWaitFences;
+    // Multisampled color and depth targets, shared with offscreen passes that mirror the render pass
+    MultiSampleTarget mMSTarget;
+    // 没有Lazy内存时MSAA颜色和这个Image共用内存，它只能在主Render Pass之外使用并且每次使用前清除
+    VkImage mMSColorAlias = VK_NULL_HANDLE;
 
 private:
     std::string getWindowTitle();
@@ -242,6 +265,8 @@ private:
     void nextFrame();
     void updateOverlay();
     void createPipelineCache();
+    void savePipelineCache();
+    std::string getPipelineCachePath();
     void createCommandPool();
     void createSynchronizationPrimitives();
     void initSwapChain();
@@ -255,5 +280,4 @@ private:
     uint32_t mDstHeight;
     bool mbResizing = false;
     std::string mShaderDir = "GLSL";
-    MultiSampleTarget mMSTarget;
 };
\ No newline at end of file
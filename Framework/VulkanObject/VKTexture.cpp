@@ -7,13 +7,27 @@ namespace LeoVK
 {
     void Texture::Destroy()
     {
+        if (!mpDevice) return;
         vkDestroyImageView(mpDevice->mLogicalDevice, mView, nullptr);
         vkDestroyImage(mpDevice->mLogicalDevice, mImage, nullptr);
-        if (mSampler)
-        {
-            vkDestroySampler(mpDevice->mLogicalDevice, mSampler, nullptr);
-        }
-        vkFreeMemory(mpDevice->mLogicalDevice, mDeviceMemory, nullptr);
+        // Sampler由设备共享，只释放引用
+        mpDevice->ReleaseSampler(mSampler);
+        mpDevice->FreeImageMemory(mImage);
+        // 句柄置空，重复调用不会再次销毁
+        mImage = VK_NULL_HANDLE;
+        mView = VK_NULL_HANDLE;
+        mSampler = VK_NULL_HANDLE;
+    }
+
+    void Texture::DeferDestroy()
+    {
+        mpDevice->DeferDestroyImage(mImage, mView);
+        LeoVK::VulkanDevice* device = mpDevice;
+        VkSampler sampler = mSampler;
+        mpDevice->DeferDestroy([device, sampler]() { device->ReleaseSampler(sampler); });
+        mImage = VK_NULL_HANDLE;
+        mView = VK_NULL_HANDLE;
+        mSampler = VK_NULL_HANDLE;
     }
 
     void Texture::UpdateDescriptor()
@@ -57,30 +71,16 @@ namespace LeoVK
         mHeight = texHeight;
         mMipLevels = 1;
 
-        VkMemoryAllocateInfo memAI = LeoVK::Init::MemoryAllocateInfo();
-        VkMemoryRequirements memReqs;
         VkCommandBuffer copyCmd = mpDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
 
-        VkBuffer stageBuffer;
-        VkDeviceMemory stageMemory{};
-
-        VkBufferCreateInfo bufferCI = LeoVK::Init::BufferCreateInfo();
-        bufferCI.size = bufferSize;
-        bufferCI.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        VK_CHECK(vkCreateBuffer(mpDevice->mLogicalDevice, &bufferCI, nullptr, &stageBuffer))
-
-        vkGetBufferMemoryRequirements(mpDevice->mLogicalDevice, stageBuffer, &memReqs);
-        memAI.allocationSize = memReqs.size;
-        memAI.memoryTypeIndex = mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        VK_CHECK(vkAllocateMemory(mpDevice->mLogicalDevice, &memAI, nullptr, &stageMemory));
-        VK_CHECK(vkBindBufferMemory(mpDevice->mLogicalDevice, stageBuffer, stageMemory, 0));
-
-        // Copy texture data into staging buffer
-        uint8_t *data;
-        VK_CHECK(vkMapMemory(mpDevice->mLogicalDevice, stageMemory, 0, memReqs.size, 0, (void **)&data));
-        memcpy(data, buffer, bufferSize);
-        vkUnmapMemory(mpDevice->mLogicalDevice, stageMemory);
+        // Create a host-visible staging buffer that contains the raw image data
+        LeoVK::Buffer stageBuffer;
+        VK_CHECK(mpDevice->CreateBuffer(
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &stageBuffer,
+            bufferSize,
+            buffer))
 
         VkBufferImageCopy bufferCopyRegion{};
         bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -109,13 +109,7 @@ namespace LeoVK
         }
         VK_CHECK(vkCreateImage(mpDevice->mLogicalDevice, &imageCI, nullptr, &mImage));
 
-        vkGetImageMemoryRequirements(mpDevice->mLogicalDevice, mImage, &memReqs);
-
-        memAI.allocationSize = memReqs.size;
-
-        memAI.memoryTypeIndex = mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        VK_CHECK(vkAllocateMemory(mpDevice->mLogicalDevice, &memAI, nullptr, &mDeviceMemory));
-        VK_CHECK(vkBindImageMemory(mpDevice->mLogicalDevice, mImage, mDeviceMemory, 0));
+        VK_CHECK(mpDevice->AllocateImageMemory(mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Default, LeoVK::MemoryCategory::Texture, &mDeviceMemory));
 
         VkImageSubresourceRange subresourceRange = {};
         subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -133,7 +127,7 @@ namespace LeoVK
         // Copy the layers and mip levels from the staging buffer to the optimal tiled image
         vkCmdCopyBufferToImage(
             copyCmd,
-            stageBuffer,
+            stageBuffer.mBuffer,
             mImage,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             1,
@@ -151,8 +145,7 @@ namespace LeoVK
         mpDevice->FlushCommandBuffer(copyCmd, copyQueue);
 
         // Clean up staging resources
-        vkFreeMemory(mpDevice->mLogicalDevice, stageMemory, nullptr);
-        vkDestroyBuffer(mpDevice->mLogicalDevice, stageBuffer, nullptr);
+        stageBuffer.Destroy();
 
         // Create sampler
         VkSamplerCreateInfo samplerCI = {};
@@ -168,7 +161,7 @@ namespace LeoVK
         samplerCI.minLod = 0.0f;
         samplerCI.maxLod = 0.0f;
         samplerCI.maxAnisotropy = 1.0f;
-        VK_CHECK(vkCreateSampler(mpDevice->mLogicalDevice, &samplerCI, nullptr, &mSampler));
+        mSampler = mpDevice->AcquireSampler(samplerCI);
 
         // Create image view
         VkImageViewCreateInfo viewCreateInfo = {};
@@ -215,40 +208,18 @@ namespace LeoVK
 
         ktx_uint8_t *ktxTextureData = ktxTexture_GetData(ktxTex);
         ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTex);
-        
-        VkMemoryAllocateInfo memAllocInfo = LeoVK::Init::MemoryAllocateInfo();
-        VkMemoryRequirements memReqs;
 
         // Use a separate command buffer for texture loading
         VkCommandBuffer copyCmd = mpDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
         
         // Create a host-visible staging buffer that contains the raw image data
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingMemory;
-
-        VkBufferCreateInfo bufferCreateInfo = LeoVK::Init::BufferCreateInfo();
-        bufferCreateInfo.size = ktxTextureSize;
-        // This buffer is used as a transfer source for the buffer copy
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        VK_CHECK(vkCreateBuffer(mpDevice->mLogicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-        // Get memory requirements for the staging buffer (alignment, memory type bits)
-        vkGetBufferMemoryRequirements(mpDevice->mLogicalDevice, stagingBuffer, &memReqs);
-
-        memAllocInfo.allocationSize = memReqs.size;
-        // Get memory type index for a host visible buffer
-        memAllocInfo.memoryTypeIndex = mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        VK_CHECK(vkAllocateMemory(mpDevice->mLogicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-        VK_CHECK(vkBindBufferMemory(mpDevice->mLogicalDevice, stagingBuffer, stagingMemory, 0));
-
-        // Copy texture data into staging buffer
-        uint8_t *data;
-        VK_CHECK(vkMapMemory(mpDevice->mLogicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-        memcpy(data, ktxTextureData, ktxTextureSize);
-        vkUnmapMemory(mpDevice->mLogicalDevice, stagingMemory);
+        LeoVK::Buffer stagingBuffer;
+        VK_CHECK(mpDevice->CreateBuffer(
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &stagingBuffer,
+            ktxTextureSize,
+            ktxTextureData))
 
         // Setup buffer copy regions for each mip level
         std::vector<VkBufferImageCopy> bufferCopyRegions;
@@ -291,13 +262,7 @@ namespace LeoVK
         }
         VK_CHECK(vkCreateImage(mpDevice->mLogicalDevice, &imageCreateInfo, nullptr, &mImage));
 
-        vkGetImageMemoryRequirements(mpDevice->mLogicalDevice, mImage, &memReqs);
-
-        memAllocInfo.allocationSize = memReqs.size;
-
-        memAllocInfo.memoryTypeIndex = mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        VK_CHECK(vkAllocateMemory(mpDevice->mLogicalDevice, &memAllocInfo, nullptr, &mDeviceMemory));
-        VK_CHECK(vkBindImageMemory(mpDevice->mLogicalDevice, mImage, mDeviceMemory, 0));
+        VK_CHECK(mpDevice->AllocateImageMemory(mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Default, LeoVK::MemoryCategory::Texture, &mDeviceMemory));
 
         VkImageSubresourceRange subresourceRange = {};
         subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -317,7 +282,7 @@ namespace LeoVK
         // Copy mip levels from staging buffer
         vkCmdCopyBufferToImage(
             copyCmd,
-            stagingBuffer,
+            stagingBuffer.mBuffer,
             mImage,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             static_cast<uint32_t>(bufferCopyRegions.size()),
@@ -336,8 +301,7 @@ namespace LeoVK
         mpDevice->FlushCommandBuffer(copyCmd, copyQueue);
 
         // Clean up staging resources
-        vkFreeMemory(mpDevice->mLogicalDevice, stagingMemory, nullptr);
-        vkDestroyBuffer(mpDevice->mLogicalDevice, stagingBuffer, nullptr);
+        stagingBuffer.Destroy();
         
         
         ktxTexture_Destroy(ktxTex);
@@ -360,7 +324,7 @@ namespace LeoVK
         samplerCreateInfo.maxAnisotropy = mpDevice->mEnabledFeatures.samplerAnisotropy ? mpDevice->mProperties.limits.maxSamplerAnisotropy : 1.0f;
         samplerCreateInfo.anisotropyEnable = mpDevice->mEnabledFeatures.samplerAnisotropy;
         samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-        VK_CHECK(vkCreateSampler(mpDevice->mLogicalDevice, &samplerCreateInfo, nullptr, &mSampler));
+        mSampler = mpDevice->AcquireSampler(samplerCreateInfo);
 
         // Create image view
         // Textures are not directly accessed by the shaders and
@@ -403,36 +367,14 @@ namespace LeoVK
         ktx_uint8_t *ktxTextureData = ktxTexture_GetData(ktxTex);
         ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTex);
 
-        VkMemoryAllocateInfo memAllocInfo = LeoVK::Init::MemoryAllocateInfo();
-        VkMemoryRequirements memReqs;
-
         // Create a host-visible staging buffer that contains the raw image data
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingMemory;
-
-        VkBufferCreateInfo bufferCreateInfo = LeoVK::Init::BufferCreateInfo();
-        bufferCreateInfo.size = ktxTextureSize;
-        // This buffer is used as a transfer source for the buffer copy
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        VK_CHECK(vkCreateBuffer(mpDevice->mLogicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-        // Get memory requirements for the staging buffer (alignment, memory type bits)
-        vkGetBufferMemoryRequirements(mpDevice->mLogicalDevice, stagingBuffer, &memReqs);
-
-        memAllocInfo.allocationSize = memReqs.size;
-        // Get memory type index for a host visible buffer
-        memAllocInfo.memoryTypeIndex = mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        VK_CHECK(vkAllocateMemory(mpDevice->mLogicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-        VK_CHECK(vkBindBufferMemory(mpDevice->mLogicalDevice, stagingBuffer, stagingMemory, 0));
-
-        // Copy texture data into staging buffer
-        uint8_t *data;
-        VK_CHECK(vkMapMemory(mpDevice->mLogicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-        memcpy(data, ktxTextureData, ktxTextureSize);
-        vkUnmapMemory(mpDevice->mLogicalDevice, stagingMemory);
+        LeoVK::Buffer stagingBuffer;
+        VK_CHECK(mpDevice->CreateBuffer(
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &stagingBuffer,
+            ktxTextureSize,
+            ktxTextureData))
 
         // Setup buffer copy regions for each layer including all of its miplevels
         std::vector<VkBufferImageCopy> bufferCopyRegions;
@@ -479,13 +421,7 @@ namespace LeoVK
 
         VK_CHECK(vkCreateImage(mpDevice->mLogicalDevice, &imageCreateInfo, nullptr, &mImage));
 
-        vkGetImageMemoryRequirements(mpDevice->mLogicalDevice, mImage, &memReqs);
-
-        memAllocInfo.allocationSize = memReqs.size;
-        memAllocInfo.memoryTypeIndex = mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        VK_CHECK(vkAllocateMemory(mpDevice->mLogicalDevice, &memAllocInfo, nullptr, &mDeviceMemory));
-        VK_CHECK(vkBindImageMemory(mpDevice->mLogicalDevice, mImage, mDeviceMemory, 0));
+        VK_CHECK(mpDevice->AllocateImageMemory(mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Default, LeoVK::MemoryCategory::Texture, &mDeviceMemory));
 
         // Use a separate command buffer for texture loading
         VkCommandBuffer copyCmd = mpDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
@@ -508,7 +444,7 @@ namespace LeoVK
         // Copy the layers and mip levels from the staging buffer to the optimal tiled image
         vkCmdCopyBufferToImage(
             copyCmd,
-            stagingBuffer,
+            stagingBuffer.mBuffer,
             mImage,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             static_cast<uint32_t>(bufferCopyRegions.size()),
@@ -540,7 +476,7 @@ namespace LeoVK
         samplerCreateInfo.minLod = 0.0f;
         samplerCreateInfo.maxLod = (float)mMipLevels;
         samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-        VK_CHECK(vkCreateSampler(mpDevice->mLogicalDevice, &samplerCreateInfo, nullptr, &mSampler));
+        mSampler = mpDevice->AcquireSampler(samplerCreateInfo);
 
         // Create image view
         VkImageViewCreateInfo viewCreateInfo = LeoVK::Init::ImageViewCreateInfo();
@@ -554,8 +490,7 @@ namespace LeoVK
 
         // Clean up staging resources
         ktxTexture_Destroy(ktxTex);
-        vkFreeMemory(mpDevice->mLogicalDevice, stagingMemory, nullptr);
-        vkDestroyBuffer(mpDevice->mLogicalDevice, stagingBuffer, nullptr);
+        stagingBuffer.Destroy();
 
         // Update descriptor image info member that can be used for setting up descriptor sets
         UpdateDescriptor();
@@ -582,36 +517,14 @@ namespace LeoVK
         ktx_uint8_t *ktxTextureData = ktxTexture_GetData(ktxTex);
         ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTex);
 
-        VkMemoryAllocateInfo memAllocInfo = LeoVK::Init::MemoryAllocateInfo();
-        VkMemoryRequirements memReqs;
-
         // Create a host-visible staging buffer that contains the raw image data
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingMemory;
-
-        VkBufferCreateInfo bufferCreateInfo = LeoVK::Init::BufferCreateInfo();
-        bufferCreateInfo.size = ktxTextureSize;
-        // This buffer is used as a transfer source for the buffer copy
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        VK_CHECK(vkCreateBuffer(mpDevice->mLogicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-        // Get memory requirements for the staging buffer (alignment, memory type bits)
-        vkGetBufferMemoryRequirements(mpDevice->mLogicalDevice, stagingBuffer, &memReqs);
-
-        memAllocInfo.allocationSize = memReqs.size;
-        // Get memory type index for a host visible buffer
-        memAllocInfo.memoryTypeIndex = mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        VK_CHECK(vkAllocateMemory(mpDevice->mLogicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-        VK_CHECK(vkBindBufferMemory(mpDevice->mLogicalDevice, stagingBuffer, stagingMemory, 0));
-
-        // Copy texture data into staging buffer
-        uint8_t *data;
-        VK_CHECK(vkMapMemory(mpDevice->mLogicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-        memcpy(data, ktxTextureData, ktxTextureSize);
-        vkUnmapMemory(mpDevice->mLogicalDevice, stagingMemory);
+        LeoVK::Buffer stagingBuffer;
+        VK_CHECK(mpDevice->CreateBuffer(
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &stagingBuffer,
+            ktxTextureSize,
+            ktxTextureData))
 
         // Setup buffer copy regions for each face including all of its mip levels
         std::vector<VkBufferImageCopy> bufferCopyRegions;
@@ -661,13 +574,7 @@ namespace LeoVK
 
         VK_CHECK(vkCreateImage(mpDevice->mLogicalDevice, &imageCreateInfo, nullptr, &mImage));
 
-        vkGetImageMemoryRequirements(mpDevice->mLogicalDevice, mImage, &memReqs);
-
-        memAllocInfo.allocationSize = memReqs.size;
-        memAllocInfo.memoryTypeIndex = mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        VK_CHECK(vkAllocateMemory(mpDevice->mLogicalDevice, &memAllocInfo, nullptr, &mDeviceMemory));
-        VK_CHECK(vkBindImageMemory(mpDevice->mLogicalDevice, mImage, mDeviceMemory, 0));
+        VK_CHECK(mpDevice->AllocateImageMemory(mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Default, LeoVK::MemoryCategory::Texture, &mDeviceMemory));
 
         // Use a separate command buffer for texture loading
         VkCommandBuffer copyCmd = mpDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
@@ -690,7 +597,7 @@ namespace LeoVK
         // Copy the cube map faces from the staging buffer to the optimal tiled image
         vkCmdCopyBufferToImage(
             copyCmd,
-            stagingBuffer,
+            stagingBuffer.mBuffer,
             mImage,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             static_cast<uint32_t>(bufferCopyRegions.size()),
@@ -722,7 +629,7 @@ namespace LeoVK
         samplerCreateInfo.minLod = 0.0f;
         samplerCreateInfo.maxLod = (float)mMipLevels;
         samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-        VK_CHECK(vkCreateSampler(mpDevice->mLogicalDevice, &samplerCreateInfo, nullptr, &mSampler));
+        mSampler = mpDevice->AcquireSampler(samplerCreateInfo);
 
         // Create image view
         VkImageViewCreateInfo viewCreateInfo = LeoVK::Init::ImageViewCreateInfo();
@@ -736,8 +643,7 @@ namespace LeoVK
 
         // Clean up staging resources
         ktxTexture_Destroy(ktxTex);
-        vkFreeMemory(mpDevice->mLogicalDevice, stagingMemory, nullptr);
-        vkDestroyBuffer(mpDevice->mLogicalDevice, stagingBuffer, nullptr);
+        stagingBuffer.Destroy();
 
         // Update descriptor image info member that can be used for setting up descriptor sets
         UpdateDescriptor();
@@ -21,6 +21,8 @@ namespace LeoVK
     {
     public:
         void Destroy();
+        // 纹理可能还被正在执行的帧使用时，交给设备在帧结束后销毁
+        void DeferDestroy();
         void UpdateDescriptor();
         ktxResult LoadKTXFile(std::string filename, ktxTexture** target);
 
@@ -34,7 +36,7 @@ namespace LeoVK
         uint32_t              mMipLevels;
         uint32_t              mLayerCount;
         VkDescriptorImageInfo mDescriptor;
-        VkSampler             mSampler;
+        VkSampler             mSampler = VK_NULL_HANDLE;
     };
 
     class Texture2D : public Texture
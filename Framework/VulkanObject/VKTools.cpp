@@ -5,6 +5,15 @@ std::string GetAssetsPath()
     return VK_ASSETS_DIR;
 }
 
+std::string GetExecutablePath()
+{
+    char path[MAX_PATH];
+    const DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    if (length == 0 || length == MAX_PATH) return "";
+    const std::string exePath(path, length);
+    return exePath.substr(0, exePath.find_last_of("/\\") + 1);
+}
+
 namespace LeoVK::VKTools
 {
     bool bErrorModeSilent = false;
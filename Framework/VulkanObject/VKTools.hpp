@@ -36,6 +36,9 @@
 
 std::string GetAssetsPath();
 
+/** @brief Directory of the running executable with a trailing separator, used for on-disk caches */
+std::string GetExecutablePath();
+
 namespace LeoVK::VKTools
 {
     /** @brief Disable message boxes on fatal errors */
@@ -159,13 +159,7 @@ namespace LeoVK
         imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         VK_CHECK(vkCreateImage(mpDevice->mLogicalDevice, &imageCI, nullptr, &mFontImage))
 
-        VkMemoryRequirements memReqs;
-        vkGetImageMemoryRequirements(mpDevice->mLogicalDevice, mFontImage, &memReqs);
-        VkMemoryAllocateInfo memAllocInfo = LeoVK::Init::MemoryAllocateInfo();
-        memAllocInfo.allocationSize = memReqs.size;
-        memAllocInfo.memoryTypeIndex = mpDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        VK_CHECK(vkAllocateMemory(mpDevice->mLogicalDevice, &memAllocInfo, nullptr, &mFontMemory))
-        VK_CHECK(vkBindImageMemory(mpDevice->mLogicalDevice, mFontImage, mFontMemory, 0))
+        VK_CHECK(mpDevice->AllocateImageMemory(mFontImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Default, LeoVK::MemoryCategory::Texture, &mFontMemory))
 
         // Image view
         VkImageViewCreateInfo viewCI = LeoVK::Init::ImageViewCreateInfo();
@@ -240,7 +234,7 @@ namespace LeoVK
         samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
         samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
         samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-        VK_CHECK(vkCreateSampler(mpDevice->mLogicalDevice, &samplerInfo, nullptr, &mSampler))
+        mSampler = mpDevice->AcquireSampler(samplerInfo);
 
         // Descriptor pool
         std::vector<VkDescriptorPoolSize> poolSizes = {
@@ -379,8 +373,8 @@ namespace LeoVK
         mIndexBuffer.Destroy();
         vkDestroyImageView(mpDevice->mLogicalDevice, mFontView, nullptr);
         vkDestroyImage(mpDevice->mLogicalDevice, mFontImage, nullptr);
-        vkFreeMemory(mpDevice->mLogicalDevice, mFontMemory, nullptr);
-        vkDestroySampler(mpDevice->mLogicalDevice, mSampler, nullptr);
+        mpDevice->FreeImageMemory(mFontImage);
+        mpDevice->ReleaseSampler(mSampler);
         vkDestroyDescriptorSetLayout(mpDevice->mLogicalDevice, mDescSetLayout, nullptr);
         vkDestroyDescriptorPool(mpDevice->mLogicalDevice, mDescPool, nullptr);
         vkDestroyPipelineLayout(mpDevice->mLogicalDevice, mPipelineLayout, nullptr);
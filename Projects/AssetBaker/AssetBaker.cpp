@@ -0,0 +1,365 @@
+#include "AssetBaker.hpp"
+
+#include "Utilities/CmdLineParser.hpp"
+#include "Utilities/ThreadPool.hpp"
+#include "Utilities/KTX2Reader.hpp"
+
+#include <climits>
+#include <filesystem>
+#include <unordered_map>
+
+// 纹理在材质中的用途，决定压缩格式
+enum TextureUsageBits
+{
+    TEXTURE_USAGE_COLOR     = 0x1,  // sRGB编码
+    TEXTURE_USAGE_NORMAL    = 0x2,
+    TEXTURE_USAGE_OCCLUSION = 0x4,
+    TEXTURE_USAGE_DATA      = 0x8   // 金属度粗糙度等线性数据
+};
+
+// FNV-1a，只用于判断输入是否变化
+static void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+struct VertexHash
+{
+    size_t operator()(const LeoVK::Vertex& vertex) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        HashBytes(hash, &vertex, sizeof(vertex));
+        return static_cast<size_t>(hash);
+    }
+};
+
+// 按位比较，只合并完全相同的顶点
+struct VertexEqual
+{
+    bool operator()(const LeoVK::Vertex& a, const LeoVK::Vertex& b) const
+    {
+        return memcmp(&a, &b, sizeof(LeoVK::Vertex)) == 0;
+    }
+};
+
+// 解析时只保存编码后的图像（包括KTX2），参与哈希，需要烘焙时再解码
+static bool LoadImageDataEncoded(
+    tinygltf::Image* image, const int imageIndex, std::string* err, std::string* warn,
+    int reqWidth, int reqHeight, const unsigned char* bytes, int size, void* userData)
+{
+    image->image.assign(bytes, bytes + size);
+    image->as_is = true;
+    return true;
+}
+
+AssetBaker::AssetBaker(uint32_t loadingFlags, bool bForce, std::string outputDir) :
+    mLoadingFlags(loadingFlags & LeoVK::PACKAGE_GEOMETRY_FLAGS),
+    mbForce(bForce),
+    mOutputDir(std::move(outputDir))
+{
+}
+
+void AssetBaker::BakePath(const std::string& path)
+{
+    std::error_code ec;
+    if (!std::filesystem::is_directory(path, ec))
+    {
+        BakeFile(path);
+        return;
+    }
+
+    // 按路径排序，保证每次处理的顺序一致
+    std::vector<std::string> sources;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(path, ec))
+    {
+        if (!entry.is_regular_file()) continue;
+        const std::string extension = entry.path().extension().string();
+        if (extension == ".gltf" || extension == ".glb") sources.push_back(entry.path().string());
+    }
+    std::sort(sources.begin(), sources.end());
+    for (const auto& source : sources) BakeFile(source);
+}
+
+std::string AssetBaker::GetPackagePath(const std::string& source) const
+{
+    std::filesystem::path packagePath(source);
+    packagePath.replace_extension(".leopkg");
+    if (!mOutputDir.empty()) packagePath = std::filesystem::path(mOutputDir) / packagePath.filename();
+    return packagePath.string();
+}
+
+uint64_t AssetBaker::HashSource(const LeoVK::MappedFile& sourceFile, const tinygltf::Model& model) const
+{
+    // 源文件、引用的Buffer和编码后的图像、包的版本和加载标志共同决定包的内容
+    uint64_t hash = 14695981039346656037ull;
+    const uint32_t version = ASSET_PACKAGE_VERSION;
+    HashBytes(hash, &version, sizeof(version));
+    HashBytes(hash, &mLoadingFlags, sizeof(mLoadingFlags));
+    HashBytes(hash, sourceFile.Data(), sourceFile.Size());
+    for (const auto& buffer : model.buffers) HashBytes(hash, buffer.data.data(), buffer.data.size());
+    for (const auto& image : model.images) HashBytes(hash, image.image.data(), image.image.size());
+    return hash;
+}
+
+void AssetBaker::BuildGeometry(tinygltf::Model& model, LeoVK::PackageContents& contents) const
+{
+    // 使用与运行时相同的路径生成最终的顶点，包括缺失的法线和切线
+    LeoVK::GLTFScene scene;
+    std::vector<LeoVK::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    scene.LoadGeometry(model, mLoadingFlags, 1.0f, vertices, indices);
+
+    // 预变换或翻转Y之后顶点不在模型空间，保留与运行时一致的Accessor包围盒
+    const bool bLocalPositions = !(mLoadingFlags & (LeoVK::FileLoadingFlags::PreTransformVertices | LeoVK::FileLoadingFlags::FlipY));
+
+    // mLinearNodes的顺序就是LoadNode处理Mesh的顺序，加载时按同样的顺序对应
+    std::unordered_map<LeoVK::Vertex, uint32_t, VertexHash, VertexEqual> uniqueVertices;
+    for (LeoVK::Node* node : scene.mLinearNodes)
+    {
+        if (!node->mpMesh) continue;
+        for (LeoVK::Primitive* primitive : node->mpMesh->mPrimitives)
+        {
+            LeoVK::PackagePrimitive packed{};
+            packed.mFirstIndex = static_cast<uint32_t>(contents.mIndices.size());
+            packed.mFirstVertex = static_cast<uint32_t>(contents.mVertices.size());
+            packed.mMin = glm::vec3(FLT_MAX);
+            packed.mMax = glm::vec3(-FLT_MAX);
+
+            // 没有索引的Primitive也生成索引，顶点按首次使用的顺序排列
+            uniqueVertices.clear();
+            const uint32_t cornerCount = primitive->mbHasIndices ? primitive->mIndexCount : primitive->mVertexCount;
+            for (uint32_t corner = 0; corner < cornerCount; corner++)
+            {
+                uint32_t source = primitive->mbHasIndices ? indices[primitive->mFirstIndex + corner] : primitive->mFirstVertex + corner;
+                if (source >= vertices.size()) source = primitive->mFirstVertex;
+                const LeoVK::Vertex& vertex = vertices[source];
+                auto it = uniqueVertices.find(vertex);
+                uint32_t index;
+                if (it == uniqueVertices.end())
+                {
+                    index = static_cast<uint32_t>(contents.mVertices.size());
+                    uniqueVertices.emplace(vertex, index);
+                    contents.mVertices.push_back(vertex);
+                    packed.mMin = glm::min(packed.mMin, vertex.mPos);
+                    packed.mMax = glm::max(packed.mMax, vertex.mPos);
+                }
+                else
+                {
+                    index = it->second;
+                }
+                contents.mIndices.push_back(index);
+            }
+
+            packed.mIndexCount = static_cast<uint32_t>(contents.mIndices.size()) - packed.mFirstIndex;
+            packed.mVertexCount = static_cast<uint32_t>(contents.mVertices.size()) - packed.mFirstVertex;
+            if (!bLocalPositions || packed.mVertexCount == 0)
+            {
+                packed.mMin = primitive->mBBox.mMin;
+                packed.mMax = primitive->mBBox.mMax;
+            }
+            contents.mPrimitives.push_back(packed);
+        }
+    }
+    std::cout << "  Geometry: " << contents.mPrimitives.size() << " primitives, " << vertices.size() << " -> " << contents.mVertices.size()
+        << " vertices, " << contents.mIndices.size() << " indices" << std::endl;
+
+    scene.Destroy(VK_NULL_HANDLE);
+}
+
+void AssetBaker::BuildTextures(tinygltf::Model& model, LeoVK::PackageContents& contents) const
+{
+    const size_t textureCount = model.textures.size();
+    contents.mTextures.resize(textureCount);
+    if (textureCount == 0) return;
+
+    std::vector<uint32_t> usages(textureCount, 0);
+    auto markTexture = [&usages, textureCount](int index, uint32_t usage) {
+        if (index >= 0 && index < (int)textureCount) usages[index] |= usage;
+    };
+    for (tinygltf::Material& mat : model.materials)
+    {
+        if (mat.values.find("baseColorTexture") != mat.values.end()) markTexture(mat.values["baseColorTexture"].TextureIndex(), TEXTURE_USAGE_COLOR);
+        if (mat.values.find("metallicRoughnessTexture") != mat.values.end()) markTexture(mat.values["metallicRoughnessTexture"].TextureIndex(), TEXTURE_USAGE_DATA);
+        if (mat.additionalValues.find("emissiveTexture") != mat.additionalValues.end()) markTexture(mat.additionalValues["emissiveTexture"].TextureIndex(), TEXTURE_USAGE_COLOR);
+        if (mat.additionalValues.find("normalTexture") != mat.additionalValues.end()) markTexture(mat.additionalValues["normalTexture"].TextureIndex(), TEXTURE_USAGE_NORMAL);
+        if (mat.additionalValues.find("occlusionTexture") != mat.additionalValues.end()) markTexture(mat.additionalValues["occlusionTexture"].TextureIndex(), TEXTURE_USAGE_OCCLUSION);
+        auto ext = mat.extensions.find("KHR_materials_pbrSpecularGlossiness");
+        if (ext != mat.extensions.end())
+        {
+            if (ext->second.Has("diffuseTexture")) markTexture(ext->second.Get("diffuseTexture").Get("index").Get<int>(), TEXTURE_USAGE_COLOR);
+            if (ext->second.Has("specularGlossinessTexture")) markTexture(ext->second.Get("specularGlossinessTexture").Get("index").Get<int>(), TEXTURE_USAGE_COLOR);
+        }
+    }
+
+    LeoVK::ThreadPool threadPool;
+    threadPool.SetThreadCount(std::max(1u, std::thread::hardware_concurrency()));
+    uint32_t nextThread = 0;
+
+    // 先并行解码所有图像，多个纹理可能共用同一个图像
+    std::vector<tinygltf::Image> decodedImages(model.images.size());
+    for (size_t imageIndex = 0; imageIndex < model.images.size(); imageIndex++)
+    {
+        const tinygltf::Image* encoded = &model.images[imageIndex];
+        if (encoded->image.empty() || LeoVK::KTX2Reader::IsKTX2(encoded->image.data(), encoded->image.size())) continue;
+        tinygltf::Image* image = &decodedImages[imageIndex];
+        threadPool.mThreads[nextThread++ % threadPool.mThreads.size()]->AddJob([encoded, image, imageIndex]() {
+            std::string err, warn;
+            if (!tinygltf::LoadImageData(image, static_cast<int>(imageIndex), &err, &warn, 0, 0, encoded->image.data(), static_cast<int>(encoded->image.size()), nullptr))
+            {
+                std::cout << "  Failed to decode image " << imageIndex << ": " << err << std::endl;
+                image->image.clear();
+                return;
+            }
+            // 16位图像只保留高8位
+            if (image->bits == 16)
+            {
+                for (size_t i = 0; i < image->image.size() / 2; i++) image->image[i] = image->image[i * 2 + 1];
+                image->image.resize(image->image.size() / 2);
+                image->bits = 8;
+            }
+        });
+    }
+    threadPool.Wait();
+
+    // 法线贴图只保留XY用BC5，只作为AO使用的单通道贴图用BC4，其余都用BC7
+    // KTX2中的BC/RGBA8数据直接写入包，KHR_texture_basisu的source优先；Basis Universal数据没有转码器
+    auto getKTX2Format = [&model](int imageIndex)
+    {
+        if (imageIndex < 0 || imageIndex >= (int)model.images.size()) return VK_FORMAT_UNDEFINED;
+        return LeoVK::KTX2Reader::GetFormat(model.images[imageIndex].image.data(), model.images[imageIndex].image.size());
+    };
+    for (size_t texIndex = 0; texIndex < textureCount; texIndex++)
+    {
+        const tinygltf::Texture& tex = model.textures[texIndex];
+        const auto basisu = tex.extensions.find("KHR_texture_basisu");
+        const int basisSource = basisu != tex.extensions.end() && basisu->second.Has("source") ? basisu->second.Get("source").GetNumberAsInt() : -1;
+        const int ktx2Source = getKTX2Format(basisSource) != VK_FORMAT_UNDEFINED ? basisSource : getKTX2Format(tex.source) != VK_FORMAT_UNDEFINED ? tex.source : -1;
+        if (ktx2Source >= 0)
+        {
+            const tinygltf::Image* encoded = &model.images[ktx2Source];
+            LeoVK::CompressedImage* compressed = &contents.mTextures[texIndex];
+            threadPool.mThreads[nextThread++ % threadPool.mThreads.size()]->AddJob([encoded, compressed, texIndex]() {
+                std::string err;
+                if (!LeoVK::KTX2Reader::Read(encoded->image.data(), encoded->image.size(), *compressed, &err))
+                {
+                    std::cout << "  Failed to read the KTX2 image of texture " << texIndex << ": " << err << std::endl;
+                }
+            });
+            continue;
+        }
+
+        const int source = tex.source;
+        if (source < 0 || source >= (int)decodedImages.size() || decodedImages[source].image.empty() || decodedImages[source].bits != 8)
+        {
+            std::cout << "  Texture " << texIndex << " has no decodable image, the renderer will use a placeholder" << std::endl;
+            continue;
+        }
+        const tinygltf::Image* image = &decodedImages[source];
+        const uint32_t usage = usages[texIndex];
+        const VkFormat format = usage == TEXTURE_USAGE_NORMAL ? VK_FORMAT_BC5_UNORM_BLOCK :
+            usage == TEXTURE_USAGE_OCCLUSION ? VK_FORMAT_BC4_UNORM_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+        const bool bSRGB = usage & TEXTURE_USAGE_COLOR;
+        LeoVK::CompressedImage* compressed = &contents.mTextures[texIndex];
+        threadPool.mThreads[nextThread++ % threadPool.mThreads.size()]->AddJob([image, format, bSRGB, compressed]() {
+            LeoVK::TextureCompressor::CompressToFormat(image->image.data(), image->component, image->width, image->height, bSRGB, format, *compressed);
+        });
+    }
+    threadPool.Wait();
+
+    size_t textureBytes = 0;
+    for (const auto& texture : contents.mTextures) textureBytes += texture.mData.size();
+    std::cout << "  Textures: " << textureCount << " compressed on " << threadPool.mThreads.size() << " threads, "
+        << (float)textureBytes / (1024.0f * 1024.0f) << " MB" << std::endl;
+}
+
+bool AssetBaker::BakeFile(const std::string& source)
+{
+    auto tStart = std::chrono::high_resolution_clock::now();
+    const std::string packagePath = GetPackagePath(source);
+    std::cout << "Baking " << source << " -> " << packagePath << std::endl;
+    auto fail = [this, &source](const std::string& error) {
+        std::cerr << "Could not bake " << source << ": " << error << std::endl;
+        mStats.mFailed++;
+        return false;
+    };
+
+    LeoVK::MappedFile sourceFile;
+    std::string error, warning;
+    if (!sourceFile.Open(source, &error)) return fail(error);
+    if (sourceFile.Size() > UINT_MAX) return fail("the file is larger than 4 GB, which tinygltf cannot parse");
+
+    tinygltf::Model model;
+    tinygltf::TinyGLTF gltfContext;
+    gltfContext.SetImageLoader(LoadImageDataEncoded, nullptr);
+    const std::filesystem::path sourcePath(source);
+    const std::string baseDir = sourcePath.parent_path().string();
+    const bool bLoaded = sourcePath.extension() == ".glb" ?
+        gltfContext.LoadBinaryFromMemory(&model, &error, &warning, sourceFile.Data(), static_cast<unsigned int>(sourceFile.Size()), baseDir) :
+        gltfContext.LoadASCIIFromString(&model, &error, &warning, reinterpret_cast<const char*>(sourceFile.Data()), static_cast<unsigned int>(sourceFile.Size()), baseDir);
+    if (!bLoaded) return fail(error);
+    if (model.scenes.empty()) return fail("no scene to bake");
+
+    // 内容没有变化时跳过
+    LeoVK::PackageContents contents;
+    contents.mSourceHash = HashSource(sourceFile, model);
+    contents.mSourceStamp = LeoVK::GetSourceStamp(source, model);
+    contents.mLoadingFlags = mLoadingFlags;
+    sourceFile.Close();
+    if (!mbForce)
+    {
+        LeoVK::AssetPackage existing;
+        if (existing.Open(packagePath) && existing.mHeader.mSourceHash == contents.mSourceHash && existing.mHeader.mSourceStamp == contents.mSourceStamp)
+        {
+            std::cout << "  Up to date" << std::endl;
+            mStats.mUpToDate++;
+            return true;
+        }
+    }
+
+    // 源文件按相对包的路径记录，包和源文件可以一起移动
+    std::error_code ec;
+    const std::filesystem::path packageDir = std::filesystem::absolute(packagePath, ec).parent_path();
+    std::filesystem::path relativeSource = std::filesystem::absolute(sourcePath, ec).lexically_relative(packageDir);
+    contents.mSourcePath = (relativeSource.empty() ? std::filesystem::absolute(sourcePath, ec) : relativeSource).generic_string();
+
+    BuildGeometry(model, contents);
+    if (contents.mVertices.empty()) return fail("no geometry to bake");
+    BuildTextures(model, contents);
+
+    if (!LeoVK::WriteAssetPackage(packagePath, contents, &error)) return fail(error);
+    mStats.mBaked++;
+    std::cout << "  Baked in " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count() << " ms" << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    CmdLineParser cmdLineParser;
+    cmdLineParser.Add("help", { "--help" }, 0, "Show help");
+    cmdLineParser.Add("input", { "-i", "--input" }, 1, "glTF file to bake, or a directory that is searched recursively for .gltf and .glb files");
+    cmdLineParser.Add("output", { "-o", "--output" }, 1, "Directory to write the packages to (default: next to each source file)");
+    cmdLineParser.Add("force", { "-f", "--force" }, 0, "Rebake packages even if their content hash is up to date");
+    cmdLineParser.Add("smoothNormals", { "-sn", "--smoothNormals" }, 0, "Generate smooth instead of flat normals, the renderer has to run with --smoothNormals as well");
+    cmdLineParser.Parse(argc, argv);
+    if (cmdLineParser.IsSet("help") || !cmdLineParser.IsSet("input"))
+    {
+        cmdLineParser.PrintHelp();
+        std::cout << std::endl;
+        return cmdLineParser.IsSet("help") ? 0 : 1;
+    }
+
+    uint32_t loadingFlags = LeoVK::FileLoadingFlags::None;
+    if (cmdLineParser.IsSet("smoothNormals")) loadingFlags |= LeoVK::FileLoadingFlags::SmoothNormals;
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+    AssetBaker baker(loadingFlags, cmdLineParser.IsSet("force"), cmdLineParser.GetValueAsString("output", ""));
+    baker.BakePath(cmdLineParser.GetValueAsString("input", ""));
+    std::cout << baker.mStats.mBaked << " baked, " << baker.mStats.mUpToDate << " up to date, " << baker.mStats.mFailed << " failed in "
+        << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count() << " ms" << std::endl;
+    return baker.mStats.mFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ProjectPCH.hpp"
+
+#include "Utilities/AssetsLoader.hpp"
+#include "Utilities/AssetPackage.hpp"
+
+/**
+ * @brief 离线把glTF烘焙为渲染器直接拷贝的.leopkg，不需要GPU
+ * @note 顶点去重后按首次使用的顺序重新编号，纹理在CPU上生成完整Mip链后压缩为BC7/BC5/BC4
+ */
+class AssetBaker
+{
+public:
+    struct BakeStats
+    {
+        uint32_t mBaked = 0;
+        uint32_t mUpToDate = 0;
+        uint32_t mFailed = 0;
+    };
+
+    AssetBaker(uint32_t loadingFlags, bool bForce, std::string outputDir);
+
+    // 单个文件，或者递归处理目录下所有的.gltf和.glb
+    void BakePath(const std::string& path);
+
+public:
+    BakeStats mStats;
+
+private:
+    bool BakeFile(const std::string& source);
+    std::string GetPackagePath(const std::string& source) const;
+    uint64_t HashSource(const LeoVK::MappedFile& sourceFile, const tinygltf::Model& model) const;
+    void BuildGeometry(tinygltf::Model& model, LeoVK::PackageContents& contents) const;
+    void BuildTextures(tinygltf::Model& model, LeoVK::PackageContents& contents) const;
+
+private:
+    uint32_t    mLoadingFlags;
+    bool        mbForce;
+    std::string mOutputDir;
+};
@@ -0,0 +1,221 @@
+#include "VulkanRenderer.hpp"
+
+#include <random>
+
+// 光照强度低于该值时认为光源已经没有贡献，用于估算没有指定范围的光源
+#define LIGHT_CUTOFF 0.005f
+// 更近的像素都归入第一层深度切片
+#define CLUSTER_NEAR 0.05f
+
+void VulkanRenderer::PrepareLightBuffers()
+{
+    ClusteredLighting& lighting = mClusteredLighting;
+    VK_CHECK(mpVulkanDevice->CreateBuffer(
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &lighting.mLightBuffer,
+        MAX_SCENE_LIGHTS * sizeof(ShaderLight)))
+    VK_CHECK(mpVulkanDevice->CreateBuffer(
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &lighting.mClusterBuffer,
+        CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z * (MAX_LIGHTS_PER_CLUSTER + 1) * sizeof(uint32_t)))
+    VK_CHECK(mpVulkanDevice->CreateBuffer(
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &lighting.mParamsUBO,
+        sizeof(UBOCluster)))
+
+    VK_CHECK(lighting.mLightBuffer.Map())
+    VK_CHECK(lighting.mParamsUBO.Map())
+    // 光源数量为0时Shader不会读取分簇数据，这里只需要保证缓冲有效
+    memset(lighting.mLightBuffer.mpMapped, 0, MAX_SCENE_LIGHTS * sizeof(ShaderLight));
+
+    GenerateSyntheticLights(static_cast<uint32_t>(mSyntheticLightCount));
+}
+
+void VulkanRenderer::PrepareLightCulling()
+{
+    ClusteredLighting& lighting = mClusteredLighting;
+
+    // 与场景Set 0的5~7号绑定一致，Shader可以共用同一份声明
+    std::vector<VkDescriptorSetLayoutBinding> cullSetLayoutBindings = {
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 5),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 6),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 7),
+    };
+    VkDescriptorSetLayoutCreateInfo cullDescSetLayoutCI = LeoVK::Init::DescSetLayoutCreateInfo(cullSetLayoutBindings);
+    VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &cullDescSetLayoutCI, nullptr, &lighting.mCullDescSetLayout))
+
+    std::vector<VkDescriptorPoolSize> poolSize = {
+        LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2),
+        LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
+    };
+    VkDescriptorPoolCreateInfo descPoolCI = LeoVK::Init::DescPoolCreateInfo(poolSize, 1);
+    VK_CHECK(vkCreateDescriptorPool(mDevice, &descPoolCI, nullptr, &lighting.mDescPool))
+
+    VkDescriptorSetAllocateInfo cullSetAI = LeoVK::Init::DescSetAllocateInfo(lighting.mDescPool, &lighting.mCullDescSetLayout, 1);
+    VK_CHECK(vkAllocateDescriptorSets(mDevice, &cullSetAI, &lighting.mCullDescSet))
+    std::vector<VkWriteDescriptorSet> writeDescSets = {
+        LeoVK::Init::WriteDescriptorSet(lighting.mCullDescSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &lighting.mLightBuffer.mDescriptor),
+        LeoVK::Init::WriteDescriptorSet(lighting.mCullDescSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6, &lighting.mClusterBuffer.mDescriptor),
+        LeoVK::Init::WriteDescriptorSet(lighting.mCullDescSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 7, &lighting.mParamsUBO.mDescriptor),
+    };
+    vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writeDescSets.size()), writeDescSets.data(), 0, nullptr);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCI = LeoVK::Init::PipelineLayoutCreateInfo(&lighting.mCullDescSetLayout, 1);
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &pipelineLayoutCI, nullptr, &lighting.mCullPipelineLayout))
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+    VkComputePipelineCreateInfo computePipelineCI = LeoVK::Init::ComputePipelineCreateInfo(lighting.mCullPipelineLayout);
+    computePipelineCI.stage = LoadShader(GetShadersPath() + "VulkanRenderer/LightCulling.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+    VK_CHECK(vkCreateComputePipelines(mDevice, mPipelineCache, 1, &computePipelineCI, nullptr, &lighting.mCullPipeline))
+    auto tPipeline = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    std::cout << "Creating light culling pipeline took " << tPipeline << " ms" << std::endl;
+    std::cout << "Clustered lighting: " << CLUSTER_GRID_X << "x" << CLUSTER_GRID_Y << "x" << CLUSTER_GRID_Z << " clusters, "
+              << lighting.mSyntheticLights.size() << " synthetic lights, " << (lighting.mbClustered ? "clustered" : "brute force") << std::endl;
+}
+
+void VulkanRenderer::GenerateSyntheticLights(uint32_t count)
+{
+    // 固定种子，保证每次测试的光源分布相同
+    std::mt19937 generator(1337);
+    std::uniform_real_distribution<float> posDist(-0.1f, 1.1f);
+    std::uniform_real_distribution<float> colorDist(0.2f, 1.0f);
+    std::uniform_real_distribution<float> rangeDist(0.05f, 0.15f);
+
+    ClusteredLighting& lighting = mClusteredLighting;
+    lighting.mSyntheticLights.resize(count);
+    for (auto& light : lighting.mSyntheticLights)
+    {
+        light.mPosition = glm::vec3(posDist(generator), posDist(generator), posDist(generator));
+        light.mColor = glm::vec3(colorDist(generator), colorDist(generator), colorDist(generator));
+        light.mRange = rangeDist(generator);
+    }
+}
+
+void VulkanRenderer::UpdateLights()
+{
+    ClusteredLighting& lighting = mClusteredLighting;
+    if (lighting.mLightBuffer.mBuffer == VK_NULL_HANDLE) return;
+
+    // 渲染空间与顶点着色器一致：场景的缩放平移之后翻转Y
+    const glm::mat4& model = mSceneUBOMatrices.mModel;
+    const float sceneScale = model[0][0];
+    const glm::vec3 flipY = glm::vec3(1.0f, -1.0f, 1.0f);
+
+    lighting.mLights.clear();
+    std::vector<ShaderLight> localLights;
+    for (auto& light : mScenes.mRenderScene.mLights)
+    {
+        const glm::mat4 world = model * (light.mpNode ? light.mpNode->GetMatrix() : glm::mat4(1.0f));
+        ShaderLight shaderLight{};
+        // glTF中光源朝向本地-Z
+        shaderLight.mDirType = glm::vec4(glm::normalize(glm::mat3(world) * glm::vec3(0.0f, 0.0f, -1.0f)) * flipY, static_cast<float>(light.mType));
+        if (light.mType == LeoVK::Light::DIRECTIONAL)
+        {
+            shaderLight.mColorIntensity = glm::vec4(light.mColor, light.mIntensity);
+            lighting.mLights.push_back(shaderLight);
+            continue;
+        }
+
+        // 点光源按距离平方衰减，场景缩放后强度也要按缩放的平方调整
+        const float intensity = light.mIntensity * sceneScale * sceneScale;
+        const float maxColor = std::max(light.mColor.r, std::max(light.mColor.g, light.mColor.b));
+        const float range = light.mRange > 0.0f ? light.mRange * sceneScale : std::sqrt(intensity * maxColor / LIGHT_CUTOFF);
+        shaderLight.mPosRange = glm::vec4(glm::vec3(world[3]) * flipY, range);
+        shaderLight.mColorIntensity = glm::vec4(light.mColor, intensity);
+        if (light.mType == LeoVK::Light::SPOT)
+        {
+            const float cosOuter = std::cos(light.mOuterConeAngle);
+            const float spotScale = 1.0f / std::max(0.001f, std::cos(light.mInnerConeAngle) - cosOuter);
+            shaderLight.mSpotParams = glm::vec4(spotScale, -cosOuter * spotScale, 0.0f, 0.0f);
+        }
+        localLights.push_back(shaderLight);
+    }
+    lighting.mDirectionalCount = static_cast<uint32_t>(lighting.mLights.size());
+    lighting.mSceneLightCount = static_cast<uint32_t>(mScenes.mRenderScene.mLights.size());
+
+    // 压力测试光源分布在场景包围盒内
+    const glm::vec3 sceneMin = glm::vec3(mScenes.mRenderScene.mAABB[3]);
+    const glm::vec3 sceneSize = glm::vec3(mScenes.mRenderScene.mAABB[0][0], mScenes.mRenderScene.mAABB[1][1], mScenes.mRenderScene.mAABB[2][2]);
+    const float sceneExtent = std::max(sceneSize.x, std::max(sceneSize.y, sceneSize.z)) * sceneScale;
+    for (auto& light : lighting.mSyntheticLights)
+    {
+        const glm::vec3 position = glm::vec3(model * glm::vec4(sceneMin + light.mPosition * sceneSize, 1.0f)) * flipY;
+        const float range = light.mRange * sceneExtent;
+        ShaderLight shaderLight{};
+        shaderLight.mPosRange = glm::vec4(position, range);
+        // 在一半范围处的辐照度约为1
+        shaderLight.mColorIntensity = glm::vec4(light.mColor, range * range * 0.25f);
+        shaderLight.mDirType = glm::vec4(0.0f, -1.0f, 0.0f, static_cast<float>(LeoVK::Light::POINT));
+        localLights.push_back(shaderLight);
+    }
+
+    lighting.mLights.insert(lighting.mLights.end(), localLights.begin(), localLights.end());
+    if (lighting.mLights.size() > MAX_SCENE_LIGHTS)
+    {
+        lighting.mLights.resize(MAX_SCENE_LIGHTS);
+        lighting.mDirectionalCount = std::min(lighting.mDirectionalCount, (uint32_t)MAX_SCENE_LIGHTS);
+    }
+    if (!lighting.mLights.empty())
+    {
+        memcpy(lighting.mLightBuffer.mpMapped, lighting.mLights.data(), lighting.mLights.size() * sizeof(ShaderLight));
+    }
+    UpdateClusterParams();
+}
+
+void VulkanRenderer::UpdateClusterParams()
+{
+    ClusteredLighting& lighting = mClusteredLighting;
+    if (lighting.mParamsUBO.mBuffer == VK_NULL_HANDLE) return;
+
+    UBOCluster& params = lighting.mParams;
+    params.mInvProj = glm::inverse(mCamera.mMatrices.mPerspective);
+    params.mView = mCamera.mMatrices.mView;
+    const VkExtent2D renderExtent = GetRenderExtent();
+    params.mScreenSize = glm::vec4((float)renderExtent.width, (float)renderExtent.height, 1.0f / (float)renderExtent.width, 1.0f / (float)renderExtent.height);
+    // 切片下标 = log(深度) * scale + bias
+    const float zNear = std::max(mCamera.GetNearClip(), CLUSTER_NEAR);
+    const float zFar = mCamera.GetFarClip();
+    const float logRatio = std::log(zFar / zNear);
+    params.mDepthParams = glm::vec4(zNear, zFar, (float)CLUSTER_GRID_Z / logRatio, -(float)CLUSTER_GRID_Z * std::log(zNear) / logRatio);
+    params.mGridSize = glm::uvec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, 0);
+    params.mLightCounts = glm::uvec4(static_cast<uint32_t>(lighting.mLights.size()), lighting.mDirectionalCount, lighting.mbClustered ? 1 : 0, 0);
+    memcpy(lighting.mParamsUBO.mpMapped, &params, sizeof(UBOCluster));
+}
+
+void VulkanRenderer::DispatchLightCulling(uint32_t cbIndex)
+{
+    ClusteredLighting& lighting = mClusteredLighting;
+    if (!lighting.mbClustered || lighting.mCullPipeline == VK_NULL_HANDLE) return;
+
+    // 每个线程处理一个分簇
+    const uint32_t clusterCount = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+    vkCmdBindPipeline(mDrawCmdBuffers[cbIndex], VK_PIPELINE_BIND_POINT_COMPUTE, lighting.mCullPipeline);
+    vkCmdBindDescriptorSets(mDrawCmdBuffers[cbIndex], VK_PIPELINE_BIND_POINT_COMPUTE, lighting.mCullPipelineLayout, 0, 1, &lighting.mCullDescSet, 0, nullptr);
+    vkCmdDispatch(mDrawCmdBuffers[cbIndex], (clusterCount + 63) / 64, 1, 1);
+
+    VkBufferMemoryBarrier bufferBarrier = LeoVK::Init::BufferMemoryBarrier();
+    bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    bufferBarrier.buffer = lighting.mClusterBuffer.mBuffer;
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(
+        mDrawCmdBuffers[cbIndex],
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+}
+
+void VulkanRenderer::DestroyClusteredLighting()
+{
+    ClusteredLighting& lighting = mClusteredLighting;
+    if (lighting.mCullPipeline != VK_NULL_HANDLE) vkDestroyPipeline(mDevice, lighting.mCullPipeline, nullptr);
+    if (lighting.mCullPipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(mDevice, lighting.mCullPipelineLayout, nullptr);
+    if (lighting.mCullDescSetLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(mDevice, lighting.mCullDescSetLayout, nullptr);
+    if (lighting.mDescPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(mDevice, lighting.mDescPool, nullptr);
+    if (lighting.mLightBuffer.mBuffer != VK_NULL_HANDLE) lighting.mLightBuffer.Destroy();
+    if (lighting.mClusterBuffer.mBuffer != VK_NULL_HANDLE) lighting.mClusterBuffer.Destroy();
+    if (lighting.mParamsUBO.mBuffer != VK_NULL_HANDLE) lighting.mParamsUBO.Destroy();
+}
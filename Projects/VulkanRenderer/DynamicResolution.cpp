@@ -0,0 +1,185 @@
+#include "VulkanRenderer.hpp"
+
+// 超出预算5%计为超时，低于预算75%计为有余量
+#define GOVERNOR_OVER_BUDGET 1.05f
+#define GOVERNOR_UNDER_BUDGET 0.75f
+// 连续超时或有余量的帧数达到后才调整，降级比升级更快
+#define GOVERNOR_DOWNGRADE_FRAMES 30
+#define GOVERNOR_UPGRADE_FRAMES 120
+// 调整后等待新的帧时间稳定
+#define GOVERNOR_COOLDOWN_FRAMES 60
+
+VkExtent2D VulkanRenderer::GetRenderExtent() const
+{
+    const DynamicResolution& dynRes = mDynamicResolution;
+    if (!dynRes.mbEnabled || dynRes.mScale >= 1.0f) return { mWidth, mHeight };
+    return {
+        std::max(1u, static_cast<uint32_t>((float)mWidth * dynRes.mScale)),
+        std::max(1u, static_cast<uint32_t>((float)mHeight * dynRes.mScale))
+    };
+}
+
+void VulkanRenderer::PrepareDynamicResolution()
+{
+    DynamicResolution& dynRes = mDynamicResolution;
+
+    // MSAA只在启动设置以下调整，并且需要设备同时支持颜色和深度
+    const VkSampleCountFlags supportedCounts = mDeviceProps.limits.framebufferColorSampleCounts & mDeviceProps.limits.framebufferDepthSampleCounts;
+    for (VkSampleCountFlagBits sampleCount : { VK_SAMPLE_COUNT_1_BIT, VK_SAMPLE_COUNT_2_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_8_BIT })
+    {
+        if (sampleCount > mSettings.sampleCount) break;
+        if (supportedCounts & sampleCount) dynRes.mSampleCounts.push_back(sampleCount);
+    }
+
+    if (mDeviceProps.limits.timestampComputeAndGraphics)
+    {
+        VkQueryPoolCreateInfo queryPoolCI{};
+        queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolCI.queryCount = static_cast<uint32_t>(mDrawCmdBuffers.size()) * 2;
+        VK_CHECK(vkCreateQueryPool(mDevice, &queryPoolCI, nullptr, &dynRes.mQueryPool))
+    }
+}
+
+void VulkanRenderer::UpdateQualityGovernor()
+{
+    DynamicResolution& dynRes = mDynamicResolution;
+
+    // 不支持时间戳时退回到CPU帧时间，SubmitFrame会等待GPU完成，两者接近
+    float frameMs = mFrameTimer * 1000.0f;
+    if (dynRes.mQueryPool != VK_NULL_HANDLE)
+    {
+        uint64_t timestamps[2] = {};
+        VkResult result = vkGetQueryPoolResults(
+            mDevice, dynRes.mQueryPool, mCurrentBuffer * 2, 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS)
+        {
+            frameMs = (float)(timestamps[1] - timestamps[0]) * mDeviceProps.limits.timestampPeriod / 1000000.0f;
+        }
+    }
+    dynRes.mGPUTimeMs = dynRes.mGPUTimeMs == 0.0f ? frameMs : dynRes.mGPUTimeMs * 0.9f + frameMs * 0.1f;
+
+    if (!dynRes.mbEnabled) return;
+    if (dynRes.mCooldownFrames > 0)
+    {
+        dynRes.mCooldownFrames--;
+        return;
+    }
+
+    if (dynRes.mGPUTimeMs > dynRes.mTargetMs * GOVERNOR_OVER_BUDGET)
+    {
+        dynRes.mOverBudgetFrames++;
+        dynRes.mUnderBudgetFrames = 0;
+    }
+    else if (dynRes.mGPUTimeMs < dynRes.mTargetMs * GOVERNOR_UNDER_BUDGET)
+    {
+        dynRes.mUnderBudgetFrames++;
+        dynRes.mOverBudgetFrames = 0;
+    }
+    else
+    {
+        dynRes.mOverBudgetFrames = 0;
+        dynRes.mUnderBudgetFrames = 0;
+    }
+
+    auto sampleIt = std::find(dynRes.mSampleCounts.begin(), dynRes.mSampleCounts.end(), mSettings.sampleCount);
+    const size_t sampleIndex = sampleIt == dynRes.mSampleCounts.end() ? 0 : std::distance(dynRes.mSampleCounts.begin(), sampleIt);
+    // Visibility Buffer只有单采样，开启时只调整分辨率
+    const bool bCanAdjustMSAA = dynRes.mbAdjustMSAA && !mbVisibilityBuffer && sampleIt != dynRes.mSampleCounts.end();
+
+    // 先降分辨率再降MSAA，恢复时顺序相反
+    if (dynRes.mOverBudgetFrames >= GOVERNOR_DOWNGRADE_FRAMES)
+    {
+        if (dynRes.mScale > DYNAMIC_RESOLUTION_MIN_SCALE + 0.001f)
+        {
+            ApplyQualityDecision(std::max(DYNAMIC_RESOLUTION_MIN_SCALE, dynRes.mScale - DYNAMIC_RESOLUTION_SCALE_STEP), mSettings.sampleCount, "over budget");
+        }
+        else if (bCanAdjustMSAA && sampleIndex > 0)
+        {
+            ApplyQualityDecision(dynRes.mScale, dynRes.mSampleCounts[sampleIndex - 1], "over budget");
+        }
+    }
+    else if (dynRes.mUnderBudgetFrames >= GOVERNOR_UPGRADE_FRAMES)
+    {
+        if (bCanAdjustMSAA && sampleIndex + 1 < dynRes.mSampleCounts.size())
+        {
+            ApplyQualityDecision(dynRes.mScale, dynRes.mSampleCounts[sampleIndex + 1], "under budget");
+        }
+        else if (dynRes.mScale < 1.0f)
+        {
+            ApplyQualityDecision(std::min(1.0f, dynRes.mScale + DYNAMIC_RESOLUTION_SCALE_STEP), mSettings.sampleCount, "under budget");
+        }
+    }
+}
+
+void VulkanRenderer::ApplyQualityDecision(float scale, VkSampleCountFlagBits sampleCount, const std::string& reason)
+{
+    DynamicResolution& dynRes = mDynamicResolution;
+
+    // 不使用逗号，直接写入Benchmark的CSV
+    char decision[256];
+    snprintf(decision, sizeof(decision), "%s: scale %.0f%% -> %.0f%% MSAA %dx -> %dx (GPU %.2f ms target %.2f ms)",
+        reason.c_str(), dynRes.mScale * 100.0f, scale * 100.0f, (int)mSettings.sampleCount, (int)sampleCount, dynRes.mGPUTimeMs, dynRes.mTargetMs);
+    dynRes.mLastDecision = decision;
+    dynRes.mDecisionCount++;
+    if (mBenchmark.mbActive) mBenchmark.AddEvent(decision);
+
+    dynRes.mScale = scale;
+    // 重新创建Render Pass和依赖它的Pipeline，调整之间的冷却时间保证不会频繁发生
+    if (sampleCount != mSettings.sampleCount) SetSampleCount(sampleCount);
+    UpdateClusterParams();
+    BuildCommandBuffers();
+
+    dynRes.mOverBudgetFrames = 0;
+    dynRes.mUnderBudgetFrames = 0;
+    dynRes.mCooldownFrames = GOVERNOR_COOLDOWN_FRAMES;
+}
+
+// 后台编译的Pipeline读取采样数和主Render Pass，修改前等它们完成
+void VulkanRenderer::SampleCountChanging()
+{
+    mPipelineThreadPool.Wait();
+}
+
+void VulkanRenderer::SampleCountChanged()
+{
+    auto tStart = std::chrono::high_resolution_clock::now();
+    CollectPipelines();
+
+    // Shadow和Visibility Buffer几何Pass使用自己的单采样Render Pass，其余Pipeline都依赖场景或主Render Pass的采样数
+    for (auto it = mPipelines.begin(); it != mPipelines.end();)
+    {
+        const bool bOwnRenderPass = it->first.rfind("Shadow", 0) == 0 || (it->first.rfind("Visibility", 0) == 0 && it->first != "VisibilityResolve");
+        if (bOwnRenderPass)
+        {
+            ++it;
+            continue;
+        }
+        mpVulkanDevice->DeferDestroyPipeline(it->second);
+        it = mPipelines.erase(it);
+    }
+
+    RequestPipeline("Skybox", "");
+    RequestPipeline("PBR", "");
+    RequestScenePipelines(true);
+    mPipelines["DepthPrepass"] = CreateDepthPrepassPipeline(mDepthPrepassShader, false);
+    mPipelines["DepthPrepass_Double_Sided"] = CreateDepthPrepassPipeline(mDepthPrepassShader, true);
+    if (mVisibilityBuffer.mResolvePipelineLayout != VK_NULL_HANDLE)
+    {
+        mPipelines["VisibilityResolve"] = CreateVisibilityResolvePipeline();
+    }
+    if (mPostProcess.mPipelineLayout != VK_NULL_HANDLE)
+    {
+        mPipelines["Tonemap"] = CreateTonemapPipeline();
+    }
+    mPipelineTimings.mPipelineCount = static_cast<uint32_t>(mPipelines.size());
+
+    auto tPipelines = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    std::cout << "Recreating pipelines for " << (int)mSettings.sampleCount << "x MSAA took " << tPipelines << " ms" << std::endl;
+}
+
+void VulkanRenderer::DestroyDynamicResolution()
+{
+    if (mDynamicResolution.mQueryPool != VK_NULL_HANDLE) vkDestroyQueryPool(mDevice, mDynamicResolution.mQueryPool, nullptr);
+}
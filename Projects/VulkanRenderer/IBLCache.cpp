@@ -0,0 +1,311 @@
+#include "VulkanRenderer.hpp"
+
+#include <filesystem>
+#include <sstream>
+
+// 自带的libktx只支持KTX1，写入时需要GL的内部格式
+#define GL_RG16F    0x822F
+#define GL_RGBA16F  0x881A
+#define GL_RGBA32F  0x8814
+
+// 缓存内容的格式变化时增加，使旧文件失效
+#define IBL_CACHE_VERSION 1
+
+struct IBLCacheFormat
+{
+    uint32_t mGLFormat;
+    uint32_t mPixelSize;
+};
+
+static IBLCacheFormat GetIBLCacheFormat(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R16G16_SFLOAT:       return { GL_RG16F, 4 };
+    case VK_FORMAT_R16G16B16A16_SFLOAT: return { GL_RGBA16F, 8 };
+    case VK_FORMAT_R32G32B32A32_SFLOAT: return { GL_RGBA32F, 16 };
+    default:                            return { 0, 0 };
+    }
+}
+
+// FNV-1a，只用于判断输入是否变化
+static void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+static bool HashFile(uint64_t& hash, const std::string& filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    if (!is.is_open()) return false;
+    std::vector<char> chunk(1 << 20);
+    while (is)
+    {
+        is.read(chunk.data(), (std::streamsize)chunk.size());
+        HashBytes(hash, chunk.data(), (size_t)is.gcount());
+    }
+    return true;
+}
+
+uint64_t VulkanRenderer::HashIBLInputs(const std::string& source, const std::vector<std::string>& shaders, const std::string& params)
+{
+    // 输入文件、生成用的Shader和参数共同决定缓存内容，读取失败时返回0
+    uint64_t hash = 14695981039346656037ull;
+    const uint32_t version = IBL_CACHE_VERSION;
+    HashBytes(hash, &version, sizeof(version));
+    HashBytes(hash, params.data(), params.size());
+    if (!source.empty() && !HashFile(hash, source)) return 0;
+    for (const auto& shader : shaders)
+    {
+        if (!HashFile(hash, GetShadersPath() + shader)) return 0;
+    }
+    return hash;
+}
+
+std::string VulkanRenderer::GetIBLCachePath(const std::string& name, const std::string& source, uint64_t hash)
+{
+    if (hash == 0) return "";
+
+    // 放在可执行文件旁边，不依赖工作目录
+    std::stringstream ss;
+    ss << GetExecutablePath() << "IBLCache/";
+    if (!source.empty()) ss << std::filesystem::path(source).stem().string() << "_";
+    ss << name << "_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".ktx";
+    return ss.str();
+}
+
+bool VulkanRenderer::LoadIBLCache(const std::string& path, VkFormat format, bool bCube, LeoVK::Texture& texture)
+{
+    if (!mbIBLCache || path.empty() || !LeoVK::VKTools::FileExists(path)) return false;
+
+    const uint32_t faceCount = bCube ? 6 : 1;
+    ktxTexture* ktxTex = nullptr;
+    if (ktxTexture_CreateFromNamedFile(path.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTex) != KTX_SUCCESS) return false;
+    if (ktxTex->glInternalformat != GetIBLCacheFormat(format).mGLFormat || ktxTex->numFaces != faceCount)
+    {
+        std::cout << "IBL cache entry " << path << " does not match, regenerating" << std::endl;
+        ktxTexture_Destroy(ktxTex);
+        return false;
+    }
+
+    texture.mpDevice = mpVulkanDevice;
+    texture.mWidth = ktxTex->baseWidth;
+    texture.mHeight = ktxTex->baseHeight;
+    texture.mMipLevels = ktxTex->numLevels;
+    texture.mLayerCount = faceCount;
+
+    LeoVK::Buffer stagingBuffer;
+    VK_CHECK(mpVulkanDevice->CreateBuffer(
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &stagingBuffer, ktxTexture_GetSize(ktxTex), ktxTexture_GetData(ktxTex)))
+
+    std::vector<VkBufferImageCopy> copyRegions;
+    for (uint32_t face = 0; face < faceCount; face++)
+    {
+        for (uint32_t level = 0; level < texture.mMipLevels; level++)
+        {
+            ktx_size_t offset;
+            ktxTexture_GetImageOffset(ktxTex, level, 0, face, &offset);
+            VkBufferImageCopy copyRegion{};
+            copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, face, 1 };
+            copyRegion.imageExtent = { std::max(1u, texture.mWidth >> level), std::max(1u, texture.mHeight >> level), 1 };
+            copyRegion.bufferOffset = offset;
+            copyRegions.push_back(copyRegion);
+        }
+    }
+    ktxTexture_Destroy(ktxTex);
+
+    VkImageCreateInfo imageCI = LeoVK::Init::ImageCreateInfo();
+    imageCI.imageType = VK_IMAGE_TYPE_2D;
+    imageCI.format = format;
+    imageCI.extent = { texture.mWidth, texture.mHeight, 1 };
+    imageCI.mipLevels = texture.mMipLevels;
+    imageCI.arrayLayers = faceCount;
+    imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageCI.flags = bCube ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+    VK_CHECK(vkCreateImage(mDevice, &imageCI, nullptr, &texture.mImage))
+    VK_CHECK(mpVulkanDevice->AllocateImageMemory(texture.mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Default, LeoVK::MemoryCategory::IBL, &texture.mDeviceMemory))
+
+    VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mMipLevels, 0, faceCount };
+    VkCommandBuffer copyCmd = mpVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    LeoVK::VKTools::SetImageLayout(copyCmd, texture.mImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+    vkCmdCopyBufferToImage(copyCmd, stagingBuffer.mBuffer, texture.mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+    LeoVK::VKTools::SetImageLayout(copyCmd, texture.mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
+    mpVulkanDevice->FlushCommandBuffer(copyCmd, mQueue);
+    stagingBuffer.Destroy();
+
+    // View和Sampler与生成路径保持一致
+    VkImageViewCreateInfo viewCI = LeoVK::Init::ImageViewCreateInfo();
+    viewCI.viewType = bCube ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D;
+    viewCI.format = format;
+    viewCI.subresourceRange = subresourceRange;
+    viewCI.image = texture.mImage;
+    VK_CHECK(vkCreateImageView(mDevice, &viewCI, nullptr, &texture.mView))
+
+    VkSamplerCreateInfo samplerCI = LeoVK::Init::SamplerCreateInfo();
+    samplerCI.magFilter = VK_FILTER_LINEAR;
+    samplerCI.minFilter = VK_FILTER_LINEAR;
+    samplerCI.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerCI.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCI.minLod = 0.0f;
+    samplerCI.maxLod = static_cast<float>(texture.mMipLevels);
+    samplerCI.maxAnisotropy = 1.0f;
+    samplerCI.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    texture.mSampler = mpVulkanDevice->AcquireSampler(samplerCI);
+
+    texture.mImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    texture.UpdateDescriptor();
+    return true;
+}
+
+void VulkanRenderer::SaveIBLCache(const std::string& path, VkFormat format, bool bCube, const LeoVK::Texture& texture)
+{
+    if (!mbIBLCache || path.empty()) return;
+
+    const IBLCacheFormat cacheFormat = GetIBLCacheFormat(format);
+    if (cacheFormat.mGLFormat == 0) return;
+    const uint32_t faceCount = bCube ? 6 : 1;
+
+    // 每个Mip和面紧密排列在一个Buffer中
+    std::vector<VkBufferImageCopy> copyRegions;
+    VkDeviceSize bufferSize = 0;
+    for (uint32_t level = 0; level < texture.mMipLevels; level++)
+    {
+        const uint32_t width = std::max(1u, texture.mWidth >> level);
+        const uint32_t height = std::max(1u, texture.mHeight >> level);
+        for (uint32_t face = 0; face < faceCount; face++)
+        {
+            VkBufferImageCopy copyRegion{};
+            copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, face, 1 };
+            copyRegion.imageExtent = { width, height, 1 };
+            copyRegion.bufferOffset = bufferSize;
+            copyRegions.push_back(copyRegion);
+            bufferSize += (VkDeviceSize)width * height * cacheFormat.mPixelSize;
+        }
+    }
+
+    LeoVK::Buffer readbackBuffer;
+    VK_CHECK(mpVulkanDevice->CreateBuffer(
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &readbackBuffer, bufferSize))
+
+    VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mMipLevels, 0, faceCount };
+    VkCommandBuffer copyCmd = mpVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    LeoVK::VKTools::SetImageLayout(copyCmd, texture.mImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, subresourceRange);
+    vkCmdCopyImageToBuffer(copyCmd, texture.mImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer.mBuffer, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+    LeoVK::VKTools::SetImageLayout(copyCmd, texture.mImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
+    mpVulkanDevice->FlushCommandBuffer(copyCmd, mQueue);
+
+    ktxTextureCreateInfo createInfo{};
+    createInfo.glInternalformat = cacheFormat.mGLFormat;
+    createInfo.baseWidth = texture.mWidth;
+    createInfo.baseHeight = texture.mHeight;
+    createInfo.baseDepth = 1;
+    createInfo.numDimensions = 2;
+    createInfo.numLevels = texture.mMipLevels;
+    createInfo.numLayers = 1;
+    createInfo.numFaces = faceCount;
+    createInfo.isArray = KTX_FALSE;
+    createInfo.generateMipmaps = KTX_FALSE;
+    ktxTexture* ktxTex = nullptr;
+    if (ktxTexture_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &ktxTex) != KTX_SUCCESS)
+    {
+        readbackBuffer.Destroy();
+        return;
+    }
+
+    VK_CHECK(readbackBuffer.Map())
+    const uint8_t* data = static_cast<const uint8_t*>(readbackBuffer.mpMapped);
+    for (size_t i = 0; i < copyRegions.size(); i++)
+    {
+        const VkBufferImageCopy& region = copyRegions[i];
+        const VkDeviceSize regionEnd = i + 1 < copyRegions.size() ? copyRegions[i + 1].bufferOffset : bufferSize;
+        ktxTexture_SetImageFromMemory(ktxTex, region.imageSubresource.mipLevel, 0, region.imageSubresource.baseArrayLayer,
+            data + region.bufferOffset, (ktx_size_t)(regionEnd - region.bufferOffset));
+    }
+    readbackBuffer.UnMap();
+    readbackBuffer.Destroy();
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    // 与Pipeline Cache相同，先写临时文件再替换
+    std::string tmpPath = path + ".tmp";
+    KTX_error_code result = ktxTexture_WriteToNamedFile(ktxTex, tmpPath.c_str());
+    ktxTexture_Destroy(ktxTex);
+    if (result == KTX_SUCCESS) std::filesystem::rename(tmpPath, path, ec);
+    if (result != KTX_SUCCESS || ec) std::cerr << "Could not write IBL cache to " << path << std::endl;
+}
+
+void VulkanRenderer::LoadBRDFLUT()
+{
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    const uint64_t hash = HashIBLInputs("", { "VulkanRenderer/GenerateBRDFLUT.vert.spv", "VulkanRenderer/GenerateBRDFLUT.frag.spv" }, "512 R16G16_SFLOAT");
+    const std::string path = GetIBLCachePath("BRDFLUT", "", hash);
+    if (LoadIBLCache(path, VK_FORMAT_R16G16_SFLOAT, false, mTextures.mLUTBRDF))
+    {
+        auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+        std::cout << "Loading BRDF LUT from " << path << " took " << tDiff << " ms" << std::endl;
+        return;
+    }
+    GenerateBRDFLUT();
+    SaveIBLCache(path, VK_FORMAT_R16G16_SFLOAT, false, mTextures.mLUTBRDF);
+}
+
+void VulkanRenderer::LoadCubeMaps(const std::string& envFilename)
+{
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    // 两条生成路径的Shader和格式不同，分别缓存
+    std::string params;
+    std::vector<std::string> shaders;
+    VkFormat irradianceFormat;
+    if (mbComputeIBL)
+    {
+        params = "compute 64 512";
+        shaders = { "VulkanRenderer/IrradianceCube.comp.spv", "VulkanRenderer/PrefilterEnvMap.comp.spv" };
+        irradianceFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    }
+    else
+    {
+        params = "graphics 64 512";
+        shaders = { "Base/FilterCube.vert.spv", "Base/IrradianceCube.frag.spv", "Base/PrefilterEnvMap.frag.spv" };
+        irradianceFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+    }
+    const VkFormat prefilteredFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    // 两张Cube Map的输入相同，环境贴图只读一遍
+    const uint64_t hash = HashIBLInputs(envFilename, shaders, params);
+    const std::string irradiancePath = GetIBLCachePath("Irradiance", envFilename, hash);
+    const std::string prefilteredPath = GetIBLCachePath("Prefiltered", envFilename, hash);
+
+    if (LoadIBLCache(irradiancePath, irradianceFormat, true, mTextures.mIrradianceCube))
+    {
+        if (LoadIBLCache(prefilteredPath, prefilteredFormat, true, mTextures.mPreFilteredCube))
+        {
+            mUBOParams.mPrefilteredCubeMipLevels = static_cast<float>(mTextures.mPreFilteredCube.mMipLevels);
+            mIBLTimings.mCacheLoad = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+            mIBLTimings.mbFromCache = true;
+            std::cout << "Loading cube maps from IBL cache took " << mIBLTimings.mCacheLoad << " ms" << std::endl;
+            return;
+        }
+        mTextures.mIrradianceCube.Destroy();
+    }
+
+    mIBLTimings.mbFromCache = false;
+    if (mbComputeIBL) GenerateCubeMapsCompute();
+    else GenerateCubeMaps();
+    SaveIBLCache(irradiancePath, irradianceFormat, true, mTextures.mIrradianceCube);
+    SaveIBLCache(prefilteredPath, prefilteredFormat, true, mTextures.mPreFilteredCube);
+}
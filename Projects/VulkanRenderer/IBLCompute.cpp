@@ -0,0 +1,198 @@
+#include "VulkanRenderer.hpp"
+
+// 与IBLFilter.glsl中的工作组大小一致
+#define IBL_GROUP_SIZE 8
+
+void VulkanRenderer::GenerateCubeMapsCompute()
+{
+    enum Target { IRRADIANCE = 0, PREFILTEREDENV = 1 };
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    // 两个目标共用一个Command Buffer，只提交并等待一次
+    const VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    const std::array<uint32_t, 2> dims = { 64, 512 };
+    std::array<LeoVK::TextureCube, 2> cubemaps;
+    std::array<uint32_t, 2> mipCounts{};
+    std::vector<VkImageView> mipViews;
+
+    // 所有Pipeline使用相同的布局：环境贴图 + 每个Mip一个存储图像
+    std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1, MAX_IBL_MIPS),
+    };
+    VkDescriptorSetLayoutCreateInfo descSetLayoutCI = LeoVK::Init::DescSetLayoutCreateInfo(setLayoutBindings);
+    VkDescriptorSetLayout descSetLayout;
+    VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &descSetLayoutCI, nullptr, &descSetLayout))
+
+    std::vector<VkDescriptorPoolSize> poolSizes = {
+        LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2),
+        LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 * MAX_IBL_MIPS),
+    };
+    VkDescriptorPoolCreateInfo descPoolCI = LeoVK::Init::DescPoolCreateInfo(poolSizes, 2);
+    VkDescriptorPool descPool;
+    VK_CHECK(vkCreateDescriptorPool(mDevice, &descPoolCI, nullptr, &descPool))
+
+    // 两个Shader的Push Constant都是16字节
+    VkPushConstantRange pushConstRange = LeoVK::Init::PushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(glm::uvec4), 0);
+    VkPipelineLayoutCreateInfo pipelineLayoutCI = LeoVK::Init::PipelineLayoutCreateInfo(&descSetLayout, 1);
+    pipelineLayoutCI.pushConstantRangeCount = 1;
+    pipelineLayoutCI.pPushConstantRanges = &pushConstRange;
+    VkPipelineLayout pipelineLayout;
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &pipelineLayoutCI, nullptr, &pipelineLayout))
+
+    std::array<VkPipeline, 2> pipelines{};
+    auto tPipelineStart = std::chrono::high_resolution_clock::now();
+    const std::array<std::string, 2> shaderNames = { "VulkanRenderer/IrradianceCube.comp.spv", "VulkanRenderer/PrefilterEnvMap.comp.spv" };
+    for (uint32_t target = 0; target < PREFILTEREDENV + 1; target++)
+    {
+        VkComputePipelineCreateInfo computePipelineCI = LeoVK::Init::ComputePipelineCreateInfo(pipelineLayout);
+        computePipelineCI.stage = LoadShader(GetShadersPath() + shaderNames[target], VK_SHADER_STAGE_COMPUTE_BIT);
+        VK_CHECK(vkCreateComputePipelines(mDevice, mPipelineCache, 1, &computePipelineCI, nullptr, &pipelines[target]))
+    }
+    mPipelineTimings.mCubeMaps = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tPipelineStart).count();
+
+    VkCommandBuffer cmdBuffer = mpVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    for (uint32_t target = 0; target < PREFILTEREDENV + 1; target++)
+    {
+        LeoVK::TextureCube& cubemap = cubemaps[target];
+        const uint32_t dim = dims[target];
+        const uint32_t numMips = static_cast<uint32_t>(floor(log2(dim))) + 1;
+        mipCounts[target] = numMips;
+        assert(numMips <= MAX_IBL_MIPS);
+
+        VkImageCreateInfo imageCI = LeoVK::Init::ImageCreateInfo();
+        imageCI.imageType = VK_IMAGE_TYPE_2D;
+        imageCI.format = format;
+        imageCI.extent = { dim, dim, 1 };
+        imageCI.mipLevels = numMips;
+        imageCI.arrayLayers = 6;
+        imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageCI.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+        VK_CHECK(vkCreateImage(mDevice, &imageCI, nullptr, &cubemap.mImage))
+        VK_CHECK(mpVulkanDevice->AllocateImageMemory(cubemap.mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Default, LeoVK::MemoryCategory::IBL, &cubemap.mDeviceMemory))
+
+        VkImageViewCreateInfo viewCI = LeoVK::Init::ImageViewCreateInfo();
+        viewCI.viewType = VK_IMAGE_VIEW_TYPE_CUBE;
+        viewCI.format = format;
+        viewCI.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, numMips, 0, 6 };
+        viewCI.image = cubemap.mImage;
+        VK_CHECK(vkCreateImageView(mDevice, &viewCI, nullptr, &cubemap.mView))
+
+        VkSamplerCreateInfo samplerCI = LeoVK::Init::SamplerCreateInfo();
+        samplerCI.magFilter = VK_FILTER_LINEAR;
+        samplerCI.minFilter = VK_FILTER_LINEAR;
+        samplerCI.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerCI.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCI.minLod = 0.0f;
+        samplerCI.maxLod = static_cast<float>(numMips);
+        samplerCI.maxAnisotropy = 1.0f;
+        samplerCI.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+        cubemap.mSampler = mpVulkanDevice->AcquireSampler(samplerCI);
+
+        // 每个Mip的6个面作为一个2D数组写入，不足MAX_IBL_MIPS的部分重复最后一级
+        std::array<VkDescriptorImageInfo, MAX_IBL_MIPS> mipDescs{};
+        for (uint32_t m = 0; m < numMips; m++)
+        {
+            VkImageViewCreateInfo mipViewCI = LeoVK::Init::ImageViewCreateInfo();
+            mipViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+            mipViewCI.format = format;
+            mipViewCI.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, m, 1, 0, 6 };
+            mipViewCI.image = cubemap.mImage;
+            VkImageView mipView;
+            VK_CHECK(vkCreateImageView(mDevice, &mipViewCI, nullptr, &mipView))
+            mipViews.push_back(mipView);
+        }
+        for (uint32_t m = 0; m < MAX_IBL_MIPS; m++)
+        {
+            mipDescs[m] = LeoVK::Init::DescImageInfo(VK_NULL_HANDLE, mipViews[mipViews.size() - numMips + std::min(m, numMips - 1)], VK_IMAGE_LAYOUT_GENERAL);
+        }
+
+        VkDescriptorSet descSet;
+        VkDescriptorSetAllocateInfo descSetAI = LeoVK::Init::DescSetAllocateInfo(descPool, &descSetLayout, 1);
+        VK_CHECK(vkAllocateDescriptorSets(mDevice, &descSetAI, &descSet))
+        std::array<VkWriteDescriptorSet, 2> writeDescSets = {
+            LeoVK::Init::WriteDescriptorSet(descSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &mTextures.mEnvCube.mDescriptor),
+            LeoVK::Init::WriteDescriptorSet(descSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, mipDescs.data(), MAX_IBL_MIPS),
+        };
+        vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writeDescSets.size()), writeDescSets.data(), 0, nullptr);
+
+        VkImageMemoryBarrier imageBarrier = LeoVK::Init::ImageMemoryBarrier();
+        imageBarrier.image = cubemap.mImage;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.srcAccessMask = 0;
+        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, numMips, 0, 6 };
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+        // 所有Mip的Tile排在X方向上，6个面在Z方向上
+        uint32_t tileCount = 0;
+        for (uint32_t m = 0; m < numMips; m++)
+        {
+            const uint32_t tilesX = (std::max(dim >> m, 1u) + IBL_GROUP_SIZE - 1) / IBL_GROUP_SIZE;
+            tileCount += tilesX * tilesX;
+        }
+
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[target]);
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descSet, 0, nullptr);
+        switch (target)
+        {
+            case IRRADIANCE:
+            {
+                struct { uint32_t baseSize, mipCount; float deltaPhi, deltaTheta; } pushConsts = {
+                    dim, numMips, (2.0f * float(M_PI)) / 180.0f, (0.5f * float(M_PI)) / 64.0f
+                };
+                vkCmdPushConstants(cmdBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConsts), &pushConsts);
+                break;
+            }
+            case PREFILTEREDENV:
+            {
+                // 图形管线的版本每个Mip固定32个样本，这里随粗糙度从8增加到64
+                const glm::uvec4 pushConsts = { dim, numMips, 8u, 64u };
+                vkCmdPushConstants(cmdBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConsts), &pushConsts);
+                break;
+            }
+        };
+        vkCmdDispatch(cmdBuffer, tileCount, 1, 6);
+
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+        cubemap.mDescriptor.imageView = cubemap.mView;
+        cubemap.mDescriptor.sampler = cubemap.mSampler;
+        cubemap.mDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        cubemap.mpDevice = mpVulkanDevice;
+        cubemap.mWidth = dim;
+        cubemap.mHeight = dim;
+        cubemap.mMipLevels = numMips;
+        cubemap.mLayerCount = 6;
+    }
+    mpVulkanDevice->FlushCommandBuffer(cmdBuffer, mQueue, true);
+
+    for (auto mipView : mipViews)
+    {
+        vkDestroyImageView(mDevice, mipView, nullptr);
+    }
+    for (auto pipeline : pipelines)
+    {
+        vkDestroyPipeline(mDevice, pipeline, nullptr);
+    }
+    vkDestroyPipelineLayout(mDevice, pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(mDevice, descPool, nullptr);
+    vkDestroyDescriptorSetLayout(mDevice, descSetLayout, nullptr);
+
+    mTextures.mIrradianceCube = cubemaps[IRRADIANCE];
+    mTextures.mPreFilteredCube = cubemaps[PREFILTEREDENV];
+    mUBOParams.mPrefilteredCubeMipLevels = static_cast<float>(mipCounts[PREFILTEREDENV]);
+
+    mIBLTimings.mCompute = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    std::cout << "Generating cube maps with compute took " << mIBLTimings.mCompute << " ms (pipelines " << mPipelineTimings.mCubeMaps << " ms)" << std::endl;
+}
@@ -18,16 +18,9 @@ void VulkanRenderer::GenerateBRDFLUT()
     imageCI.arrayLayers = 1;
     imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
     imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
     VK_CHECK(vkCreateImage(mDevice, &imageCI, nullptr, &mTextures.mLUTBRDF.mImage));
-    VkMemoryRequirements memReqs;
-    vkGetImageMemoryRequirements(mDevice, mTextures.mLUTBRDF.mImage, &memReqs);
-    VkMemoryAllocateInfo memAllocInfo{};
-    memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memAllocInfo.allocationSize = memReqs.size;
-    memAllocInfo.memoryTypeIndex = mpVulkanDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    VK_CHECK(vkAllocateMemory(mDevice, &memAllocInfo, nullptr, &mTextures.mLUTBRDF.mDeviceMemory));
-    VK_CHECK(vkBindImageMemory(mDevice, mTextures.mLUTBRDF.mImage, mTextures.mLUTBRDF.mDeviceMemory, 0));
+    VK_CHECK(mpVulkanDevice->AllocateImageMemory(mTextures.mLUTBRDF.mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Default, LeoVK::MemoryCategory::IBL, &mTextures.mLUTBRDF.mDeviceMemory));
 
     // View
     VkImageViewCreateInfo imageViewCI = LeoVK::Init::ImageViewCreateInfo();
@@ -52,7 +45,7 @@ void VulkanRenderer::GenerateBRDFLUT()
     samplerCI.maxLod = 1.0f;
     samplerCI.maxAnisotropy = 1.0f;
     samplerCI.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-    VK_CHECK(vkCreateSampler(mDevice, &samplerCI, nullptr, &mTextures.mLUTBRDF.mSampler));
+    mTextures.mLUTBRDF.mSampler = mpVulkanDevice->AcquireSampler(samplerCI);
 
     VkAttachmentDescription attachDesc {};
     attachDesc.format = format;
@@ -151,7 +144,9 @@ void VulkanRenderer::GenerateBRDFLUT()
     };
 
     VkPipeline pipeline;
+    auto tPipelineStart = std::chrono::high_resolution_clock::now();
     VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline));
+    mPipelineTimings.mBRDFLUT = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tPipelineStart).count();
 
     // for (auto s : ssCI) vkDestroyShaderModule(mDevice, s.module, nullptr);
 
@@ -186,8 +181,6 @@ void VulkanRenderer::GenerateBRDFLUT()
     vkCmdEndRenderPass(cmdBuffer);
     mpVulkanDevice->FlushCommandBuffer(cmdBuffer, mQueue);
 
-    vkQueueWaitIdle(mQueue);
-
     vkDestroyPipeline(mDevice, pipeline, nullptr);
     vkDestroyPipelineLayout(mDevice, pipelineLayout, nullptr);
     vkDestroyRenderPass(mDevice, renderPass, nullptr);
@@ -198,16 +191,22 @@ void VulkanRenderer::GenerateBRDFLUT()
     mTextures.mLUTBRDF.mDescriptor.sampler = mTextures.mLUTBRDF.mSampler;
     mTextures.mLUTBRDF.mDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     mTextures.mLUTBRDF.mpDevice = mpVulkanDevice;
+    mTextures.mLUTBRDF.mWidth = dim;
+    mTextures.mLUTBRDF.mHeight = dim;
+    mTextures.mLUTBRDF.mMipLevels = 1;
+    mTextures.mLUTBRDF.mLayerCount = 1;
 
     auto tEnd = std::chrono::high_resolution_clock::now();
     auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
-    std::cout << "Generating BRDF LUT took " << tDiff << " ms" << std::endl;
+    std::cout << "Generating BRDF LUT took " << tDiff << " ms (pipeline " << mPipelineTimings.mBRDFLUT << " ms)" << std::endl;
 }
 
 void VulkanRenderer::GenerateCubeMaps()
 {
     enum Target { IRRADIANCE = 0, PREFILTEREDENV = 1 };
 
+    auto tCubeMapsStart = std::chrono::high_resolution_clock::now();
+    mPipelineTimings.mCubeMaps = 0.0;
     for (uint32_t target = 0; target < PREFILTEREDENV + 1; target++) 
     {
         LeoVK::TextureCube cubemap;
@@ -244,16 +243,10 @@ void VulkanRenderer::GenerateCubeMaps()
         	imageCI.arrayLayers = 6;
         	imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
         	imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-        	imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        	imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
         	imageCI.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
         	VK_CHECK(vkCreateImage(mDevice, &imageCI, nullptr, &cubemap.mImage));
-        	VkMemoryRequirements memReqs;
-        	vkGetImageMemoryRequirements(mDevice, cubemap.mImage, &memReqs);
-        	VkMemoryAllocateInfo memAllocInfo = LeoVK::Init::MemoryAllocateInfo();
-        	memAllocInfo.allocationSize = memReqs.size;
-        	memAllocInfo.memoryTypeIndex = mpVulkanDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        	VK_CHECK(vkAllocateMemory(mDevice, &memAllocInfo, nullptr, &cubemap.mDeviceMemory));
-        	VK_CHECK(vkBindImageMemory(mDevice, cubemap.mImage, cubemap.mDeviceMemory, 0));
+        	VK_CHECK(mpVulkanDevice->AllocateImageMemory(cubemap.mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Default, LeoVK::MemoryCategory::IBL, &cubemap.mDeviceMemory));
 
         	// View
         	VkImageViewCreateInfo viewCI = LeoVK::Init::ImageViewCreateInfo();
@@ -278,7 +271,7 @@ void VulkanRenderer::GenerateCubeMaps()
         	samplerCI.maxLod = static_cast<float>(numMips);
         	samplerCI.maxAnisotropy = 1.0f;
         	samplerCI.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-        	VK_CHECK(vkCreateSampler(mDevice, &samplerCI, nullptr, &cubemap.mSampler));
+        	cubemap.mSampler = mpVulkanDevice->AcquireSampler(samplerCI);
         }
 
         // FB, Att, RP, Pipe, etc.
@@ -354,14 +347,7 @@ void VulkanRenderer::GenerateCubeMaps()
         	imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
         	imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         	VK_CHECK(vkCreateImage(mDevice, &imageCI, nullptr, &offscreen.image));
-        	VkMemoryRequirements memReqs;
-        	vkGetImageMemoryRequirements(mDevice, offscreen.image, &memReqs);
-        	VkMemoryAllocateInfo memAllocInfo{};
-        	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        	memAllocInfo.allocationSize = memReqs.size;
-        	memAllocInfo.memoryTypeIndex = mpVulkanDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        	VK_CHECK(vkAllocateMemory(mDevice, &memAllocInfo, nullptr, &offscreen.memory));
-        	VK_CHECK(vkBindImageMemory(mDevice, offscreen.image, offscreen.memory, 0));
+        	VK_CHECK(mpVulkanDevice->AllocateImageMemory(offscreen.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Default, LeoVK::MemoryCategory::IBL, &offscreen.memory));
 
         	// View
         	VkImageViewCreateInfo viewCI{};
@@ -505,7 +491,9 @@ void VulkanRenderer::GenerateCubeMaps()
         };
 
         VkPipeline pipeline;
+        auto tPipelineStart = std::chrono::high_resolution_clock::now();
         VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline));
+        mPipelineTimings.mCubeMaps += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tPipelineStart).count();
         // for (auto ss : shaderStages) 
         // {
         // 	vkDestroyShaderModule(mDevice, ss.module, nullptr);
@@ -681,7 +669,7 @@ void VulkanRenderer::GenerateCubeMaps()
 
         vkDestroyRenderPass(mDevice, renderPass, nullptr);
         vkDestroyFramebuffer(mDevice, offscreen.framebuffer, nullptr);
-        vkFreeMemory(mDevice, offscreen.memory, nullptr);
+        mpVulkanDevice->FreeImageMemory(offscreen.image);
         vkDestroyImageView(mDevice, offscreen.view, nullptr);
         vkDestroyImage(mDevice, offscreen.image, nullptr);
         vkDestroyDescriptorPool(mDevice, descPool, nullptr);
@@ -693,6 +681,10 @@ void VulkanRenderer::GenerateCubeMaps()
         cubemap.mDescriptor.sampler = cubemap.mSampler;
         cubemap.mDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         cubemap.mpDevice = mpVulkanDevice;
+        cubemap.mWidth = dim;
+        cubemap.mHeight = dim;
+        cubemap.mMipLevels = numMips;
+        cubemap.mLayerCount = 6;
         
         switch (target) 
         {
@@ -709,4 +701,5 @@ void VulkanRenderer::GenerateCubeMaps()
         auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
         std::cout << "Generating cube map with " << numMips << " mip levels took " << tDiff << " ms" << std::endl;
     }
+    mIBLTimings.mGraphics = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tCubeMapsStart).count();
 }
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "VulkanRenderer.hpp"
+
+void VulkanRenderer::RegisterPipelineSet(const std::string& prefix, const std::string& vertexShader, const std::string& pixelShader)
+{
+    // Shader Module只在主线程加载，工作线程只读取
+    mPipelineShaders[prefix] = {
+        LoadShader(GetShadersPath() + vertexShader, VK_SHADER_STAGE_VERTEX_BIT),
+        LoadShader(GetShadersPath() + pixelShader, VK_SHADER_STAGE_FRAGMENT_BIT)
+    };
+}
+
+std::string VulkanRenderer::GetPipelineName(const std::string& prefix, const std::string& variant, uint32_t permutation)
+{
+    if (permutation == 0) return prefix + variant;
+
+    char key[16];
+    snprintf(key, sizeof(key), "#%08X", permutation);
+    return prefix + variant + key;
+}
+
+PipelineTarget VulkanRenderer::GetPipelineTarget() const
+{
+    return { mPostProcess.mRenderPass, mSettings.multiSampling ? mSettings.sampleCount : VK_SAMPLE_COUNT_1_BIT };
+}
+
+VkPipeline VulkanRenderer::CreatePipelineVariant(const std::string& prefix, const std::string& variant, uint32_t permutation, const PipelineTarget& target)
+{
+    VkPipelineInputAssemblyStateCreateInfo iaStateCI = LeoVK::Init::PipelineIAStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+    VkPipelineRasterizationStateCreateInfo rsStateCI = LeoVK::Init::PipelineRSStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+    VkPipelineColorBlendAttachmentState cbAttachCI = LeoVK::Init::PipelineCBAState(VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT, VK_FALSE);
+    VkPipelineColorBlendStateCreateInfo cbStateCI = LeoVK::Init::PipelineCBStateCreateInfo(1, &cbAttachCI);
+    VkPipelineDepthStencilStateCreateInfo dsStateCI = LeoVK::Init::PipelineDSStateCreateInfo(prefix == "Skybox" ? VK_FALSE : VK_TRUE, prefix == "Skybox" ? VK_FALSE : VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+    VkPipelineViewportStateCreateInfo vpStateCI = LeoVK::Init::PipelineVPStateCreateInfo(1, 1, 0);
+    VkPipelineMultisampleStateCreateInfo msStateCI = LeoVK::Init::PipelineMSStateCreateInfo(target.mSampleCount, 0);
+    const std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dyStateCI = LeoVK::Init::PipelineDYStateCreateInfo(dynamicStateEnables.data(), static_cast<uint32_t>(dynamicStateEnables.size()), 0);
+    std::array<VkPipelineShaderStageCreateInfo, 2> ssStateCIs = mPipelineShaders.at(prefix);
+
+    // 材质特性位作为Specialization Constant烘焙进Fragment Shader
+    VkSpecializationMapEntry specMapEntry = LeoVK::Init::SpecializationMapEntry(0, 0, sizeof(uint32_t));
+    VkSpecializationInfo specInfo = LeoVK::Init::SpecializationInfo(1, &specMapEntry, sizeof(uint32_t), &permutation);
+    if (permutation != 0)
+    {
+        ssStateCIs[1].pSpecializationInfo = &specInfo;
+    }
+
+    const std::vector<VkVertexInputBindingDescription> viBindings = {
+        LeoVK::Init::VIBindingDescription(0, sizeof(LeoVK::Vertex), VK_VERTEX_INPUT_RATE_VERTEX),
+    };
+    const std::vector<VkVertexInputAttributeDescription> viAttributes = {
+        LeoVK::Init::VIAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LeoVK::Vertex, mPos)),
+        LeoVK::Init::VIAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LeoVK::Vertex, mNormal)),
+        LeoVK::Init::VIAttributeDescription(0, 2, VK_FORMAT_R32G32_SFLOAT, offsetof(LeoVK::Vertex, mUV0)),
+        LeoVK::Init::VIAttributeDescription(0, 3, VK_FORMAT_R32G32_SFLOAT, offsetof(LeoVK::Vertex, mUV1)),
+        LeoVK::Init::VIAttributeDescription(0, 4, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mColor)),
+        LeoVK::Init::VIAttributeDescription(0, 5, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mJoint0)),
+        LeoVK::Init::VIAttributeDescription(0, 6, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mWeight0)),
+        LeoVK::Init::VIAttributeDescription(0, 7, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mTangent)),
+    };
+    VkPipelineVertexInputStateCreateInfo viStateCI = LeoVK::Init::PipelineVIStateCreateInfo(viBindings, viAttributes);
+
+    VkGraphicsPipelineCreateInfo pipelineCI = LeoVK::Init::PipelineCreateInfo(mPipelineLayout, target.mRenderPass, 0);
+    pipelineCI.pVertexInputState = &viStateCI;
+    pipelineCI.pInputAssemblyState = &iaStateCI;
+    pipelineCI.pRasterizationState = &rsStateCI;
+    pipelineCI.pColorBlendState = &cbStateCI;
+    pipelineCI.pMultisampleState = &msStateCI;
+    pipelineCI.pViewportState = &vpStateCI;
+    pipelineCI.pDepthStencilState = &dsStateCI;
+    pipelineCI.pDynamicState = &dyStateCI;
+    pipelineCI.stageCount = static_cast<uint32_t>(ssStateCIs.size());
+    pipelineCI.pStages = ssStateCIs.data();
+
+    if (variant.find("_Double_Sided") != std::string::npos)
+    {
+        rsStateCI.cullMode = VK_CULL_MODE_NONE;
+    }
+    if (variant.find("_EqualDepth") != std::string::npos)
+    {
+        // 深度已经由预渲染写入，主Pass只着色可见的片元
+        dsStateCI.depthWriteEnable = VK_FALSE;
+        dsStateCI.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    }
+    if (variant == "_Alpha_Blend")
+    {
+        rsStateCI.cullMode = VK_CULL_MODE_NONE;
+        cbAttachCI.blendEnable = VK_TRUE;
+        cbAttachCI.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        cbAttachCI.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        cbAttachCI.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        cbAttachCI.colorBlendOp = VK_BLEND_OP_ADD;
+        cbAttachCI.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        cbAttachCI.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        cbAttachCI.alphaBlendOp = VK_BLEND_OP_ADD;
+    }
+
+    // vkCreateGraphicsPipelines对Pipeline Cache的访问由驱动内部同步，可以在多个线程同时调用
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline))
+    return pipeline;
+}
+
+VkPipeline VulkanRenderer::CreateDepthPrepassPipeline(const VkPipelineShaderStageCreateInfo& vertexShader, bool doubleSided)
+{
+    VkPipelineInputAssemblyStateCreateInfo iaStateCI = LeoVK::Init::PipelineIAStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+    VkPipelineRasterizationStateCreateInfo rsStateCI = LeoVK::Init::PipelineRSStateCreateInfo(VK_POLYGON_MODE_FILL, doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+    // 只写深度，不写颜色
+    VkPipelineColorBlendAttachmentState cbAttachCI = LeoVK::Init::PipelineCBAState(0, VK_FALSE);
+    VkPipelineColorBlendStateCreateInfo cbStateCI = LeoVK::Init::PipelineCBStateCreateInfo(1, &cbAttachCI);
+    VkPipelineDepthStencilStateCreateInfo dsStateCI = LeoVK::Init::PipelineDSStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+    VkPipelineViewportStateCreateInfo vpStateCI = LeoVK::Init::PipelineVPStateCreateInfo(1, 1, 0);
+    VkPipelineMultisampleStateCreateInfo msStateCI = LeoVK::Init::PipelineMSStateCreateInfo(mSettings.multiSampling ? mSettings.sampleCount : VK_SAMPLE_COUNT_1_BIT, 0);
+    const std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dyStateCI = LeoVK::Init::PipelineDYStateCreateInfo(dynamicStateEnables.data(), static_cast<uint32_t>(dynamicStateEnables.size()), 0);
+
+    // 只读取位置和蒙皮属性，仍然使用完整的顶点Buffer
+    const std::vector<VkVertexInputBindingDescription> viBindings = {
+        LeoVK::Init::VIBindingDescription(0, sizeof(LeoVK::Vertex), VK_VERTEX_INPUT_RATE_VERTEX),
+    };
+    const std::vector<VkVertexInputAttributeDescription> viAttributes = {
+        LeoVK::Init::VIAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LeoVK::Vertex, mPos)),
+        LeoVK::Init::VIAttributeDescription(0, 5, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mJoint0)),
+        LeoVK::Init::VIAttributeDescription(0, 6, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mWeight0)),
+    };
+    VkPipelineVertexInputStateCreateInfo viStateCI = LeoVK::Init::PipelineVIStateCreateInfo(viBindings, viAttributes);
+
+    VkGraphicsPipelineCreateInfo pipelineCI = LeoVK::Init::PipelineCreateInfo(mPipelineLayout, mPostProcess.mRenderPass, 0);
+    pipelineCI.pVertexInputState = &viStateCI;
+    pipelineCI.pInputAssemblyState = &iaStateCI;
+    pipelineCI.pRasterizationState = &rsStateCI;
+    pipelineCI.pColorBlendState = &cbStateCI;
+    pipelineCI.pMultisampleState = &msStateCI;
+    pipelineCI.pViewportState = &vpStateCI;
+    pipelineCI.pDepthStencilState = &dsStateCI;
+    pipelineCI.pDynamicState = &dyStateCI;
+    pipelineCI.stageCount = 1;
+    pipelineCI.pStages = &vertexShader;
+
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline))
+    return pipeline;
+}
+
+void VulkanRenderer::RequestPipeline(const std::string& prefix, const std::string& variant, uint32_t permutation)
+{
+    const std::string name = GetPipelineName(prefix, variant, permutation);
+    if (mPipelines.find(name) != mPipelines.end() || mPendingPipelines.find(name) != mPendingPipelines.end()) return;
+
+    const PipelineTarget target = GetPipelineTarget();
+    // 排列编译期间由同一混合和剔除状态的运行时分支版本代替，它不存在时在这里同步创建
+    if (permutation != 0)
+    {
+        const std::string fallback = prefix + variant;
+        if (mPipelines.find(fallback) == mPipelines.end() && mPendingPipelines.find(fallback) == mPendingPipelines.end())
+        {
+            mPipelines[fallback] = CreatePipelineVariant(prefix, variant, 0, target);
+            mPipelineTimings.mPipelineCount = static_cast<uint32_t>(mPipelines.size());
+        }
+    }
+
+    mPendingPipelines.insert(name);
+    auto& thread = mPipelineThreadPool.mThreads[mNextPipelineThread++ % mPipelineThreadPool.mThreads.size()];
+    thread->AddJob([this, prefix, variant, permutation, name, target]
+    {
+        VkPipeline pipeline = CreatePipelineVariant(prefix, variant, permutation, target);
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        mCompiledPipelines[name] = pipeline;
+    });
+}
+
+void VulkanRenderer::RequestScenePipelines(bool wait)
+{
+    // 只创建当前场景材质用到的组合
+    for (auto& material : mScenes.mRenderScene.mMaterials)
+    {
+        std::string prefix, variant;
+        uint32_t permutation;
+        GetMaterialPipeline(material, prefix, variant, permutation);
+        RequestPipeline(prefix, variant, permutation);
+    }
+    if (wait)
+    {
+        mPipelineThreadPool.Wait();
+        CollectPipelines();
+    }
+}
+
+bool VulkanRenderer::CollectPipelines()
+{
+    std::lock_guard<std::mutex> lock(mPipelineMutex);
+    if (mCompiledPipelines.empty()) return false;
+
+    for (auto& pipeline : mCompiledPipelines)
+    {
+        // 同名的旧Pipeline可能还在录制好的Command Buffer中
+        auto it = mPipelines.find(pipeline.first);
+        if (it != mPipelines.end() && it->second != pipeline.second) mpVulkanDevice->DeferDestroyPipeline(it->second);
+        mPipelines[pipeline.first] = pipeline.second;
+        mPendingPipelines.erase(pipeline.first);
+    }
+    mPipelineTimings.mPipelineCount = static_cast<uint32_t>(mPipelines.size());
+    mCompiledPipelines.clear();
+    return true;
+}
+
+VkPipeline VulkanRenderer::GetPipeline(const std::string& prefix, const std::string& variant, uint32_t permutation)
+{
+    auto it = mPipelines.find(GetPipelineName(prefix, variant, permutation));
+    if (it != mPipelines.end()) return it->second;
+
+    // 还在后台编译时使用运行时分支的版本，混合和剔除状态相同。
+    // 不能退回到其他变体，不透明剔除的Pipeline画混合或双面材质会得到错误的结果，此时返回空，调用者跳过这次绘制
+    it = mPipelines.find(prefix + variant);
+    if (it != mPipelines.end()) return it->second;
+    return VK_NULL_HANDLE;
+}
+
+void VulkanRenderer::GetMaterialPipeline(const LeoVK::Material& material, std::string& prefix, std::string& variant, uint32_t& permutation)
+{
+    prefix = material.mbUnlit ? "Unlit" : "PBR";
+    variant = "";
+    // Unlit Shader不读取材质特性，不需要排列
+    permutation = (mbUsePermutations && !material.mbUnlit) ? (material.mFeatureBits | LeoVK::MATERIAL_FEATURE_PERMUTATION) : 0;
+    if (material.mAlphaMode == LeoVK::Material::ALPHA_MODE_BLEND)
+    {
+        variant = "_Alpha_Blend";
+    }
+    else if (material.mbDoubleSided)
+    {
+        variant = "_Double_Sided";
+    }
+    // 不透明物体在开启深度预渲染时使用EQUAL深度测试，Mask物体需要在主Pass里做Alpha Test所以不参与预渲染
+    // Visibility Buffer开启时深度预渲染不生效，剩下的前向物体使用普通的深度测试
+    if (mbDepthPrepass && !IsVisibilityBufferActive() && material.mAlphaMode == LeoVK::Material::ALPHA_MODE_OPAQUE)
+    {
+        variant += "_EqualDepth";
+    }
+}
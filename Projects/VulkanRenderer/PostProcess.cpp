@@ -0,0 +1,289 @@
+#include "VulkanRenderer.hpp"
+
+// 色调映射Pass的参数，UV只覆盖动态分辨率下实际渲染的区域
+struct TonemapPushConstants
+{
+    glm::vec2 mUVScale;
+    glm::vec2 mMaxUV;
+    float mExposure;
+    float mGamma;
+};
+
+void VulkanRenderer::SetupFrameBuffer()
+{
+    // 场景的MSAA颜色先于主Pass的附件创建，没有Lazy内存时主Pass的MSAA颜色和它共用内存
+    CreateSceneTargets();
+    VKRendererBase::SetupFrameBuffer();
+    SetupSceneTarget();
+}
+
+void VulkanRenderer::CreateSceneTargets()
+{
+    PostProcess& postProcess = mPostProcess;
+    if (postProcess.mFrameBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyFramebuffer(mDevice, postProcess.mFrameBuffer, nullptr);
+        vkDestroyImageView(mDevice, postProcess.mColor.imageView, nullptr);
+        vkDestroyImage(mDevice, postProcess.mColor.image, nullptr);
+        mpVulkanDevice->FreeImageMemory(postProcess.mColor.image);
+    }
+    if (postProcess.mMSColor.image != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(mDevice, postProcess.mMSColor.imageView, nullptr);
+        vkDestroyImage(mDevice, postProcess.mMSColor.image, nullptr);
+        mpVulkanDevice->FreeImageMemory(postProcess.mMSColor.image);
+        postProcess.mMSColor = {};
+    }
+
+    auto createTarget = [&](RenderTarget& target, VkSampleCountFlagBits samples, VkImageUsageFlags usage)
+    {
+        VkImageCreateInfo imageCI = LeoVK::Init::ImageCreateInfo();
+        imageCI.imageType = VK_IMAGE_TYPE_2D;
+        imageCI.format = postProcess.mFormat;
+        imageCI.extent = { mWidth, mHeight, 1 };
+        imageCI.mipLevels = 1;
+        imageCI.arrayLayers = 1;
+        imageCI.samples = samples;
+        imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCI.usage = usage;
+        imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VK_CHECK(vkCreateImage(mDevice, &imageCI, nullptr, &target.image))
+
+        const VkMemoryPropertyFlags memProps = (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) ? mpVulkanDevice->GetTransientAttachmentMemoryFlags(target.image) : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        VK_CHECK(mpVulkanDevice->AllocateImageMemory(target.image, memProps, LeoVK::MemoryPool::Transient, LeoVK::MemoryCategory::RenderTarget, &target.memory))
+
+        VkImageViewCreateInfo imageViewCI = LeoVK::Init::ImageViewCreateInfo();
+        imageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        imageViewCI.image = target.image;
+        imageViewCI.format = postProcess.mFormat;
+        imageViewCI.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        VK_CHECK(vkCreateImageView(mDevice, &imageViewCI, nullptr, &target.imageView))
+    };
+    // HDR颜色按窗口大小分配，动态分辨率调整比例时不需要重新创建
+    createTarget(postProcess.mColor, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    if (mSettings.multiSampling)
+    {
+        createTarget(postProcess.mMSColor, mSettings.sampleCount, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+    }
+    // 场景Pass和色调映射Pass各自清除后使用自己的MSAA颜色，场景Pass结束时的依赖覆盖了附件写入
+    mMSColorAlias = postProcess.mMSColor.image;
+}
+
+void VulkanRenderer::SetupSceneTarget()
+{
+    PostProcess& postProcess = mPostProcess;
+    const VkSampleCountFlagBits sampleCount = mSettings.multiSampling ? mSettings.sampleCount : VK_SAMPLE_COUNT_1_BIT;
+    // Render Pass只在采样数变化时重新创建，后台编译中的Pipeline可能正在引用它
+    if (postProcess.mRenderPass != VK_NULL_HANDLE && postProcess.mSampleCount != sampleCount)
+    {
+        mPipelineThreadPool.Wait();
+        vkDestroyRenderPass(mDevice, postProcess.mRenderPass, nullptr);
+        postProcess.mRenderPass = VK_NULL_HANDLE;
+    }
+    if (postProcess.mRenderPass == VK_NULL_HANDLE)
+    {
+        std::vector<VkAttachmentDescription> attachments;
+        auto addAttachment = [&](VkFormat format, VkSampleCountFlagBits samples, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, VkImageLayout finalLayout)
+        {
+            VkAttachmentDescription attachment{};
+            attachment.format = format;
+            attachment.samples = samples;
+            attachment.loadOp = loadOp;
+            attachment.storeOp = storeOp;
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            attachment.finalLayout = finalLayout;
+            attachments.push_back(attachment);
+        };
+
+        VkAttachmentReference colorRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkAttachmentReference resolveRef = { 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkAttachmentReference depthRef = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+        VkSubpassDescription subpassDesc{};
+        subpassDesc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpassDesc.colorAttachmentCount = 1;
+        subpassDesc.pColorAttachments = &colorRef;
+        subpassDesc.pDepthStencilAttachment = &depthRef;
+        if (mSettings.multiSampling)
+        {
+            addAttachment(postProcess.mFormat, sampleCount, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+            addAttachment(postProcess.mFormat, VK_SAMPLE_COUNT_1_BIT, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            addAttachment(mDepthFormat, sampleCount, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+            depthRef.attachment = 2;
+            subpassDesc.pResolveAttachments = &resolveRef;
+        }
+        else
+        {
+            addAttachment(postProcess.mFormat, VK_SAMPLE_COUNT_1_BIT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            addAttachment(mDepthFormat, VK_SAMPLE_COUNT_1_BIT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        }
+
+        // 深度与主Pass共用，前后都需要等待附件写入完成；结束后颜色在色调映射Pass中采样
+        std::array<VkSubpassDependency, 2> subpassDep{};
+        subpassDep[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        subpassDep[0].dstSubpass = 0;
+        subpassDep[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDep[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDep[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDep[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDep[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        subpassDep[1].srcSubpass = 0;
+        subpassDep[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        subpassDep[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDep[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDep[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDep[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDep[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        VkRenderPassCreateInfo renderPassCI = LeoVK::Init::RenderPassCreateInfo();
+        renderPassCI.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassCI.pAttachments = attachments.data();
+        renderPassCI.subpassCount = 1;
+        renderPassCI.pSubpasses = &subpassDesc;
+        renderPassCI.dependencyCount = static_cast<uint32_t>(subpassDep.size());
+        renderPassCI.pDependencies = subpassDep.data();
+        VK_CHECK(vkCreateRenderPass(mDevice, &renderPassCI, nullptr, &postProcess.mRenderPass))
+        postProcess.mSampleCount = sampleCount;
+    }
+
+    std::vector<VkImageView> attachments;
+    if (mSettings.multiSampling)
+    {
+        attachments = { postProcess.mMSColor.imageView, postProcess.mColor.imageView, mMSTarget.depth.imageView };
+    }
+    else
+    {
+        attachments = { postProcess.mColor.imageView, mDepthStencil.imageView };
+    }
+    VkFramebufferCreateInfo frameBufferCI = LeoVK::Init::FrameBufferCreateInfo();
+    frameBufferCI.renderPass = postProcess.mRenderPass;
+    frameBufferCI.attachmentCount = static_cast<uint32_t>(attachments.size());
+    frameBufferCI.pAttachments = attachments.data();
+    frameBufferCI.width = mWidth;
+    frameBufferCI.height = mHeight;
+    frameBufferCI.layers = 1;
+    VK_CHECK(vkCreateFramebuffer(mDevice, &frameBufferCI, nullptr, &postProcess.mFrameBuffer))
+
+    // 采样器和Descriptor只创建一次，之后只更新图像
+    if (postProcess.mDescPool == VK_NULL_HANDLE)
+    {
+        VkSamplerCreateInfo samplerCI = LeoVK::Init::SamplerCreateInfo();
+        samplerCI.magFilter = VK_FILTER_LINEAR;
+        samplerCI.minFilter = VK_FILTER_LINEAR;
+        samplerCI.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerCI.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCI.maxLod = 1.0f;
+        samplerCI.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+        postProcess.mSampler = mpVulkanDevice->AcquireSampler(samplerCI);
+
+        std::vector<VkDescriptorPoolSize> poolSizes = { LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1) };
+        VkDescriptorPoolCreateInfo descPoolCI = LeoVK::Init::DescPoolCreateInfo(poolSizes, 1);
+        VK_CHECK(vkCreateDescriptorPool(mDevice, &descPoolCI, nullptr, &postProcess.mDescPool))
+
+        std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+        };
+        VkDescriptorSetLayoutCreateInfo descSetLayoutCI = LeoVK::Init::DescSetLayoutCreateInfo(setLayoutBindings);
+        VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &descSetLayoutCI, nullptr, &postProcess.mDescSetLayout))
+
+        VkDescriptorSetAllocateInfo descSetAI = LeoVK::Init::DescSetAllocateInfo(postProcess.mDescPool, &postProcess.mDescSetLayout, 1);
+        VK_CHECK(vkAllocateDescriptorSets(mDevice, &descSetAI, &postProcess.mDescSet))
+    }
+    VkDescriptorImageInfo sceneColorDesc = LeoVK::Init::DescImageInfo(postProcess.mSampler, postProcess.mColor.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    VkWriteDescriptorSet writeDescSet = LeoVK::Init::WriteDescriptorSet(postProcess.mDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &sceneColorDesc);
+    vkUpdateDescriptorSets(mDevice, 1, &writeDescSet, 0, nullptr);
+}
+
+void VulkanRenderer::PreparePostProcess()
+{
+    VkPushConstantRange pushConstRange = LeoVK::Init::PushConstantRange(VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(TonemapPushConstants), 0);
+    VkPipelineLayoutCreateInfo pipelineLayoutCI = LeoVK::Init::PipelineLayoutCreateInfo(&mPostProcess.mDescSetLayout, 1);
+    pipelineLayoutCI.pushConstantRangeCount = 1;
+    pipelineLayoutCI.pPushConstantRanges = &pushConstRange;
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &pipelineLayoutCI, nullptr, &mPostProcess.mPipelineLayout))
+
+    RegisterPipelineSet("Tonemap", "Base/FullScreen.vert.spv", "VulkanRenderer/Tonemap.frag.spv");
+    mPipelines["Tonemap"] = CreateTonemapPipeline();
+}
+
+VkPipeline VulkanRenderer::CreateTonemapPipeline()
+{
+    VkPipelineInputAssemblyStateCreateInfo iaStateCI = LeoVK::Init::PipelineIAStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+    VkPipelineRasterizationStateCreateInfo rsStateCI = LeoVK::Init::PipelineRSStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+    VkPipelineColorBlendAttachmentState cbAttachCI = LeoVK::Init::PipelineCBAState(VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT, VK_FALSE);
+    VkPipelineColorBlendStateCreateInfo cbStateCI = LeoVK::Init::PipelineCBStateCreateInfo(1, &cbAttachCI);
+    VkPipelineDepthStencilStateCreateInfo dsStateCI = LeoVK::Init::PipelineDSStateCreateInfo(VK_FALSE, VK_FALSE, VK_COMPARE_OP_ALWAYS);
+    VkPipelineViewportStateCreateInfo vpStateCI = LeoVK::Init::PipelineVPStateCreateInfo(1, 1, 0);
+    VkPipelineMultisampleStateCreateInfo msStateCI = LeoVK::Init::PipelineMSStateCreateInfo(mSettings.multiSampling ? mSettings.sampleCount : VK_SAMPLE_COUNT_1_BIT, 0);
+    const std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dyStateCI = LeoVK::Init::PipelineDYStateCreateInfo(dynamicStateEnables.data(), static_cast<uint32_t>(dynamicStateEnables.size()), 0);
+    const std::array<VkPipelineShaderStageCreateInfo, 2>& ssStateCIs = mPipelineShaders.at("Tonemap");
+    VkPipelineVertexInputStateCreateInfo viStateCI = LeoVK::Init::PipelineVIStateCreateInfo();
+
+    // 写入交换链，与UI共用主Render Pass
+    VkGraphicsPipelineCreateInfo pipelineCI = LeoVK::Init::PipelineCreateInfo(mPostProcess.mPipelineLayout, mRenderPass, 0);
+    pipelineCI.pVertexInputState = &viStateCI;
+    pipelineCI.pInputAssemblyState = &iaStateCI;
+    pipelineCI.pRasterizationState = &rsStateCI;
+    pipelineCI.pColorBlendState = &cbStateCI;
+    pipelineCI.pMultisampleState = &msStateCI;
+    pipelineCI.pViewportState = &vpStateCI;
+    pipelineCI.pDepthStencilState = &dsStateCI;
+    pipelineCI.pDynamicState = &dyStateCI;
+    pipelineCI.stageCount = static_cast<uint32_t>(ssStateCIs.size());
+    pipelineCI.pStages = ssStateCIs.data();
+
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline))
+    return pipeline;
+}
+
+void VulkanRenderer::DrawTonemap(uint32_t cbIndex)
+{
+    PostProcess& postProcess = mPostProcess;
+    VkCommandBuffer cmdBuffer = mDrawCmdBuffers[cbIndex];
+    const VkViewport viewport = LeoVK::Init::Viewport((float)mWidth, (float)mHeight, 0.0f, 1.0f);
+    const VkRect2D scissor = LeoVK::Init::Rect2D((int)mWidth, (int)mHeight, 0, 0);
+    vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+    // 只采样左上角的渲染区域，UV限制在最后半个纹素以内，避免双线性过滤读到区域外的内容
+    const VkExtent2D renderExtent = GetRenderExtent();
+    TonemapPushConstants pushConsts{};
+    pushConsts.mUVScale = glm::vec2((float)renderExtent.width / (float)mWidth, (float)renderExtent.height / (float)mHeight);
+    pushConsts.mMaxUV = glm::vec2(((float)renderExtent.width - 0.5f) / (float)mWidth, ((float)renderExtent.height - 0.5f) / (float)mHeight);
+    pushConsts.mExposure = mUBOParams.mExposure;
+    pushConsts.mGamma = mUBOParams.mGamma;
+
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines["Tonemap"]);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, postProcess.mPipelineLayout, 0, 1, &postProcess.mDescSet, 0, nullptr);
+    vkCmdPushConstants(cmdBuffer, postProcess.mPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(TonemapPushConstants), &pushConsts);
+    vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+}
+
+void VulkanRenderer::DestroyPostProcess()
+{
+    PostProcess& postProcess = mPostProcess;
+    if (postProcess.mFrameBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyFramebuffer(mDevice, postProcess.mFrameBuffer, nullptr);
+        vkDestroyImageView(mDevice, postProcess.mColor.imageView, nullptr);
+        vkDestroyImage(mDevice, postProcess.mColor.image, nullptr);
+        mpVulkanDevice->FreeImageMemory(postProcess.mColor.image);
+    }
+    if (postProcess.mMSColor.image != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(mDevice, postProcess.mMSColor.imageView, nullptr);
+        vkDestroyImage(mDevice, postProcess.mMSColor.image, nullptr);
+        mpVulkanDevice->FreeImageMemory(postProcess.mMSColor.image);
+    }
+    if (postProcess.mRenderPass != VK_NULL_HANDLE) vkDestroyRenderPass(mDevice, postProcess.mRenderPass, nullptr);
+    if (postProcess.mPipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(mDevice, postProcess.mPipelineLayout, nullptr);
+    if (postProcess.mDescSetLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(mDevice, postProcess.mDescSetLayout, nullptr);
+    if (postProcess.mDescPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(mDevice, postProcess.mDescPool, nullptr);
+    mpVulkanDevice->ReleaseSampler(postProcess.mSampler);
+}
@@ -0,0 +1,101 @@
+#include "VulkanRenderer.hpp"
+
+// 投影时每个面采样的分辨率，漫反射辐照度只需要很低的频率
+#define SH_FACE_SIZE 64u
+#define SH_COEFF_COUNT 9
+
+void VulkanRenderer::ProjectEnvironmentSH()
+{
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+    };
+    VkDescriptorSetLayoutCreateInfo descSetLayoutCI = LeoVK::Init::DescSetLayoutCreateInfo(setLayoutBindings);
+    VkDescriptorSetLayout descSetLayout;
+    VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &descSetLayoutCI, nullptr, &descSetLayout))
+
+    std::vector<VkDescriptorPoolSize> poolSizes = {
+        LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1),
+        LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1),
+    };
+    VkDescriptorPoolCreateInfo descPoolCI = LeoVK::Init::DescPoolCreateInfo(poolSizes, 1);
+    VkDescriptorPool descPool;
+    VK_CHECK(vkCreateDescriptorPool(mDevice, &descPoolCI, nullptr, &descPool))
+
+    struct { uint32_t faceSize; float lod; } pushConsts;
+    VkPushConstantRange pushConstRange = LeoVK::Init::PushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(pushConsts), 0);
+    VkPipelineLayoutCreateInfo pipelineLayoutCI = LeoVK::Init::PipelineLayoutCreateInfo(&descSetLayout, 1);
+    pipelineLayoutCI.pushConstantRangeCount = 1;
+    pipelineLayoutCI.pPushConstantRanges = &pushConstRange;
+    VkPipelineLayout pipelineLayout;
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &pipelineLayoutCI, nullptr, &pipelineLayout))
+
+    VkComputePipelineCreateInfo computePipelineCI = LeoVK::Init::ComputePipelineCreateInfo(pipelineLayout);
+    computePipelineCI.stage = LoadShader(GetShadersPath() + "VulkanRenderer/ProjectSH.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateComputePipelines(mDevice, mPipelineCache, 1, &computePipelineCI, nullptr, &pipeline))
+
+    // 每个面写出9个系数，回读后在CPU上累加
+    LeoVK::Buffer faceCoeffsBuffer;
+    VK_CHECK(mpVulkanDevice->CreateBuffer(
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &faceCoeffsBuffer, sizeof(glm::vec4) * SH_COEFF_COUNT * 6))
+
+    VkDescriptorSet descSet;
+    VkDescriptorSetAllocateInfo descSetAI = LeoVK::Init::DescSetAllocateInfo(descPool, &descSetLayout, 1);
+    VK_CHECK(vkAllocateDescriptorSets(mDevice, &descSetAI, &descSet))
+    std::array<VkWriteDescriptorSet, 2> writeDescSets = {
+        LeoVK::Init::WriteDescriptorSet(descSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &mTextures.mEnvCube.mDescriptor),
+        LeoVK::Init::WriteDescriptorSet(descSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &faceCoeffsBuffer.mDescriptor),
+    };
+    vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writeDescSets.size()), writeDescSets.data(), 0, nullptr);
+
+    // 从接近投影分辨率的Mip采样，避免高分辨率环境贴图欠采样
+    const float maxLod = static_cast<float>(std::max(mTextures.mEnvCube.mMipLevels, 1u) - 1);
+    pushConsts.faceSize = SH_FACE_SIZE;
+    pushConsts.lod = std::clamp(std::log2((float)mTextures.mEnvCube.mWidth / (float)SH_FACE_SIZE), 0.0f, maxLod);
+
+    VkCommandBuffer cmdBuffer = mpVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descSet, 0, nullptr);
+    vkCmdPushConstants(cmdBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConsts), &pushConsts);
+    vkCmdDispatch(cmdBuffer, 1, 1, 6);
+
+    VkBufferMemoryBarrier bufferBarrier = LeoVK::Init::BufferMemoryBarrier();
+    bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = faceCoeffsBuffer.mBuffer;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+    mpVulkanDevice->FlushCommandBuffer(cmdBuffer, mQueue, true);
+
+    // 余弦卷积后再除以PI，与辐照度立方体贴图中存储的值一致
+    const float bandScale[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+    const int coeffBand[SH_COEFF_COUNT] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+    VK_CHECK(faceCoeffsBuffer.Map())
+    const glm::vec4* faceCoeffs = static_cast<const glm::vec4*>(faceCoeffsBuffer.mpMapped);
+    for (uint32_t i = 0; i < SH_COEFF_COUNT; i++)
+    {
+        glm::vec4 coeff(0.0f);
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            coeff += faceCoeffs[face * SH_COEFF_COUNT + i];
+        }
+        mUBOParams.mSHIrradiance[i] = coeff * bandScale[coeffBand[i]];
+    }
+    faceCoeffsBuffer.UnMap();
+
+    faceCoeffsBuffer.Destroy();
+    vkDestroyPipeline(mDevice, pipeline, nullptr);
+    vkDestroyPipelineLayout(mDevice, pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(mDevice, descPool, nullptr);
+    vkDestroyDescriptorSetLayout(mDevice, descSetLayout, nullptr);
+
+    mIBLTimings.mSH = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    std::cout << "Projecting environment to SH took " << mIBLTimings.mSH << " ms" << std::endl;
+}
@@ -0,0 +1,86 @@
+#include "VulkanRenderer.hpp"
+
+void VulkanRenderer::LoadSceneAsync(const std::string& filename)
+{
+    // 正在加载时先取消，等它结束后在CollectSceneLoad中开始新的加载
+    if (mpSceneLoad)
+    {
+        mpSceneLoad->mProgress.mbCancel = true;
+        mQueuedSceneFile = filename;
+        return;
+    }
+
+    std::cout << "Loading scene in background from: " << filename << std::endl;
+    mpSceneLoad = std::make_unique<SceneLoad>();
+    mpSceneLoad->mFilename = filename;
+    // 新场景的Descriptor分配到当前场景没有使用的分组，交换时再释放旧的
+    mpSceneLoad->mDescGroup = mSceneDescGroup == DESC_GROUP_SCENE ? DESC_GROUP_SCENE_BACK : DESC_GROUP_SCENE;
+
+    SceneLoad* load = mpSceneLoad.get();
+    const uint32_t loadingFlags = GetSceneLoadingFlags();
+    mSceneLoadThread.AddJob([this, load, loadingFlags]()
+    {
+        auto tStart = std::chrono::high_resolution_clock::now();
+        load->mbSucceeded = load->mScene.LoadFromFile(load->mFilename, mpVulkanDevice, mQueue, loadingFlags, 1.0f, &load->mProgress);
+        if (load->mbSucceeded && !load->mProgress.mbCancel)
+        {
+            load->mScene.LoadMaterialBuffer(load->mMaterialParamsBuffer, mQueue);
+            SetupSceneDescriptors(load->mScene, load->mDescGroup);
+        }
+        load->mLoadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+        load->mProgress.mProgress = 1.0f;
+        load->mbFinished = true;
+    });
+}
+
+uint32_t VulkanRenderer::GetSceneLoadingFlags() const
+{
+    uint32_t flags = LeoVK::FileLoadingFlags::None;
+    if (mbCompressTextures) flags |= LeoVK::FileLoadingFlags::CompressTextures;
+    if (mbStreamAssets) flags |= LeoVK::FileLoadingFlags::StreamAssets;
+    if (mbSmoothNormals) flags |= LeoVK::FileLoadingFlags::SmoothNormals;
+    return flags;
+}
+
+/**
+ * 在上一帧完成之后调用，场景交换后需要重新录制Command Buffer
+ */
+bool VulkanRenderer::CollectSceneLoad()
+{
+    if (!mpSceneLoad || !mpSceneLoad->mbFinished) return false;
+    std::unique_ptr<SceneLoad> load = std::move(mpSceneLoad);
+
+    bool bSwapped = false;
+    if (load->mbSucceeded && !load->mProgress.mbCancel)
+    {
+        std::swap(mScenes.mRenderScene, load->mScene);
+        std::swap(mUniformBuffers.mMaterialParamsBuffer, load->mMaterialParamsBuffer);
+        std::swap(mSceneDescGroup, load->mDescGroup);
+        std::cout << "Loading " << load->mFilename << " took " << load->mLoadTime << " ms" << std::endl;
+        ResetSceneState();
+        UpdateSceneDescriptors();
+        RequestScenePipelines(false);
+        bSwapped = true;
+    }
+    else if (!load->mProgress.mError.empty())
+    {
+        std::cout << load->mProgress.mError << std::endl;
+    }
+    else
+    {
+        std::cout << "Loading " << load->mFilename << " was cancelled" << std::endl;
+    }
+
+    // 被替换下来的旧场景，或者取消、失败的新场景，都在这一帧结束后销毁
+    load->mScene.Destroy(mDevice);
+    if (load->mMaterialParamsBuffer.mBuffer != VK_NULL_HANDLE) load->mMaterialParamsBuffer.DeferDestroy();
+    mDescAllocator.FreeGroup(load->mDescGroup);
+
+    if (!mQueuedSceneFile.empty())
+    {
+        std::string filename = std::move(mQueuedSceneFile);
+        mQueuedSceneFile.clear();
+        LoadSceneAsync(filename);
+    }
+    return bSwapped;
+}
@@ -0,0 +1,601 @@
+#include "VulkanRenderer.hpp"
+
+// 对数和均匀划分的混合比例
+#define SHADOW_SPLIT_LAMBDA 0.9f
+#define SHADOW_DEPTH_BIAS 0.0005f
+// 级联拟合时包围球的余量，以及当前范围超过需要的多少倍时收缩
+#define SHADOW_FIT_MARGIN 1.25f
+#define SHADOW_FIT_SHRINK 2.5f
+
+void VulkanRenderer::PrepareShadowMaps()
+{
+    ShadowMaps& shadow = mShadowMaps;
+
+    // D32需要同时支持作为深度附件和采样，否则使用必须支持的D16
+    VkFormatProperties formatProps;
+    vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, VK_FORMAT_D32_SFLOAT, &formatProps);
+    const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    shadow.mFormat = (formatProps.optimalTilingFeatures & requiredFeatures) == requiredFeatures ? VK_FORMAT_D32_SFLOAT : VK_FORMAT_D16_UNORM;
+
+    // Render Pass，三者只有加载和最终布局不同，彼此兼容
+    auto createRenderPass = [&](VkAttachmentLoadOp loadOp, VkImageLayout initialLayout, VkImageLayout finalLayout, VkRenderPass& renderPass)
+    {
+        VkAttachmentDescription attachment{};
+        attachment.format = shadow.mFormat;
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = loadOp;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = initialLayout;
+        attachment.finalLayout = finalLayout;
+
+        VkAttachmentReference depthRef{};
+        depthRef.attachment = 0;
+        depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpassDesc{};
+        subpassDesc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpassDesc.colorAttachmentCount = 0;
+        subpassDesc.pDepthStencilAttachment = &depthRef;
+
+        std::array<VkSubpassDependency, 2> subpassDep{};
+        // 等待之前的采样和缓存拷贝
+        subpassDep[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        subpassDep[0].dstSubpass = 0;
+        subpassDep[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        subpassDep[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDep[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        subpassDep[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDep[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        subpassDep[1].srcSubpass = 0;
+        subpassDep[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        subpassDep[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDep[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        subpassDep[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDep[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        subpassDep[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        VkRenderPassCreateInfo renderPassCI = LeoVK::Init::RenderPassCreateInfo();
+        renderPassCI.attachmentCount = 1;
+        renderPassCI.pAttachments = &attachment;
+        renderPassCI.subpassCount = 1;
+        renderPassCI.pSubpasses = &subpassDesc;
+        renderPassCI.dependencyCount = static_cast<uint32_t>(subpassDep.size());
+        renderPassCI.pDependencies = subpassDep.data();
+        VK_CHECK(vkCreateRenderPass(mDevice, &renderPassCI, nullptr, &renderPass))
+    };
+    createRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, shadow.mClearRenderPass);
+    createRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, shadow.mCacheRenderPass);
+    createRenderPass(VK_ATTACHMENT_LOAD_OP_LOAD, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, shadow.mLoadRenderPass);
+
+    // 每个级联占一层
+    auto createTarget = [&](RenderTarget& target, VkImageUsageFlags usage, std::array<VkImageView, SHADOW_CASCADE_COUNT>& layerViews, std::array<VkFramebuffer, SHADOW_CASCADE_COUNT>& frameBuffers)
+    {
+        VkImageCreateInfo imageCI = LeoVK::Init::ImageCreateInfo();
+        imageCI.imageType = VK_IMAGE_TYPE_2D;
+        imageCI.format = shadow.mFormat;
+        imageCI.extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1 };
+        imageCI.mipLevels = 1;
+        imageCI.arrayLayers = SHADOW_CASCADE_COUNT;
+        imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCI.usage = usage | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VK_CHECK(vkCreateImage(mDevice, &imageCI, nullptr, &target.image))
+
+        VK_CHECK(mpVulkanDevice->AllocateImageMemory(target.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Transient, LeoVK::MemoryCategory::RenderTarget, &target.memory))
+
+        VkImageViewCreateInfo imageViewCI = LeoVK::Init::ImageViewCreateInfo();
+        imageViewCI.image = target.image;
+        imageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        imageViewCI.format = shadow.mFormat;
+        imageViewCI.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, SHADOW_CASCADE_COUNT };
+        VK_CHECK(vkCreateImageView(mDevice, &imageViewCI, nullptr, &target.imageView))
+
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++)
+        {
+            imageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            imageViewCI.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, i, 1 };
+            VK_CHECK(vkCreateImageView(mDevice, &imageViewCI, nullptr, &layerViews[i]))
+
+            VkFramebufferCreateInfo frameBufferCI = LeoVK::Init::FrameBufferCreateInfo();
+            frameBufferCI.renderPass = shadow.mClearRenderPass;
+            frameBufferCI.attachmentCount = 1;
+            frameBufferCI.pAttachments = &layerViews[i];
+            frameBufferCI.width = SHADOW_MAP_SIZE;
+            frameBufferCI.height = SHADOW_MAP_SIZE;
+            frameBufferCI.layers = 1;
+            VK_CHECK(vkCreateFramebuffer(mDevice, &frameBufferCI, nullptr, &frameBuffers[i]))
+        }
+    };
+    createTarget(shadow.mShadowMap, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, shadow.mLayerViews, shadow.mFrameBuffers);
+    createTarget(shadow.mStaticCache, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, shadow.mCacheLayerViews, shadow.mCacheFrameBuffers);
+
+    // 阴影图在第一次渲染前也可能被采样，先清空为最远深度
+    {
+        VkCommandBuffer cmdBuffer = mpVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+        VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, SHADOW_CASCADE_COUNT };
+        LeoVK::VKTools::SetImageLayout(cmdBuffer, shadow.mShadowMap.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+        VkClearDepthStencilValue clearValue = { 1.0f, 0 };
+        vkCmdClearDepthStencilImage(cmdBuffer, shadow.mShadowMap.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearValue, 1, &subresourceRange);
+        VkImageMemoryBarrier imageBarrier = LeoVK::Init::ImageMemoryBarrier();
+        imageBarrier.image = shadow.mShadowMap.image;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageBarrier.subresourceRange = subresourceRange;
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+        mpVulkanDevice->FlushCommandBuffer(cmdBuffer, mQueue);
+    }
+
+    // 硬件深度比较，超出阴影图的区域视为没有遮挡
+    VkSamplerCreateInfo samplerCI = LeoVK::Init::SamplerCreateInfo();
+    samplerCI.magFilter = VK_FILTER_LINEAR;
+    samplerCI.minFilter = VK_FILTER_LINEAR;
+    samplerCI.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCI.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerCI.compareEnable = VK_TRUE;
+    samplerCI.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    samplerCI.maxLod = 1.0f;
+    samplerCI.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    shadow.mSampler = mpVulkanDevice->AcquireSampler(samplerCI);
+
+    VK_CHECK(mpVulkanDevice->CreateBuffer(
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &shadow.mUBO,
+        sizeof(UBOShadow)))
+    VK_CHECK(shadow.mUBO.Map())
+
+    // 静态缓存的更新录制到这里，和帧的Command Buffer一起提交
+    shadow.mStaticCmdBuffer = mpVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, mCmdPool, false);
+
+    if (mDeviceProps.limits.timestampComputeAndGraphics)
+    {
+        VkQueryPoolCreateInfo queryPoolCI{};
+        queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolCI.queryCount = static_cast<uint32_t>(mDrawCmdBuffers.size() + 1) * (SHADOW_CASCADE_COUNT + 1);
+        VK_CHECK(vkCreateQueryPool(mDevice, &queryPoolCI, nullptr, &shadow.mQueryPool))
+    }
+}
+
+void VulkanRenderer::PrepareShadowPipelines()
+{
+    ShadowMaps& shadow = mShadowMaps;
+    // Set 0和Set 2与前向渲染一致，Set 1不使用
+    std::array<VkDescriptorSetLayout, 3> descSetLayouts = { mDescSetLayout.mUniformDescSetLayout, mDescSetLayout.mTextureDescSetLayout, mDescSetLayout.mNodeDescSetLayout };
+    VkPipelineLayoutCreateInfo pipelineLayoutCI = LeoVK::Init::PipelineLayoutCreateInfo(descSetLayouts.data(), static_cast<uint32_t>(descSetLayouts.size()));
+    VkPushConstantRange pushConstRange = LeoVK::Init::PushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, sizeof(uint32_t), 0);
+    pipelineLayoutCI.pushConstantRangeCount = 1;
+    pipelineLayoutCI.pPushConstantRanges = &pushConstRange;
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &pipelineLayoutCI, nullptr, &shadow.mPipelineLayout))
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+    mPipelines["Shadow"] = CreateShadowPipeline(false);
+    mPipelines["Shadow_Skinned"] = CreateShadowPipeline(true);
+    auto tPipelines = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    std::cout << "Creating shadow pipelines took " << tPipelines << " ms" << std::endl;
+}
+
+VkPipeline VulkanRenderer::CreateShadowPipeline(bool skinned)
+{
+    VkPipelineInputAssemblyStateCreateInfo iaStateCI = LeoVK::Init::PipelineIAStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+    // 不剔除背面，双面材质和开口的模型同样投射阴影
+    VkPipelineRasterizationStateCreateInfo rsStateCI = LeoVK::Init::PipelineRSStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+    rsStateCI.depthBiasEnable = VK_TRUE;
+    rsStateCI.depthBiasConstantFactor = 1.25f;
+    rsStateCI.depthBiasSlopeFactor = 1.75f;
+    VkPipelineColorBlendStateCreateInfo cbStateCI = LeoVK::Init::PipelineCBStateCreateInfo(0, nullptr);
+    VkPipelineDepthStencilStateCreateInfo dsStateCI = LeoVK::Init::PipelineDSStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+    VkPipelineViewportStateCreateInfo vpStateCI = LeoVK::Init::PipelineVPStateCreateInfo(1, 1, 0);
+    VkPipelineMultisampleStateCreateInfo msStateCI = LeoVK::Init::PipelineMSStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
+    const std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dyStateCI = LeoVK::Init::PipelineDYStateCreateInfo(dynamicStateEnables.data(), static_cast<uint32_t>(dynamicStateEnables.size()), 0);
+
+    // 静态物体只读取位置，蒙皮物体额外读取骨骼和权重
+    const std::vector<VkVertexInputBindingDescription> viBindings = {
+        LeoVK::Init::VIBindingDescription(0, sizeof(LeoVK::Vertex), VK_VERTEX_INPUT_RATE_VERTEX),
+    };
+    std::vector<VkVertexInputAttributeDescription> viAttributes = {
+        LeoVK::Init::VIAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LeoVK::Vertex, mPos)),
+    };
+    if (skinned)
+    {
+        viAttributes.push_back(LeoVK::Init::VIAttributeDescription(0, 5, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mJoint0)));
+        viAttributes.push_back(LeoVK::Init::VIAttributeDescription(0, 6, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mWeight0)));
+    }
+    VkPipelineVertexInputStateCreateInfo viStateCI = LeoVK::Init::PipelineVIStateCreateInfo(viBindings, viAttributes);
+
+    const VkPipelineShaderStageCreateInfo vertexShader = LoadShader(GetShadersPath() + (skinned ? "VulkanRenderer/ShadowMapSkinned.vert.spv" : "VulkanRenderer/ShadowMap.vert.spv"), VK_SHADER_STAGE_VERTEX_BIT);
+
+    VkGraphicsPipelineCreateInfo pipelineCI = LeoVK::Init::PipelineCreateInfo(mShadowMaps.mPipelineLayout, mShadowMaps.mClearRenderPass, 0);
+    pipelineCI.pVertexInputState = &viStateCI;
+    pipelineCI.pInputAssemblyState = &iaStateCI;
+    pipelineCI.pRasterizationState = &rsStateCI;
+    pipelineCI.pColorBlendState = &cbStateCI;
+    pipelineCI.pMultisampleState = &msStateCI;
+    pipelineCI.pViewportState = &vpStateCI;
+    pipelineCI.pDepthStencilState = &dsStateCI;
+    pipelineCI.pDynamicState = &dyStateCI;
+    pipelineCI.stageCount = 1;
+    pipelineCI.pStages = &vertexShader;
+
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline))
+    return pipeline;
+}
+
+void VulkanRenderer::UpdateShadowCascades()
+{
+    ShadowMaps& shadow = mShadowMaps;
+    if (shadow.mUBO.mBuffer == VK_NULL_HANDLE || glm::length(glm::vec3(mUBOParams.mLight)) == 0.0f) return;
+
+    // 光源方向与Shader中的L一致，指向光源
+    const glm::vec3 lightDir = glm::normalize(glm::vec3(mUBOParams.mLight));
+    const glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+    // 场景包围盒变换到渲染空间
+    const glm::mat4& model = mSceneUBOMatrices.mModel;
+    const glm::vec3 sceneMin = glm::vec3(mScenes.mRenderScene.mAABB[3]);
+    const glm::vec3 sceneSize = glm::vec3(mScenes.mRenderScene.mAABB[0][0], mScenes.mRenderScene.mAABB[1][1], mScenes.mRenderScene.mAABB[2][2]);
+    std::array<glm::vec3, 8> sceneCorners;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        const glm::vec3 corner = sceneMin + sceneSize * glm::vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+        sceneCorners[i] = glm::vec3(model * glm::vec4(corner, 1.0f)) * glm::vec3(1.0f, -1.0f, 1.0f);
+    }
+
+    // 级联只覆盖到场景为止，而不是整个相机远平面
+    const glm::mat4& view = mCamera.mMatrices.mView;
+    const float camNear = mCamera.GetNearClip();
+    const float camFar = mCamera.GetFarClip();
+    float sceneNear = camFar;
+    float sceneFar = camNear;
+    for (auto& corner : sceneCorners)
+    {
+        const float depth = -(view * glm::vec4(corner, 1.0f)).z;
+        sceneNear = std::min(sceneNear, depth);
+        sceneFar = std::max(sceneFar, depth);
+    }
+    const float shadowFar = glm::clamp(sceneFar, camNear * 2.0f, camFar);
+    const float shadowNear = glm::clamp(sceneNear, std::max(camNear, shadowFar * 0.005f), shadowFar * 0.5f);
+
+    // 相机视锥体在近、远平面上的角点
+    const glm::mat4 invCamera = glm::inverse(mCamera.mMatrices.mPerspective * view);
+    std::array<glm::vec3, 8> frustumCorners;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        const glm::vec4 corner = invCamera * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : 0.0f, 1.0f);
+        frustumCorners[i] = glm::vec3(corner) / corner.w;
+    }
+
+    // 光源方向或场景范围变化时所有级联重新拟合
+    const bool bRefitAll = lightDir != shadow.mFitLightDir || sceneCorners != shadow.mFitSceneCorners;
+    shadow.mFitLightDir = lightDir;
+    shadow.mFitSceneCorners = sceneCorners;
+
+    float lastSplit = camNear;
+    for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+    {
+        const float p = (float)(cascade + 1) / (float)SHADOW_CASCADE_COUNT;
+        const float logSplit = shadowNear * std::pow(shadowFar / shadowNear, p);
+        const float uniformSplit = shadowNear + (shadowFar - shadowNear) * p;
+        const float split = SHADOW_SPLIT_LAMBDA * (logSplit - uniformSplit) + uniformSplit;
+
+        // 沿视锥体的棱插值出当前级联的8个角点
+        std::array<glm::vec3, 8> corners;
+        glm::vec3 center = glm::vec3(0.0f);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            const glm::vec3 edge = frustumCorners[i + 4] - frustumCorners[i];
+            corners[i] = frustumCorners[i] + edge * ((lastSplit - camNear) / (camFar - camNear));
+            corners[i + 4] = frustumCorners[i] + edge * ((split - camNear) / (camFar - camNear));
+            center += corners[i] + corners[i + 4];
+        }
+        center /= 8.0f;
+
+        // 用包围球保证相机旋转时级联大小不变
+        float radius = 0.0f;
+        for (auto& corner : corners) radius = std::max(radius, glm::length(corner - center));
+
+        shadow.mUBOData.mSplitDepths[cascade] = split;
+        lastSplit = split;
+
+        // 当前的投影仍然包含这段视锥体并且没有大太多时保持不变，静态缓存继续有效
+        const glm::vec4& fit = shadow.mCascadeFits[cascade];
+        const bool bCovered = fit.w > 0.0f && glm::length(center - glm::vec3(fit)) + radius <= fit.w && fit.w <= radius * SHADOW_FIT_SHRINK;
+        if (bCovered && !bRefitAll) continue;
+
+        // 留出余量后半径按2的1/4次幂取整，中心对齐到半径1/8的世界网格，只在相机移动较远时才需要重新拟合
+        const float fitRadius = std::exp2(std::ceil(std::log2(radius * SHADOW_FIT_MARGIN) * 4.0f) / 4.0f);
+        const float gridSize = fitRadius / 8.0f;
+        const glm::vec3 fitCenter = glm::round(center / gridSize) * gridSize;
+        shadow.mCascadeFits[cascade] = glm::vec4(fitCenter, fitRadius);
+
+        const glm::mat4 lightView = glm::lookAt(fitCenter + lightDir * fitRadius, fitCenter, up);
+        // 光源和级联之间的物体同样需要投射阴影
+        float casterNear = 0.0f;
+        for (auto& corner : sceneCorners) casterNear = std::min(casterNear, -(lightView * glm::vec4(corner, 1.0f)).z);
+        glm::mat4 lightProj = glm::ortho(-fitRadius, fitRadius, -fitRadius, fitRadius, casterNear, fitRadius * 2.0f);
+
+        // 对齐到纹素，避免重新拟合前后阴影边缘闪烁
+        const glm::vec4 origin = lightProj * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) * (SHADOW_MAP_SIZE * 0.5f);
+        const glm::vec2 offset = (glm::round(glm::vec2(origin)) - glm::vec2(origin)) * (2.0f / SHADOW_MAP_SIZE);
+        lightProj[3][0] += offset.x;
+        lightProj[3][1] += offset.y;
+
+        // 投影变化后这一级的静态缓存失效
+        shadow.mUBOData.mCascadeViewProj[cascade] = lightProj * lightView;
+        shadow.mStaticDirtyMask |= 1u << cascade;
+    }
+    UpdateShadowParams();
+}
+
+void VulkanRenderer::UpdateShadowParams()
+{
+    ShadowMaps& shadow = mShadowMaps;
+    if (shadow.mUBO.mBuffer == VK_NULL_HANDLE) return;
+    shadow.mUBOData.mParams = glm::vec4(shadow.mbEnabled ? 1.0f : 0.0f, 1.0f / SHADOW_MAP_SIZE, SHADOW_DEPTH_BIAS, (float)SHADOW_CASCADE_COUNT);
+    memcpy(shadow.mUBO.mpMapped, &shadow.mUBOData, sizeof(UBOShadow));
+}
+
+void VulkanRenderer::GatherShadowItems(const std::vector<DrawItem>& drawItems)
+{
+    ShadowMaps& shadow = mShadowMaps;
+    std::vector<DrawItem> staticItems;
+    shadow.mDynamicItems.clear();
+
+    // 动画通道作用的节点及其子节点每帧都可能变化
+    std::unordered_set<LeoVK::Node*> animatedNodes;
+    for (auto& animation : mScenes.mRenderScene.mAnimations)
+    {
+        for (auto& channel : animation.mChannels) animatedNodes.insert(channel.mpNode);
+    }
+    auto isDynamic = [&](LeoVK::Node* node)
+    {
+        if (node->mpSkin) return true;
+        for (LeoVK::Node* current = node; current; current = current->mpParent)
+        {
+            if (animatedNodes.count(current)) return true;
+        }
+        return false;
+    };
+
+    // 只有不透明物体投射阴影，Alpha Mask需要采样纹理，不适合只读取位置的Pipeline
+    for (auto& drawItem : drawItems)
+    {
+        if (drawItem.mpPrimitive->mMaterial.mAlphaMode != LeoVK::Material::ALPHA_MODE_OPAQUE) continue;
+        if (isDynamic(drawItem.mpNode)) shadow.mDynamicItems.push_back(drawItem);
+        else staticItems.push_back(drawItem);
+    }
+
+    // Command Buffer重新录制很频繁，只有静态物体本身变化时缓存才失效
+    const bool bStaticChanged = staticItems.size() != shadow.mStaticItems.size() ||
+        !std::equal(staticItems.begin(), staticItems.end(), shadow.mStaticItems.begin(), [](const DrawItem& a, const DrawItem& b)
+        {
+            return a.mpNode == b.mpNode && a.mpPrimitive == b.mpPrimitive;
+        });
+    if (bStaticChanged) shadow.mStaticDirtyMask = SHADOW_ALL_CASCADES;
+    shadow.mStaticItems.swap(staticItems);
+}
+
+void VulkanRenderer::DrawShadowItems(VkCommandBuffer cmdBuffer, const std::vector<DrawItem>& drawItems, uint32_t cascade)
+{
+    ShadowMaps& shadow = mShadowMaps;
+    const VkViewport viewport = LeoVK::Init::Viewport((float)SHADOW_MAP_SIZE, (float)SHADOW_MAP_SIZE, 0.0f, 1.0f);
+    const VkRect2D scissor = LeoVK::Init::Rect2D(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 0, 0);
+    vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+    VkDeviceSize offsets[1] = {0};
+    vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &mScenes.mRenderScene.mVertices.mBuffer, offsets);
+    vkCmdBindIndexBuffer(cmdBuffer, mScenes.mRenderScene.mIndices.mBuffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadow.mPipelineLayout, 0, 1, &mDescSets.mObjectDescSet, 0, nullptr);
+    vkCmdPushConstants(cmdBuffer, shadow.mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &cascade);
+
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    for (auto& drawItem : drawItems)
+    {
+        LeoVK::Primitive* primitive = drawItem.mpPrimitive;
+        const VkPipeline pipeline = mPipelines[drawItem.mpNode->mpSkin ? "Shadow_Skinned" : "Shadow"];
+        if (pipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        }
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadow.mPipelineLayout, 2, 1, &drawItem.mpNode->mpMesh->mUniformBuffer.mDescriptorSet, 0, nullptr);
+        if (primitive->mbHasIndices)
+        {
+            vkCmdDrawIndexed(cmdBuffer, primitive->mIndexCount, 1, primitive->mFirstIndex, 0, 0);
+        }
+        else
+        {
+            vkCmdDraw(cmdBuffer, primitive->mVertexCount, 1, 0, 0);
+        }
+    }
+}
+
+void VulkanRenderer::RecordStaticShadows()
+{
+    ShadowMaps& shadow = mShadowMaps;
+    const uint32_t dirtyMask = shadow.mStaticDirtyMask;
+    shadow.mStaticDirtyMask = 0;
+    if (dirtyMask == 0 || !shadow.mbEnabled || !shadow.mbCacheStatic) return;
+
+    // 没有动态物体时静态物体直接渲染到阴影图，每帧不再需要拷贝
+    const bool bCopyToShadowMap = !shadow.mDynamicItems.empty();
+    const uint32_t queryBase = static_cast<uint32_t>(mDrawCmdBuffers.size()) * (SHADOW_CASCADE_COUNT + 1);
+
+    // 和这一帧的Command Buffer一起提交，不需要等待GPU完成
+    VkCommandBuffer cmdBuffer = shadow.mStaticCmdBuffer;
+    VkCommandBufferBeginInfo cmdBI = LeoVK::Init::CmdBufferBeginInfo();
+    cmdBI.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(cmdBuffer, &cmdBI))
+    if (shadow.mQueryPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(cmdBuffer, shadow.mQueryPool, queryBase, SHADOW_CASCADE_COUNT + 1);
+        vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, shadow.mQueryPool, queryBase);
+    }
+
+    VkClearValue clearValue;
+    clearValue.depthStencil = { 1.0f, 0 };
+    VkRenderPassBeginInfo rpBI = LeoVK::Init::RenderPassBeginInfo();
+    rpBI.renderPass = bCopyToShadowMap ? shadow.mCacheRenderPass : shadow.mClearRenderPass;
+    rpBI.renderArea.extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE };
+    rpBI.clearValueCount = 1;
+    rpBI.pClearValues = &clearValue;
+    for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+    {
+        // 只重新渲染投影变化的级联，其余级联的缓存保持不变
+        if (dirtyMask & (1u << cascade))
+        {
+            rpBI.framebuffer = bCopyToShadowMap ? shadow.mCacheFrameBuffers[cascade] : shadow.mFrameBuffers[cascade];
+            vkCmdBeginRenderPass(cmdBuffer, &rpBI, VK_SUBPASS_CONTENTS_INLINE);
+            DrawShadowItems(cmdBuffer, shadow.mStaticItems, cascade);
+            vkCmdEndRenderPass(cmdBuffer);
+        }
+        if (shadow.mQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, shadow.mQueryPool, queryBase + cascade + 1);
+        }
+    }
+    VK_CHECK(vkEndCommandBuffer(cmdBuffer))
+    shadow.mStaticUpdates++;
+    shadow.mStaticSubmittedMask = dirtyMask;
+    shadow.mbStaticPending = true;
+}
+
+void VulkanRenderer::DrawShadowMaps(uint32_t cbIndex)
+{
+    ShadowMaps& shadow = mShadowMaps;
+    if (!shadow.mbEnabled) return;
+    // 静态缓存开启且没有动态物体时，阴影图只在RenderStaticShadows中更新
+    if (shadow.mbCacheStatic && shadow.mDynamicItems.empty()) return;
+
+    VkCommandBuffer cmdBuffer = mDrawCmdBuffers[cbIndex];
+    const uint32_t queryBase = cbIndex * (SHADOW_CASCADE_COUNT + 1);
+    if (shadow.mQueryPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(cmdBuffer, shadow.mQueryPool, queryBase, SHADOW_CASCADE_COUNT + 1);
+    }
+
+    if (shadow.mbCacheStatic)
+    {
+        // 用静态缓存覆盖上一帧的阴影图
+        VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, SHADOW_CASCADE_COUNT };
+        VkImageMemoryBarrier imageBarrier = LeoVK::Init::ImageMemoryBarrier();
+        imageBarrier.image = shadow.mShadowMap.image;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageBarrier.subresourceRange = subresourceRange;
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+        VkImageCopy copyRegion{};
+        copyRegion.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, SHADOW_CASCADE_COUNT };
+        copyRegion.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, SHADOW_CASCADE_COUNT };
+        copyRegion.extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1 };
+        vkCmdCopyImage(cmdBuffer, shadow.mStaticCache.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, shadow.mShadowMap.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+    }
+    if (shadow.mQueryPool != VK_NULL_HANDLE)
+    {
+        vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, shadow.mQueryPool, queryBase);
+    }
+
+    // 不使用缓存时每帧重新绘制所有物体，用于对比
+    VkClearValue clearValue;
+    clearValue.depthStencil = { 1.0f, 0 };
+    VkRenderPassBeginInfo rpBI = LeoVK::Init::RenderPassBeginInfo();
+    rpBI.renderPass = shadow.mbCacheStatic ? shadow.mLoadRenderPass : shadow.mClearRenderPass;
+    rpBI.renderArea.extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE };
+    rpBI.clearValueCount = 1;
+    rpBI.pClearValues = &clearValue;
+    for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+    {
+        rpBI.framebuffer = shadow.mFrameBuffers[cascade];
+        vkCmdBeginRenderPass(cmdBuffer, &rpBI, VK_SUBPASS_CONTENTS_INLINE);
+        if (!shadow.mbCacheStatic) DrawShadowItems(cmdBuffer, shadow.mStaticItems, cascade);
+        DrawShadowItems(cmdBuffer, shadow.mDynamicItems, cascade);
+        vkCmdEndRenderPass(cmdBuffer);
+        if (shadow.mQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, shadow.mQueryPool, queryBase + cascade + 1);
+        }
+    }
+}
+
+void VulkanRenderer::ReadShadowTimings()
+{
+    ShadowMaps& shadow = mShadowMaps;
+    if (shadow.mQueryPool == VK_NULL_HANDLE || !shadow.mbEnabled) return;
+
+    // 静态缓存和上一帧一起提交，帧结束后结果已经可用
+    if (shadow.mStaticSubmittedMask != 0)
+    {
+        std::array<uint64_t, SHADOW_CASCADE_COUNT + 1> timestamps{};
+        VkResult result = vkGetQueryPoolResults(
+            mDevice, shadow.mQueryPool, static_cast<uint32_t>(mDrawCmdBuffers.size()) * (SHADOW_CASCADE_COUNT + 1), static_cast<uint32_t>(timestamps.size()),
+            sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS)
+        {
+            for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+            {
+                if (!(shadow.mStaticSubmittedMask & (1u << cascade))) continue;
+                shadow.mStaticTimings[cascade] = (float)(timestamps[cascade + 1] - timestamps[cascade]) * mDeviceProps.limits.timestampPeriod / 1000000.0f;
+            }
+        }
+        shadow.mStaticSubmittedMask = 0;
+    }
+    if (shadow.mbCacheStatic && shadow.mDynamicItems.empty())
+    {
+        shadow.mFrameTimings.fill(0.0f);
+        return;
+    }
+
+    std::array<uint64_t, SHADOW_CASCADE_COUNT + 1> timestamps{};
+    VkResult result = vkGetQueryPoolResults(
+        mDevice, shadow.mQueryPool, mCurrentBuffer * (SHADOW_CASCADE_COUNT + 1), static_cast<uint32_t>(timestamps.size()),
+        sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) return;
+
+    for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+    {
+        const float timing = (float)(timestamps[cascade + 1] - timestamps[cascade]) * mDeviceProps.limits.timestampPeriod / 1000000.0f;
+        shadow.mFrameTimings[cascade] = shadow.mFrameTimings[cascade] * 0.95f + timing * 0.05f;
+    }
+}
+
+void VulkanRenderer::DestroyShadowMaps()
+{
+    ShadowMaps& shadow = mShadowMaps;
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        if (shadow.mFrameBuffers[i] != VK_NULL_HANDLE) vkDestroyFramebuffer(mDevice, shadow.mFrameBuffers[i], nullptr);
+        if (shadow.mCacheFrameBuffers[i] != VK_NULL_HANDLE) vkDestroyFramebuffer(mDevice, shadow.mCacheFrameBuffers[i], nullptr);
+        if (shadow.mLayerViews[i] != VK_NULL_HANDLE) vkDestroyImageView(mDevice, shadow.mLayerViews[i], nullptr);
+        if (shadow.mCacheLayerViews[i] != VK_NULL_HANDLE) vkDestroyImageView(mDevice, shadow.mCacheLayerViews[i], nullptr);
+    }
+    for (RenderTarget* target : { &shadow.mShadowMap, &shadow.mStaticCache })
+    {
+        if (target->image == VK_NULL_HANDLE) continue;
+        vkDestroyImageView(mDevice, target->imageView, nullptr);
+        vkDestroyImage(mDevice, target->image, nullptr);
+        mpVulkanDevice->FreeImageMemory(target->image);
+    }
+    if (shadow.mUBO.mBuffer != VK_NULL_HANDLE) shadow.mUBO.Destroy();
+    if (shadow.mStaticCmdBuffer != VK_NULL_HANDLE) vkFreeCommandBuffers(mDevice, mCmdPool, 1, &shadow.mStaticCmdBuffer);
+    if (shadow.mQueryPool != VK_NULL_HANDLE) vkDestroyQueryPool(mDevice, shadow.mQueryPool, nullptr);
+    if (shadow.mPipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(mDevice, shadow.mPipelineLayout, nullptr);
+    mpVulkanDevice->ReleaseSampler(shadow.mSampler);
+    for (VkRenderPass renderPass : { shadow.mClearRenderPass, shadow.mCacheRenderPass, shadow.mLoadRenderPass })
+    {
+        if (renderPass != VK_NULL_HANDLE) vkDestroyRenderPass(mDevice, renderPass, nullptr);
+    }
+}
@@ -0,0 +1,507 @@
+#include "VulkanRenderer.hpp"
+
+std::string VulkanRenderer::GetVisibilityFallbackReason()
+{
+    if (!mbVisibilityBuffer || !mVisibilityBuffer.mbSupported) return "";
+    // ID只有单采样，MSAA时解析Pass逐像素着色会丢失边缘的抗锯齿，退回前向渲染。
+    // 选择Visibility Buffer时会切换到单采样，只有之后又手动开启MSAA时才会走到这里
+    if (mSettings.multiSampling) return "MSAA is enabled";
+    // 解析Pass的纹理数组大小固定，场景纹理放不下时同样退回前向渲染
+    if (mScenes.mRenderScene.mTextures.size() > MAX_VISIBILITY_TEXTURES)
+    {
+        return "scene has " + std::to_string(mScenes.mRenderScene.mTextures.size()) + " textures, limit is " + std::to_string(MAX_VISIBILITY_TEXTURES);
+    }
+    return "";
+}
+
+bool VulkanRenderer::IsVisibilityBufferActive()
+{
+    return mbVisibilityBuffer && mVisibilityBuffer.mbSupported && GetVisibilityFallbackReason().empty();
+}
+
+void VulkanRenderer::PrepareVisibilityBuffer()
+{
+    if (!mVisibilityBuffer.mbSupported) return;
+
+    // ID和深度在解析Pass中按像素读取，不需要过滤
+    VkSamplerCreateInfo samplerCI = LeoVK::Init::SamplerCreateInfo();
+    samplerCI.magFilter = VK_FILTER_NEAREST;
+    samplerCI.minFilter = VK_FILTER_NEAREST;
+    samplerCI.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCI.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCI.maxLod = 1.0f;
+    samplerCI.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    mVisibilityBuffer.mSampler = mpVulkanDevice->AcquireSampler(samplerCI);
+
+    // Render Pass
+    {
+        std::array<VkAttachmentDescription, 2> attachments{};
+        // DrawID和PrimitiveID
+        attachments[0].format = VK_FORMAT_R32G32_UINT;
+        attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[0].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        // 解析Pass把深度写回主Pass，供后续的前向绘制使用
+        attachments[1].format = VK_FORMAT_D32_SFLOAT;
+        attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+        VkAttachmentReference colorRef{};
+        colorRef.attachment = 0;
+        colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference depthRef{};
+        depthRef.attachment = 1;
+        depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpassDesc{};
+        subpassDesc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpassDesc.colorAttachmentCount = 1;
+        subpassDesc.pColorAttachments = &colorRef;
+        subpassDesc.pDepthStencilAttachment = &depthRef;
+
+        std::array<VkSubpassDependency, 2> subpassDep{};
+        // 上一帧的解析Pass读取完成后才能覆盖
+        subpassDep[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        subpassDep[0].dstSubpass = 0;
+        subpassDep[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        subpassDep[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDep[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        subpassDep[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDep[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        subpassDep[1].srcSubpass = 0;
+        subpassDep[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        subpassDep[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDep[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        subpassDep[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDep[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        subpassDep[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        VkRenderPassCreateInfo renderPassCI = LeoVK::Init::RenderPassCreateInfo();
+        renderPassCI.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassCI.pAttachments = attachments.data();
+        renderPassCI.subpassCount = 1;
+        renderPassCI.pSubpasses = &subpassDesc;
+        renderPassCI.dependencyCount = static_cast<uint32_t>(subpassDep.size());
+        renderPassCI.pDependencies = subpassDep.data();
+        VK_CHECK(vkCreateRenderPass(mDevice, &renderPassCI, nullptr, &mVisibilityBuffer.mRenderPass))
+    }
+
+    // Descriptor Set Layout
+    {
+        std::vector<VkDescriptorSetLayoutBinding> resolveSetLayoutBindings = {
+            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
+            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
+            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4, MAX_VISIBILITY_TEXTURES),
+        };
+        mVisibilityBuffer.mResolveDescSetLayout = mDescAllocator.GetLayout(resolveSetLayoutBindings);
+
+        std::vector<VkDescriptorSetLayoutBinding> drawSetLayoutBindings = {
+            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+        };
+        mVisibilityBuffer.mDrawDescSetLayout = mDescAllocator.GetLayout(drawSetLayoutBindings);
+    }
+
+    // Pipeline Layout，Set 0和Set 3与前向渲染一致
+    {
+        std::array<VkDescriptorSetLayout, 4> geometrySetLayouts = { mDescSetLayout.mUniformDescSetLayout, mDescSetLayout.mTextureDescSetLayout, mVisibilityBuffer.mDrawDescSetLayout, mDescSetLayout.mMaterialBufferDescSetLayout };
+        VkPipelineLayoutCreateInfo geometryLayoutCI = LeoVK::Init::PipelineLayoutCreateInfo(geometrySetLayouts.data(), static_cast<uint32_t>(geometrySetLayouts.size()));
+        VkPushConstantRange pushConstRange = LeoVK::Init::PushConstantRange(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(uint32_t) * 2, 0);
+        geometryLayoutCI.pushConstantRangeCount = 1;
+        geometryLayoutCI.pPushConstantRanges = &pushConstRange;
+        VK_CHECK(vkCreatePipelineLayout(mDevice, &geometryLayoutCI, nullptr, &mVisibilityBuffer.mGeometryPipelineLayout))
+
+        std::array<VkDescriptorSetLayout, 4> resolveSetLayouts = { mDescSetLayout.mUniformDescSetLayout, mVisibilityBuffer.mResolveDescSetLayout, mVisibilityBuffer.mDrawDescSetLayout, mDescSetLayout.mMaterialBufferDescSetLayout };
+        VkPipelineLayoutCreateInfo resolveLayoutCI = LeoVK::Init::PipelineLayoutCreateInfo(resolveSetLayouts.data(), static_cast<uint32_t>(resolveSetLayouts.size()));
+        VK_CHECK(vkCreatePipelineLayout(mDevice, &resolveLayoutCI, nullptr, &mVisibilityBuffer.mResolvePipelineLayout))
+    }
+
+    RegisterPipelineSet("Visibility", "VulkanRenderer/VisibilityBuffer.vert.spv", "VulkanRenderer/VisibilityBuffer.frag.spv");
+    RegisterPipelineSet("VisibilityResolve", "Base/FullScreen.vert.spv", "VulkanRenderer/VisibilityResolve.frag.spv");
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+    mPipelines["Visibility"] = CreateVisibilityPipeline(false, false);
+    mPipelines["Visibility_Double_Sided"] = CreateVisibilityPipeline(false, true);
+    mPipelines["Visibility_Alpha_Mask"] = CreateVisibilityPipeline(true, false);
+    mPipelines["Visibility_Alpha_Mask_Double_Sided"] = CreateVisibilityPipeline(true, true);
+    mPipelines["VisibilityResolve"] = CreateVisibilityResolvePipeline();
+    auto tPipelines = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    std::cout << "Creating visibility buffer pipelines took " << tPipelines << " ms" << std::endl;
+
+    SetupVisibilityTargets();
+    SetupVisibilityDescriptors();
+}
+
+void VulkanRenderer::SetupVisibilityTargets()
+{
+    VisibilityBuffer& visBuffer = mVisibilityBuffer;
+    if (visBuffer.mWidth == mWidth && visBuffer.mHeight == mHeight) return;
+
+    if (visBuffer.mWidth != 0)
+    {
+        vkDestroyFramebuffer(mDevice, visBuffer.mFrameBuffer, nullptr);
+        for (RenderTarget* target : { &visBuffer.mIDTarget, &visBuffer.mDepthTarget })
+        {
+            vkDestroyImageView(mDevice, target->imageView, nullptr);
+            vkDestroyImage(mDevice, target->image, nullptr);
+            mpVulkanDevice->FreeImageMemory(target->image);
+        }
+    }
+
+    auto createTarget = [&](RenderTarget& target, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect)
+    {
+        VkImageCreateInfo imageCI = LeoVK::Init::ImageCreateInfo();
+        imageCI.imageType = VK_IMAGE_TYPE_2D;
+        imageCI.format = format;
+        imageCI.extent = { mWidth, mHeight, 1 };
+        imageCI.mipLevels = 1;
+        imageCI.arrayLayers = 1;
+        imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCI.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VK_CHECK(vkCreateImage(mDevice, &imageCI, nullptr, &target.image))
+
+        VK_CHECK(mpVulkanDevice->AllocateImageMemory(target.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, LeoVK::MemoryPool::Transient, LeoVK::MemoryCategory::RenderTarget, &target.memory))
+
+        VkImageViewCreateInfo imageViewCI = LeoVK::Init::ImageViewCreateInfo();
+        imageViewCI.image = target.image;
+        imageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        imageViewCI.format = format;
+        imageViewCI.subresourceRange = { aspect, 0, 1, 0, 1 };
+        VK_CHECK(vkCreateImageView(mDevice, &imageViewCI, nullptr, &target.imageView))
+    };
+    createTarget(visBuffer.mIDTarget, VK_FORMAT_R32G32_UINT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+    createTarget(visBuffer.mDepthTarget, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    std::array<VkImageView, 2> attachments = { visBuffer.mIDTarget.imageView, visBuffer.mDepthTarget.imageView };
+    VkFramebufferCreateInfo frameBufferCI = LeoVK::Init::FrameBufferCreateInfo();
+    frameBufferCI.renderPass = visBuffer.mRenderPass;
+    frameBufferCI.attachmentCount = static_cast<uint32_t>(attachments.size());
+    frameBufferCI.pAttachments = attachments.data();
+    frameBufferCI.width = mWidth;
+    frameBufferCI.height = mHeight;
+    frameBufferCI.layers = 1;
+    VK_CHECK(vkCreateFramebuffer(mDevice, &frameBufferCI, nullptr, &visBuffer.mFrameBuffer))
+
+    visBuffer.mWidth = mWidth;
+    visBuffer.mHeight = mHeight;
+
+    // 窗口大小变化后更新解析Pass引用的Image View
+    if (visBuffer.mResolveDescSet != VK_NULL_HANDLE)
+    {
+        VkDescriptorImageInfo idDesc = LeoVK::Init::DescImageInfo(visBuffer.mSampler, visBuffer.mIDTarget.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        VkDescriptorImageInfo depthDesc = LeoVK::Init::DescImageInfo(visBuffer.mSampler, visBuffer.mDepthTarget.imageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+        std::vector<VkWriteDescriptorSet> writeDescSets = {
+            LeoVK::Init::WriteDescriptorSet(visBuffer.mResolveDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &idDesc),
+            LeoVK::Init::WriteDescriptorSet(visBuffer.mResolveDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &depthDesc),
+        };
+        vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writeDescSets.size()), writeDescSets.data(), 0, nullptr);
+    }
+}
+
+void VulkanRenderer::SetupVisibilityDescriptors()
+{
+    VisibilityBuffer& visBuffer = mVisibilityBuffer;
+    // 在PrepareVisibilityBuffer之前调用的SetupDescriptors不需要处理
+    if (visBuffer.mResolveDescSetLayout == VK_NULL_HANDLE) return;
+
+    // 属于当前场景的分组，场景切换时随材质的Set一起释放
+    visBuffer.mResolveDescSet = mDescAllocator.Allocate(visBuffer.mResolveDescSetLayout, mSceneDescGroup);
+    visBuffer.mDrawDescSet = mDescAllocator.Allocate(visBuffer.mDrawDescSetLayout, mSceneDescGroup);
+
+    LeoVK::GLTFScene& scene = mScenes.mRenderScene;
+    VkDescriptorImageInfo idDesc = LeoVK::Init::DescImageInfo(visBuffer.mSampler, visBuffer.mIDTarget.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    VkDescriptorImageInfo depthDesc = LeoVK::Init::DescImageInfo(visBuffer.mSampler, visBuffer.mDepthTarget.imageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+    VkDescriptorBufferInfo vertexDesc = { scene.mVertices.mBuffer, 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo indexDesc = { scene.mIndices.mBuffer, 0, VK_WHOLE_SIZE };
+    // 数组中多出的位置用空纹理填满，Shader中不会访问到
+    // 纹理超过数组大小时只写入放得下的部分，此时GetVisibilityFallbackReason会让场景走前向渲染
+    // 没有场景纹理时用BRDF LUT占位，数组中的每个元素都必须是有效的Descriptor
+    const VkDescriptorImageInfo fillerDesc = scene.mTextures.empty() ? mTextures.mLUTBRDF.mDescriptor : scene.mTextures.back().mDescriptor;
+    std::vector<VkDescriptorImageInfo> textureDescs(MAX_VISIBILITY_TEXTURES, fillerDesc);
+    for (size_t i = 0; i < std::min(scene.mTextures.size(), (size_t)MAX_VISIBILITY_TEXTURES); i++)
+    {
+        textureDescs[i] = scene.mTextures[i].mDescriptor;
+    }
+
+    std::vector<VkWriteDescriptorSet> writeDescSets = {
+        LeoVK::Init::WriteDescriptorSet(visBuffer.mResolveDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &idDesc),
+        LeoVK::Init::WriteDescriptorSet(visBuffer.mResolveDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &depthDesc),
+        LeoVK::Init::WriteDescriptorSet(visBuffer.mResolveDescSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &vertexDesc),
+        LeoVK::Init::WriteDescriptorSet(visBuffer.mResolveDescSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &indexDesc),
+        LeoVK::Init::WriteDescriptorSet(visBuffer.mResolveDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, textureDescs.data(), MAX_VISIBILITY_TEXTURES),
+    };
+    if (visBuffer.mDrawBuffer.mBuffer != VK_NULL_HANDLE)
+    {
+        writeDescSets.push_back(LeoVK::Init::WriteDescriptorSet(visBuffer.mDrawDescSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &visBuffer.mDrawBuffer.mDescriptor));
+    }
+    vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writeDescSets.size()), writeDescSets.data(), 0, nullptr);
+}
+
+void VulkanRenderer::UpdateVisibilityDraws()
+{
+    VisibilityBuffer& visBuffer = mVisibilityBuffer;
+    if (visBuffer.mDrawItems.empty()) return;
+
+    const VkDeviceSize bufferSize = visBuffer.mDrawItems.size() * sizeof(VisibilityDraw);
+    if (visBuffer.mDrawBuffer.mSize < bufferSize)
+    {
+        // 按两倍扩容，场景切换时尽量复用；旧Buffer可能还被之前录制的Command Buffer引用，在帧结束后销毁
+        const VkDeviceSize newSize = std::max(bufferSize, visBuffer.mDrawBuffer.mSize * 2);
+        if (visBuffer.mDrawBuffer.mBuffer != VK_NULL_HANDLE) visBuffer.mDrawBuffer.DeferDestroy();
+        VK_CHECK(mpVulkanDevice->CreateBuffer(
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &visBuffer.mDrawBuffer,
+            newSize))
+        VK_CHECK(visBuffer.mDrawBuffer.Map())
+
+        VkWriteDescriptorSet writeDescSet = LeoVK::Init::WriteDescriptorSet(visBuffer.mDrawDescSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &visBuffer.mDrawBuffer.mDescriptor);
+        vkUpdateDescriptorSets(mDevice, 1, &writeDescSet, 0, nullptr);
+    }
+
+    LeoVK::GLTFScene& scene = mScenes.mRenderScene;
+    const int emptyTexture = std::max(0, static_cast<int>(scene.mTextures.size()) - 1);
+    auto getTextureIndex = [&](const LeoVK::Texture* texture)
+    {
+        return texture ? static_cast<int>(texture - scene.mTextures.data()) : emptyTexture;
+    };
+
+    std::vector<VisibilityDraw> draws(visBuffer.mDrawItems.size());
+    for (size_t i = 0; i < visBuffer.mDrawItems.size(); i++)
+    {
+        const LeoVK::Primitive* primitive = visBuffer.mDrawItems[i].mpPrimitive;
+        const LeoVK::Material& material = primitive->mMaterial;
+        VisibilityDraw& draw = draws[i];
+
+        // 与PBRShader.vert相同的模型矩阵，Mesh的Uniform Buffer在GPU上无法按DrawID索引
+        draw.mModel = mSceneUBOMatrices.mModel * visBuffer.mDrawItems[i].mpNode->GetMatrix();
+        draw.mNormal = glm::mat4(glm::transpose(glm::inverse(glm::mat3(draw.mModel))));
+        draw.mFirstIndex = primitive->mbHasIndices ? primitive->mFirstIndex : 0;
+        draw.mMaterialIndex = static_cast<uint32_t>(material.mIndex);
+        draw.mHasIndices = primitive->mbHasIndices ? 1 : 0;
+        draw.mPadding = 0;
+
+        // 纹理选择与SetupDescriptors中的材质Descriptor Set一致
+        int colorTexture = emptyTexture;
+        int physicalDescTexture = emptyTexture;
+        if (material.mPBRWorkFlows.mbMetallicRoughness)
+        {
+            colorTexture = getTextureIndex(material.mpBaseColorTexture);
+            physicalDescTexture = getTextureIndex(material.mpMetallicRoughnessTexture);
+        }
+        if (material.mPBRWorkFlows.mbSpecularGlossiness)
+        {
+            colorTexture = getTextureIndex(material.mExtension.mpDiffuseTexture);
+            physicalDescTexture = getTextureIndex(material.mExtension.mpSpecularGlossinessTexture);
+        }
+        draw.mTextures = glm::ivec4(colorTexture, physicalDescTexture, getTextureIndex(material.mpNormalTexture), getTextureIndex(material.mpOcclusionTexture));
+        draw.mTexturesExt = glm::ivec4(getTextureIndex(material.mpEmissiveTexture), 0, 0, 0);
+    }
+    memcpy(visBuffer.mDrawBuffer.mpMapped, draws.data(), bufferSize);
+}
+
+VkPipeline VulkanRenderer::CreateVisibilityPipeline(bool alphaMask, bool doubleSided)
+{
+    VkPipelineInputAssemblyStateCreateInfo iaStateCI = LeoVK::Init::PipelineIAStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+    VkPipelineRasterizationStateCreateInfo rsStateCI = LeoVK::Init::PipelineRSStateCreateInfo(VK_POLYGON_MODE_FILL, doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+    // 整数格式不能混合
+    VkPipelineColorBlendAttachmentState cbAttachCI = LeoVK::Init::PipelineCBAState(VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT, VK_FALSE);
+    VkPipelineColorBlendStateCreateInfo cbStateCI = LeoVK::Init::PipelineCBStateCreateInfo(1, &cbAttachCI);
+    VkPipelineDepthStencilStateCreateInfo dsStateCI = LeoVK::Init::PipelineDSStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+    VkPipelineViewportStateCreateInfo vpStateCI = LeoVK::Init::PipelineVPStateCreateInfo(1, 1, 0);
+    VkPipelineMultisampleStateCreateInfo msStateCI = LeoVK::Init::PipelineMSStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
+    const std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dyStateCI = LeoVK::Init::PipelineDYStateCreateInfo(dynamicStateEnables.data(), static_cast<uint32_t>(dynamicStateEnables.size()), 0);
+    std::array<VkPipelineShaderStageCreateInfo, 2> ssStateCIs = mPipelineShaders.at("Visibility");
+
+    VkBool32 alphaMaskConst = alphaMask ? VK_TRUE : VK_FALSE;
+    VkSpecializationMapEntry specMapEntry = LeoVK::Init::SpecializationMapEntry(0, 0, sizeof(VkBool32));
+    VkSpecializationInfo specInfo = LeoVK::Init::SpecializationInfo(1, &specMapEntry, sizeof(VkBool32), &alphaMaskConst);
+    ssStateCIs[1].pSpecializationInfo = &specInfo;
+
+    // 几何Pass只需要位置，Alpha Mask还需要纹理坐标
+    const std::vector<VkVertexInputBindingDescription> viBindings = {
+        LeoVK::Init::VIBindingDescription(0, sizeof(LeoVK::Vertex), VK_VERTEX_INPUT_RATE_VERTEX),
+    };
+    const std::vector<VkVertexInputAttributeDescription> viAttributes = {
+        LeoVK::Init::VIAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LeoVK::Vertex, mPos)),
+        LeoVK::Init::VIAttributeDescription(0, 2, VK_FORMAT_R32G32_SFLOAT, offsetof(LeoVK::Vertex, mUV0)),
+        LeoVK::Init::VIAttributeDescription(0, 3, VK_FORMAT_R32G32_SFLOAT, offsetof(LeoVK::Vertex, mUV1)),
+    };
+    VkPipelineVertexInputStateCreateInfo viStateCI = LeoVK::Init::PipelineVIStateCreateInfo(viBindings, viAttributes);
+
+    VkGraphicsPipelineCreateInfo pipelineCI = LeoVK::Init::PipelineCreateInfo(mVisibilityBuffer.mGeometryPipelineLayout, mVisibilityBuffer.mRenderPass, 0);
+    pipelineCI.pVertexInputState = &viStateCI;
+    pipelineCI.pInputAssemblyState = &iaStateCI;
+    pipelineCI.pRasterizationState = &rsStateCI;
+    pipelineCI.pColorBlendState = &cbStateCI;
+    pipelineCI.pMultisampleState = &msStateCI;
+    pipelineCI.pViewportState = &vpStateCI;
+    pipelineCI.pDepthStencilState = &dsStateCI;
+    pipelineCI.pDynamicState = &dyStateCI;
+    pipelineCI.stageCount = static_cast<uint32_t>(ssStateCIs.size());
+    pipelineCI.pStages = ssStateCIs.data();
+
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline))
+    return pipeline;
+}
+
+VkPipeline VulkanRenderer::CreateVisibilityResolvePipeline()
+{
+    VkPipelineInputAssemblyStateCreateInfo iaStateCI = LeoVK::Init::PipelineIAStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+    VkPipelineRasterizationStateCreateInfo rsStateCI = LeoVK::Init::PipelineRSStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+    VkPipelineColorBlendAttachmentState cbAttachCI = LeoVK::Init::PipelineCBAState(VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT, VK_FALSE);
+    VkPipelineColorBlendStateCreateInfo cbStateCI = LeoVK::Init::PipelineCBStateCreateInfo(1, &cbAttachCI);
+    // 深度来自Visibility Buffer，通过gl_FragDepth写入主Pass
+    VkPipelineDepthStencilStateCreateInfo dsStateCI = LeoVK::Init::PipelineDSStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_ALWAYS);
+    VkPipelineViewportStateCreateInfo vpStateCI = LeoVK::Init::PipelineVPStateCreateInfo(1, 1, 0);
+    VkPipelineMultisampleStateCreateInfo msStateCI = LeoVK::Init::PipelineMSStateCreateInfo(mSettings.multiSampling ? mSettings.sampleCount : VK_SAMPLE_COUNT_1_BIT, 0);
+    const std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dyStateCI = LeoVK::Init::PipelineDYStateCreateInfo(dynamicStateEnables.data(), static_cast<uint32_t>(dynamicStateEnables.size()), 0);
+    std::array<VkPipelineShaderStageCreateInfo, 2> ssStateCIs = mPipelineShaders.at("VisibilityResolve");
+    VkPipelineVertexInputStateCreateInfo viStateCI = LeoVK::Init::PipelineVIStateCreateInfo();
+
+    // 解析Pass把顶点Buffer当作float数组读取，布局由LeoVK::Vertex决定
+    static_assert(sizeof(LeoVK::Vertex) % sizeof(float) == 0, "Vertex must be a whole number of floats");
+    const std::array<uint32_t, 6> vertexLayout = {
+        static_cast<uint32_t>(sizeof(LeoVK::Vertex) / sizeof(float)),
+        static_cast<uint32_t>(offsetof(LeoVK::Vertex, mPos) / sizeof(float)),
+        static_cast<uint32_t>(offsetof(LeoVK::Vertex, mNormal) / sizeof(float)),
+        static_cast<uint32_t>(offsetof(LeoVK::Vertex, mUV0) / sizeof(float)),
+        static_cast<uint32_t>(offsetof(LeoVK::Vertex, mUV1) / sizeof(float)),
+        static_cast<uint32_t>(offsetof(LeoVK::Vertex, mTangent) / sizeof(float)),
+    };
+    std::array<VkSpecializationMapEntry, 6> specMapEntries;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(specMapEntries.size()); i++)
+    {
+        specMapEntries[i] = LeoVK::Init::SpecializationMapEntry(i, i * sizeof(uint32_t), sizeof(uint32_t));
+    }
+    VkSpecializationInfo specInfo = LeoVK::Init::SpecializationInfo(static_cast<uint32_t>(specMapEntries.size()), specMapEntries.data(), sizeof(vertexLayout), vertexLayout.data());
+    ssStateCIs[1].pSpecializationInfo = &specInfo;
+
+    VkGraphicsPipelineCreateInfo pipelineCI = LeoVK::Init::PipelineCreateInfo(mVisibilityBuffer.mResolvePipelineLayout, mPostProcess.mRenderPass, 0);
+    pipelineCI.pVertexInputState = &viStateCI;
+    pipelineCI.pInputAssemblyState = &iaStateCI;
+    pipelineCI.pRasterizationState = &rsStateCI;
+    pipelineCI.pColorBlendState = &cbStateCI;
+    pipelineCI.pMultisampleState = &msStateCI;
+    pipelineCI.pViewportState = &vpStateCI;
+    pipelineCI.pDepthStencilState = &dsStateCI;
+    pipelineCI.pDynamicState = &dyStateCI;
+    pipelineCI.stageCount = static_cast<uint32_t>(ssStateCIs.size());
+    pipelineCI.pStages = ssStateCIs.data();
+
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline))
+    return pipeline;
+}
+
+void VulkanRenderer::DrawVisibilityBuffer(uint32_t cbIndex)
+{
+    VisibilityBuffer& visBuffer = mVisibilityBuffer;
+    VkCommandBuffer cmdBuffer = mDrawCmdBuffers[cbIndex];
+
+    VkClearValue clearValues[2];
+    clearValues[0].color.uint32[0] = UINT32_MAX;
+    clearValues[0].color.uint32[1] = UINT32_MAX;
+    clearValues[0].color.uint32[2] = 0;
+    clearValues[0].color.uint32[3] = 0;
+    clearValues[1].depthStencil = { 1.0f, 0 };
+
+    VkRenderPassBeginInfo rpBI = LeoVK::Init::RenderPassBeginInfo();
+    rpBI.renderPass = visBuffer.mRenderPass;
+    rpBI.framebuffer = visBuffer.mFrameBuffer;
+    rpBI.renderArea.offset = { 0, 0 };
+    // 目标按窗口大小分配，动态分辨率时只使用左上角
+    const VkExtent2D renderExtent = GetRenderExtent();
+    rpBI.renderArea.extent = renderExtent;
+    rpBI.clearValueCount = 2;
+    rpBI.pClearValues = clearValues;
+
+    const VkViewport viewport = LeoVK::Init::Viewport((float)renderExtent.width, (float)renderExtent.height, 0.0f, 1.0f);
+    const VkRect2D scissor = LeoVK::Init::Rect2D((int)renderExtent.width, (int)renderExtent.height, 0, 0);
+
+    vkCmdBeginRenderPass(cmdBuffer, &rpBI, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+    VkDeviceSize offsets[1] = { 0 };
+    vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &mScenes.mRenderScene.mVertices.mBuffer, offsets);
+    vkCmdBindIndexBuffer(cmdBuffer, mScenes.mRenderScene.mIndices.mBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    for (uint32_t drawIndex = 0; drawIndex < static_cast<uint32_t>(visBuffer.mDrawItems.size()); drawIndex++)
+    {
+        const LeoVK::Primitive* primitive = visBuffer.mDrawItems[drawIndex].mpPrimitive;
+        const LeoVK::Material& material = primitive->mMaterial;
+
+        std::string pipelineName = "Visibility";
+        if (material.mAlphaMode == LeoVK::Material::ALPHA_MODE_MASK) pipelineName += "_Alpha_Mask";
+        if (material.mbDoubleSided) pipelineName += "_Double_Sided";
+        const VkPipeline pipeline = mPipelines[pipelineName];
+        if (pipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        }
+
+        const std::vector<VkDescriptorSet> descSets = {
+            mDescSets.mObjectDescSet,
+            material.mDescriptorSet,
+            visBuffer.mDrawDescSet,
+            mDescSets.mMaterialParamsDescSet
+        };
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, visBuffer.mGeometryPipelineLayout, 0, static_cast<uint32_t>(descSets.size()), descSets.data(), 0, nullptr);
+        const uint32_t pushConstants[2] = { drawIndex, static_cast<uint32_t>(material.mIndex) };
+        vkCmdPushConstants(cmdBuffer, visBuffer.mGeometryPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), pushConstants);
+        if (primitive->mbHasIndices)
+        {
+            vkCmdDrawIndexed(cmdBuffer, primitive->mIndexCount, 1, primitive->mFirstIndex, 0, 0);
+        }
+        else
+        {
+            vkCmdDraw(cmdBuffer, primitive->mVertexCount, 1, 0, 0);
+        }
+    }
+
+    vkCmdEndRenderPass(cmdBuffer);
+}
+
+void VulkanRenderer::DestroyVisibilityBuffer()
+{
+    VisibilityBuffer& visBuffer = mVisibilityBuffer;
+    if (visBuffer.mWidth != 0)
+    {
+        vkDestroyFramebuffer(mDevice, visBuffer.mFrameBuffer, nullptr);
+        for (RenderTarget* target : { &visBuffer.mIDTarget, &visBuffer.mDepthTarget })
+        {
+            vkDestroyImageView(mDevice, target->imageView, nullptr);
+            vkDestroyImage(mDevice, target->image, nullptr);
+            mpVulkanDevice->FreeImageMemory(target->image);
+        }
+    }
+    if (visBuffer.mDrawBuffer.mBuffer != VK_NULL_HANDLE) visBuffer.mDrawBuffer.Destroy();
+
+    if (visBuffer.mGeometryPipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(mDevice, visBuffer.mGeometryPipelineLayout, nullptr);
+    if (visBuffer.mResolvePipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(mDevice, visBuffer.mResolvePipelineLayout, nullptr);
+
+    if (visBuffer.mRenderPass != VK_NULL_HANDLE) vkDestroyRenderPass(mDevice, visBuffer.mRenderPass, nullptr);
+    mpVulkanDevice->ReleaseSampler(visBuffer.mSampler);
+}
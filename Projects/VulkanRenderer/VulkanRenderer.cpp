@@ -10,23 +10,64 @@ VulkanRenderer::VulkanRenderer() : VKRendererBase(ENABLE_MSAA, ENABLE_VALIDATION
     mCamera.SetPerspective(60.0f, (float)mWidth / (float)mHeight, 0.001f, 256.0f);
     mCamera.SetMovementSpeed(0.5f);
     mCamera.SetRotationSpeed(0.3f);
+
+    mbDepthPrepass = mCmdLineParser.IsSet("depthPrepass");
+    mbVisibilityBuffer = mCmdLineParser.IsSet("visibilityBuffer");
+    // Visibility Buffer不支持MSAA，从命令行开启时以单采样启动
+    if (mbVisibilityBuffer)
+    {
+        mVisibilityBuffer.mForwardSampleCount = mSettings.sampleCount;
+        mSettings.multiSampling = false;
+        mSettings.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+        mUIOverlay.mMSAA = mSettings.sampleCount;
+    }
+    mClusteredLighting.mbClustered = !mCmdLineParser.IsSet("bruteForceLights");
+    if (mCmdLineParser.IsSet("manyLights"))
+    {
+        mSyntheticLightCount = std::clamp(mCmdLineParser.GetValueAsInt("manyLights", 0), 0, MAX_SCENE_LIGHTS);
+    }
+    mShadowMaps.mbCacheStatic = !mCmdLineParser.IsSet("noShadowCache");
+    mbComputeIBL = !mCmdLineParser.IsSet("graphicsIBL");
+    mbIBLCache = !mCmdLineParser.IsSet("noIBLCache");
+    mbCompressTextures = !mCmdLineParser.IsSet("noTextureCompression");
+    mbStreamAssets = mCmdLineParser.IsSet("streamAssets");
+    mbSmoothNormals = mCmdLineParser.IsSet("smoothNormals");
+    mUBOParams.mUseSHIrradiance = mCmdLineParser.IsSet("shIrradiance") ? 1.0f : 0.0f;
+    if (mCmdLineParser.IsSet("dynamicResolution"))
+    {
+        mDynamicResolution.mbEnabled = true;
+        mDynamicResolution.mTargetMs = (float)mCmdLineParser.GetValueAsInt("dynamicResolution", 16);
+    }
 }
 
 VulkanRenderer::~VulkanRenderer()
 {
     if (mDevice)
     {
+        // 取消还在进行的后台加载，已经创建的资源随场景一起销毁
+        if (mpSceneLoad) mpSceneLoad->mProgress.mbCancel = true;
+        mSceneLoadThread.Wait();
+        if (mpSceneLoad)
+        {
+            mpSceneLoad->mScene.Destroy(mDevice);
+            if (mpSceneLoad->mMaterialParamsBuffer.mBuffer != VK_NULL_HANDLE) mpSceneLoad->mMaterialParamsBuffer.Destroy();
+        }
+        mPipelineThreadPool.Wait();
+        CollectPipelines();
         for (auto& pipeline : mPipelines)
         {
             vkDestroyPipeline(mDevice, pipeline.second, nullptr);
         }
+        DestroyVisibilityBuffer();
+        DestroyClusteredLighting();
+        DestroyShadowMaps();
+        DestroyPostProcess();
+        DestroyDynamicResolution();
         
         vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
+        if (mTimestampQueryPool != VK_NULL_HANDLE) vkDestroyQueryPool(mDevice, mTimestampQueryPool, nullptr);
 
-        vkDestroyDescriptorSetLayout(mDevice, mDescSetLayout.mUniformDescSetLayout, nullptr);
-        vkDestroyDescriptorSetLayout(mDevice, mDescSetLayout.mTextureDescSetLayout, nullptr);
-        vkDestroyDescriptorSetLayout(mDevice, mDescSetLayout.mNodeDescSetLayout, nullptr);
-        vkDestroyDescriptorSetLayout(mDevice, mDescSetLayout.mMaterialBufferDescSetLayout, nullptr);
+        mDescAllocator.Destroy();
 
         mUniformBuffers.mObjectUBO.Destroy();
         mUniformBuffers.mParamsUBO.Destroy();
@@ -46,233 +87,188 @@ VulkanRenderer::~VulkanRenderer()
 void VulkanRenderer::GetEnabledFeatures()
 {
     mEnabledFeatures.samplerAnisotropy = mDeviceFeatures.samplerAnisotropy;
+    // 场景纹理在加载时压缩为BC1/BC3
+    mEnabledFeatures.textureCompressionBC = mDeviceFeatures.textureCompressionBC;
+    // 计算着色器生成IBL时按Mip索引存储图像数组
+    mEnabledFeatures.shaderStorageImageArrayDynamicIndexing = mDeviceFeatures.shaderStorageImageArrayDynamicIndexing;
+    if (!mDeviceFeatures.shaderStorageImageArrayDynamicIndexing) mbComputeIBL = false;
+
+    // Visibility Buffer的解析Pass用非一致索引访问场景纹理数组，并采样D32深度
+    if (mDeviceProps.apiVersion >= VK_API_VERSION_1_2)
+    {
+        VkPhysicalDeviceVulkan12Features features12{};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &features12;
+        vkGetPhysicalDeviceFeatures2(mPhysicalDevice, &features2);
+
+        mEnabledFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        mEnabledFeatures12.shaderSampledImageArrayNonUniformIndexing = features12.shaderSampledImageArrayNonUniformIndexing;
+        mpDeviceCreatepNexChain = &mEnabledFeatures12;
+
+        VkFormatProperties depthFormatProps;
+        vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, VK_FORMAT_D32_SFLOAT, &depthFormatProps);
+        mVisibilityBuffer.mbSupported =
+            features12.shaderSampledImageArrayNonUniformIndexing &&
+            (depthFormatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) &&
+            mDeviceProps.limits.maxPerStageDescriptorSamplers >= MAX_VISIBILITY_TEXTURES + 8 &&
+            mDeviceProps.limits.maxPerStageDescriptorSampledImages >= MAX_VISIBILITY_TEXTURES + 8;
+    }
+    if (!mVisibilityBuffer.mbSupported) mbVisibilityBuffer = false;
 }
 
 void VulkanRenderer::SetupDescriptors()
 {
-    uint32_t imageSamplerCount = 3;
-    uint32_t materialCount = 0;
-    uint32_t meshCount = 0;
+    // Layout按Binding签名缓存，Pipeline Layout一直引用同一组句柄
+    std::vector<VkDescriptorSetLayoutBinding> uniformSetLayoutBindings = {
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
+        // 分簇光照：光源、分簇光源列表、分簇参数
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 5),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 6),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 7),
+        // 级联阴影：阴影图、级联矩阵
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 8),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 9),
+    };
+    mDescSetLayout.mUniformDescSetLayout = mDescAllocator.GetLayout(uniformSetLayoutBindings);
+
+    std::vector<VkDescriptorSetLayoutBinding> samplerDescSetLayoutBinding = {
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
+    };
+    mDescSetLayout.mTextureDescSetLayout = mDescAllocator.GetLayout(samplerDescSetLayoutBinding);
 
-    std::vector<LeoVK::GLTFScene*> modelList = {&mScenes.mSkybox, &mScenes.mRenderScene};
-    for (auto & model : modelList)
-    {
-        for (auto& mat : model->mMaterials)
-        {
-            imageSamplerCount += 5;
-            materialCount++;
-        }
-        for (auto& node : model->mLinearNodes)
-        {
-            if (node->mpMesh) meshCount++;
-        }
-    }
-    
-    if (mDescPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(mDevice, mDescPool, nullptr);
-    std::vector<VkDescriptorPoolSize> poolSize = {
-        LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 4 + meshCount),
-        LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageSamplerCount),
-        LeoVK::Init::DescPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1)
+    std::vector<VkDescriptorSetLayoutBinding> nodeDescSetLayoutBinding = {
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0)
+    };
+    mDescSetLayout.mNodeDescSetLayout = mDescAllocator.GetLayout(nodeDescSetLayoutBinding);
+
+    std::vector<VkDescriptorSetLayoutBinding> matDescSetLayoutBinding = {
+        LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
     };
-    const uint32_t maxSetCount = materialCount + meshCount + 2;
-    VkDescriptorPoolCreateInfo descSetPoolCI = LeoVK::Init::DescPoolCreateInfo(poolSize, maxSetCount);
-    VK_CHECK(vkCreateDescriptorPool(mDevice, &descSetPoolCI, nullptr, &mDescPool));
+    mDescSetLayout.mMaterialBufferDescSetLayout = mDescAllocator.GetLayout(matDescSetLayoutBinding);
+
+    // 全局的Set只分配一次，之后场景和环境切换只重写变化的Binding
+    mDescSets.mObjectDescSet = mDescAllocator.Allocate(mDescSetLayout.mUniformDescSetLayout, DESC_GROUP_GLOBAL);
+    mDescSets.mSkyboxDescSet = mDescAllocator.Allocate(mDescSetLayout.mUniformDescSetLayout, DESC_GROUP_GLOBAL);
+    mDescSets.mMaterialParamsDescSet = mDescAllocator.Allocate(mDescSetLayout.mMaterialBufferDescSetLayout, DESC_GROUP_GLOBAL);
 
     // Scene
     {
-        // UniformBuffer的DescSetLayout
-        std::vector<VkDescriptorSetLayoutBinding> uniformSetLayoutBindings = {
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0),
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
-        };
-        VkDescriptorSetLayoutCreateInfo uniformDescSetLayoutCI = LeoVK::Init::DescSetLayoutCreateInfo(uniformSetLayoutBindings);
-        VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &uniformDescSetLayoutCI, nullptr, &mDescSetLayout.mUniformDescSetLayout));
-
-        // 分配Uniform的DescSet
-        VkDescriptorSetAllocateInfo descSetAI = LeoVK::Init::DescSetAllocateInfo(mDescPool, &mDescSetLayout.mUniformDescSetLayout, 1);
-        VK_CHECK(vkAllocateDescriptorSets(mDevice, &descSetAI, &mDescSets.mObjectDescSet));
+        VkDescriptorImageInfo shadowMapDesc = LeoVK::Init::DescImageInfo(mShadowMaps.mSampler, mShadowMaps.mShadowMap.imageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
         std::vector<VkWriteDescriptorSet> objWriteDescSet = {
             LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &mUniformBuffers.mObjectUBO.mDescriptor),
             LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, &mUniformBuffers.mParamsUBO.mDescriptor),
             LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &mTextures.mLUTBRDF.mDescriptor),
-            LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &mTextures.mIrradianceCube.mDescriptor),
-            LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, &mTextures.mPreFilteredCube.mDescriptor)
+            LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &mClusteredLighting.mLightBuffer.mDescriptor),
+            LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6, &mClusteredLighting.mClusterBuffer.mDescriptor),
+            LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 7, &mClusteredLighting.mParamsUBO.mDescriptor),
+            LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 8, &shadowMapDesc),
+            LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 9, &mShadowMaps.mUBO.mDescriptor)
         };
         vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(objWriteDescSet.size()), objWriteDescSet.data(), 0, nullptr);
     }
 
-    // Materials
+    // Skybox
     {
-        // Sampler的DescSetLayout
-        std::vector<VkDescriptorSetLayoutBinding> samplerDescSetLayoutBinding = {
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
+        std::vector<VkWriteDescriptorSet> skyboxWriteDescSet = {
+            LeoVK::Init::WriteDescriptorSet(mDescSets.mSkyboxDescSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &mUniformBuffers.mSkyboxUBO.mDescriptor),
+            LeoVK::Init::WriteDescriptorSet(mDescSets.mSkyboxDescSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, &mUniformBuffers.mParamsUBO.mDescriptor),
         };
-        VkDescriptorSetLayoutCreateInfo samplerDescSetLayoutCI = LeoVK::Init::DescSetLayoutCreateInfo(samplerDescSetLayoutBinding);
-        VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &samplerDescSetLayoutCI, nullptr, &mDescSetLayout.mTextureDescSetLayout));
-
-        // 分配Texture的DescSet
-        for (auto& mat : mScenes.mRenderScene.mMaterials)
-        {
-            const VkDescriptorSetAllocateInfo texDescAI = LeoVK::Init::DescSetAllocateInfo(mDescPool, &mDescSetLayout.mTextureDescSetLayout, 1);
-            VK_CHECK(vkAllocateDescriptorSets(mDevice, &texDescAI, &mat.mDescriptorSet));
-            std::vector<VkDescriptorImageInfo> imageDescs = {
-                mScenes.mRenderScene.mTextures.back().mDescriptor,
-                mScenes.mRenderScene.mTextures.back().mDescriptor,
-                mat.mpNormalTexture ? mat.mpNormalTexture->mDescriptor : mScenes.mRenderScene.mTextures.back().mDescriptor,
-                mat.mpOcclusionTexture ? mat.mpOcclusionTexture->mDescriptor : mScenes.mRenderScene.mTextures.back().mDescriptor,
-                mat.mpEmissiveTexture ? mat.mpEmissiveTexture->mDescriptor : mScenes.mRenderScene.mTextures.back().mDescriptor
-            };
-            if (mat.mPBRWorkFlows.mbMetallicRoughness)
-            {
-                if (mat.mpBaseColorTexture) imageDescs[0] = mat.mpBaseColorTexture->mDescriptor;
-                if (mat.mpMetallicRoughnessTexture) imageDescs[1] = mat.mpMetallicRoughnessTexture->mDescriptor;
-            }
-            if (mat.mPBRWorkFlows.mbSpecularGlossiness)
-            {
-                if (mat.mExtension.mpDiffuseTexture) imageDescs[0] = mat.mExtension.mpDiffuseTexture->mDescriptor;
-                if (mat.mExtension.mpSpecularGlossinessTexture) imageDescs[1] = mat.mExtension.mpSpecularGlossinessTexture->mDescriptor;
-            }
-            std::vector<VkWriteDescriptorSet> texWriteDescSet = {
-                LeoVK::Init::WriteDescriptorSet(mat.mDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescs[0]),
-                LeoVK::Init::WriteDescriptorSet(mat.mDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &imageDescs[1]),
-                LeoVK::Init::WriteDescriptorSet(mat.mDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &imageDescs[2]),
-                LeoVK::Init::WriteDescriptorSet(mat.mDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &imageDescs[3]),
-                LeoVK::Init::WriteDescriptorSet(mat.mDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, &imageDescs[4]),
-            };
-            vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(texWriteDescSet.size()), texWriteDescSet.data(), 0, nullptr);
-        }
+        vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(skyboxWriteDescSet.size()), skyboxWriteDescSet.data(), 0, nullptr);
     }
 
-    // Node Desc Set
+    UpdateEnvironmentDescriptors();
+    SetupSceneDescriptors(mScenes.mRenderScene, mSceneDescGroup);
+    UpdateSceneDescriptors();
+}
+
+/**
+ * 只访问传入的场景和分组，可以在后台加载线程中调用
+ */
+void VulkanRenderer::SetupSceneDescriptors(LeoVK::GLTFScene& scene, uint32_t group)
+{
+    // Materials
+    for (auto& mat : scene.mMaterials)
     {
-        std::vector<VkDescriptorSetLayoutBinding> nodeDescSetLayoutBinding = {
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0)
+        mat.mDescriptorSet = mDescAllocator.Allocate(mDescSetLayout.mTextureDescSetLayout, group);
+        std::vector<VkDescriptorImageInfo> imageDescs = {
+            scene.mTextures.back().mDescriptor,
+            scene.mTextures.back().mDescriptor,
+            mat.mpNormalTexture ? mat.mpNormalTexture->mDescriptor : scene.mTextures.back().mDescriptor,
+            mat.mpOcclusionTexture ? mat.mpOcclusionTexture->mDescriptor : scene.mTextures.back().mDescriptor,
+            mat.mpEmissiveTexture ? mat.mpEmissiveTexture->mDescriptor : scene.mTextures.back().mDescriptor
         };
-        VkDescriptorSetLayoutCreateInfo nodeDescSetLayoutCI = LeoVK::Init::DescSetLayoutCreateInfo(nodeDescSetLayoutBinding);
-        VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &nodeDescSetLayoutCI, nullptr, &mDescSetLayout.mNodeDescSetLayout));
-        for (auto & node : mScenes.mRenderScene.mNodes)
+        if (mat.mPBRWorkFlows.mbMetallicRoughness)
+        {
+            if (mat.mpBaseColorTexture) imageDescs[0] = mat.mpBaseColorTexture->mDescriptor;
+            if (mat.mpMetallicRoughnessTexture) imageDescs[1] = mat.mpMetallicRoughnessTexture->mDescriptor;
+        }
+        if (mat.mPBRWorkFlows.mbSpecularGlossiness)
         {
-            SetupNodeDescriptors(node);
+            if (mat.mExtension.mpDiffuseTexture) imageDescs[0] = mat.mExtension.mpDiffuseTexture->mDescriptor;
+            if (mat.mExtension.mpSpecularGlossinessTexture) imageDescs[1] = mat.mExtension.mpSpecularGlossinessTexture->mDescriptor;
         }
+        std::vector<VkWriteDescriptorSet> texWriteDescSet = {
+            LeoVK::Init::WriteDescriptorSet(mat.mDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescs[0]),
+            LeoVK::Init::WriteDescriptorSet(mat.mDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &imageDescs[1]),
+            LeoVK::Init::WriteDescriptorSet(mat.mDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &imageDescs[2]),
+            LeoVK::Init::WriteDescriptorSet(mat.mDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &imageDescs[3]),
+            LeoVK::Init::WriteDescriptorSet(mat.mDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, &imageDescs[4]),
+        };
+        vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(texWriteDescSet.size()), texWriteDescSet.data(), 0, nullptr);
     }
 
-    // Material Buffer Descriptor
+    // Node Desc Set
+    for (auto & node : scene.mNodes)
     {
-        std::vector<VkDescriptorSetLayoutBinding> matDescSetLayoutBinding = {
-            LeoVK::Init::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
-        };
-        VkDescriptorSetLayoutCreateInfo nodeDescSetLayoutCI = LeoVK::Init::DescSetLayoutCreateInfo(matDescSetLayoutBinding);
-        VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &nodeDescSetLayoutCI, nullptr, &mDescSetLayout.mMaterialBufferDescSetLayout))
-
-        VkDescriptorSetAllocateInfo matDescSetAI = LeoVK::Init::DescSetAllocateInfo(mDescPool, &mDescSetLayout.mMaterialBufferDescSetLayout, 1);
-        VK_CHECK(vkAllocateDescriptorSets(mDevice, &matDescSetAI, &mDescSets.mMaterialParamsDescSet))
-
-        VkWriteDescriptorSet matWriteDescSet = LeoVK::Init::WriteDescriptorSet(mDescSets.mMaterialParamsDescSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &mUniformBuffers.mMaterialParamsBuffer.mDescriptor);
-        vkUpdateDescriptorSets(mDevice, 1, &matWriteDescSet, 0, nullptr);
+        SetupNodeDescriptors(node, group);
     }
+}
 
-    // Skybox
-    {
-        VkDescriptorSetAllocateInfo skyboxDescSetAI = LeoVK::Init::DescSetAllocateInfo(mDescPool, &mDescSetLayout.mUniformDescSetLayout, 1);
-        VK_CHECK(vkAllocateDescriptorSets(mDevice, &skyboxDescSetAI, &mDescSets.mSkyboxDescSet))
+void VulkanRenderer::UpdateSceneDescriptors()
+{
+    // 材质参数Buffer随场景重建，Set本身保持不变
+    VkWriteDescriptorSet matWriteDescSet = LeoVK::Init::WriteDescriptorSet(mDescSets.mMaterialParamsDescSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &mUniformBuffers.mMaterialParamsBuffer.mDescriptor);
+    vkUpdateDescriptorSets(mDevice, 1, &matWriteDescSet, 0, nullptr);
 
-        std::vector<VkWriteDescriptorSet> skyboxWriteDescSet = {
-            LeoVK::Init::WriteDescriptorSet(mDescSets.mSkyboxDescSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &mUniformBuffers.mSkyboxUBO.mDescriptor),
-            LeoVK::Init::WriteDescriptorSet(mDescSets.mSkyboxDescSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, &mUniformBuffers.mParamsUBO.mDescriptor),
-            LeoVK::Init::WriteDescriptorSet(mDescSets.mSkyboxDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &mTextures.mPreFilteredCube.mDescriptor)
-        };
-        vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(skyboxWriteDescSet.size()), skyboxWriteDescSet.data(), 0, nullptr);
-    }
+    SetupVisibilityDescriptors();
+}
+
+void VulkanRenderer::UpdateEnvironmentDescriptors()
+{
+    // 切换环境只替换辐照度和预滤波立方体贴图
+    std::vector<VkWriteDescriptorSet> envWriteDescSet = {
+        LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &mTextures.mIrradianceCube.mDescriptor),
+        LeoVK::Init::WriteDescriptorSet(mDescSets.mObjectDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, &mTextures.mPreFilteredCube.mDescriptor),
+        LeoVK::Init::WriteDescriptorSet(mDescSets.mSkyboxDescSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &mTextures.mPreFilteredCube.mDescriptor)
+    };
+    vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(envWriteDescSet.size()), envWriteDescSet.data(), 0, nullptr);
 }
 
-void VulkanRenderer::SetupNodeDescriptors(LeoVK::Node* node)
+void VulkanRenderer::SetupNodeDescriptors(LeoVK::Node* node, uint32_t group)
 {
     if (node->mpMesh)
     {
-        VkDescriptorSetAllocateInfo descSetAI = LeoVK::Init::DescSetAllocateInfo(mDescPool, &mDescSetLayout.mNodeDescSetLayout, 1);
-        VK_CHECK(vkAllocateDescriptorSets(mDevice, &descSetAI, &node->mpMesh->mUniformBuffer.mDescriptorSet))
+        node->mpMesh->mUniformBuffer.mDescriptorSet = mDescAllocator.Allocate(mDescSetLayout.mNodeDescSetLayout, group);
 
         VkWriteDescriptorSet writeDescSet = LeoVK::Init::WriteDescriptorSet(node->mpMesh->mUniformBuffer.mDescriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &node->mpMesh->mUniformBuffer.mDescriptor);
         vkUpdateDescriptorSets(mDevice, 1, &writeDescSet, 0, nullptr);
     }
     for (auto & child : node->mChildren)
     {
-        SetupNodeDescriptors(child);
+        SetupNodeDescriptors(child, group);
     }
 }
 
-void VulkanRenderer::AddPipelineSet(const std::string prefix, const std::string vertexShader, const std::string pixelShader)
-{
-    VkPipelineInputAssemblyStateCreateInfo iaStateCI = LeoVK::Init::PipelineIAStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
-    VkPipelineRasterizationStateCreateInfo rsStateCI = LeoVK::Init::PipelineRSStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
-    VkPipelineColorBlendAttachmentState cbAttachCI = LeoVK::Init::PipelineCBAState(VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT, VK_FALSE);
-    VkPipelineColorBlendStateCreateInfo cbStateCI = LeoVK::Init::PipelineCBStateCreateInfo(1, &cbAttachCI);
-    VkPipelineDepthStencilStateCreateInfo dsStateCI = LeoVK::Init::PipelineDSStateCreateInfo(prefix == "Skybox" ? VK_FALSE : VK_TRUE, prefix == "Skybox" ? VK_FALSE : VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
-    VkPipelineViewportStateCreateInfo vpStateCI = LeoVK::Init::PipelineVPStateCreateInfo(1, 1, 0);
-    VkPipelineMultisampleStateCreateInfo msStateCI = LeoVK::Init::PipelineMSStateCreateInfo(mSettings.multiSampling ? mSettings.sampleCount : VK_SAMPLE_COUNT_1_BIT, 0);
-    const std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-    VkPipelineDynamicStateCreateInfo dyStateCI = LeoVK::Init::PipelineDYStateCreateInfo(dynamicStateEnables.data(), static_cast<uint32_t>(dynamicStateEnables.size()), 0);
-    std::array<VkPipelineShaderStageCreateInfo, 2> ssStateCIs{};
-
-    const std::vector<VkVertexInputBindingDescription> viBindings = {
-        LeoVK::Init::VIBindingDescription(0, sizeof(LeoVK::Vertex), VK_VERTEX_INPUT_RATE_VERTEX),
-    };
-    const std::vector<VkVertexInputAttributeDescription> viAttributes = {
-        LeoVK::Init::VIAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LeoVK::Vertex, mPos)),
-        LeoVK::Init::VIAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LeoVK::Vertex, mNormal)),
-        LeoVK::Init::VIAttributeDescription(0, 2, VK_FORMAT_R32G32_SFLOAT, offsetof(LeoVK::Vertex, mUV0)),
-        LeoVK::Init::VIAttributeDescription(0, 3, VK_FORMAT_R32G32_SFLOAT, offsetof(LeoVK::Vertex, mUV1)),
-        LeoVK::Init::VIAttributeDescription(0, 4, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mColor)),
-        LeoVK::Init::VIAttributeDescription(0, 5, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mJoint0)),
-        LeoVK::Init::VIAttributeDescription(0, 6, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mWeight0)),
-        LeoVK::Init::VIAttributeDescription(0, 7, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LeoVK::Vertex, mTangent)),
-    };
-    VkPipelineVertexInputStateCreateInfo viStateCI = LeoVK::Init::PipelineVIStateCreateInfo(viBindings, viAttributes);
-
-    VkGraphicsPipelineCreateInfo pipelineCI = LeoVK::Init::PipelineCreateInfo(mPipelineLayout, mRenderPass, 0);
-    pipelineCI.pVertexInputState = &viStateCI;
-    pipelineCI.pInputAssemblyState = &iaStateCI;
-    pipelineCI.pRasterizationState = &rsStateCI;
-    pipelineCI.pColorBlendState = &cbStateCI;
-    pipelineCI.pMultisampleState = &msStateCI;
-    pipelineCI.pViewportState = &vpStateCI;
-    pipelineCI.pDepthStencilState = &dsStateCI;
-    pipelineCI.pDynamicState = &dyStateCI;
-    pipelineCI.stageCount = static_cast<uint32_t>(ssStateCIs.size());
-    pipelineCI.pStages = ssStateCIs.data();
-
-    ssStateCIs[0] = LoadShader(GetShadersPath() + vertexShader, VK_SHADER_STAGE_VERTEX_BIT);
-    ssStateCIs[1] = LoadShader(GetShadersPath() + pixelShader, VK_SHADER_STAGE_FRAGMENT_BIT);
-
-    VkPipeline pipeline;
-    // Default Pipeline
-    VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline))
-    mPipelines[prefix] = pipeline;
-    // Double Sided
-    rsStateCI.cullMode = VK_CULL_MODE_NONE;
-    VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline))
-    mPipelines[prefix + "_Double_Sided"] = pipeline;
-    // Alpha Blending
-    rsStateCI.cullMode = VK_CULL_MODE_NONE;
-    cbAttachCI.blendEnable = VK_TRUE;
-    cbAttachCI.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    cbAttachCI.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    cbAttachCI.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    cbAttachCI.colorBlendOp = VK_BLEND_OP_ADD;
-    cbAttachCI.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    cbAttachCI.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    cbAttachCI.alphaBlendOp = VK_BLEND_OP_ADD;
-    VK_CHECK(vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCI, nullptr, &pipeline))
-    mPipelines[prefix + "_Alpha_Blend"] = pipeline;
-}
-
 void VulkanRenderer::PreparePipelines()
 {
     // 确定pipelineLayout
@@ -285,9 +281,23 @@ void VulkanRenderer::PreparePipelines()
     pipelineLayoutCI.pPushConstantRanges = &pushConstRange;
     VK_CHECK(vkCreatePipelineLayout(mDevice, &pipelineLayoutCI, nullptr, &mPipelineLayout));
 
-    AddPipelineSet("Skybox", "Base/Skybox.vert.spv", "Base/Skybox.frag.spv");
-    AddPipelineSet("PBR", "VulkanRenderer/PBRShader.vert.spv", "VulkanRenderer/PBRShader.frag.spv");
-    AddPipelineSet("Unlit", "VulkanRenderer/PBRShader.vert.spv", "VulkanRenderer/PBRUnlitShader.frag.spv");
+    RegisterPipelineSet("Skybox", "Base/Skybox.vert.spv", "Base/Skybox.frag.spv");
+    RegisterPipelineSet("PBR", "VulkanRenderer/PBRShader.vert.spv", "VulkanRenderer/PBRShader.frag.spv");
+    RegisterPipelineSet("Unlit", "VulkanRenderer/PBRShader.vert.spv", "VulkanRenderer/PBRUnlitShader.frag.spv");
+
+    mPipelineThreadPool.SetThreadCount(std::max(2u, std::thread::hardware_concurrency()) - 1);
+
+    // Skybox和PBR总是创建，其余组合按场景材质在工作线程上并行创建
+    auto tStart = std::chrono::high_resolution_clock::now();
+    RequestPipeline("Skybox", "");
+    RequestPipeline("PBR", "");
+    RequestScenePipelines(true);
+
+    mDepthPrepassShader = LoadShader(GetShadersPath() + "VulkanRenderer/DepthPrepass.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+    mPipelines["DepthPrepass"] = CreateDepthPrepassPipeline(mDepthPrepassShader, false);
+    mPipelines["DepthPrepass_Double_Sided"] = CreateDepthPrepassPipeline(mDepthPrepassShader, true);
+    mPipelineTimings.mPreparePipelines = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    std::cout << "Creating " << mPipelines.size() << " scene pipelines took " << mPipelineTimings.mPreparePipelines << " ms" << std::endl;
 }
 
 void VulkanRenderer::PrepareUniformBuffers()
@@ -314,6 +324,7 @@ void VulkanRenderer::PrepareUniformBuffers()
     VK_CHECK(mUniformBuffers.mObjectUBO.Map())
     VK_CHECK(mUniformBuffers.mSkyboxUBO.Map())
     VK_CHECK(mUniformBuffers.mParamsUBO.Map())
+    PrepareLightBuffers();
     UpdateUniformBuffers();
     UpdateParams();
 }
@@ -342,6 +353,12 @@ void VulkanRenderer::UpdateUniformBuffers()
     );
 
     memcpy(mUniformBuffers.mObjectUBO.mpMapped, &mSceneUBOMatrices, sizeof(mSceneUBOMatrices));
+    // 光源位置同样依赖场景的缩放和平移，分簇参数依赖相机
+    UpdateLights();
+    // 级联范围依赖相机和场景包围盒
+    UpdateShadowCascades();
+    // Visibility Buffer的模型矩阵包含场景的缩放和平移
+    if (IsVisibilityBufferActive()) UpdateVisibilityDraws();
 
     mSkyboxUBOMatrices.mProj = mCamera.mMatrices.mPerspective;
     mSkyboxUBOMatrices.mView = mCamera.mMatrices.mView;
@@ -364,19 +381,29 @@ void VulkanRenderer::UpdateParams()
         cos(glm::radians(lightSource.rotation.x)) * cos(glm::radians(lightSource.rotation.y)),
         0.0f);
     memcpy(mUniformBuffers.mParamsUBO.mpMapped, &mUBOParams, sizeof(mUBOParams));
+    UpdateShadowCascades();
 }
 
 void VulkanRenderer::LoadScene(std::string filename)
 {
     std::cout << "Loading scen from: " << filename << std::endl;
+    // 旧场景的GPU资源在当前帧结束后销毁，空出来的池在那时整块还给驱动
     mScenes.mRenderScene.Destroy(mDevice);
-    mAnimIndex = 0;
-    mAnimTimer = 0.0f;
     auto tStart = std::chrono::high_resolution_clock::now();
-    mScenes.mRenderScene.LoadFromFile(filename, mpVulkanDevice, mQueue);
+    mScenes.mRenderScene.LoadFromFile(filename, mpVulkanDevice, mQueue, GetSceneLoadingFlags());
     mScenes.mRenderScene.LoadMaterialBuffer(mUniformBuffers.mMaterialParamsBuffer, mQueue);
     auto tFileLoad = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
     std::cout << "Loading took " << tFileLoad << " ms" << std::endl;
+    ResetSceneState();
+}
+
+void VulkanRenderer::ResetSceneState()
+{
+    mAnimIndex = 0;
+    mAnimTimer = 0.0f;
+    mPermutationTimings.clear();
+    mVisibilityBuffer.mDrawItems.clear();
+    if (mbMemoryReport) PrintMemoryReport();
     mCamera.SetPosition(glm::vec3(0.0f, 0.0f, -0.5f));
     mCamera.SetRotation({ 0.0f, 0.0f, 0.0f });
 }
@@ -386,12 +413,13 @@ void VulkanRenderer::LoadEnvironment(std::string filename)
     std::cout << "Loading environment from " << filename << std::endl;
     if (mTextures.mEnvCube.mImage) 
     {
-        mTextures.mEnvCube.Destroy();
-        mTextures.mIrradianceCube.Destroy();
-        mTextures.mPreFilteredCube.Destroy();
+        mTextures.mEnvCube.DeferDestroy();
+        mTextures.mIrradianceCube.DeferDestroy();
+        mTextures.mPreFilteredCube.DeferDestroy();
     }
     mTextures.mEnvCube.LoadFromFile(filename, VK_FORMAT_R16G16B16A16_SFLOAT, mpVulkanDevice, mQueue);
-    GenerateCubeMaps();
+    LoadCubeMaps(filename);
+    ProjectEnvironmentSH();
 }
 
 void VulkanRenderer::LoadAssets()
@@ -412,61 +440,159 @@ void VulkanRenderer::LoadAssets()
     LoadEnvironment(GetAssetsPath() + "Environments/papermill.ktx");
 }
 
-void VulkanRenderer::DrawNode(LeoVK::Node* node, uint32_t cbIndex , LeoVK::Material::AlphaMode alphaMode)
+void VulkanRenderer::GatherDrawItems(LeoVK::Node* node, std::vector<DrawItem>& drawItems)
 {
     if (node->mpMesh)
     {
         for (LeoVK::Primitive* primitive : node->mpMesh->mPrimitives)
         {
-            if (primitive->mMaterial.mAlphaMode == alphaMode)
+            const LeoVK::Material& material = primitive->mMaterial;
+            std::string pipelineName, pipelineVariant;
+            uint32_t permutation;
+            GetMaterialPipeline(material, pipelineName, pipelineVariant, permutation);
+
+            // 排序键：Pass | Unlit | Variant | Shader排列 | 材质，半透明物体只按Pass排序以保持原有顺序
+            uint64_t pass = material.mAlphaMode == LeoVK::Material::ALPHA_MODE_BLEND ? 2 : (material.mAlphaMode == LeoVK::Material::ALPHA_MODE_MASK ? 1 : 0);
+            uint64_t sortKey = pass << 60;
+            if (pass != 2)
             {
-                std::string pipelineName = "PBR";
-                std::string pipelineVariant = "";
-
-                if (primitive->mMaterial.mbUnlit)
-                {
-                    pipelineName = "Unlit";
-                }
-                if (alphaMode == LeoVK::Material::ALPHA_MODE_BLEND)
-                {
-                    pipelineVariant = "_Alpha_Blend";
-                }
-                else
-                {
-                    if (primitive->mMaterial.mbDoubleSided)
-                    {
-                        pipelineVariant = "_Double_Sided";
-                    }
-                }
-                const VkPipeline pipeline = mPipelines[pipelineName + pipelineVariant];
-                if (pipeline != mBoundPipeline)
-                {
-                    vkCmdBindPipeline(mDrawCmdBuffers[cbIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-                    mBoundPipeline = pipeline;
-                }
-
-                const std::vector<VkDescriptorSet> descSets = {
-                    mDescSets.mObjectDescSet,
-                    primitive->mMaterial.mDescriptorSet,
-                    node->mpMesh->mUniformBuffer.mDescriptorSet,
-                    mDescSets.mMaterialParamsDescSet
-                };
-                vkCmdBindDescriptorSets(mDrawCmdBuffers[cbIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, static_cast<uint32_t>(descSets.size()), descSets.data(), 0, nullptr);
-                vkCmdPushConstants(mDrawCmdBuffers[cbIndex], mPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &primitive->mMaterial.mIndex);
-                if (primitive->mbHasIndices)
-                {
-                    vkCmdDrawIndexed(mDrawCmdBuffers[cbIndex], primitive->mIndexCount, 1, primitive->mFirstIndex, 0, 0);
-                }
-                else
-                {
-                    vkCmdDraw(mDrawCmdBuffers[cbIndex], primitive->mVertexCount, 1, 0, 0);
-                }
+                uint64_t variantIndex = pipelineVariant.empty() ? 0 : 1;
+                sortKey |= (uint64_t)(material.mbUnlit ? 1 : 0) << 59;
+                sortKey |= variantIndex << 56;
+                sortKey |= (uint64_t)permutation << 24;
+                sortKey |= (uint64_t)(material.mIndex & 0xFFFFFF);
             }
+            drawItems.push_back({ sortKey, node, primitive });
         }
     }
     for (auto child : node->mChildren)
     {
-        DrawNode(child, cbIndex, alphaMode);
+        GatherDrawItems(child, drawItems);
+    }
+}
+
+void VulkanRenderer::DrawItems(const std::vector<DrawItem>& drawItems, uint32_t cbIndex)
+{
+    std::vector<uint32_t>& batches = mTimestampBatches[cbIndex];
+    uint32_t currentPermutation = UINT32_MAX;
+
+    for (auto& drawItem : drawItems)
+    {
+        LeoVK::Primitive* primitive = drawItem.mpPrimitive;
+        LeoVK::Node* node = drawItem.mpNode;
+
+        std::string pipelineName, pipelineVariant;
+        uint32_t permutation;
+        GetMaterialPipeline(primitive->mMaterial, pipelineName, pipelineVariant, permutation);
+
+        // Shader排列切换时写入时间戳，相邻时间戳之差即为该排列的GPU耗时
+        if (mTimestampQueryPool != VK_NULL_HANDLE && permutation != currentPermutation && batches.size() < MAX_TIMESTAMP_BATCHES)
+        {
+            vkCmdWriteTimestamp(mDrawCmdBuffers[cbIndex], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mTimestampQueryPool, cbIndex * (MAX_TIMESTAMP_BATCHES + 1) + static_cast<uint32_t>(batches.size()));
+            batches.push_back(permutation);
+            currentPermutation = permutation;
+        }
+
+        // Pipeline就绪后CollectPipelines会重新录制Command Buffer
+        const VkPipeline pipeline = GetPipeline(pipelineName, pipelineVariant, permutation);
+        if (pipeline == VK_NULL_HANDLE) continue;
+        if (pipeline != mBoundPipeline)
+        {
+            vkCmdBindPipeline(mDrawCmdBuffers[cbIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            mBoundPipeline = pipeline;
+        }
+
+        const std::vector<VkDescriptorSet> descSets = {
+            mDescSets.mObjectDescSet,
+            primitive->mMaterial.mDescriptorSet,
+            node->mpMesh->mUniformBuffer.mDescriptorSet,
+            mDescSets.mMaterialParamsDescSet
+        };
+        vkCmdBindDescriptorSets(mDrawCmdBuffers[cbIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, static_cast<uint32_t>(descSets.size()), descSets.data(), 0, nullptr);
+        vkCmdPushConstants(mDrawCmdBuffers[cbIndex], mPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &primitive->mMaterial.mIndex);
+        if (primitive->mbHasIndices)
+        {
+            vkCmdDrawIndexed(mDrawCmdBuffers[cbIndex], primitive->mIndexCount, 1, primitive->mFirstIndex, 0, 0);
+        }
+        else
+        {
+            vkCmdDraw(mDrawCmdBuffers[cbIndex], primitive->mVertexCount, 1, 0, 0);
+        }
+    }
+
+    if (!batches.empty())
+    {
+        vkCmdWriteTimestamp(mDrawCmdBuffers[cbIndex], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mTimestampQueryPool, cbIndex * (MAX_TIMESTAMP_BATCHES + 1) + static_cast<uint32_t>(batches.size()));
+    }
+}
+
+void VulkanRenderer::DrawDepthPrepass(const std::vector<DrawItem>& drawItems, uint32_t cbIndex)
+{
+    for (auto& drawItem : drawItems)
+    {
+        LeoVK::Primitive* primitive = drawItem.mpPrimitive;
+        // 只有不透明物体参与预渲染，Draw Item已按Pass排序
+        if (primitive->mMaterial.mAlphaMode != LeoVK::Material::ALPHA_MODE_OPAQUE) break;
+
+        const VkPipeline pipeline = mPipelines[primitive->mMaterial.mbDoubleSided ? "DepthPrepass_Double_Sided" : "DepthPrepass"];
+        if (pipeline != mBoundPipeline)
+        {
+            vkCmdBindPipeline(mDrawCmdBuffers[cbIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            mBoundPipeline = pipeline;
+        }
+
+        const std::vector<VkDescriptorSet> descSets = {
+            mDescSets.mObjectDescSet,
+            primitive->mMaterial.mDescriptorSet,
+            drawItem.mpNode->mpMesh->mUniformBuffer.mDescriptorSet,
+            mDescSets.mMaterialParamsDescSet
+        };
+        vkCmdBindDescriptorSets(mDrawCmdBuffers[cbIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, static_cast<uint32_t>(descSets.size()), descSets.data(), 0, nullptr);
+        if (primitive->mbHasIndices)
+        {
+            vkCmdDrawIndexed(mDrawCmdBuffers[cbIndex], primitive->mIndexCount, 1, primitive->mFirstIndex, 0, 0);
+        }
+        else
+        {
+            vkCmdDraw(mDrawCmdBuffers[cbIndex], primitive->mVertexCount, 1, 0, 0);
+        }
+    }
+}
+
+void VulkanRenderer::PrepareTimestampQueries()
+{
+    mTimestampBatches.resize(mDrawCmdBuffers.size());
+    if (!mDeviceProps.limits.timestampComputeAndGraphics) return;
+
+    VkQueryPoolCreateInfo queryPoolCI{};
+    queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCI.queryCount = static_cast<uint32_t>(mDrawCmdBuffers.size()) * (MAX_TIMESTAMP_BATCHES + 1);
+    VK_CHECK(vkCreateQueryPool(mDevice, &queryPoolCI, nullptr, &mTimestampQueryPool))
+}
+
+void VulkanRenderer::ReadTimestampQueries()
+{
+    if (mTimestampQueryPool == VK_NULL_HANDLE) return;
+    const std::vector<uint32_t>& batches = mTimestampBatches[mCurrentBuffer];
+    if (batches.empty()) return;
+
+    std::vector<uint64_t> timestamps(batches.size() + 1);
+    VkResult result = vkGetQueryPoolResults(
+        mDevice, mTimestampQueryPool,
+        mCurrentBuffer * (MAX_TIMESTAMP_BATCHES + 1), static_cast<uint32_t>(timestamps.size()),
+        timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) return;
+
+    std::map<uint32_t, float> frameTimings;
+    for (size_t i = 0; i < batches.size(); i++)
+    {
+        frameTimings[batches[i]] += (float)(timestamps[i + 1] - timestamps[i]) * mDeviceProps.limits.timestampPeriod / 1000000.0f;
+    }
+    for (auto& timing : frameTimings)
+    {
+        auto it = mPermutationTimings.find(timing.first);
+        mPermutationTimings[timing.first] = it == mPermutationTimings.end() ? timing.second : it->second * 0.95f + timing.second * 0.05f;
     }
 }
 
@@ -487,20 +613,77 @@ void VulkanRenderer::BuildCommandBuffers()
         clearValues[1].depthStencil = { 1.0f, 0 };
     }
 
+    // 场景渲染到HDR目标，降低分辨率时只使用左上角，色调映射时再放大到交换链
+    const VkExtent2D renderExtent = GetRenderExtent();
+
     VkRenderPassBeginInfo rpBI = LeoVK::Init::RenderPassBeginInfo();
-    rpBI.renderPass = mRenderPass;
+    rpBI.renderPass = mPostProcess.mRenderPass;
+    rpBI.framebuffer = mPostProcess.mFrameBuffer;
     rpBI.renderArea.offset = {0, 0};
-    rpBI.renderArea.extent = {mWidth, mHeight};
+    rpBI.renderArea.extent = renderExtent;
     rpBI.clearValueCount = mSettings.multiSampling ? 3 : 2;
     rpBI.pClearValues = clearValues;
 
-    const VkViewport viewport = LeoVK::Init::Viewport((float)mWidth, (float)mHeight, 0.0f, 1.0f);
-    const VkRect2D scissor = LeoVK::Init::Rect2D((int)mWidth, (int)mHeight, 0, 0);
+    const VkViewport viewport = LeoVK::Init::Viewport((float)renderExtent.width, (float)renderExtent.height, 0.0f, 1.0f);
+    const VkRect2D scissor = LeoVK::Init::Rect2D((int)renderExtent.width, (int)renderExtent.height, 0, 0);
+
+    std::vector<DrawItem> drawItems;
+    for (auto& node : mScenes.mRenderScene.mNodes)
+    {
+        GatherDrawItems(node, drawItems);
+    }
+    std::stable_sort(drawItems.begin(), drawItems.end(), [](const DrawItem& a, const DrawItem& b) { return a.mSortKey < b.mSortKey; });
+    // 在拆分Visibility Buffer之前收集，阴影包含全部不透明物体
+    GatherShadowItems(drawItems);
+
+    // 开启Visibility Buffer时，不透明和Alpha Mask的静态PBR物体写入Visibility Buffer，其余物体仍然前向绘制
+    const bool bVisibilityBuffer = IsVisibilityBufferActive();
+    const std::string fallbackReason = GetVisibilityFallbackReason();
+    if (mVisibilityBuffer.mFallbackReason != fallbackReason)
+    {
+        mVisibilityBuffer.mFallbackReason = fallbackReason;
+        if (!fallbackReason.empty()) std::cout << "Visibility buffer falls back to forward rendering: " << fallbackReason << std::endl;
+    }
+    mVisibilityBuffer.mDrawItems.clear();
+    if (bVisibilityBuffer)
+    {
+        std::vector<DrawItem> forwardItems;
+        for (auto& drawItem : drawItems)
+        {
+            const LeoVK::Material& material = drawItem.mpPrimitive->mMaterial;
+            if (material.mAlphaMode != LeoVK::Material::ALPHA_MODE_BLEND && !material.mbUnlit && drawItem.mpNode->mpSkin == nullptr)
+            {
+                mVisibilityBuffer.mDrawItems.push_back(drawItem);
+            }
+            else
+            {
+                forwardItems.push_back(drawItem);
+            }
+        }
+        drawItems.swap(forwardItems);
+        SetupVisibilityTargets();
+        UpdateVisibilityDraws();
+    }
 
     for (int i = 0; i < mDrawCmdBuffers.size(); i++)
     {
-        rpBI.framebuffer = mFrameBuffers[i];
         VK_CHECK(vkBeginCommandBuffer(mDrawCmdBuffers[i], &cmdBI))
+        if (mDynamicResolution.mQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdResetQueryPool(mDrawCmdBuffers[i], mDynamicResolution.mQueryPool, i * 2, 2);
+            vkCmdWriteTimestamp(mDrawCmdBuffers[i], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mDynamicResolution.mQueryPool, i * 2);
+        }
+        mTimestampBatches[i].clear();
+        if (mTimestampQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdResetQueryPool(mDrawCmdBuffers[i], mTimestampQueryPool, i * (MAX_TIMESTAMP_BATCHES + 1), MAX_TIMESTAMP_BATCHES + 1);
+        }
+        DispatchLightCulling(i);
+        DrawShadowMaps(i);
+        if (bVisibilityBuffer && !mVisibilityBuffer.mDrawItems.empty())
+        {
+            DrawVisibilityBuffer(i);
+        }
         vkCmdBeginRenderPass(mDrawCmdBuffers[i], &rpBI, VK_SUBPASS_CONTENTS_INLINE);
         vkCmdSetViewport(mDrawCmdBuffers[i], 0, 1, &viewport);
         vkCmdSetScissor(mDrawCmdBuffers[i], 0, 1, &scissor);
@@ -513,26 +696,47 @@ void VulkanRenderer::BuildCommandBuffers()
             mScenes.mSkybox.Draw(mDrawCmdBuffers[i], mPipelineLayout);
         }
 
+        // 全屏解析Visibility Buffer，同时写回深度
+        if (bVisibilityBuffer && !mVisibilityBuffer.mDrawItems.empty())
+        {
+            const std::vector<VkDescriptorSet> resolveDescSets = {
+                mDescSets.mObjectDescSet,
+                mVisibilityBuffer.mResolveDescSet,
+                mVisibilityBuffer.mDrawDescSet,
+                mDescSets.mMaterialParamsDescSet
+            };
+            vkCmdBindDescriptorSets(mDrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, mVisibilityBuffer.mResolvePipelineLayout, 0, static_cast<uint32_t>(resolveDescSets.size()), resolveDescSets.data(), 0, nullptr);
+            vkCmdBindPipeline(mDrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines["VisibilityResolve"]);
+            vkCmdDraw(mDrawCmdBuffers[i], 3, 1, 0, 0);
+        }
+
         vkCmdBindVertexBuffers(mDrawCmdBuffers[i], 0, 1, &mScenes.mRenderScene.mVertices.mBuffer, offsets);
         vkCmdBindIndexBuffer(mDrawCmdBuffers[i], mScenes.mRenderScene.mIndices.mBuffer, 0, VK_INDEX_TYPE_UINT32);
 
         mBoundPipeline = VK_NULL_HANDLE;
-        for (auto& node : mScenes.mRenderScene.mNodes)
+        if (mbDepthPrepass && !bVisibilityBuffer)
         {
-            DrawNode(node, i, LeoVK::Material::ALPHA_MODE_OPAQUE);
-        }
-        for (auto& node : mScenes.mRenderScene.mNodes)
-        {
-            DrawNode(node, i, LeoVK::Material::ALPHA_MODE_MASK);
-        }
-        for (auto& node : mScenes.mRenderScene.mNodes)
-        {
-            DrawNode(node, i, LeoVK::Material::ALPHA_MODE_BLEND);
+            DrawDepthPrepass(drawItems, i);
         }
+        DrawItems(drawItems, i);
+
+        vkCmdEndRenderPass(mDrawCmdBuffers[i]);
+
+        // 每个像素只做一次色调映射，UI保持窗口分辨率直接写入交换链
+        VkRenderPassBeginInfo tonemapBI = rpBI;
+        tonemapBI.renderPass = mRenderPass;
+        tonemapBI.framebuffer = mFrameBuffers[i];
+        tonemapBI.renderArea.extent = {mWidth, mHeight};
+        vkCmdBeginRenderPass(mDrawCmdBuffers[i], &tonemapBI, VK_SUBPASS_CONTENTS_INLINE);
+        DrawTonemap(i);
 
         DrawUI(mDrawCmdBuffers[i]);
 
         vkCmdEndRenderPass(mDrawCmdBuffers[i]);
+        if (mDynamicResolution.mQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdWriteTimestamp(mDrawCmdBuffers[i], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mDynamicResolution.mQueryPool, i * 2 + 1);
+        }
         VK_CHECK(vkEndCommandBuffer(mDrawCmdBuffers[i]))
     }
 }
@@ -541,11 +745,19 @@ void VulkanRenderer::Prepare()
 {
     VKRendererBase::Prepare();
     LoadAssets();
-    GenerateBRDFLUT();
+    LoadBRDFLUT();
     
+    PrepareShadowMaps();
     PrepareUniformBuffers();
+    mDescAllocator.Init(mpVulkanDevice);
     SetupDescriptors();
     PreparePipelines();
+    PrepareShadowPipelines();
+    PreparePostProcess();
+    PrepareDynamicResolution();
+    PrepareVisibilityBuffer();
+    PrepareLightCulling();
+    PrepareTimestampQueries();
     BuildCommandBuffers();
 
     mbPrepared = true;
@@ -553,7 +765,16 @@ void VulkanRenderer::Prepare()
 
 void VulkanRenderer::Render()
 {
+    // 静态阴影缓存需要更新时先录制，在RenderFrame中和这一帧一起提交
+    RecordStaticShadows();
     RenderFrame();
+    ReadTimestampQueries();
+    ReadShadowTimings();
+    UpdateQualityGovernor();
+    // 后台加载完成的场景和编译完成的Pipeline都在帧间替换
+    bool bRebuildCBs = CollectSceneLoad();
+    if (CollectPipelines()) bRebuildCBs = true;
+    if (bRebuildCBs) BuildCommandBuffers();
     if (mCamera.mbUpdated) UpdateUniformBuffers();
     if (mbAnimate && !mScenes.mRenderScene.mAnimations.empty())
     {
@@ -563,9 +784,27 @@ void VulkanRenderer::Render()
             mAnimTimer -= mScenes.mRenderScene.mAnimations[mAnimIndex].mEnd;
         }
         mScenes.mRenderScene.UpdateAnimation(mAnimIndex, mAnimTimer);
+        if (IsVisibilityBufferActive()) UpdateVisibilityDraws();
+        if (!mScenes.mRenderScene.mLights.empty()) UpdateLights();
     }
 }
 
+void VulkanRenderer::RenderFrame()
+{
+    VKRendererBase::PrepareFrame();
+    // 同一次提交中按顺序执行，静态缓存的Render Pass依赖保证帧内的拷贝和采样在它之后
+    std::array<VkCommandBuffer, 2> cmdBuffers = { mShadowMaps.mStaticCmdBuffer, mDrawCmdBuffers[mCurrentBuffer] };
+    const uint32_t firstCmdBuffer = mShadowMaps.mbStaticPending ? 0 : 1;
+    mShadowMaps.mbStaticPending = false;
+    mSubmitInfo.commandBufferCount = static_cast<uint32_t>(cmdBuffers.size()) - firstCmdBuffer;
+    mSubmitInfo.pCommandBuffers = cmdBuffers.data() + firstCmdBuffer;
+    {
+        std::lock_guard<std::mutex> lock(mpVulkanDevice->mQueueMutex);
+        VK_CHECK(vkQueueSubmit(mQueue, 1, &mSubmitInfo, VK_NULL_HANDLE));
+    }
+    VKRendererBase::SubmitFrame();
+}
+
 void VulkanRenderer::ViewChanged()
 {
     UpdateUniformBuffers();
@@ -585,26 +824,25 @@ void VulkanRenderer::OnUpdateUIOverlay(LeoVK::UIOverlay *overlay)
             ZeroMemory(&buffer, sizeof(buffer));
             ZeroMemory(&ofn, sizeof(ofn));
             ofn.lStructSize = sizeof(ofn);
-            ofn.lpstrFilter = "glTF files\0*.gltf;*.glb\0";
+            ofn.lpstrFilter = "glTF files\0*.gltf;*.glb;*.leopkg\0";
             ofn.lpstrFile = buffer;
             ofn.nMaxFile = MAX_PATH;
             ofn.lpstrTitle = "Select a glTF file to load";
             ofn.Flags = OFN_DONTADDTORECENT | OFN_FILEMUSTEXIST | OFN_NOCHANGEDIR;
             if (GetOpenFileNameA(&ofn)) filename = buffer;
-            if (!filename.empty())
-            {
-                vkDeviceWaitIdle(mDevice);
-                LoadScene(filename);
-                SetupDescriptors();
-                bUpdateCBs = true;
-            }
+            if (!filename.empty()) LoadSceneAsync(filename);
+        }
+        if (mpSceneLoad)
+        {
+            overlay->Text("Loading: %.0f%%", mpSceneLoad->mProgress.mProgress * 100.0f);
+            if (!mpSceneLoad->mProgress.mbCancel && overlay->Button("Cancel Loading")) mpSceneLoad->mProgress.mbCancel = true;
         }
 
         if (overlay->ComboBox("Environment", mSelectEnvMap, mEnvMaps))
         {
-            vkDeviceWaitIdle(mDevice);
             LoadEnvironment(mEnvMaps[mSelectEnvMap]);
-            SetupDescriptors();
+            UpdateEnvironmentDescriptors();
+            bUpdateShaderParams = true;
             bUpdateCBs = true;
         }
     }
@@ -625,16 +863,82 @@ void VulkanRenderer::OnUpdateUIOverlay(LeoVK::UIOverlay *overlay)
         }
         if (overlay->SliderFloat("Exposure", &mUBOParams.mExposure, 0.1f, 10.0f))
         {
-            bUpdateShaderParams = true;
+            // 色调映射参数作为Push Constant记录在Command Buffer中
+            bUpdateCBs = true;
         }
         if (overlay->SliderFloat("Gamma", &mUBOParams.mGamma, 0.1f, 4.0f))
         {
-            bUpdateShaderParams = true;
+            bUpdateCBs = true;
         }
         if (overlay->SliderFloat("IBL", &mUBOParams.mScaleIBLAmbient, 0.0f, 10.0f))
         {
             bUpdateShaderParams = true;
         }
+        bool bSHIrradiance = mUBOParams.mUseSHIrradiance > 0.0f;
+        if (overlay->CheckBox("SH Irradiance", &bSHIrradiance))
+        {
+            mUBOParams.mUseSHIrradiance = bSHIrradiance ? 1.0f : 0.0f;
+            bUpdateShaderParams = true;
+        }
+    }
+
+    if (overlay->Header("Lights"))
+    {
+        if (overlay->CheckBox("Clustered Lighting", &mClusteredLighting.mbClustered))
+        {
+            UpdateClusterParams();
+            bUpdateCBs = true;
+        }
+        if (overlay->SliderInt("Synthetic Lights", &mSyntheticLightCount, 0, MAX_SCENE_LIGHTS))
+        {
+            GenerateSyntheticLights(static_cast<uint32_t>(mSyntheticLightCount));
+            UpdateLights();
+        }
+        overlay->Text("Scene lights: %d (%d directional)", (int)mClusteredLighting.mSceneLightCount, (int)mClusteredLighting.mDirectionalCount);
+        overlay->Text("Total lights: %d", (int)mClusteredLighting.mLights.size());
+        overlay->Text("Clusters: %dx%dx%d", CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
+    }
+
+    if (overlay->Header("Shadows"))
+    {
+        // 关闭期间缓存没有更新，重新开启时需要完整渲染一次
+        if (overlay->CheckBox("Shadows", &mShadowMaps.mbEnabled))
+        {
+            UpdateShadowParams();
+            mShadowMaps.mStaticDirtyMask = SHADOW_ALL_CASCADES;
+            bUpdateCBs = true;
+        }
+        if (overlay->CheckBox("Cache Static Cascades", &mShadowMaps.mbCacheStatic))
+        {
+            mShadowMaps.mStaticDirtyMask = SHADOW_ALL_CASCADES;
+            bUpdateCBs = true;
+        }
+        overlay->Text("Casters: %d static, %d dynamic", (int)mShadowMaps.mStaticItems.size(), (int)mShadowMaps.mDynamicItems.size());
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++)
+        {
+            overlay->Text("Cascade %d: %.3f ms/frame, %.3f ms static", i, mShadowMaps.mFrameTimings[i], mShadowMaps.mStaticTimings[i]);
+        }
+        overlay->Text("Static cache updates: %d", (int)mShadowMaps.mStaticUpdates);
+    }
+
+    if (overlay->Header("Dynamic Resolution"))
+    {
+        DynamicResolution& dynRes = mDynamicResolution;
+        if (overlay->CheckBox("Enable", &dynRes.mbEnabled) && !dynRes.mbEnabled)
+        {
+            // 关闭时恢复到完整分辨率和启动时的MSAA
+            // Visibility Buffer开启时保持单采样
+            const VkSampleCountFlagBits maxSampleCount = dynRes.mSampleCounts.empty() ? mSettings.sampleCount : dynRes.mSampleCounts.back();
+            ApplyQualityDecision(1.0f, dynRes.mbAdjustMSAA && !mbVisibilityBuffer ? maxSampleCount : mSettings.sampleCount, "disabled");
+        }
+        overlay->SliderFloat("Target (ms)", &dynRes.mTargetMs, 4.0f, 50.0f);
+        overlay->CheckBox("Adjust MSAA", &dynRes.mbAdjustMSAA);
+        const VkExtent2D renderExtent = GetRenderExtent();
+        overlay->Text("Scale: %.0f%% (%dx%d)", dynRes.mScale * 100.0f, (int)renderExtent.width, (int)renderExtent.height);
+        overlay->Text("MSAA: %dx", (int)mSettings.sampleCount);
+        overlay->Text("GPU frame: %.2f ms", dynRes.mGPUTimeMs);
+        overlay->Text("Decisions: %d", (int)dynRes.mDecisionCount);
+        if (!dynRes.mLastDecision.empty()) overlay->Text("Last: %s", dynRes.mLastDecision.c_str());
     }
 
     if (overlay->Header("Settings")) 
@@ -647,6 +951,37 @@ void VulkanRenderer::OnUpdateUIOverlay(LeoVK::UIOverlay *overlay)
                 overlay->SliderFloat("Animation Speed", &mAnimateSpeed, 0.00001, 10);
             }
         }
+        if (overlay->CheckBox("Depth Prepass", &mbDepthPrepass))
+        {
+            RequestScenePipelines(false);
+            bUpdateCBs = true;
+        }
+        if (mVisibilityBuffer.mbSupported)
+        {
+            if (overlay->CheckBox("Visibility Buffer", &mbVisibilityBuffer))
+            {
+                // 解析Pass只有单采样，开启时切换采样数，关闭时恢复
+                if (mbVisibilityBuffer)
+                {
+                    mVisibilityBuffer.mForwardSampleCount = mSettings.sampleCount;
+                    SetSampleCount(VK_SAMPLE_COUNT_1_BIT);
+                }
+                else
+                {
+                    SetSampleCount(mVisibilityBuffer.mForwardSampleCount);
+                }
+                RequestScenePipelines(false);
+                bUpdateCBs = true;
+            }
+            if (!mVisibilityBuffer.mFallbackReason.empty())
+            {
+                overlay->Text("Forward fallback: %s", mVisibilityBuffer.mFallbackReason.c_str());
+            }
+        }
+        else
+        {
+            overlay->Text("Visibility Buffer: unsupported");
+        }
         const std::vector<std::string> camType = {"LookAt", "FirstPerson"};
         if (overlay->Header("Camera Settings"))
         {
@@ -657,13 +992,78 @@ void VulkanRenderer::OnUpdateUIOverlay(LeoVK::UIOverlay *overlay)
         }
     }
 
-    if (bUpdateShaderParams) UpdateParams();
-    if (bUpdateCBs) 
+    if (overlay->Header("Statistics"))
     {
-        vkDeviceWaitIdle(mDevice);
-        BuildCommandBuffers();
-        vkDeviceWaitIdle(mDevice);
+        overlay->Text("Scene pipelines: %.2f ms", mPipelineTimings.mPreparePipelines);
+        overlay->Text("Pipelines: %d ready, %d compiling", mPipelineTimings.mPipelineCount, (int)mPendingPipelines.size());
+        overlay->Text("Descriptor sets: %d in %d pools", mDescAllocator.mSetCount, mDescAllocator.mPoolCount);
+        overlay->Text("BRDF LUT pipeline: %.2f ms", mPipelineTimings.mBRDFLUT);
+        overlay->Text("Cube map pipelines: %.2f ms", mPipelineTimings.mCubeMaps);
+        if (mDeviceFeatures.shaderStorageImageArrayDynamicIndexing && overlay->CheckBox("Compute IBL", &mbComputeIBL))
+        {
+            LoadEnvironment(mEnvMaps[mSelectEnvMap]);
+            UpdateEnvironmentDescriptors();
+            bUpdateCBs = true;
+        }
+        overlay->Text("IBL generation: %.2f ms graphics, %.2f ms compute", mIBLTimings.mGraphics, mIBLTimings.mCompute);
+        overlay->Text("SH projection: %.2f ms", mIBLTimings.mSH);
+        if (mIBLTimings.mbFromCache) overlay->Text("IBL cache: loaded in %.2f ms", mIBLTimings.mCacheLoad);
+        else overlay->Text("IBL cache: %s", mbIBLCache ? "miss" : "disabled");
+        const LeoVK::TextureStats& texStats = mScenes.mRenderScene.mTextureStats;
+        overlay->Text("Textures: %d (%d BC), %.1f MB, %.2f ms", texStats.mCount, texStats.mCompressedCount, (float)texStats.mMemory / (1024.0f * 1024.0f), texStats.mLoadTime);
+        if (texStats.mPlaceholderCount > 0)
+        {
+            overlay->Text("Placeholder textures: %d (Basis Universal not supported)", texStats.mPlaceholderCount);
+        }
+        overlay->Text("Scene load peak memory: %.1f MB%s", (float)mScenes.mRenderScene.mPeakLoadMemory / (1024.0f * 1024.0f), mbStreamAssets ? " (streamed)" : "");
+        for (uint32_t i = 0; i < (uint32_t)LeoVK::MemoryPool::Count; i++)
+        {
+            LeoVK::MemoryPoolStats poolStats = mpVulkanDevice->GetMemoryPoolStats((LeoVK::MemoryPool)i);
+            overlay->Text("%s pool: %d allocs, %d blocks, %.1f / %.1f MB", LeoVK::VulkanDevice::GetMemoryPoolName((LeoVK::MemoryPool)i),
+                poolStats.mAllocationCount, poolStats.mBlockCount, (float)poolStats.mUsedBytes / (1024.0f * 1024.0f), (float)poolStats.mBlockBytes / (1024.0f * 1024.0f));
+        }
+        const LeoVK::MemoryReport memReport = mpVulkanDevice->GetMemoryReport(3);
+        for (size_t i = 0; i < memReport.mHeaps.size(); i++)
+        {
+            if (!memReport.mHeaps[i].mbDeviceLocal) continue;
+            overlay->Text("VRAM heap %d: %.1f / %.1f MB%s", (int)i, (float)memReport.mHeaps[i].mUsage / (1024.0f * 1024.0f),
+                (float)memReport.mHeaps[i].mBudget / (1024.0f * 1024.0f), memReport.mbBudgetExtension ? "" : " (estimated)");
+        }
+        overlay->Text("Resources: %.1f MB", (float)memReport.mTotalBytes / (1024.0f * 1024.0f));
+        // 类别按用量从大到小排列
+        std::array<uint32_t, (size_t)LeoVK::MemoryCategory::Count> categories;
+        std::iota(categories.begin(), categories.end(), 0u);
+        std::sort(categories.begin(), categories.end(), [&](uint32_t a, uint32_t b) { return memReport.mCategoryBytes[a] > memReport.mCategoryBytes[b]; });
+        for (uint32_t category : categories)
+        {
+            if (memReport.mCategoryCounts[category] == 0) continue;
+            overlay->Text("  %s: %d allocs, %.1f MB", LeoVK::VulkanDevice::GetMemoryCategoryName((LeoVK::MemoryCategory)category),
+                memReport.mCategoryCounts[category], (float)memReport.mCategoryBytes[category] / (1024.0f * 1024.0f));
+        }
+        for (auto& record : memReport.mTopAllocations)
+        {
+            overlay->Text("Largest: %s (%s pool), %.1f MB", LeoVK::VulkanDevice::GetMemoryCategoryName(record.mCategory),
+                LeoVK::VulkanDevice::GetMemoryPoolName(record.mPool), (float)record.mSize / (1024.0f * 1024.0f));
+        }
+        if (overlay->CheckBox("Shader Permutations", &mbUsePermutations))
+        {
+            mPermutationTimings.clear();
+            RequestScenePipelines(false);
+            bUpdateCBs = true;
+        }
+        for (auto& timing : mPermutationTimings)
+        {
+            overlay->Text("Permutation %08X: %.3f ms", timing.first, timing.second);
+        }
+        if (IsVisibilityBufferActive())
+        {
+            overlay->Text("Visibility buffer draws: %d", (int)mVisibilityBuffer.mDrawItems.size());
+        }
     }
+
+    if (bUpdateShaderParams) UpdateParams();
+    // UI在SubmitFrame等待队列空闲之后更新，Command Buffer不在执行中，可以直接重新录制
+    if (bUpdateCBs) BuildCommandBuffers();
 }
 
 void VulkanRenderer::WindowResized()
@@ -674,10 +1074,7 @@ void VulkanRenderer::WindowResized()
 
 void VulkanRenderer::FileDropped(std::string &filename)
 {
-    vkDeviceWaitIdle(mDevice);
-    LoadScene(filename);
-    SetupDescriptors();
-    BuildCommandBuffers();
+    LoadSceneAsync(filename);
 }
 
 VulkanRenderer * testRenderer;
@@ -2,8 +2,13 @@
 
 #include "ProjectPCH.hpp"
 
+#include <mutex>
+#include <unordered_set>
+
 #include "VKRendererBase.hpp"
+#include "VKDescriptorAllocator.hpp"
 #include "Utilities/AssetsLoader.hpp"
+#include "Utilities/ThreadPool.hpp"
 
 #define ENABLE_VALIDATION true
 #define ENABLE_MSAA true
@@ -39,9 +44,21 @@ struct UBOParams
     float mScaleIBLAmbient = 1.0f;
     glm::vec3 mLightColor = glm::vec3(1.0f);
     float mLightIntensity = 10.0f;
+    // L2球谐的漫反射辐照度，已包含余弦卷积
+    glm::vec4 mSHIrradiance[9]{};
+    float mUseSHIrradiance = 0.0f;
 };
 
 typedef std::unordered_map<std::string, VkPipeline> PBRPipelines;
+// 每个Pipeline Set（Skybox、PBR、Unlit）使用的Shader
+typedef std::unordered_map<std::string, std::array<VkPipelineShaderStageCreateInfo, 2>> PipelineShaders;
+
+// 材质Pipeline依赖的Render Pass和采样数，排队时拷贝一份，工作线程不读取会变化的设置
+struct PipelineTarget
+{
+    VkRenderPass            mRenderPass;
+    VkSampleCountFlagBits   mSampleCount;
+};
 
 struct PBRDescSets
 {
@@ -66,6 +83,244 @@ struct DescSetLayouts
     VkDescriptorSetLayout mMaterialBufferDescSetLayout;
 };
 
+// DescriptorAllocator中的分组，加载新场景时只释放场景分组
+enum DescriptorGroup : uint32_t
+{
+    DESC_GROUP_GLOBAL = 0,  // Object、Skybox和材质参数Set，只分配一次
+    DESC_GROUP_SCENE,       // 材质、Mesh和Visibility Buffer的Set，后台加载的场景使用另一个分组
+    DESC_GROUP_SCENE_BACK,
+};
+
+// 后台加载的场景，材质参数Buffer和Descriptor也在加载线程中创建，完成后在帧边界与当前场景交换
+struct SceneLoad
+{
+    std::string             mFilename;
+    LeoVK::GLTFScene        mScene;
+    LeoVK::Buffer           mMaterialParamsBuffer;
+    LeoVK::LoadingProgress  mProgress;
+    uint32_t                mDescGroup = DESC_GROUP_SCENE;
+    double                  mLoadTime = 0.0;
+    bool                    mbSucceeded = false;
+    std::atomic<bool>       mbFinished{ false };    // 加载线程最后写入，之后其它成员才能在渲染线程中访问
+};
+
+// 一次绘制，按mSortKey排序以减少Pipeline切换，排列键位于键的中间位
+struct DrawItem
+{
+    uint64_t            mSortKey;
+    LeoVK::Node*        mpNode;
+    LeoVK::Primitive*   mpPrimitive;
+};
+
+// Visibility Buffer能绑定的场景纹理数量，修改时需要同步VisibilityBuffer.glsl
+// 场景纹理超出时退回前向渲染，原因输出到日志并显示在界面上
+#define MAX_VISIBILITY_TEXTURES 256
+
+// 与VisibilityBuffer.glsl中的VisibilityDraw一致（std430）
+struct VisibilityDraw
+{
+    glm::mat4   mModel;
+    glm::mat4   mNormal;
+    uint32_t    mFirstIndex;
+    uint32_t    mMaterialIndex;
+    uint32_t    mHasIndices;
+    uint32_t    mPadding;
+    glm::ivec4  mTextures;      // BaseColor, PhysicalDesc, Normal, Occlusion
+    glm::ivec4  mTexturesExt;   // Emissive
+};
+
+// Visibility Buffer：几何Pass只写入DrawID和PrimitiveID，全屏Pass再按需读取顶点属性并着色
+// ID只有单采样，选择这条路径时切换到单采样，关闭时恢复之前的MSAA
+struct VisibilityBuffer
+{
+    RenderTarget            mIDTarget{};
+    RenderTarget            mDepthTarget{};
+    uint32_t                mWidth = 0;
+    uint32_t                mHeight = 0;
+    VkSampler               mSampler = VK_NULL_HANDLE;
+    VkRenderPass            mRenderPass = VK_NULL_HANDLE;
+    VkFramebuffer           mFrameBuffer = VK_NULL_HANDLE;
+    VkDescriptorSetLayout   mResolveDescSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout   mDrawDescSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSet         mResolveDescSet = VK_NULL_HANDLE;
+    VkDescriptorSet         mDrawDescSet = VK_NULL_HANDLE;
+    VkPipelineLayout        mGeometryPipelineLayout = VK_NULL_HANDLE;
+    VkPipelineLayout        mResolvePipelineLayout = VK_NULL_HANDLE;
+    LeoVK::Buffer           mDrawBuffer;
+    // 写入Visibility Buffer的绘制，下标即DrawID；半透明、Unlit和蒙皮物体仍走前向渲染
+    std::vector<DrawItem>   mDrawItems;
+    bool                    mbSupported = false;
+    std::string             mFallbackReason;    // 开启但退回前向渲染的原因，变化时输出一次
+    VkSampleCountFlagBits   mForwardSampleCount = VK_SAMPLE_COUNT_1_BIT;   // 开启前的采样数，关闭时恢复
+};
+
+// 分簇光照的参数，修改时需要同步ClusteredLighting.glsl
+#define MAX_SCENE_LIGHTS 4096
+#define MAX_LIGHTS_PER_CLUSTER 128
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+
+// 与ClusteredLighting.glsl中的ShaderLight一致（std430）
+struct ShaderLight
+{
+    glm::vec4 mPosRange;        // 位置(xyz)、作用范围(w)，已变换到渲染空间
+    glm::vec4 mColorIntensity;
+    glm::vec4 mDirType;         // 方向(xyz)、类型(w)
+    glm::vec4 mSpotParams;      // 聚光灯角度衰减的scale和offset
+};
+
+struct UBOCluster
+{
+    glm::mat4   mInvProj;
+    glm::mat4   mView;
+    glm::vec4   mScreenSize;    // 宽、高、1/宽、1/高
+    glm::vec4   mDepthParams;   // 近平面、远平面、深度切片的scale和bias
+    glm::uvec4  mGridSize;
+    glm::uvec4  mLightCounts;   // 光源总数、平行光数量、是否分簇
+};
+
+// 用于压力测试的随机点光源，位置和范围相对场景包围盒
+struct SyntheticLight
+{
+    glm::vec3   mPosition;
+    glm::vec3   mColor;
+    float       mRange;
+};
+
+// 分簇前向光照：每帧用Compute Shader把点光源和聚光灯分配到视锥体分簇中，平行光对所有像素生效
+struct ClusteredLighting
+{
+    LeoVK::Buffer               mLightBuffer;
+    LeoVK::Buffer               mClusterBuffer;
+    LeoVK::Buffer               mParamsUBO;
+    VkDescriptorPool            mDescPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout       mCullDescSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSet             mCullDescSet = VK_NULL_HANDLE;
+    VkPipelineLayout            mCullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline                  mCullPipeline = VK_NULL_HANDLE;
+    UBOCluster                  mParams;
+    std::vector<ShaderLight>    mLights;
+    std::vector<SyntheticLight> mSyntheticLights;
+    uint32_t                    mSceneLightCount = 0;
+    uint32_t                    mDirectionalCount = 0;
+    bool                        mbClustered = true;
+};
+
+// 级联阴影参数，修改时需要同步CascadedShadow.glsl
+#define SHADOW_CASCADE_COUNT 4
+#define SHADOW_MAP_SIZE 2048
+#define SHADOW_ALL_CASCADES ((1u << SHADOW_CASCADE_COUNT) - 1u)
+
+struct UBOShadow
+{
+    glm::mat4 mCascadeViewProj[SHADOW_CASCADE_COUNT];
+    glm::vec4 mSplitDepths;
+    glm::vec4 mParams;          // 是否开启、纹素大小、深度偏移
+};
+
+// 平行光的级联阴影：静态物体渲染到缓存中，只在光源、级联范围或静态内容变化时重新渲染，
+// 每帧把缓存拷贝到阴影图后只绘制动画和蒙皮物体。
+// 级联的投影带余量拟合并对齐到世界网格，相机移出余量之前保持不变，重新拟合时只更新对应的一级
+struct ShadowMaps
+{
+    VkFormat                mFormat = VK_FORMAT_D16_UNORM;
+    RenderTarget            mShadowMap{};       // 着色时采样的阴影图
+    RenderTarget            mStaticCache{};     // 静态物体的缓存
+    std::array<VkImageView, SHADOW_CASCADE_COUNT>   mLayerViews{};
+    std::array<VkImageView, SHADOW_CASCADE_COUNT>   mCacheLayerViews{};
+    std::array<VkFramebuffer, SHADOW_CASCADE_COUNT> mFrameBuffers{};
+    std::array<VkFramebuffer, SHADOW_CASCADE_COUNT> mCacheFrameBuffers{};
+    VkRenderPass            mClearRenderPass = VK_NULL_HANDLE;  // 清空后绘制，结束时可采样
+    VkRenderPass            mCacheRenderPass = VK_NULL_HANDLE;  // 清空后绘制，结束时作为拷贝源
+    VkRenderPass            mLoadRenderPass = VK_NULL_HANDLE;   // 在拷贝的缓存上继续绘制
+    VkSampler               mSampler = VK_NULL_HANDLE;
+    VkPipelineLayout        mPipelineLayout = VK_NULL_HANDLE;
+    LeoVK::Buffer           mUBO;
+    UBOShadow               mUBOData{};
+    // 每个Command Buffer一组，最后一组给静态缓存
+    VkQueryPool             mQueryPool = VK_NULL_HANDLE;
+    std::vector<DrawItem>   mStaticItems;
+    std::vector<DrawItem>   mDynamicItems;
+    std::array<float, SHADOW_CASCADE_COUNT> mStaticTimings{};
+    std::array<float, SHADOW_CASCADE_COUNT> mFrameTimings{};
+    uint32_t                mStaticUpdates = 0;
+    bool                    mbEnabled = true;
+    bool                    mbCacheStatic = true;
+    // 级联的包围球，xyz为中心，w为半径，0表示还没有拟合
+    std::array<glm::vec4, SHADOW_CASCADE_COUNT> mCascadeFits{};
+    glm::vec3               mFitLightDir = glm::vec3(0.0f);
+    std::array<glm::vec3, 8> mFitSceneCorners{};
+    uint32_t                mStaticDirtyMask = SHADOW_ALL_CASCADES;     // 需要重新渲染静态缓存的级联
+    uint32_t                mStaticSubmittedMask = 0;                   // 上一帧提交的级联，用于读取时间戳
+    VkCommandBuffer         mStaticCmdBuffer = VK_NULL_HANDLE;
+    bool                    mbStaticPending = false;                    // mStaticCmdBuffer已录制，随下一帧提交
+};
+
+// 每个Command Buffer记录的时间戳对应的Shader排列
+#define MAX_TIMESTAMP_BATCHES 64
+
+// 动态分辨率的缩放范围和步长
+#define DYNAMIC_RESOLUTION_MIN_SCALE 0.5f
+#define DYNAMIC_RESOLUTION_SCALE_STEP 0.1f
+
+// 场景渲染到HDR目标，在一个全屏Pass中统一做曝光、色调映射和Gamma校正，同时放大到交换链
+struct PostProcess
+{
+    VkFormat                mFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    RenderTarget            mColor{};           // 单采样的HDR场景颜色，MSAA时作为Resolve目标，按窗口大小分配
+    RenderTarget            mMSColor{};         // MSAA时的多采样HDR颜色
+    VkSampleCountFlagBits   mSampleCount = VK_SAMPLE_COUNT_1_BIT;   // mRenderPass创建时的采样数
+    VkRenderPass            mRenderPass = VK_NULL_HANDLE;   // 场景Pipeline都基于这个Render Pass创建
+    VkFramebuffer           mFrameBuffer = VK_NULL_HANDLE;
+    VkSampler               mSampler = VK_NULL_HANDLE;
+    VkDescriptorPool        mDescPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout   mDescSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSet         mDescSet = VK_NULL_HANDLE;
+    VkPipelineLayout        mPipelineLayout = VK_NULL_HANDLE;
+};
+
+// 根据GPU帧时间调整内部渲染分辨率和MSAA，场景只渲染到HDR目标的左上角，在色调映射时放大。
+// 超出预算一段时间后先降低分辨率再降低MSAA，有余量时按相反顺序恢复，调整后冷却一段时间以避免来回振荡
+struct DynamicResolution
+{
+    // 每个Command Buffer的开始和结束时间戳
+    VkQueryPool             mQueryPool = VK_NULL_HANDLE;
+    std::vector<VkSampleCountFlagBits> mSampleCounts;   // 设备支持且不超过启动设置的采样数，从低到高
+    float                   mScale = 1.0f;
+    float                   mTargetMs = 16.6f;
+    float                   mGPUTimeMs = 0.0f;  // 平滑后的GPU帧时间
+    uint32_t                mOverBudgetFrames = 0;
+    uint32_t                mUnderBudgetFrames = 0;
+    uint32_t                mCooldownFrames = 0;
+    uint32_t                mDecisionCount = 0;
+    std::string             mLastDecision;
+    bool                    mbEnabled = false;
+    bool                    mbAdjustMSAA = true;
+};
+
+// 立方体贴图存储图像视图的数量上限，与IBLFilter.glsl一致
+#define MAX_IBL_MIPS 10
+
+// 最近一次生成辐照度和预过滤贴图的总耗时(ms)，用于对比图形管线和计算着色器两条路径
+struct IBLTimings
+{
+    double mGraphics = 0.0;
+    double mCompute = 0.0;
+    double mCacheLoad = 0.0;
+    double mSH = 0.0;
+    bool mbFromCache = false;
+};
+
+// Pipeline创建耗时(ms)，用于对比Pipeline Cache冷/热启动
+struct PipelineTimings
+{
+    double mPreparePipelines = 0.0;
+    double mBRDFLUT = 0.0;
+    double mCubeMaps = 0.0;
+    uint32_t mPipelineCount = 0;
+};
+
 class VulkanRenderer : public VKRendererBase
 {
 public:
@@ -75,14 +330,30 @@ public:
     void BuildCommandBuffers() override;
     void Prepare() override;
     void Render() override;
+    void RenderFrame() override;
     void ViewChanged() override;
     void OnUpdateUIOverlay(LeoVK::UIOverlay* overlay) override;
     void WindowResized() override;
     void FileDropped(std::string &filename) override;
+    void SetupFrameBuffer() override;
+    void SampleCountChanging() override;
+    void SampleCountChanged() override;
 
     void SetupDescriptors();
-    void SetupNodeDescriptors(LeoVK::Node* node);
-    void AddPipelineSet(const std::string prefix, const std::string vertexShader, const std::string pixelShader);
+    void SetupSceneDescriptors(LeoVK::GLTFScene& scene, uint32_t group);
+    void UpdateSceneDescriptors();
+    void UpdateEnvironmentDescriptors();
+    void SetupNodeDescriptors(LeoVK::Node* node, uint32_t group);
+    void RegisterPipelineSet(const std::string& prefix, const std::string& vertexShader, const std::string& pixelShader);
+    static std::string GetPipelineName(const std::string& prefix, const std::string& variant, uint32_t permutation);
+    PipelineTarget GetPipelineTarget() const;
+    VkPipeline CreatePipelineVariant(const std::string& prefix, const std::string& variant, uint32_t permutation, const PipelineTarget& target);
+    VkPipeline CreateDepthPrepassPipeline(const VkPipelineShaderStageCreateInfo& vertexShader, bool doubleSided);
+    void RequestPipeline(const std::string& prefix, const std::string& variant, uint32_t permutation = 0);
+    void RequestScenePipelines(bool wait);
+    bool CollectPipelines();
+    VkPipeline GetPipeline(const std::string& prefix, const std::string& variant, uint32_t permutation = 0);
+    void GetMaterialPipeline(const LeoVK::Material& material, std::string& prefix, std::string& variant, uint32_t& permutation);
     void PreparePipelines();
     void PrepareUniformBuffers();
     void UpdateUniformBuffers();
@@ -90,11 +361,71 @@ public:
 
     void GenerateBRDFLUT();
     void GenerateCubeMaps();
+    void GenerateCubeMapsCompute();
+    uint64_t HashIBLInputs(const std::string& source, const std::vector<std::string>& shaders, const std::string& params);
+    std::string GetIBLCachePath(const std::string& name, const std::string& source, uint64_t hash);
+    bool LoadIBLCache(const std::string& path, VkFormat format, bool bCube, LeoVK::Texture& texture);
+    void SaveIBLCache(const std::string& path, VkFormat format, bool bCube, const LeoVK::Texture& texture);
+    void LoadBRDFLUT();
+    void LoadCubeMaps(const std::string& envFilename);
+    void ProjectEnvironmentSH();
 
     void LoadScene(std::string filename);
+    void LoadSceneAsync(const std::string& filename);
+    bool CollectSceneLoad();
+    uint32_t GetSceneLoadingFlags() const;
+    void ResetSceneState();
     void LoadEnvironment(std::string filename);
     void LoadAssets();
-    void DrawNode(LeoVK::Node* node, uint32_t cbIndex, LeoVK::Material::AlphaMode alphaMode);
+    void GatherDrawItems(LeoVK::Node* node, std::vector<DrawItem>& drawItems);
+    void DrawItems(const std::vector<DrawItem>& drawItems, uint32_t cbIndex);
+    void DrawDepthPrepass(const std::vector<DrawItem>& drawItems, uint32_t cbIndex);
+    void PrepareTimestampQueries();
+    void ReadTimestampQueries();
+
+    std::string GetVisibilityFallbackReason();
+    bool IsVisibilityBufferActive();
+    void PrepareVisibilityBuffer();
+    void SetupVisibilityTargets();
+    void SetupVisibilityDescriptors();
+    void UpdateVisibilityDraws();
+    VkPipeline CreateVisibilityPipeline(bool alphaMask, bool doubleSided);
+    VkPipeline CreateVisibilityResolvePipeline();
+    void DrawVisibilityBuffer(uint32_t cbIndex);
+    void DestroyVisibilityBuffer();
+
+    void PrepareLightBuffers();
+    void PrepareLightCulling();
+    void GenerateSyntheticLights(uint32_t count);
+    void UpdateLights();
+    void UpdateClusterParams();
+    void DispatchLightCulling(uint32_t cbIndex);
+    void DestroyClusteredLighting();
+
+    void PrepareShadowMaps();
+    void PrepareShadowPipelines();
+    VkPipeline CreateShadowPipeline(bool skinned);
+    void UpdateShadowCascades();
+    void UpdateShadowParams();
+    void GatherShadowItems(const std::vector<DrawItem>& drawItems);
+    void DrawShadowItems(VkCommandBuffer cmdBuffer, const std::vector<DrawItem>& drawItems, uint32_t cascade);
+    void RecordStaticShadows();
+    void DrawShadowMaps(uint32_t cbIndex);
+    void ReadShadowTimings();
+    void DestroyShadowMaps();
+
+    void CreateSceneTargets();
+    void SetupSceneTarget();
+    void PreparePostProcess();
+    VkPipeline CreateTonemapPipeline();
+    void DrawTonemap(uint32_t cbIndex);
+    void DestroyPostProcess();
+
+    VkExtent2D GetRenderExtent() const;
+    void PrepareDynamicResolution();
+    void UpdateQualityGovernor();
+    void ApplyQualityDecision(float scale, VkSampleCountFlagBits sampleCount, const std::string& reason);
+    void DestroyDynamicResolution();
 
 public:
 
@@ -106,11 +437,49 @@ public:
     UBOParams mUBOParams;
 
     PBRPipelines mPipelines;
+    PipelineTimings mPipelineTimings;
+    IBLTimings mIBLTimings;
+    bool mbComputeIBL = true;
+    bool mbIBLCache = true;
+    bool mbCompressTextures = true;
+    bool mbStreamAssets = false;
+    bool mbSmoothNormals = false;
+    PipelineShaders mPipelineShaders;
+    // 后台编译的Pipeline，编译完成前使用同一Set的默认Pipeline代替
+    LeoVK::ThreadPool mPipelineThreadPool;
+    uint32_t mNextPipelineThread = 0;
+    std::mutex mPipelineMutex;
+    PBRPipelines mCompiledPipelines;
+    std::unordered_set<std::string> mPendingPipelines;
+    bool mbUsePermutations = true;
+    bool mbDepthPrepass = false;
+    // MSAA变化时重新创建深度预渲染Pipeline
+    VkPipelineShaderStageCreateInfo mDepthPrepassShader{};
+    bool mbVisibilityBuffer = false;
+    VisibilityBuffer mVisibilityBuffer;
+    VkPhysicalDeviceVulkan12Features mEnabledFeatures12{};
+    ClusteredLighting mClusteredLighting;
+    int32_t mSyntheticLightCount = 0;
+    ShadowMaps mShadowMaps;
+    PostProcess mPostProcess;
+    DynamicResolution mDynamicResolution;
+
+    // 按Shader排列统计的GPU耗时
+    VkQueryPool mTimestampQueryPool = VK_NULL_HANDLE;
+    std::vector<std::vector<uint32_t>> mTimestampBatches;
+    std::map<uint32_t, float> mPermutationTimings;
     VkPipeline mBoundPipeline = VK_NULL_HANDLE;
     PBRDescSets mDescSets;
 
     VkPipelineLayout mPipelineLayout;
     DescSetLayouts mDescSetLayout;
+    LeoVK::DescriptorAllocator mDescAllocator;
+    uint32_t mSceneDescGroup = DESC_GROUP_SCENE;
+
+    // 同一时间只有一个后台加载，新的请求排在当前加载取消之后
+    LeoVK::Thread mSceneLoadThread;
+    std::unique_ptr<SceneLoad> mpSceneLoad;
+    std::string mQueuedSceneFile;
 
     int32_t mAnimIndex = 0;
     float mAnimTimer = 0.0f;